@@ -20,7 +20,6 @@ BuildRequires: cmake
 BuildRequires: zip
 # BuildRequires: pkgconfig(dlog)
 BuildRequires: libattr-devel
-BuildRequires: pkgconfig(libprocps)
 BuildRequires: pkgconfig(libsmack)
 BuildRequires: pkgconfig(libcap)
 BuildRequires: pkgconfig(libsystemd-daemon)
@@ -222,6 +221,7 @@ chsmack -a System %{db_test_dir}/.security-manager-test.db-journal
 %dir %attr(711,root,root) %{TZ_SYS_VAR}/security-manager/
 %dir %attr(700,root,root) %{TZ_SYS_VAR}/security-manager/rules
 %dir %attr(700,root,root) %{TZ_SYS_VAR}/security-manager/rules-merged
+%dir %attr(755,root,root) %{TZ_SYS_VAR}/security-manager/groups
 
 %{_libdir}/libsecurity-manager-commons.so.*
 %attr(-,root,root) %{_unitdir}/security-manager.*
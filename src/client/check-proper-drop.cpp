@@ -25,40 +25,135 @@
 #include "check-proper-drop.h"
 #include "smack-labels.h"
 #include "dpl/log/log.h"
-#include "utils.h"
+#include "dpl/errno_string.h"
+#include "filesystem.h"
 
-#include <sys/capability.h>
+#include <fcntl.h>
+#include <unistd.h>
 
-#include <memory>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
 #include <string>
 
 namespace SecurityManager {
 
-CheckProperDrop::~CheckProperDrop()
+namespace {
+
+/* status of a task is ~1.5 KiB, Groups: line being the only unbounded part */
+const size_t STATUS_BUFFER_SIZE = 8192;
+
+const char *findField(const char *buffer, const char *name)
 {
-    for (const auto &thread : m_threads)
-        freeproc(thread);
-    freeproc(m_proc);
+    const char *field = strstr(buffer, name);
+    return field ? field + strlen(name) : nullptr;
 }
 
-void CheckProperDrop::getThreads()
+bool parseIds(const char *buffer, const char *name, unsigned *ids)
+{
+    const char *p = findField(buffer, name);
+    if (!p)
+        return false;
+    for (int i = 0; i < 4; ++i) {
+        char *end;
+        ids[i] = strtoul(p, &end, 10);
+        if (end == p)
+            return false;
+        p = end;
+    }
+    return true;
+}
+
+bool parseCap(const char *buffer, const char *name, uint64_t &cap)
+{
+    const char *p = findField(buffer, name);
+    if (!p)
+        return false;
+    char *end;
+    cap = strtoull(p, &end, 16);
+    return end != p;
+}
+
+std::string capToString(const uint64_t *caps)
+{
+    std::ostringstream os;
+    os << std::hex << std::setfill('0')
+       << "inh=" << std::setw(16) << caps[0]
+       << " prm=" << std::setw(16) << caps[1]
+       << " eff=" << std::setw(16) << caps[2];
+    return os.str();
+}
+
+} // namespace anonymous
+
+bool CheckProperDrop::readTaskCreds(pid_t pid, pid_t tid, TaskCreds &creds)
 {
-    pid_t pid[2] = {m_pid, 0};
-    auto proctabPtr = makeUnique(openproc(PROC_FILLSTATUS | PROC_PID, pid), closeproc);
-    if (!proctabPtr)
-        ThrowMsg(Exception::ProcError, "Unable to open proc interface");
+    std::string path = "/proc/" + std::to_string(pid) + "/task/" + std::to_string(tid) + "/status";
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        if (errno == ENOENT)
+            return false; // task exited in the meantime
+        ThrowMsg(Exception::ProcError, "Unable to open " << path << ": " << GetErrnoString(errno));
+    }
+
+    char stackBuffer[STATUS_BUFFER_SIZE];
+    std::string heapBuffer;
+    const char *buffer = stackBuffer;
+    ssize_t len = TEMP_FAILURE_RETRY(pread(fd, stackBuffer, sizeof(stackBuffer) - 1, 0));
+    if (len == static_cast<ssize_t>(sizeof(stackBuffer) - 1)) {
+        /* huge Groups: line, fall back to reading the rest to the heap */
+        heapBuffer.assign(stackBuffer, len);
+        ssize_t ret;
+        while ((ret = TEMP_FAILURE_RETRY(pread(fd, stackBuffer, sizeof(stackBuffer),
+                                               heapBuffer.size()))) > 0)
+            heapBuffer.append(stackBuffer, ret);
+        if (ret < 0)
+            len = ret;
+        buffer = heapBuffer.c_str();
+    } else if (len >= 0) {
+        stackBuffer[len] = '\0';
+    }
+    int err = errno;
+    close(fd);
+    if (len < 0) {
+        if (err == ESRCH)
+            return false;
+        ThrowMsg(Exception::ProcError, "Unable to read " << path << ": " << GetErrnoString(err));
+    }
 
-    m_proc = readproc(proctabPtr.get(), nullptr);
-    if (!m_proc)
+    creds.tid = tid;
+    const char *groups = findField(buffer, "\nGroups:");
+    if (!parseIds(buffer, "\nUid:", creds.ids + TaskCreds::RUID) ||
+        !parseIds(buffer, "\nGid:", creds.ids + TaskCreds::RGID) ||
+        !parseCap(buffer, "\nCapInh:", creds.caps[TaskCreds::CAP_INH]) ||
+        !parseCap(buffer, "\nCapPrm:", creds.caps[TaskCreds::CAP_PRM]) ||
+        !parseCap(buffer, "\nCapEff:", creds.caps[TaskCreds::CAP_EFF]) ||
+        !groups)
+        ThrowMsg(Exception::ProcError, "Unable to parse " << path);
+
+    groups += strspn(groups, " \t");
+    creds.groups.assign(groups, strcspn(groups, "\n"));
+    return true;
+}
+
+void CheckProperDrop::getThreads()
+{
+    if (!readTaskCreds(m_pid, m_pid, m_proc))
         ThrowMsg(Exception::ProcError,
-            "Unable read process information for " << pid);
-
-    proc_t *thread;
-    while ((thread = readtask(proctabPtr.get(), m_proc, nullptr))) {
-        if (thread->tid != m_pid)
-            m_threads.push_back(thread);
-        else
-            freeproc(thread);
+            "Unable read process information for " << m_pid);
+
+    FS::FileNameVector tasks = FS::getDirsFromDirectory("/proc/" + std::to_string(m_pid) + "/task");
+    m_threads.reserve(tasks.size());
+    for (const auto &task : tasks) {
+        pid_t tid = atoi(task.c_str());
+        if (tid <= 0 || tid == m_pid)
+            continue;
+
+        m_threads.emplace_back();
+        if (!readTaskCreds(m_pid, tid, m_threads.back()))
+            m_threads.pop_back();
     }
 }
 
@@ -70,56 +165,31 @@ bool CheckProperDrop::checkThreads()
     return false;                                                              \
 }
 
-#define CHECK_THREAD_CRED_FIELD(P, T, FIELD) {                                 \
-    int pval = (P)->FIELD, tval = (T)->FIELD;                                  \
-    if (pval != tval)                                                          \
-        REPORT_THREAD_ERROR((T)->tid, #FIELD, pval, tval);                     \
-}
+    static const char *idNames[TaskCreds::ID_COUNT] = {
+        "ruid", "euid", "suid", "fuid", "rgid", "egid", "sgid", "fgid"
+    };
 
     std::string smackProc = SmackLabels::getSmackLabelFromPid(m_pid);
 
-    auto capProcPtr = makeUnique(cap_get_pid(m_pid), cap_free);
-    if (!capProcPtr)
-        ThrowMsg(Exception::CapError,
-            "Unable to get capabilities for " << m_pid);
-
-    auto capProcStrPtr = makeUnique(cap_to_text(capProcPtr.get(), nullptr), cap_free);
-    if (!capProcStrPtr)
-        ThrowMsg(Exception::CapError,
-            "Unable to get capabilities for " << m_pid);
-
     for (const auto &thread : m_threads) {
-        auto capThreadPtr = makeUnique(cap_get_pid(thread->tid), cap_free);
-        if (!capThreadPtr)
-            ThrowMsg(Exception::CapError,
-                "Unable to get capabilities for " << thread->tid);
+        if (memcmp(m_proc.caps, thread.caps, sizeof(m_proc.caps)))
+            REPORT_THREAD_ERROR(thread.tid, "capabilities",
+                capToString(m_proc.caps), capToString(thread.caps));
 
-        if (cap_compare(capProcPtr.get(), capThreadPtr.get())) {
-            auto capStrThreadPtr = makeUnique(cap_to_text(capThreadPtr.get(), nullptr), cap_free);
-            if (!capStrThreadPtr)
-                ThrowMsg(Exception::CapError, "Unable to get capabilities for " << thread->tid);
-
-            REPORT_THREAD_ERROR(thread->tid, "capabilities",
-                capProcStrPtr.get(), capStrThreadPtr.get());
-        }
-
-        std::string smackThread = SmackLabels::getSmackLabelFromPid(thread->tid);
+        std::string smackThread = SmackLabels::getSmackLabelFromPid(thread.tid);
         if (smackProc != smackThread)
-            REPORT_THREAD_ERROR(thread->tid, "Smack label",
+            REPORT_THREAD_ERROR(thread.tid, "Smack label",
                 smackProc, smackThread);
 
-        if (strcmp(m_proc->supgid, thread->supgid))
-            REPORT_THREAD_ERROR(thread->tid, "Supplementary groups",
-                m_proc->supgid, thread->supgid);
-
-            CHECK_THREAD_CRED_FIELD(m_proc, thread, euid);
-            CHECK_THREAD_CRED_FIELD(m_proc, thread, egid);
-            CHECK_THREAD_CRED_FIELD(m_proc, thread, ruid);
-            CHECK_THREAD_CRED_FIELD(m_proc, thread, rgid);
-            CHECK_THREAD_CRED_FIELD(m_proc, thread, suid);
-            CHECK_THREAD_CRED_FIELD(m_proc, thread, sgid);
-            CHECK_THREAD_CRED_FIELD(m_proc, thread, fuid);
-            CHECK_THREAD_CRED_FIELD(m_proc, thread, fgid);
+        if (m_proc.groups != thread.groups)
+            REPORT_THREAD_ERROR(thread.tid, "Supplementary groups",
+                m_proc.groups, thread.groups);
+
+        if (memcmp(m_proc.ids, thread.ids, sizeof(m_proc.ids)))
+            for (int i = 0; i < TaskCreds::ID_COUNT; ++i)
+                if (m_proc.ids[i] != thread.ids[i])
+                    REPORT_THREAD_ERROR(thread.tid, idNames[i],
+                        m_proc.ids[i], thread.ids[i]);
     }
 
     return true;
@@ -57,22 +57,36 @@ struct app_labels_monitor {
     bool fresh;
     std::string user_label_file_path;
     std::string global_label_file_path;
+    std::unique_ptr<PermissibleSet::PermissibleFileReader> global_labels;
+    std::unique_ptr<PermissibleSet::PermissibleFileReader> user_labels;
     app_labels_monitor() : inotify(-1), global_labels_file_watch(-1), user_labels_file_watch(-1),
                            fresh(true) {}
 };
 
-static lib_retcode apply_relabel_list(const std::string &global_label_file,
-        const std::string &user_label_file)
+/*
+ * Read changes of permissible files and apply resulting relabel list.
+ * Only records appended since previous call are parsed and the list is
+ * applied only if it has changed, unless force is set.
+ */
+static lib_retcode apply_relabel_list(app_labels_monitor *monitor, bool global, bool user,
+        bool force)
 {
-    std::vector<std::string> appLabels;
-
     try {
-        PermissibleSet::readLabelsFromPermissibleFile(global_label_file, appLabels);
-        PermissibleSet::readLabelsFromPermissibleFile(user_label_file, appLabels);
-        std::vector<const char*> temp;
+        bool changed = force;
+        if (global)
+            changed |= monitor->global_labels->update();
+        if (user)
+            changed |= monitor->user_labels->update();
+
+        if (!changed) {
+            LogDebug("Relabel list not changed");
+            return SECURITY_MANAGER_SUCCESS;
+        }
 
-        std::transform(appLabels.begin(), appLabels.end(), std::back_inserter(temp),
-                [] (std::string &label) {return label.c_str();});
+        std::vector<const char*> temp;
+        temp.reserve(monitor->global_labels->labels().live() + monitor->user_labels->labels().live());
+        monitor->global_labels->labels().getLabels(temp);
+        monitor->user_labels->labels().getLabels(temp);
 
         if (smack_set_relabel_self(temp.data(), temp.size()) != 0) {
             LogError("smack_set_relabel_self failed");
@@ -81,6 +95,9 @@ static lib_retcode apply_relabel_list(const std::string &global_label_file,
     } catch (PermissibleSet::PermissibleSetException::FileOpenError &e) {
         LogWarning("Invalid state of configuration files - smack_set_relabel_self not called");
         return SECURITY_MANAGER_SUCCESS;
+    } catch (PermissibleSet::PermissibleSetException::FileLockError &e) {
+        LogError("Failed to lock the configuration files");
+        return SECURITY_MANAGER_ERROR_UNKNOWN;
     } catch (PermissibleSet::PermissibleSetException::FileReadError &e) {
         LogError("Failed to read the configuration files");
         return SECURITY_MANAGER_ERROR_UNKNOWN;
@@ -144,6 +161,8 @@ int security_manager_app_labels_monitor_init(app_labels_monitor **monitor)
         }
         monitorPtr->user_label_file_path = userFile;
         monitorPtr->global_label_file_path = globalFile;
+        monitorPtr->global_labels.reset(new PermissibleSet::PermissibleFileReader(globalFile));
+        monitorPtr->user_labels.reset(new PermissibleSet::PermissibleFileReader(userFile));
         *monitor = monitorPtr.release();
         return SECURITY_MANAGER_SUCCESS;
     });
@@ -225,8 +244,7 @@ int security_manager_app_labels_monitor_process(app_labels_monitor *monitor)
 
         if (monitor->fresh) {
             monitor->fresh = false;
-            return apply_relabel_list(monitor->global_label_file_path,
-                   monitor->user_label_file_path);
+            return apply_relabel_list(monitor, true, true, true);
         }
 
         int avail;
@@ -246,24 +264,22 @@ int security_manager_app_labels_monitor_process(app_labels_monitor *monitor)
             pos += ret;
         }
 
+        bool global = false, user = false;
         for (int pos = 0; pos < avail;) {
             struct inotify_event event;
 
             /* Event must be copied to avoid memory alignment issues */
             memcpy(&event, bufPtr.get() + pos, sizeof(struct inotify_event));
             pos += sizeof(struct inotify_event) + event.len;
-            if ((event.mask & IN_CLOSE_WRITE) &&
-                ((event.wd == monitor->global_labels_file_watch) ||
-                 (event.wd == monitor->user_labels_file_watch))
-               ){
-                lib_retcode r = apply_relabel_list(monitor->global_label_file_path,
-                                                   monitor->user_label_file_path);
-                if (r != SECURITY_MANAGER_SUCCESS)
-                    return r;
-                break;
+            if (event.mask & IN_CLOSE_WRITE) {
+                global |= event.wd == monitor->global_labels_file_watch;
+                user |= event.wd == monitor->user_labels_file_watch;
             }
         }
-        return SECURITY_MANAGER_SUCCESS;
+
+        if (!global && !user)
+            return SECURITY_MANAGER_SUCCESS;
+        return apply_relabel_list(monitor, global, user, false);
     });
 }
 
@@ -25,11 +25,14 @@
  * @brief       This file contain client side implementation of security-manager API
  */
 
+#include <cerrno>
 #include <cstdio>
 #include <cstdlib>
 #include <functional>
 #include <fstream>
 #include <memory>
+#include <mutex>
+#include <unordered_map>
 #include <unordered_set>
 #include <utility>
 #include <atomic>
@@ -38,6 +41,7 @@
 
 #include <unistd.h>
 #include <grp.h>
+#include <pthread.h>
 #include <dirent.h>
 #include <fcntl.h>
 #include <sys/types.h>
@@ -57,6 +61,11 @@
 #include <client-request.h>
 #include <service_impl.h>
 #include <check-proper-drop.h>
+#include <thread-sync.h>
+#include <group-generation.h>
+#ifdef CHECK_PROPER_DROP_WITH_PROCPS
+#include <check-proper-drop-procps.h>
+#endif
 #include <utils.h>
 
 #include <security-manager.h>
@@ -81,18 +90,79 @@ static std::map<enum lib_retcode, std::string> lib_retcode_string_map = {
     {SECURITY_MANAGER_ERROR_ACCESS_DENIED, "Insufficient privileges"},
 };
 
+/*
+ * Off-line mode state shared by requests made between
+ * security_manager_offline_session_begin() and _end()
+ */
+struct offline_session {
+    SecurityManager::ClientOffline offlineMode;
+    std::unique_ptr<SecurityManager::ServiceImpl> service;
+
+    offline_session() : offlineMode(false) {}
+};
+
+// guards g_offline_session and its service, which serves one request at a time
+static std::mutex g_offline_session_mutex;
+static offline_session *g_offline_session = nullptr;
+
+/*
+ * Finish a session the process didn't end itself, so deferred files are
+ * written and the service lock is released
+ */
+static void offline_session_at_exit()
+{
+    std::lock_guard<std::mutex> lock(g_offline_session_mutex);
+    delete g_offline_session;
+    g_offline_session = nullptr;
+}
+
+/*
+ * Process request in off-line mode, if it is active. Requests made within
+ * an off-line session reuse its service instance.
+ * Returns false if the request should be sent to the service instead.
+ */
+template <typename F>
+static bool callOffline(int &retval, F &&call)
+{
+    using namespace SecurityManager;
+
+    {
+        std::lock_guard<std::mutex> lock(g_offline_session_mutex);
+        if (g_offline_session) {
+            retval = call(*g_offline_session->service,
+                          g_offline_session->offlineMode.getCredentials());
+            return true;
+        }
+    }
+
+    ClientOffline offlineMode;
+    if (!offlineMode.isOffline())
+        return false;
+
+    ServiceImpl service;
+    retval = call(service, offlineMode.getCredentials());
+    return true;
+}
+
+/*
+ * Everything security_manager_prepare_app() needs from the service,
+ * collected by the launcher before fork
+ */
+struct prepare_app_handle {
+    uid_t uid;                  // policy was checked for this user
+    std::string appName;
+    std::string label;
+    std::vector<gid_t> privilegedGroups;
+    std::vector<gid_t> allowedGroups;
+};
+
 // variables & definitions for thread security attributes
 static std::string g_app_label;
-static std::atomic<int> g_threads_count;
-static std::map<uid_t, std::string> g_tid_attr_current_map;
 static bool g_smack_present;
 static cap_t g_cap;
 
 #define MAX_SIG_WAIT_TIME   1000
 
-// Hackish, based on glibc's definition in sysdeps/unix/sysv/linux/nptl-signals.h
-#define SIGSETXID           (__SIGRTMIN + 1)
-
 SECURITY_MANAGER_API
 const char *security_manager_strerror(enum lib_retcode rc)
 {
@@ -272,22 +342,11 @@ int security_manager_app_install(const app_inst_req *p_req)
             return SECURITY_MANAGER_ERROR_REQ_NOT_COMPLETE;
 
         int retval;
-        ClientOffline offlineMode;
-        if (offlineMode.isOffline()) {
-            Credentials creds = offlineMode.getCredentials();
-            retval = SecurityManager::ServiceImpl().appInstall(creds, app_inst_req(*p_req));
-        } else {
-            retval = ClientRequest(SecurityModuleCall::APP_INSTALL).send(
-                         p_req->appName,
-                         p_req->pkgName,
-                         p_req->privileges,
-                         p_req->appDefinedPrivileges,
-                         p_req->pkgPaths,
-                         p_req->uid,
-                         p_req->tizenVersion,
-                         p_req->authorName,
-                         p_req->installationType,
-                         p_req->isHybrid).getStatus();
+        if (!callOffline(retval, [&](ServiceImpl &service, const Credentials &creds) {
+                return service.appInstall(creds, app_inst_req(*p_req));
+            })) {
+            retval = ClientRequest(SecurityModuleCall::APP_INSTALL).sendFlat(
+                         *p_req).getStatus();
         }
         return retval;
     });
@@ -306,21 +365,11 @@ int security_manager_app_uninstall(const app_inst_req *p_req)
             return SECURITY_MANAGER_ERROR_REQ_NOT_COMPLETE;
 
         int retval;
-        ClientOffline offlineMode;
-        if (offlineMode.isOffline()) {
-            Credentials creds = offlineMode.getCredentials();
-            retval = SecurityManager::ServiceImpl().appUninstall(creds, app_inst_req(*p_req));
-        } else {
-            retval = ClientRequest(SecurityModuleCall::APP_UNINSTALL).send(
-                         p_req->appName,
-                         p_req->pkgName,
-                         p_req->privileges,
-                         p_req->appDefinedPrivileges,
-                         p_req->pkgPaths,
-                         p_req->uid,
-                         p_req->tizenVersion,
-                         p_req->authorName,
-                         p_req->installationType).getStatus();
+        if (!callOffline(retval, [&](ServiceImpl &service, const Credentials &creds) {
+                return service.appUninstall(creds, app_inst_req(*p_req));
+            })) {
+            retval = ClientRequest(SecurityModuleCall::APP_UNINSTALL).sendFlatAs<AppUninstallLayout>(
+                         *p_req).getStatus();
         }
         return retval;
     });
@@ -465,17 +514,102 @@ static int setProcessGroups(const std::vector<gid_t> &groups)
     return SECURITY_MANAGER_SUCCESS;
 }
 
+/*
+ * Per-process cache of privileged group information. Its content is valid
+ * as long as the generation published by the service doesn't change.
+ * Nothing is cached when the generation can't be read.
+ *
+ * The mutex is never held while asking the service or NSS, which may call
+ * back into security-manager. Results are stored only if the generation
+ * didn't change in the meantime.
+ */
+struct GroupCache {
+    std::mutex mutex;
+    bool enabled = false;
+    uint32_t generation = 0;
+
+    bool hasPrivilegedGroups = false;
+    std::vector<gid_t> privilegedGroups;
+    bool hasGroupList = false;
+    std::vector<std::string> groupList;
+    std::unordered_map<std::string, gid_t> gids;
+
+    /* Must be called with mutex held, returns whether caching may be used */
+    bool refresh()
+    {
+        uint32_t current;
+        bool available = SecurityManager::GroupGeneration::read(current);
+        if (!available || !enabled || current != generation) {
+            hasPrivilegedGroups = false;
+            privilegedGroups.clear();
+            hasGroupList = false;
+            groupList.clear();
+            gids.clear();
+        }
+        enabled = available;
+        generation = current;
+        return enabled;
+    }
+
+    /* Must be called with mutex held, returns whether results fetched at given generation may be stored */
+    bool current(uint32_t fetchedGeneration)
+    {
+        return refresh() && generation == fetchedGeneration;
+    }
+};
+
+static GroupCache g_group_cache;
+
+/* Launchers fork from many threads, child must not inherit the mutex locked */
+static int g_group_cache_atfork = pthread_atfork(
+    [] { g_group_cache.mutex.lock(); },
+    [] { g_group_cache.mutex.unlock(); },
+    [] { g_group_cache.mutex.unlock(); });
+
 static int groupNamesToGids(const std::vector<std::string> &groupNames,
     std::vector<gid_t> &groups)
 {
-    groups.reserve(groupNames.size());
-    for (const auto &groupName : groupNames) {
-        struct group *grp = getgrnam(groupName.c_str());
-        if (grp == nullptr) {
-            LogError("No such group: " << groupName);
+    size_t base = groups.size();
+    groups.resize(base + groupNames.size());
+
+    std::vector<size_t> missing;
+    bool cached;
+    uint32_t generation;
+    {
+        std::lock_guard<std::mutex> lock(g_group_cache.mutex);
+        cached = g_group_cache.refresh();
+        generation = g_group_cache.generation;
+        for (size_t i = 0; i < groupNames.size(); ++i) {
+            auto it = cached ? g_group_cache.gids.find(groupNames[i]) : g_group_cache.gids.end();
+            if (it != g_group_cache.gids.end())
+                groups[base + i] = it->second;
+            else
+                missing.push_back(i);
+        }
+    }
+
+    std::vector<char> buffer(4096);
+    for (size_t i : missing) {
+        struct group grpBuff;
+        struct group *grp = nullptr;
+        int ret;
+
+        while (ERANGE == (ret = TEMP_FAILURE_RETRY(getgrnam_r(groupNames[i].c_str(), &grpBuff,
+                buffer.data(), buffer.size(), &grp))))
+            buffer.resize(buffer.size() << 1);
+
+        if (ret != 0 || grp == nullptr) {
+            LogError("No such group: " << groupNames[i]);
             return SECURITY_MANAGER_ERROR_UNKNOWN;
         }
-        groups.push_back(grp->gr_gid);
+        groups[base + i] = grp->gr_gid;
+    }
+
+    if (cached && !missing.empty()) {
+        std::lock_guard<std::mutex> lock(g_group_cache.mutex);
+        if (g_group_cache.current(generation))
+            for (size_t i : missing)
+                g_group_cache.gids.emplace(groupNames[i], groups[base + i]);
     }
 
     return SECURITY_MANAGER_SUCCESS;
@@ -483,6 +617,18 @@ static int groupNamesToGids(const std::vector<std::string> &groupNames,
 
 static int getPrivilegedGroups(std::vector<gid_t> &groups)
 {
+    bool cached;
+    uint32_t generation;
+    {
+        std::lock_guard<std::mutex> lock(g_group_cache.mutex);
+        cached = g_group_cache.refresh();
+        if (cached && g_group_cache.hasPrivilegedGroups) {
+            groups = g_group_cache.privilegedGroups;
+            return SECURITY_MANAGER_SUCCESS;
+        }
+        generation = g_group_cache.generation;
+    }
+
     ClientRequest request(SecurityModuleCall::GROUPS_GET);
     if (request.send().failed()) {
         LogError("Failed to get list of groups from security-manager service.");
@@ -491,7 +637,15 @@ static int getPrivilegedGroups(std::vector<gid_t> &groups)
 
     std::vector<std::string> groupNames;
     request.recv(groupNames);
-    return groupNamesToGids(groupNames, groups);
+    int ret = groupNamesToGids(groupNames, groups);
+    if (ret == SECURITY_MANAGER_SUCCESS && cached) {
+        std::lock_guard<std::mutex> lock(g_group_cache.mutex);
+        if (g_group_cache.current(generation)) {
+            g_group_cache.privilegedGroups = groups;
+            g_group_cache.hasPrivilegedGroups = true;
+        }
+    }
+    return ret;
 }
 
 static int getAppGroups(const std::string appName, std::vector<gid_t> &groups)
@@ -504,118 +658,23 @@ static int getAppGroups(const std::string appName, std::vector<gid_t> &groups)
 
     std::vector<std::string> groupNames;
     request.recv(groupNames);
-    return groupNamesToGids(groupNames, groups);
-}
-
-namespace Syscall {
-
-inline static int gettid()
-{
-    return syscall(SYS_gettid);
-}
-
-inline static int tgkill(int tgid, int tid, int sig)
-{
-    return syscall(SYS_tgkill, tgid, tid, sig);
-}
-
-// reimplement libc sigaction code
-// sigaction structure used in the kernel is not the same as in the libc
-// sysdeps/unix/sysv/linux/kernel_sigaction.h
-// sysdeps/unix/sysv/linux/{i386,x86_64,arm,aarch64}/sigaction.c
-
-#define SA_RESTORER 0x04000000
-
-struct kernel_sigaction {
-    __sighandler_t k_sa_handler;
-    unsigned long sa_flags;
-    void (*sa_restorer)(void);
-    sigset_t sa_mask;
-};
-
-#if __x86_64__
-void restore_rt(void) __asm__("__restore_rt");
-
-#define RESTORE(name, syscall) RESTORE2(name, syscall)
-#define RESTORE2(name, syscall) \
-__asm__ (                                       \
-        "nop\n"                                 \
-        ".text\n"                               \
-        "__" #name ":\n"                        \
-        "        movq $" #syscall ", %rax\n"    \
-        "        syscall\n"                     \
-);
-
-RESTORE(restore_rt, __NR_rt_sigreturn)
-#endif
 
-inline static int sigaction(int signum, const struct sigaction *act, struct sigaction *oldact)
-{
-    int ret;
-    struct kernel_sigaction kact, koldact;
-
-    if (act) {
-        kact.k_sa_handler = act->sa_handler;
-        memcpy(&kact.sa_mask, &act->sa_mask, sizeof(sigset_t));
-#if __x86_64__
-        kact.sa_flags = act->sa_flags | SA_RESTORER;
-        kact.sa_restorer = &restore_rt;
-#else
-        kact.sa_flags = act->sa_flags;
-        kact.sa_restorer = act->sa_restorer;
-#endif
-    }
-
-    ret = syscall(SYS_rt_sigaction, signum, act ? &kact : NULL, oldact ? &koldact : NULL, NSIG / 8);
-
-    if (oldact && ret >= 0) {
-        oldact->sa_handler = koldact.k_sa_handler;
-        memcpy(&oldact->sa_mask, &koldact.sa_mask, sizeof(sigset_t));
-        oldact->sa_flags = koldact.sa_flags;
-        oldact->sa_restorer = koldact.sa_restorer;
-    }
-
-    return ret;
-}
-
-} // namespace Syscall
-
-inline static int label_for_self_internal()
-{
-    int fd;
-    int ret;
-    fd = open(g_tid_attr_current_map[Syscall::gettid()].c_str(), O_WRONLY);
-    if (fd < 0) {
-        return -1;
-    }
-    ret = write(fd, g_app_label.c_str(), g_app_label.length());
-    close(fd);
-
-    if (ret < 0) {
-        return -1;
-    }
-    return 0;
+    return groupNamesToGids(groupNames, groups);
 }
 
-static inline int security_manager_sync_threads_internal(const char *app_name)
+static inline int security_manager_sync_threads_internal(const std::string &app_label)
 {
-    LogDebug("security_manager_sync_threads_internal called for app_name: " << app_name);
+    LogDebug("security_manager_sync_threads_internal called for app_label: " << app_label);
 
-    if (ATOMIC_INT_LOCK_FREE != 2) {
-        LogError("std::atomic<int> is not always lock free");
+    // late handlers of an earlier call may still read the label and capabilities
+    if (ThreadSync::poisoned()) {
+        LogError("Threads of the process were not synchronized before, refusing to continue");
         return SECURITY_MANAGER_ERROR_UNKNOWN;
     }
 
-    FS::FileNameVector files = FS::getDirsFromDirectory("/proc/self/task");
-    uid_t cur_tid = Syscall::gettid();
-    pid_t cur_pid = getpid();
-
-    int ret = fetchLabelForProcess(app_name, g_app_label);
-    if (ret != SECURITY_MANAGER_SUCCESS)
-        return ret;
-    g_threads_count = 0;
-    g_tid_attr_current_map.clear();
+    g_app_label = app_label;
     g_smack_present = smack_check();
+
     g_cap = cap_init();
 
     if (!g_cap) {
@@ -629,69 +688,16 @@ static inline int security_manager_sync_threads_internal(const char *app_name)
         return SECURITY_MANAGER_ERROR_UNKNOWN;
     }
 
-    struct sigaction act;
-    struct sigaction old;
-    memset(&act, '\0', sizeof(act));
-    memset(&old, '\0', sizeof(old));
-
-    sigemptyset(&act.sa_mask);
-    act.sa_flags = SA_RESTART;
-    act.sa_handler = [](int signo) {
-        (void)signo;
-
-        std::atomic_thread_fence(std::memory_order_acquire);
-
-        if (g_smack_present)
-            if (label_for_self_internal() != 0)
-                return;
+    int ret = ThreadSync::runOnOtherThreads([](int attrFd) -> bool {
+        if (g_smack_present && write(attrFd, g_app_label.c_str(), g_app_label.length()) < 0)
+            return false;
+        return !cap_set_proc(g_cap);
+    }, g_smack_present, MAX_SIG_WAIT_TIME);
 
-        if (cap_set_proc(g_cap))
-            return;
-
-        g_threads_count++;
-    };
-
-    if (Syscall::sigaction(SIGSETXID, &act, &old) < 0) {
-        LogError("Error in sigaction()");
-        cap_free(g_cap);
-        return SECURITY_MANAGER_ERROR_UNKNOWN;
-    }
-
-    int sent_signals_count = 0;
-
-    for (auto const &e : files) {
-        if (e.compare(".") == 0 || e.compare("..") == 0)
-            continue;
-
-        int tid = atoi(e.c_str());
-        if (tid == static_cast<int>(cur_tid))
-            continue;
-
-        g_tid_attr_current_map[tid] = "/proc/self/task/" + std::to_string(tid) + "/attr/current";
-    }
-
-    std::atomic_thread_fence(std::memory_order_release);
-
-    for (auto const& t_pair : g_tid_attr_current_map) {
-        if (Syscall::tgkill(cur_pid, t_pair.first, SIGSETXID) < 0) {
-            LogWarning("Error in tgkill()");
-            continue;
-        }
-
-        sent_signals_count++;
-    }
-
-    LogDebug("sent_signals_count: " << sent_signals_count);
-
-    for (int i = 0; g_threads_count != sent_signals_count && i < MAX_SIG_WAIT_TIME; ++i)
-        usleep(1000);   // 1 ms
-
-    Syscall::sigaction(SIGSETXID, &old, nullptr);
-
-    if (g_threads_count != sent_signals_count) {
-        LogError("Not all threads synchronized: threads done: " << g_threads_count);
-        cap_free(g_cap);
-        return SECURITY_MANAGER_ERROR_UNKNOWN;
+    if (ret != SECURITY_MANAGER_SUCCESS) {
+        if (!ThreadSync::poisoned())
+            cap_free(g_cap);
+        return ret;
     }
 
     if (g_smack_present && smack_set_label_for_self(g_app_label.c_str()) != 0) {
@@ -711,6 +717,28 @@ static inline int security_manager_sync_threads_internal(const char *app_name)
     return SECURITY_MANAGER_SUCCESS;
 }
 
+static int applyProcessGroups(const std::vector<gid_t> &privilegedGroups,
+    const std::vector<gid_t> &allowedGroups)
+{
+    std::vector<gid_t> currentGroups;
+    int ret = getProcessGroups(currentGroups);
+    if (ret != SECURITY_MANAGER_SUCCESS)
+        return ret;
+    LogDebug("Current supplementary groups count: " << currentGroups.size());
+
+    std::unordered_set<gid_t> groupsSet(currentGroups.begin(), currentGroups.end());
+    // Remove all groups that are mapped to privileges, so if app is not granted
+    // the privilege, the group will be dropped from current process
+    for (gid_t group : privilegedGroups)
+        groupsSet.erase(group);
+
+    // Re-add those privileged groups that an app is entitled to
+    groupsSet.insert(allowedGroups.begin(), allowedGroups.end());
+    LogDebug("Final supplementary groups count: " << groupsSet.size());
+
+    return setProcessGroups(std::vector<gid_t>(groupsSet.begin(), groupsSet.end()));
+}
+
 SECURITY_MANAGER_API
 int security_manager_set_process_groups_from_appid(const char *app_name)
 {
@@ -727,12 +755,6 @@ int security_manager_set_process_groups_from_appid(const char *app_name)
             return SECURITY_MANAGER_ERROR_INPUT_PARAM;
         }
 
-        std::vector<gid_t> currentGroups;
-        ret = getProcessGroups(currentGroups);
-        if (ret != SECURITY_MANAGER_SUCCESS)
-            return ret;
-        LogDebug("Current supplementary groups count: " << currentGroups.size());
-
         std::vector<gid_t> privilegedGroups;
         ret = getPrivilegedGroups(privilegedGroups);
         if (ret != SECURITY_MANAGER_SUCCESS)
@@ -745,17 +767,7 @@ int security_manager_set_process_groups_from_appid(const char *app_name)
             return ret;
         LogDebug("Allowed privileged supplementary groups count: " << allowedGroups.size());
 
-        std::unordered_set<gid_t> groupsSet(currentGroups.begin(), currentGroups.end());
-        // Remove all groups that are mapped to privileges, so if app is not granted
-        // the privilege, the group will be dropped from current process
-        for (gid_t group : privilegedGroups)
-            groupsSet.erase(group);
-
-        // Re-add those privileged groups that an app is entitled to
-        groupsSet.insert(allowedGroups.begin(), allowedGroups.end());
-        LogDebug("Final supplementary groups count: " << groupsSet.size());
-
-        return setProcessGroups(std::vector<gid_t>(groupsSet.begin(), groupsSet.end()));
+        return applyProcessGroups(privilegedGroups, allowedGroups);
     });
 }
 
@@ -789,6 +801,37 @@ int security_manager_drop_process_privileges(void)
     return SECURITY_MANAGER_SUCCESS;
 }
 
+/*
+ * Set Smack label and drop capabilities of all threads of the process,
+ * then verify that no thread was left behind.
+ */
+static int dropProcessPrivileges(const char *app_name, const std::string &appLabel)
+{
+    int ret = security_manager_sync_threads_internal(appLabel);
+    if (ret != SECURITY_MANAGER_SUCCESS) {
+        LogError("Can't properly setup application threads (Smack label & capabilities) for application " << app_name);
+        return ret;
+    }
+
+    try {
+#ifdef CHECK_PROPER_DROP_WITH_PROCPS
+        CheckProperDropProcps cpd;
+#else
+        CheckProperDrop cpd;
+#endif
+        cpd.getThreads();
+        if (!cpd.checkThreads()) {
+            LogError("Privileges haven't been properly dropped for the whole process of application " << app_name);
+            return ret;
+        }
+    } catch (const SecurityManager::Exception &e) {
+        LogError("Error while checking privileges of the process for application " << app_name << ": " << e.DumpToString());
+        return ret;
+    }
+
+    return ret;
+}
+
 SECURITY_MANAGER_API
 int security_manager_prepare_app(const char *app_name)
 {
@@ -808,28 +851,83 @@ int security_manager_prepare_app(const char *app_name)
             return ret;
         }
 
-        ret = security_manager_sync_threads_internal(app_name);
-        if (ret != SECURITY_MANAGER_SUCCESS) {
-            LogError("Can't properly setup application threads (Smack label & capabilities) for application " << app_name);
+        std::string appLabel;
+        ret = fetchLabelForProcess(app_name, appLabel);
+        if (ret != SECURITY_MANAGER_SUCCESS)
+            return ret;
+
+        return dropProcessPrivileges(app_name, appLabel);
+    });
+}
+
+SECURITY_MANAGER_API
+int security_manager_prepare_app_prefetch(const char *app_name, prepare_app_handle **handle)
+{
+    using namespace SecurityManager;
+
+    LogDebug("security_manager_prepare_app_prefetch() called");
+
+    if (app_name == nullptr || handle == nullptr) {
+        LogError("Invalid parameters");
+        return SECURITY_MANAGER_ERROR_INPUT_PARAM;
+    }
+
+    return try_catch([&]() -> int {
+        std::unique_ptr<prepare_app_handle> prefetched(new prepare_app_handle);
+        prefetched->uid = getuid();
+        prefetched->appName = app_name;
+
+        int ret = getPrivilegedGroups(prefetched->privilegedGroups);
+        if (ret != SECURITY_MANAGER_SUCCESS)
+            return ret;
+
+        ret = getAppGroups(app_name, prefetched->allowedGroups);
+        if (ret != SECURITY_MANAGER_SUCCESS)
             return ret;
+
+        ret = fetchLabelForProcess(app_name, prefetched->label);
+        if (ret != SECURITY_MANAGER_SUCCESS)
+            return ret;
+
+        *handle = prefetched.release();
+        return SECURITY_MANAGER_SUCCESS;
+    });
+}
+
+SECURITY_MANAGER_API
+int security_manager_prepare_app_apply(const prepare_app_handle *handle)
+{
+    return try_catch([&] {
+        LogDebug("security_manager_prepare_app_apply() called");
+
+        if (handle == nullptr) {
+            LogError("handle is NULL");
+            return static_cast<int>(SECURITY_MANAGER_ERROR_INPUT_PARAM);
         }
 
-        try {
-            CheckProperDrop cpd;
-            cpd.getThreads();
-            if (!cpd.checkThreads()) {
-                LogError("Privileges haven't been properly dropped for the whole process of application " << app_name);
-                return ret;
-            }
-        } catch (const SecurityManager::Exception &e) {
-            LogError("Error while checking privileges of the process for application " << app_name << ": " << e.DumpToString());
+        if (handle->uid != getuid()) {
+            LogError("Handle was prefetched by uid " << handle->uid << ", not by the uid " <<
+                     getuid() << " of the application process");
+            return static_cast<int>(SECURITY_MANAGER_ERROR_INPUT_PARAM);
+        }
+
+        const char *app_name = handle->appName.c_str();
+        int ret = applyProcessGroups(handle->privilegedGroups, handle->allowedGroups);
+        if (ret != SECURITY_MANAGER_SUCCESS) {
+            LogError("Unable to setup process groups for application " << app_name);
             return ret;
         }
 
-        return ret;
+        return dropProcessPrivileges(app_name, handle->label);
     });
 }
 
+SECURITY_MANAGER_API
+void security_manager_prepare_app_handle_free(prepare_app_handle *handle)
+{
+    delete handle;
+}
+
 SECURITY_MANAGER_API
 int security_manager_user_req_new(user_req **pp_req)
 {
@@ -880,11 +978,9 @@ int security_manager_user_add(const user_req *p_req)
 
     return try_catch([&] {
         int retval;
-        ClientOffline offlineMode;
-        if (offlineMode.isOffline()) {
-            Credentials creds = offlineMode.getCredentials();
-            retval = SecurityManager::ServiceImpl().userAdd(creds, p_req->uid, p_req->utype);
-        } else {
+        if (!callOffline(retval, [&](ServiceImpl &service, const Credentials &creds) {
+                return service.userAdd(creds, p_req->uid, p_req->utype);
+            })) {
             //server is working
             retval = ClientRequest(SecurityModuleCall::USER_ADD).send(
                 p_req->uid, p_req->utype).getStatus();
@@ -938,11 +1034,39 @@ int security_manager_policy_update_send(policy_update_req *p_req)
         return SECURITY_MANAGER_ERROR_INPUT_PARAM;
 
     return try_catch([&] {
-        return ClientRequest(SecurityModuleCall::POLICY_UPDATE).send(
+        return ClientRequest(SecurityModuleCall::POLICY_UPDATE).sendFlat(
             p_req->units).getStatus();
     });
 }
 
+SECURITY_MANAGER_API
+int security_manager_policy_resync(void)
+{
+    using namespace SecurityManager;
+
+    return try_catch([&] {
+        return ClientRequest(SecurityModuleCall::POLICY_RESYNC).send().getStatus();
+    });
+}
+
+SECURITY_MANAGER_API
+int security_manager_policy_cache_statistics(unsigned *p_hits, unsigned *p_misses)
+{
+    using namespace SecurityManager;
+
+    return try_catch([&]() -> int {
+        if (p_hits == NULL || p_misses == NULL)
+            return SECURITY_MANAGER_ERROR_INPUT_PARAM;
+
+        ClientRequest request(SecurityModuleCall::POLICY_CACHE_STATISTICS);
+        if (request.send().failed())
+            return request.getStatus();
+
+        request.recv(*p_hits, *p_misses);
+        return request.getStatus();
+    });
+}
+
 static inline int security_manager_get_policy_internal(
         SecurityManager::SecurityModuleCall call_type,
         policy_entry *p_filter,
@@ -1227,6 +1351,17 @@ int security_manager_groups_get(char ***groups, size_t *groups_count)
     if (!groups || !groups_count)
         return SECURITY_MANAGER_ERROR_INPUT_PARAM;
     return try_catch([&]() -> int {
+        std::lock_guard<std::mutex> lock(g_group_cache.mutex);
+        if (g_group_cache.refresh()) {
+            if (!g_group_cache.hasGroupList) {
+                std::vector<std::string> vgroups;
+                loadGroups(vgroups);
+                g_group_cache.groupList.swap(vgroups);
+                g_group_cache.hasGroupList = true;
+            }
+            return group_vector_to_array(g_group_cache.groupList, groups, groups_count);
+        }
+
         std::vector<std::string> vgroups;
         loadGroups(vgroups);
         return group_vector_to_array(vgroups, groups, groups_count);
@@ -1556,21 +1691,74 @@ int security_manager_paths_register(const path_req *p_req)
             return SECURITY_MANAGER_ERROR_REQ_NOT_COMPLETE;
 
         int retval;
-        ClientOffline offlineMode;
-        if (offlineMode.isOffline()) {
-            Credentials creds = offlineMode.getCredentials();
-            retval = SecurityManager::ServiceImpl().pathsRegister(creds, *p_req);
-        } else {
-            return ClientRequest(SecurityModuleCall::PATHS_REGISTER).send(
-                p_req->pkgName,
-                p_req->uid,
-                p_req->pkgPaths,
-                p_req->installationType).getStatus();
+        if (!callOffline(retval, [&](ServiceImpl &service, const Credentials &creds) {
+                return service.pathsRegister(creds, *p_req);
+            })) {
+            return ClientRequest(SecurityModuleCall::PATHS_REGISTER).sendFlat(
+                *p_req).getStatus();
         }
         return retval;
     });
 }
 
+SECURITY_MANAGER_API
+int security_manager_offline_session_begin(offline_session **session)
+{
+    using namespace SecurityManager;
+
+    LogDebug("security_manager_offline_session_begin() called");
+
+    if (!session)
+        return SECURITY_MANAGER_ERROR_INPUT_PARAM;
+
+    return try_catch([&]() -> int {
+        std::lock_guard<std::mutex> lock(g_offline_session_mutex);
+        if (g_offline_session) {
+            LogError("Off-line session already started");
+            return SECURITY_MANAGER_ERROR_BAD_REQUEST;
+        }
+
+        std::unique_ptr<offline_session> newSession(new offline_session);
+        if (!newSession->offlineMode.isOffline()) {
+            LogError("Off-line mode is not available");
+            return SECURITY_MANAGER_ERROR_ACCESS_DENIED;
+        }
+
+        newSession->service.reset(new ServiceImpl);
+        int ret = newSession->service->beginBatch();
+        if (ret != SECURITY_MANAGER_SUCCESS)
+            return ret;
+
+        static std::once_flag atExitRegistered;
+        std::call_once(atExitRegistered, [] { atexit(offline_session_at_exit); });
+
+        g_offline_session = newSession.release();
+        *session = g_offline_session;
+        return SECURITY_MANAGER_SUCCESS;
+    });
+}
+
+SECURITY_MANAGER_API
+int security_manager_offline_session_end(offline_session *session)
+{
+    using namespace SecurityManager;
+
+    LogDebug("security_manager_offline_session_end() called");
+
+    if (!session)
+        return SECURITY_MANAGER_ERROR_INPUT_PARAM;
+
+    return try_catch([&]() -> int {
+        std::lock_guard<std::mutex> lock(g_offline_session_mutex);
+        if (session != g_offline_session)
+            return SECURITY_MANAGER_ERROR_INPUT_PARAM;
+
+        std::unique_ptr<offline_session> endedSession(g_offline_session);
+        g_offline_session = nullptr;
+        return endedSession->service->endBatch();
+    });
+}
+
 SECURITY_MANAGER_API
 int security_manager_shm_open(const char *name, int oflag, mode_t mode, const char *app_name)
 {
@@ -1735,3 +1923,61 @@ int security_manager_get_client_privilege_license(
         return SECURITY_MANAGER_SUCCESS;
     });
 }
+
+SECURITY_MANAGER_API
+int security_manager_get_license_bundle(
+        const char *client,
+        const char *privilege,
+        uid_t uid,
+        char **provider_pkg_name,
+        char **provider_app_name,
+        char **provider_license,
+        char **client_pkg_name,
+        char **client_app_name,
+        char **client_license)
+{
+    return try_catch([&]() -> int {
+        using namespace SecurityManager;
+        LogDebug(__PRETTY_FUNCTION__ << " called");
+
+        if (!client || !privilege) {
+            LogError("client, privilege could not be NULL");
+            return SECURITY_MANAGER_ERROR_INPUT_PARAM;
+        }
+
+        ClientRequest request(SecurityModuleCall::GET_LICENSE_BUNDLE);
+        if (request.send(uid, std::string(client), std::string(privilege)).failed())
+            return request.getStatus();
+
+        std::string values[6];
+        request.recv(values[0], values[1], values[2], values[3], values[4], values[5]);
+
+        if (values[0].empty() || values[1].empty() || values[4].empty()) {
+            LogError("Unexpected empty provider appName, pkgName or client pkgName");
+            return SECURITY_MANAGER_ERROR_UNKNOWN;
+        }
+
+        // provider app, provider pkg, provider license, client app, client pkg, client license
+        char **outputs[6] = {provider_app_name, provider_pkg_name, provider_license,
+                             client_app_name, client_pkg_name, client_license};
+        typedef std::unique_ptr<char, decltype(free)*> CStringPtr;
+        std::vector<CStringPtr> copies;
+        for (int i = 0; i < 6; ++i) {
+            copies.emplace_back(nullptr, free);
+            // client app name is not known for non-hybrid applications
+            if (!outputs[i] || (i == 3 && values[i].empty()))
+                continue;
+            copies.back().reset(strdup(values[i].c_str()));
+            if (!copies.back()) {
+                LogError("Memory allocation in strdup failed.");
+                return SECURITY_MANAGER_ERROR_MEMORY;
+            }
+        }
+
+        for (int i = 0; i < 6; ++i)
+            if (outputs[i])
+                *outputs[i] = copies[i].release();
+
+        return SECURITY_MANAGER_SUCCESS;
+    });
+}
@@ -0,0 +1,65 @@
+/*
+ *  Copyright (c) 2015-2016 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ *  Contact: Rafal Krypa <r.krypa@samsung.com>
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License
+ */
+/*
+ * @file        check-proper-drop-procps.h
+ * @author      Rafal Krypa <r.krypa@samsung.com>
+ * @version     1.0
+ * @brief       Definition of libprocps based proper privilege dropping check
+ */
+
+#pragma once
+
+#include <check-proper-drop.h>
+
+#include <unistd.h>
+#include <proc/readproc.h>
+
+#include <vector>
+
+namespace SecurityManager {
+
+/**
+ * Former implementation of CheckProperDrop, reading task credentials
+ * with libprocps. Built only with CHECK_PROPER_DROP_WITH_PROCPS.
+ */
+class CheckProperDropProcps {
+public:
+    typedef CheckProperDrop::Exception Exception;
+
+    ~CheckProperDropProcps();
+    CheckProperDropProcps(pid_t pid = getpid()) : m_pid(pid) {};
+
+    /**
+     * Fetch credentials of the process and all its threads.
+     * Must be called before checkThreads().
+     */
+    void getThreads();
+
+    /**
+     * Check whether all threads of the process has properly aligned
+     * credentials, see CheckProperDrop::checkThreads().
+     */
+    bool checkThreads();
+
+private:
+    pid_t m_pid;
+    proc_t *m_proc = nullptr;
+    std::vector<proc_t*> m_threads;
+};
+
+} // namespace SecurityManager
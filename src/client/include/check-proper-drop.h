@@ -26,9 +26,11 @@
 
 #include <dpl/exception.h>
 
+#include <sys/types.h>
 #include <unistd.h>
-#include <proc/readproc.h>
 
+#include <cstdint>
+#include <string>
 #include <vector>
 
 namespace SecurityManager {
@@ -42,7 +44,6 @@ public:
         DECLARE_EXCEPTION_TYPE(Base, CapError)
     };
 
-    ~CheckProperDrop();
     CheckProperDrop(pid_t pid = getpid()) : m_pid(pid) {};
 
     /**
@@ -66,9 +67,22 @@ public:
     bool checkThreads();
 
 private:
+    /* Credentials of a single task, as reported in /proc/<pid>/task/<tid>/status */
+    struct TaskCreds {
+        enum { RUID, EUID, SUID, FUID, RGID, EGID, SGID, FGID, ID_COUNT };
+        enum { CAP_INH, CAP_PRM, CAP_EFF, CAP_COUNT };
+
+        pid_t tid;
+        unsigned ids[ID_COUNT];
+        uint64_t caps[CAP_COUNT];
+        std::string groups;
+    };
+
+    static bool readTaskCreds(pid_t pid, pid_t tid, TaskCreds &creds);
+
     pid_t m_pid;
-    proc_t *m_proc = nullptr;
-    std::vector<proc_t*> m_threads;
+    TaskCreds m_proc;
+    std::vector<TaskCreds> m_threads;
 };
 
 } // namespace SecurityManager
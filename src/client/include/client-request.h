@@ -73,6 +73,19 @@ public:
         return send();
     }
 
+    /* Send value encoded in one go, see FlatSerialization */
+    template <typename T> ClientRequest &sendFlat(const T &value)
+    {
+        m_send.Push(FlatSerialization::Encode(value));
+        return send();
+    }
+
+    template <typename Fields, typename T> ClientRequest &sendFlatAs(const T &object)
+    {
+        m_send.Push(FlatSerialization::EncodeAs<Fields>(object));
+        return send();
+    }
+
     template <typename... T> ClientRequest &recv(T&... args)
     {
         if (!m_sent)
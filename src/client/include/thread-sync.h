@@ -0,0 +1,59 @@
+/*
+ *  Copyright (c) 2017 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License
+ */
+/*
+ * @file        thread-sync.h
+ * @version     1.0
+ * @brief       Running work on all threads of the process from signal handler
+ */
+
+#pragma once
+
+#include <signal.h>
+
+// Hackish, based on glibc's definition in sysdeps/unix/sysv/linux/nptl-signals.h
+#define SIGSETXID           (__SIGRTMIN + 1)
+
+namespace SecurityManager {
+namespace ThreadSync {
+
+/*
+ * Work done by each thread in SIGSETXID handler, must be async-signal-safe.
+ * attrFd is /proc/self/task/<tid>/attr/current of the thread, opened before
+ * signalling, or -1 if descriptors were not asked for.
+ * Returns true on success.
+ */
+typedef bool (*Work)(int attrFd);
+
+/**
+ * Make all threads of the process but the calling one do work, and wait for
+ * each of them to report back, for at most timeoutMs.
+ *
+ * When a thread does not report in time, its handler may still run at any
+ * later moment. Descriptors and state it uses are then left as they are and
+ * the process is poisoned: every later call fails without signalling.
+ *
+ * @param work function run by the threads
+ * @param openAttrCurrent whether to open attr/current of the threads for work
+ * @param timeoutMs time to wait for all threads
+ * @return SECURITY_MANAGER_SUCCESS if all threads succeeded, error code otherwise
+ */
+int runOnOtherThreads(Work work, bool openAttrCurrent, int timeoutMs);
+
+/* Whether some thread did not report back to earlier runOnOtherThreads() */
+bool poisoned();
+
+} // namespace ThreadSync
+} // namespace SecurityManager
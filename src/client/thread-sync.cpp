@@ -0,0 +1,313 @@
+/*
+ *  Copyright (c) 2017 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License
+ */
+/*
+ * @file        thread-sync.cpp
+ * @version     1.0
+ * @brief       Running work on all threads of the process from signal handler
+ */
+
+#include "thread-sync.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+
+#include <dpl/log/log.h>
+#include <dpl/errno_string.h>
+#include <security-manager-types.h>
+
+#include "filesystem.h"
+
+namespace SecurityManager {
+namespace ThreadSync {
+
+namespace {
+
+// work of the current run
+Work g_work;
+// threads that did their work successfully
+std::atomic<int> g_threads_count;
+// (tid, fd of /proc/self/task/<tid>/attr/current) sorted by tid, opened before signalling
+std::vector<std::pair<pid_t, int>> g_tid_attr_current_fds;
+// signalled once by every thread that handled SIGSETXID, successfully or not
+int g_threads_done_fd = -1;
+// set when a handler may still be running, all above is left to it then
+bool g_poisoned = false;
+
+} // namespace anonymous
+
+namespace Syscall {
+
+inline static int gettid()
+{
+    return syscall(SYS_gettid);
+}
+
+inline static int tgkill(int tgid, int tid, int sig)
+{
+    return syscall(SYS_tgkill, tgid, tid, sig);
+}
+
+// reimplement libc sigaction code
+// sigaction structure used in the kernel is not the same as in the libc
+// sysdeps/unix/sysv/linux/kernel_sigaction.h
+// sysdeps/unix/sysv/linux/{i386,x86_64,arm,aarch64}/sigaction.c
+
+#define SA_RESTORER 0x04000000
+
+struct kernel_sigaction {
+    __sighandler_t k_sa_handler;
+    unsigned long sa_flags;
+    void (*sa_restorer)(void);
+    sigset_t sa_mask;
+};
+
+#if __x86_64__
+void restore_rt(void) __asm__("__restore_rt");
+
+#define RESTORE(name, syscall) RESTORE2(name, syscall)
+#define RESTORE2(name, syscall) \
+__asm__ (                                       \
+        "nop\n"                                 \
+        ".text\n"                               \
+        "__" #name ":\n"                        \
+        "        movq $" #syscall ", %rax\n"    \
+        "        syscall\n"                     \
+);
+
+RESTORE(restore_rt, __NR_rt_sigreturn)
+#endif
+
+inline static int sigaction(int signum, const struct sigaction *act, struct sigaction *oldact)
+{
+    int ret;
+    struct kernel_sigaction kact, koldact;
+
+    if (act) {
+        kact.k_sa_handler = act->sa_handler;
+        memcpy(&kact.sa_mask, &act->sa_mask, sizeof(sigset_t));
+#if __x86_64__
+        kact.sa_flags = act->sa_flags | SA_RESTORER;
+        kact.sa_restorer = &restore_rt;
+#else
+        kact.sa_flags = act->sa_flags;
+        kact.sa_restorer = act->sa_restorer;
+#endif
+    }
+
+    ret = syscall(SYS_rt_sigaction, signum, act ? &kact : NULL, oldact ? &koldact : NULL, NSIG / 8);
+
+    if (oldact && ret >= 0) {
+        oldact->sa_handler = koldact.k_sa_handler;
+        memcpy(&oldact->sa_mask, &koldact.sa_mask, sizeof(sigset_t));
+        oldact->sa_flags = koldact.sa_flags;
+        oldact->sa_restorer = koldact.sa_restorer;
+    }
+
+    return ret;
+}
+
+} // namespace Syscall
+
+inline static int attr_current_fd_for_self()
+{
+    pid_t tid = Syscall::gettid();
+    auto it = std::lower_bound(g_tid_attr_current_fds.begin(), g_tid_attr_current_fds.end(),
+                               std::make_pair(tid, -1));
+    if (it == g_tid_attr_current_fds.end() || it->first != tid)
+        return -1;
+    return it->second;
+}
+
+static void close_tid_attr_current_fds()
+{
+    for (auto const &t_pair : g_tid_attr_current_fds)
+        if (t_pair.second != -1)
+            close(t_pair.second);
+    g_tid_attr_current_fds.clear();
+}
+
+/*
+ * Wait until count threads report back on g_threads_done_fd or timeoutMs
+ * passes. Returns number of threads that reported.
+ */
+static int wait_for_threads(int count, int timeoutMs)
+{
+    struct timespec start, now;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    int done = 0;
+    while (done < count) {
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        long elapsedMs = (now.tv_sec - start.tv_sec) * 1000 +
+                         (now.tv_nsec - start.tv_nsec) / 1000000;
+        if (elapsedMs >= timeoutMs)
+            break;
+
+        struct pollfd pfd = {g_threads_done_fd, POLLIN, 0};
+        int ret = poll(&pfd, 1, timeoutMs - elapsedMs);
+        if (ret < 0 && errno != EINTR) {
+            LogError("Error in poll(): " << GetErrnoString(errno));
+            break;
+        }
+        if (ret <= 0)
+            continue;
+
+        eventfd_t value;
+        if (eventfd_read(g_threads_done_fd, &value) == 0)
+            done += static_cast<int>(value);
+    }
+    return done;
+}
+
+bool poisoned()
+{
+    return g_poisoned;
+}
+
+int runOnOtherThreads(Work work, bool openAttrCurrent, int timeoutMs)
+{
+    if (g_poisoned) {
+        LogError("Some thread did not finish earlier synchronization, refusing to run");
+        return SECURITY_MANAGER_ERROR_UNKNOWN;
+    }
+
+    if (ATOMIC_INT_LOCK_FREE != 2) {
+        LogError("std::atomic<int> is not always lock free");
+        return SECURITY_MANAGER_ERROR_UNKNOWN;
+    }
+
+    FS::FileNameVector files = FS::getDirsFromDirectory("/proc/self/task");
+    pid_t cur_tid = Syscall::gettid();
+    pid_t cur_pid = getpid();
+
+    g_work = work;
+    g_threads_count = 0;
+    g_tid_attr_current_fds.clear();
+
+    for (auto const &e : files) {
+        if (e.compare(".") == 0 || e.compare("..") == 0)
+            continue;
+
+        int tid = atoi(e.c_str());
+        if (tid == static_cast<int>(cur_tid))
+            continue;
+
+        int fd = -1;
+        if (openAttrCurrent) {
+            std::string path = "/proc/self/task/" + e + "/attr/current";
+            fd = open(path.c_str(), O_WRONLY | O_CLOEXEC);
+            if (fd < 0) {
+                if (errno == ENOENT)
+                    continue; // thread exited in the meantime
+                LogError("Unable to open " << path << ": " << GetErrnoString(errno));
+                close_tid_attr_current_fds();
+                return SECURITY_MANAGER_ERROR_UNKNOWN;
+            }
+        }
+        g_tid_attr_current_fds.emplace_back(tid, fd);
+    }
+    std::sort(g_tid_attr_current_fds.begin(), g_tid_attr_current_fds.end());
+
+    g_threads_done_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (g_threads_done_fd < 0) {
+        LogError("Error in eventfd(): " << GetErrnoString(errno));
+        close_tid_attr_current_fds();
+        return SECURITY_MANAGER_ERROR_UNKNOWN;
+    }
+
+    auto cleanup = [] {
+        close_tid_attr_current_fds();
+        close(g_threads_done_fd);
+        g_threads_done_fd = -1;
+    };
+
+    struct sigaction act;
+    struct sigaction old;
+    memset(&act, '\0', sizeof(act));
+    memset(&old, '\0', sizeof(old));
+
+    sigemptyset(&act.sa_mask);
+    act.sa_flags = SA_RESTART;
+    act.sa_handler = [](int signo) {
+        (void)signo;
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        int saved_errno = errno;
+        if (g_work(attr_current_fd_for_self()))
+            g_threads_count++;
+
+        eventfd_write(g_threads_done_fd, 1);
+        errno = saved_errno;
+    };
+
+    if (Syscall::sigaction(SIGSETXID, &act, &old) < 0) {
+        LogError("Error in sigaction()");
+        cleanup();
+        return SECURITY_MANAGER_ERROR_UNKNOWN;
+    }
+
+    int sent_signals_count = 0;
+
+    std::atomic_thread_fence(std::memory_order_release);
+
+    for (auto const& t_pair : g_tid_attr_current_fds) {
+        if (Syscall::tgkill(cur_pid, t_pair.first, SIGSETXID) < 0) {
+            LogWarning("Error in tgkill()");
+            continue;
+        }
+
+        sent_signals_count++;
+    }
+
+    LogDebug("sent_signals_count: " << sent_signals_count);
+
+    int threads_done = wait_for_threads(sent_signals_count, timeoutMs);
+
+    Syscall::sigaction(SIGSETXID, &old, nullptr);
+
+    if (threads_done != sent_signals_count) {
+        /* Late handlers may still use the descriptors and work, leave them be */
+        LogError("Not all threads synchronized: threads done: " << threads_done);
+        g_poisoned = true;
+        return SECURITY_MANAGER_ERROR_UNKNOWN;
+    }
+
+    cleanup();
+
+    if (g_threads_count != sent_signals_count) {
+        LogError("Not all threads synchronized: threads succeeded: " << g_threads_count);
+        return SECURITY_MANAGER_ERROR_UNKNOWN;
+    }
+
+    return SECURITY_MANAGER_SUCCESS;
+}
+
+} // namespace ThreadSync
+} // namespace SecurityManager
@@ -39,6 +39,7 @@
 #include <dpl/errno_string.h>
 
 #include <message-buffer.h>
+#include <message-reader.h>
 
 #include <protocols.h>
 
@@ -170,7 +171,8 @@ int sendToServer(char const * const interface, const RawBuffer &send, MessageBuf
     int ret;
     SockRAII sock;
     ssize_t done = 0;
-    char buffer[2048];
+    MessageReader reader(MessageReader::REPLY_PREALLOC);
+    RawBuffer message;
 
     if (SECURITY_MANAGER_SUCCESS != (ret = sock.Connect(interface))) {
         LogError("Error in SockRAII");
@@ -199,10 +201,7 @@ int sendToServer(char const * const interface, const RawBuffer &send, MessageBuf
             LogError("Error in poll(POLLIN)");
             return SECURITY_MANAGER_ERROR_SOCKET;
         }
-        ssize_t temp = TEMP_FAILURE_RETRY(::recv(sock.Get(),
-                                                 buffer,
-                                                 2048,
-                                                 0));
+        ssize_t temp = reader.Receive(sock.Get());
         if (-1 == temp) {
             int err = errno;
             LogError("Error in read: " << GetErrnoString(err));
@@ -213,10 +212,9 @@ int sendToServer(char const * const interface, const RawBuffer &send, MessageBuf
             LogError("Read return 0/Connection closed by server(?)");
             return SECURITY_MANAGER_ERROR_SOCKET;
         }
+    } while(!reader.Pop(message));
 
-        RawBuffer raw(buffer, buffer+temp);
-        recv.Push(raw);
-    } while(!recv.Ready());
+    recv.Push(std::move(message));
     return SECURITY_MANAGER_SUCCESS;
 }
 
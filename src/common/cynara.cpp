@@ -292,6 +292,176 @@ static bool checkCynaraError(int result, const std::string &msg)
     }
 }
 
+static bool filterMatches(const std::string &filter, const std::string &value)
+{
+    return filter == CYNARA_ADMIN_ANY || filter == value;
+}
+
+CynaraAdminMirror::CynaraAdminMirror()
+{
+    m_buckets[CynaraAdmin::Buckets.at(Bucket::MANIFESTS_GLOBAL)] = {false, false, {}};
+    m_buckets[CynaraAdmin::Buckets.at(Bucket::MANIFESTS_LOCAL)] = {false, false, {}};
+    m_buckets[CynaraAdmin::Buckets.at(Bucket::APPDEFINED)] = {false, false, {}};
+    // MAIN holds also manufacturer rules, only user type links are owned by us
+    m_buckets[CynaraAdmin::Buckets.at(Bucket::MAIN)] = {true, false, {}};
+}
+
+bool CynaraAdminMirror::accepts(const MirroredBucket &mirrored, const std::string &client,
+    const std::string &privilege) const
+{
+    return !mirrored.userLinksOnly ||
+        (client == CYNARA_ADMIN_WILDCARD && privilege == CYNARA_ADMIN_WILDCARD);
+}
+
+bool CynaraAdminMirror::covers(const std::string &bucket, const std::string &client,
+    const std::string &privilege) const
+{
+    auto it = m_buckets.find(bucket);
+    return it != m_buckets.end() && accepts(it->second, client, privilege);
+}
+
+void CynaraAdminMirror::loadFilter(const std::string &bucket, std::string &client,
+    std::string &privilege) const
+{
+    if (m_buckets.at(bucket).userLinksOnly) {
+        client = CYNARA_ADMIN_WILDCARD;
+        privilege = CYNARA_ADMIN_WILDCARD;
+    } else {
+        client = CYNARA_ADMIN_ANY;
+        privilege = CYNARA_ADMIN_ANY;
+    }
+}
+
+bool CynaraAdminMirror::isLoaded(const std::string &bucket) const
+{
+    auto it = m_buckets.find(bucket);
+    return it != m_buckets.end() && it->second.loaded;
+}
+
+void CynaraAdminMirror::load(const std::string &bucket,
+    const std::vector<CynaraAdminPolicy> &policies)
+{
+    auto &mirrored = m_buckets.at(bucket);
+    mirrored.clients.clear();
+    for (const auto &policy : policies)
+        mirrored.clients[policy.client][policy.user][policy.privilege] =
+            {policy.result, policy.result_extra ? policy.result_extra : ""};
+    mirrored.loaded = true;
+    LogDebug("Mirrored " << policies.size() << " policies of bucket " << bucket);
+}
+
+void CynaraAdminMirror::invalidate()
+{
+    for (auto &it : m_buckets) {
+        it.second.loaded = false;
+        it.second.clients.clear();
+    }
+}
+
+void CynaraAdminMirror::update(const std::vector<CynaraAdminPolicy> &policies)
+{
+    for (const auto &policy : policies) {
+        auto it = m_buckets.find(policy.bucket);
+        if (it == m_buckets.end() || !it->second.loaded ||
+            !accepts(it->second, policy.client, policy.privilege))
+            continue;
+
+        auto &clients = it->second.clients;
+        if (policy.result == static_cast<int>(CynaraAdminPolicy::Operation::Delete)) {
+            auto clientIt = clients.find(policy.client);
+            if (clientIt == clients.end())
+                continue;
+            auto userIt = clientIt->second.find(policy.user);
+            if (userIt == clientIt->second.end())
+                continue;
+            userIt->second.erase(policy.privilege);
+            if (userIt->second.empty())
+                clientIt->second.erase(userIt);
+            if (clientIt->second.empty())
+                clients.erase(clientIt);
+        } else {
+            clients[policy.client][policy.user][policy.privilege] =
+                {policy.result, policy.result_extra ? policy.result_extra : ""};
+        }
+    }
+}
+
+void CynaraAdminMirror::erase(const std::string &bucket, const std::string &client,
+    const std::string &user, const std::string &privilege)
+{
+    auto it = m_buckets.find(bucket);
+    if (it == m_buckets.end())
+        return;
+
+    auto &clients = it->second.clients;
+    for (auto clientIt = clients.begin(); clientIt != clients.end();) {
+        if (!filterMatches(client, clientIt->first)) {
+            ++clientIt;
+            continue;
+        }
+        auto &users = clientIt->second;
+        for (auto userIt = users.begin(); userIt != users.end();) {
+            if (!filterMatches(user, userIt->first)) {
+                ++userIt;
+                continue;
+            }
+            auto &privileges = userIt->second;
+            if (privilege == CYNARA_ADMIN_ANY)
+                privileges.clear();
+            else
+                privileges.erase(privilege);
+            userIt = privileges.empty() ? users.erase(userIt) : std::next(userIt);
+        }
+        clientIt = users.empty() ? clients.erase(clientIt) : std::next(clientIt);
+    }
+}
+
+void CynaraAdminMirror::list(const std::string &bucket, const std::string &client,
+    const std::string &user, const std::string &privilege,
+    std::vector<CynaraAdminPolicy> &policies) const
+{
+    auto addPolicy = [&](const std::string &c, const std::string &u,
+                         const std::string &p, const Entry &entry) {
+        if (entry.result == CYNARA_ADMIN_BUCKET) {
+            policies.push_back(CynaraAdminPolicy(c, u, p, entry.resultExtra, bucket));
+        } else {
+            policies.push_back(CynaraAdminPolicy(c, u, p, entry.result, bucket));
+            if (!entry.resultExtra.empty())
+                policies.back().result_extra = strdup(entry.resultExtra.c_str());
+        }
+    };
+
+    // exact filters are looked up directly, CYNARA_ADMIN_ANY iterates over level
+    const auto &clients = m_buckets.at(bucket).clients;
+    for (auto clientIt = (client == CYNARA_ADMIN_ANY) ? clients.begin() : clients.find(client);
+         clientIt != clients.end(); ++clientIt) {
+        const auto &users = clientIt->second;
+        for (auto userIt = (user == CYNARA_ADMIN_ANY) ? users.begin() : users.find(user);
+             userIt != users.end(); ++userIt) {
+            const auto &privileges = userIt->second;
+            for (auto privIt = (privilege == CYNARA_ADMIN_ANY) ? privileges.begin()
+                                                                : privileges.find(privilege);
+                 privIt != privileges.end(); ++privIt) {
+                addPolicy(clientIt->first, userIt->first, privIt->first, privIt->second);
+                if (privilege != CYNARA_ADMIN_ANY)
+                    break;
+            }
+            if (user != CYNARA_ADMIN_ANY)
+                break;
+        }
+        if (client != CYNARA_ADMIN_ANY)
+            break;
+    }
+}
+
+std::vector<std::string> CynaraAdminMirror::buckets() const
+{
+    std::vector<std::string> names;
+    for (const auto &it : m_buckets)
+        names.push_back(it.first);
+    return names;
+}
+
 CynaraAdmin::TypeToDescriptionMap CynaraAdmin::s_typeToDescription;
 CynaraAdmin::DescriptionToTypeMap CynaraAdmin::s_descriptionToType;
 
@@ -331,9 +501,17 @@ void CynaraAdmin::setPolicies(const std::vector<CynaraAdminPolicy> &policies)
 
     pp_policies[policies.size()] = nullptr;
 
-    checkCynaraError(
-        cynara_admin_set_policies(m_cynaraAdmin, pp_policies.data()),
-        "Error while updating Cynara policy.");
+    try {
+        checkCynaraError(
+            cynara_admin_set_policies(m_cynaraAdmin, pp_policies.data()),
+            "Error while updating Cynara policy.");
+    } catch (const CynaraException::Base &) {
+        // state of Cynara is unknown, mirror will be reloaded on next use
+        m_mirror.invalidate();
+        throw;
+    }
+
+    m_mirror.update(policies);
 }
 
 void CynaraAdmin::updateAppPolicy(
@@ -636,6 +814,53 @@ void CynaraAdmin::listPolicies(
     const std::string &user,
     const std::string &privilege,
     std::vector<CynaraAdminPolicy> &policies)
+{
+    if (m_mirror.covers(bucket, label, privilege) && loadMirror(bucket)) {
+        m_mirror.list(bucket, label, user, privilege, policies);
+        return;
+    }
+
+    listPoliciesFromCynara(bucket, label, user, privilege, policies);
+}
+
+bool CynaraAdmin::loadMirror(const std::string &bucket)
+{
+    if (m_mirror.isLoaded(bucket))
+        return true;
+
+    std::string client, privilege;
+    std::vector<CynaraAdminPolicy> policies;
+    m_mirror.loadFilter(bucket, client, privilege);
+    try {
+        listPoliciesFromCynara(bucket, client, CYNARA_ADMIN_ANY, privilege, policies);
+    } catch (const CynaraException::Base &e) {
+        LogWarning("Unable to mirror bucket " << bucket << ": " << e.DumpToString());
+        return false;
+    }
+
+    m_mirror.load(bucket, policies);
+    return true;
+}
+
+void CynaraAdmin::syncMirror()
+{
+    LogDebug("Reloading mirror of Cynara buckets");
+    m_mirror.invalidate();
+    for (const auto &bucket : m_mirror.buckets()) {
+        std::string client, privilege;
+        std::vector<CynaraAdminPolicy> policies;
+        m_mirror.loadFilter(bucket, client, privilege);
+        listPoliciesFromCynara(bucket, client, CYNARA_ADMIN_ANY, privilege, policies);
+        m_mirror.load(bucket, policies);
+    }
+}
+
+void CynaraAdmin::listPoliciesFromCynara(
+    const std::string &bucket,
+    const std::string &label,
+    const std::string &user,
+    const std::string &privilege,
+    std::vector<CynaraAdminPolicy> &policies)
 {
     struct cynara_admin_policy ** pp_policies = nullptr;
 
@@ -657,11 +882,22 @@ void CynaraAdmin::listPolicies(
 void CynaraAdmin::emptyBucket(const std::string &bucketName, bool recursive, const std::string &client,
     const std::string &user, const std::string &privilege)
 {
-    checkCynaraError(
-        cynara_admin_erase(m_cynaraAdmin, bucketName.c_str(), static_cast<int>(recursive),
-            client.c_str(), user.c_str(), privilege.c_str()),
-        "Error while emptying bucket: " + bucketName + ", filter (C, U, P): " +
-            client + ", " + user + ", " + privilege);
+    try {
+        checkCynaraError(
+            cynara_admin_erase(m_cynaraAdmin, bucketName.c_str(), static_cast<int>(recursive),
+                client.c_str(), user.c_str(), privilege.c_str()),
+            "Error while emptying bucket: " + bucketName + ", filter (C, U, P): " +
+                client + ", " + user + ", " + privilege);
+    } catch (const CynaraException::Base &) {
+        m_mirror.invalidate();
+        throw;
+    }
+
+    // recursive erase may reach any of the mirrored buckets
+    if (recursive)
+        m_mirror.invalidate();
+    else
+        m_mirror.erase(bucketName, client, user, privilege);
 }
 
 void CynaraAdmin::fetchCynaraPolicyDescriptions(bool forceRefresh)
@@ -804,7 +1040,9 @@ int CynaraAdmin::getPrivilegeManagerMaxLevel(const std::string &label, const std
     return result;
 }
 
-Cynara::Cynara() : m_eventFd(eventfd(0, 0)), m_cynaraFd(m_eventFd), m_cynaraFdEvents(0), m_terminate(false)
+Cynara::Cynara(const PolicyTypeGetter &policyType) :
+    m_eventFd(eventfd(0, 0)), m_cynaraFd(m_eventFd), m_cynaraFdEvents(0), m_terminate(false),
+    m_policyType(policyType), m_decisions(CACHE_SIZE, std::chrono::seconds(CACHE_TTL))
 {
     if (m_eventFd == -1) {
         LogError("Error while creating eventfd: " << GetErrnoString(errno));
@@ -857,6 +1095,14 @@ void Cynara::statusCallback(int oldFd, int newFd, cynara_async_status status)
     LogDebug("Cynara status callback. " <<
         "Status = " << status << ", oldFd = " << oldFd << ", newFd = " << newFd);
 
+    /*
+     * Cynara drops connections of its clients after policy change, which
+     * makes them clear their caches. Same is done with our decisions.
+     * Nothing was decided before first connection.
+     */
+    if (oldFd != -1 && oldFd != newFd)
+        invalidateCache();
+
     if (newFd == -1) {
         m_cynaraFdEvents = 0;
     } else {
@@ -955,12 +1201,60 @@ void Cynara::run()
     }
 }
 
+void Cynara::invalidateCache()
+{
+    m_decisions.clear();
+}
+
+DecisionCache::Statistics Cynara::getCacheStatistics()
+{
+    return m_decisions.statistics();
+}
+
+unsigned Cynara::getCacheGeneration()
+{
+    return m_decisions.generation();
+}
+
 bool Cynara::check(const std::string &label, const std::string &privilege,
         const std::string &user, const std::string &session)
 {
     LogDebug("check: client = " << label << ", user = " << user <<
         ", privilege = " << privilege << ", session = " << session);
 
+    DecisionCache::PolicyKey key(label, user, privilege);
+    bool allowed;
+    if (m_decisions.get(key, session, allowed)) {
+        LogDebug("Decision cache hit: " << allowed);
+        return allowed;
+    }
+
+    unsigned generation = m_decisions.generation();
+    allowed = askCynara(label, privilege, user, session);
+
+    int type;
+    if (!m_decisions.getType(key, type)) {
+        if (!m_policyType)
+            return allowed;
+        try {
+            type = m_policyType(label, user, privilege);
+        } catch (const CynaraException::Base &e) {
+            LogWarning("Unable to get type of policy, decision not cached: " << e.DumpToString());
+            return allowed;
+        }
+        m_decisions.putType(key, type, generation);
+    }
+
+    // answers of plugins may depend on more than the key, those are left to Cynara
+    if ((type == CYNARA_ADMIN_ALLOW && allowed) || (type == CYNARA_ADMIN_DENY && !allowed))
+        m_decisions.put(key, session, allowed, generation);
+
+    return allowed;
+}
+
+bool Cynara::askCynara(const std::string &label, const std::string &privilege,
+        const std::string &user, const std::string &session)
+{
     std::promise<bool> promise;
     auto future = promise.get_future();
 
@@ -0,0 +1,116 @@
+/*
+ *  Copyright (c) 2017 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License
+ */
+/*
+ * @file        group-generation.cpp
+ * @version     1.0
+ * @brief       Generation counter published by the service to invalidate
+ * @brief       privileged group information cached by clients
+ */
+#ifndef _GNU_SOURCE //for TEMP_FAILURE_RETRY
+#define _GNU_SOURCE
+#endif
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <mutex>
+
+#include <dpl/errno_string.h>
+#include <dpl/log/log.h>
+#include <group-generation.h>
+#include <smack-labels.h>
+
+namespace SecurityManager {
+namespace GroupGeneration {
+
+namespace {
+
+std::mutex g_mutex;
+uint32_t *g_writable = nullptr;
+const uint32_t *g_readable = nullptr;
+
+void *mapGenerationFile(bool writable)
+{
+    const std::string &path = getGenerationFileLocation();
+    int fd = TEMP_FAILURE_RETRY(open(path.c_str(),
+        writable ? O_RDWR | O_CREAT | O_CLOEXEC : O_RDONLY | O_CLOEXEC, 0644));
+    if (fd < 0) {
+        if (writable)
+            LogError("Unable to open " << path << ": " << GetErrnoString(errno));
+        return nullptr;
+    }
+
+    void *addr = MAP_FAILED;
+    struct stat st;
+    if (fstat(fd, &st) == -1) {
+        LogError("Unable to stat " << path << ": " << GetErrnoString(errno));
+    } else if (static_cast<size_t>(st.st_size) < sizeof(uint32_t) &&
+               (!writable || TEMP_FAILURE_RETRY(ftruncate(fd, sizeof(uint32_t))) == -1)) {
+        if (writable)
+            LogError("Unable to resize " << path << ": " << GetErrnoString(errno));
+    } else {
+        if (writable) {
+            if (fchmod(fd, 0644) == -1)
+                LogWarning("Unable to set mode of " << path << ": " << GetErrnoString(errno));
+            try {
+                SmackLabels::setSmackLabelForFd(fd, "_");
+            } catch (const SmackException::Base &e) {
+                LogWarning("Unable to set Smack label of " << path << ": " << e.DumpToString());
+            }
+        }
+        addr = mmap(nullptr, sizeof(uint32_t), writable ? PROT_READ | PROT_WRITE : PROT_READ,
+                    MAP_SHARED, fd, 0);
+        if (addr == MAP_FAILED)
+            LogError("Unable to map " << path << ": " << GetErrnoString(errno));
+    }
+
+    close(fd);
+    return addr == MAP_FAILED ? nullptr : addr;
+}
+
+} // namespace anonymous
+
+const std::string &getGenerationFileLocation()
+{
+    static const std::string path = LOCAL_STATE_DIR "/security-manager/groups-generation";
+    return path;
+}
+
+void bump()
+{
+    std::lock_guard<std::mutex> lock(g_mutex);
+    if (!g_writable)
+        g_writable = static_cast<uint32_t *>(mapGenerationFile(true));
+    if (g_writable)
+        __atomic_add_fetch(g_writable, 1, __ATOMIC_RELEASE);
+}
+
+bool read(uint32_t &generation)
+{
+    std::lock_guard<std::mutex> lock(g_mutex);
+    if (!g_readable)
+        g_readable = static_cast<const uint32_t *>(mapGenerationFile(false));
+    if (!g_readable)
+        return false;
+
+    generation = __atomic_load_n(g_readable, __ATOMIC_ACQUIRE);
+    return true;
+}
+
+} // GroupGeneration
+} // SecurityManager
@@ -25,6 +25,8 @@
 #pragma once
 
 #include <map>
+#include <boost/optional.hpp>
+#include <credentials.h>
 #include <generic-socket-manager.h>
 #include <message-buffer.h>
 
@@ -33,6 +35,10 @@ namespace SecurityManager
     struct ConnectionInfo {
         InterfaceID interfaceID;
         MessageBuffer buffer;
+        uid_t uid;
+        pid_t pid;
+        bool queued;                // waiting in queue of requests to process
+        boost::optional<Credentials> creds; // peer credentials, read with the first request
     };
 
     typedef std::map<int, ConnectionInfo> ConnectionInfoMap;
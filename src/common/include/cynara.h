@@ -28,16 +28,29 @@
 #include <dpl/exception.h>
 #include <string>
 #include <vector>
+#include <list>
 #include <map>
+#include <set>
+#include <tuple>
 #include <mutex>
 #include <thread>
 #include <future>
+#include <functional>
 
 #include <poll.h>
 #include <sys/eventfd.h>
 
 #include "security-manager.h"
 #include "privilege_db.h"
+#include "decision-cache.h"
+
+#ifndef CYNARA_CACHE_SIZE
+#define CYNARA_CACHE_SIZE 1000
+#endif
+
+#ifndef CYNARA_CACHE_TTL
+#define CYNARA_CACHE_TTL 60
+#endif
 
 namespace SecurityManager {
 
@@ -104,6 +117,95 @@ struct CynaraAdminPolicy : cynara_admin_policy
     ~CynaraAdminPolicy();
 };
 
+/*
+ * In-memory copy of Cynara buckets that are written only by security-manager:
+ * MANIFESTS_GLOBAL, MANIFESTS_LOCAL, APPDEFINED and user type links
+ * (* <uid> * entries) of MAIN bucket. Indexed by client, user and privilege.
+ * Content of the buckets is loaded from Cynara when the service starts (or on
+ * first use, if that failed) and then kept up to date with every policy
+ * change made through CynaraAdmin.
+ */
+class CynaraAdminMirror
+{
+public:
+    CynaraAdminMirror();
+
+    /**
+     * Check whether listing policies with given filter may be answered by mirror.
+     *
+     * @param bucket name of the bucket
+     * @param client client filter
+     * @param privilege privilege filter
+     */
+    bool covers(const std::string &bucket, const std::string &client,
+        const std::string &privilege) const;
+
+    /**
+     * Get filter that selects mirrored part of the bucket.
+     *
+     * @param[in] bucket name of mirrored bucket
+     * @param[out] client client filter to be used for loading
+     * @param[out] privilege privilege filter to be used for loading
+     */
+    void loadFilter(const std::string &bucket, std::string &client,
+        std::string &privilege) const;
+
+    bool isLoaded(const std::string &bucket) const;
+
+    /**
+     * Replace content of mirrored bucket with given policies.
+     */
+    void load(const std::string &bucket, const std::vector<CynaraAdminPolicy> &policies);
+
+    /**
+     * Mark all buckets as not loaded, forcing reload on next use.
+     */
+    void invalidate();
+
+    /**
+     * Apply policies that were successfully set in Cynara.
+     * Policies for buckets that are not mirrored are ignored.
+     */
+    void update(const std::vector<CynaraAdminPolicy> &policies);
+
+    /**
+     * Remove mirrored policies matching filter, like cynara_admin_erase
+     * does non-recursively.
+     */
+    void erase(const std::string &bucket, const std::string &client,
+        const std::string &user, const std::string &privilege);
+
+    /**
+     * List mirrored policies matching filter, like cynara_admin_list_policies.
+     */
+    void list(const std::string &bucket, const std::string &client,
+        const std::string &user, const std::string &privilege,
+        std::vector<CynaraAdminPolicy> &policies) const;
+
+    std::vector<std::string> buckets() const;
+
+private:
+    struct Entry {
+        int result;
+        std::string resultExtra;
+    };
+
+    typedef std::map<std::string, Entry> PrivilegeMap;
+    typedef std::map<std::string, PrivilegeMap> UserMap;
+    typedef std::map<std::string, UserMap> ClientMap;
+
+    struct MirroredBucket {
+        bool userLinksOnly;
+        bool loaded;
+        ClientMap clients;
+    };
+
+    bool accepts(const MirroredBucket &mirrored, const std::string &client,
+        const std::string &privilege) const;
+
+    std::map<std::string, MirroredBucket> m_buckets;
+};
+
 class CynaraAdmin
 {
 public:
@@ -207,6 +309,12 @@ public:
         const std::string &privilege,
         std::vector<CynaraAdminPolicy> &policies);
 
+    /**
+     * Reload in-memory mirror of security-manager owned buckets from Cynara.
+     * Needed when those buckets were modified bypassing security-manager.
+     */
+    void syncMirror();
+
     /**
      * Wrapper for Cynara API function cynara_admin_list_policies_descriptions.
      * It collects all policies descriptions, extracts names
@@ -295,6 +403,24 @@ public:
         const std::string &privilege);
 
 private:
+    /**
+     * Wrapper for Cynara API function cynara_admin_list_policies,
+     * bypassing the mirror.
+     */
+    void listPoliciesFromCynara(const std::string &bucketName,
+        const std::string &label,
+        const std::string &user,
+        const std::string &privilege,
+        std::vector<CynaraAdminPolicy> &policies);
+
+    /**
+     * Make sure mirrored bucket is loaded
+     *
+     * @param bucketName name of mirrored bucket
+     * @return false if bucket could not be fetched from Cynara
+     */
+    bool loadMirror(const std::string &bucketName);
+
     /**
      * Empty bucket using filter - matching rules will be removed
      *
@@ -336,12 +462,25 @@ private:
 
     struct cynara_admin *m_cynaraAdmin;
     bool m_policyDescriptionsInitialized;
+    CynaraAdminMirror m_mirror;
 };
 
 class Cynara
 {
 public:
-    Cynara();
+    /*
+     * Function returning type of policy applying to label, user and privilege,
+     * as stored in Cynara buckets (e.g. CYNARA_ADMIN_ALLOW or a plugin type).
+     */
+    typedef std::function<int(const std::string &label, const std::string &user,
+        const std::string &privilege)> PolicyTypeGetter;
+
+    /**
+     * @param policyType source of policy types, needed to tell decisions that
+     *        may be cached from answers of plugins. Without it, nothing is
+     *        cached by security-manager.
+     */
+    explicit Cynara(const PolicyTypeGetter &policyType = PolicyTypeGetter());
     ~Cynara();
 
     /**
@@ -356,8 +495,30 @@ public:
     bool check(const std::string &label, const std::string &privilege,
         const std::string &user, const std::string &session);
 
+    /**
+     * Drop all decisions cached by security-manager.
+     * Done whenever Cynara reports policy change; may be called when
+     * security-manager changes policy itself, not to wait for it.
+     */
+    void invalidateCache();
+
+    /**
+     * Get statistics of security-manager decision cache.
+     */
+    DecisionCache::Statistics getCacheStatistics();
+
+    /**
+     * Get generation of security-manager decision cache, changed whenever
+     * the cache is dropped. Decisions made in an older generation are stale.
+     */
+    unsigned getCacheGeneration();
+
 private:
-    static const int CACHE_SIZE = 100;
+    static const int CACHE_SIZE = CYNARA_CACHE_SIZE;
+    static const int CACHE_TTL = CYNARA_CACHE_TTL;
+
+    bool askCynara(const std::string &label, const std::string &privilege,
+        const std::string &user, const std::string &session);
 
     void statusCallback(int oldFd, int newFd, cynara_async_status status);
 
@@ -380,6 +541,9 @@ private:
     std::atomic<int> m_cynaraFd;
     std::atomic<short> m_cynaraFdEvents;
     std::atomic<bool> m_terminate;
+
+    PolicyTypeGetter m_policyType;
+    DecisionCache m_decisions;
 };
 
 } // namespace SecurityManager
@@ -0,0 +1,213 @@
+/*
+ *  Copyright (c) 2017 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License
+ */
+/*
+ * @file        decision-cache.h
+ * @version     1.0
+ * @brief       Cynara decisions remembered by security-manager
+ */
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <list>
+#include <map>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <utility>
+
+namespace SecurityManager {
+
+/**
+ * Decisions of Cynara kept in front of its client cache.
+ *
+ * Only decisions coming from plain ALLOW/DENY policies are kept, each for
+ * the session it was made in and for no longer than the time to live.
+ * Answers of plugins (e.g. "Ask user") are always left to Cynara, only the
+ * policy type is remembered, so that it is not looked up on every check.
+ *
+ * Everything is dropped by clear(), which must be called whenever policy in
+ * Cynara changes. Answers that were asked for before clear() are not stored:
+ * put() is given the generation taken before asking.
+ */
+class DecisionCache {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    /* label, user, privilege */
+    typedef std::tuple<std::string, std::string, std::string> PolicyKey;
+
+    struct Statistics {
+        size_t hits;
+        size_t misses;
+        size_t entries;
+        size_t clears;
+    };
+
+    DecisionCache(size_t size, Clock::duration ttl)
+      : m_decisions(size, ttl)
+      , m_types(size, ttl)
+      , m_generation(0)
+      , m_hits(0)
+      , m_misses(0)
+      , m_clears(0)
+    {}
+
+    /**
+     * Get decision made for policy in session.
+     *
+     * @param[in] key label, user and privilege checked
+     * @param[in] session session of the check
+     * @param[out] allowed the decision
+     * @return false if there is no decision cached
+     */
+    bool get(const PolicyKey &key, const std::string &session, bool &allowed)
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        if (!m_decisions.get(DecisionKey(key, session), allowed)) {
+            ++m_misses;
+            return false;
+        }
+        ++m_hits;
+        return true;
+    }
+
+    /**
+     * Get type of policy, as found in Cynara buckets.
+     *
+     * @return false if type of policy is not known
+     */
+    bool getType(const PolicyKey &key, int &type)
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        return m_types.get(key, type);
+    }
+
+    /* Generation to be passed to put() and putType() after asking Cynara */
+    unsigned generation()
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        return m_generation;
+    }
+
+    /**
+     * Store decision made by plain ALLOW/DENY policy.
+     *
+     * @param generation value of generation() taken before asking Cynara
+     */
+    void put(const PolicyKey &key, const std::string &session, bool allowed, unsigned generation)
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        if (generation == m_generation)
+            m_decisions.put(DecisionKey(key, session), allowed);
+    }
+
+    void putType(const PolicyKey &key, int type, unsigned generation)
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        if (generation == m_generation)
+            m_types.put(key, type);
+    }
+
+    void clear()
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        ++m_generation;
+        ++m_clears;
+        m_decisions.clear();
+        m_types.clear();
+    }
+
+    Statistics statistics()
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        return Statistics{m_hits, m_misses, m_decisions.size(), m_clears};
+    }
+
+private:
+    typedef std::pair<PolicyKey, std::string> DecisionKey;
+
+    /* Least recently used entries are dropped first, expired ones on access */
+    template <typename Key, typename Value>
+    class Lru {
+    public:
+        Lru(size_t size, Clock::duration ttl)
+          : m_size(size)
+          , m_ttl(ttl)
+        {}
+
+        bool get(const Key &key, Value &value)
+        {
+            auto it = m_index.find(key);
+            if (it == m_index.end())
+                return false;
+            if (it->second->expiry <= Clock::now()) {
+                m_entries.erase(it->second);
+                m_index.erase(it);
+                return false;
+            }
+            m_entries.splice(m_entries.end(), m_entries, it->second);
+            value = it->second->value;
+            return true;
+        }
+
+        void put(const Key &key, const Value &value)
+        {
+            auto it = m_index.find(key);
+            if (it != m_index.end()) {
+                m_entries.erase(it->second);
+                m_index.erase(it);
+            } else if (m_entries.size() >= m_size) {
+                if (m_entries.empty())
+                    return;
+                m_index.erase(m_entries.front().key);
+                m_entries.pop_front();
+            }
+            m_index[key] = m_entries.insert(m_entries.end(),
+                                            Entry{key, value, Clock::now() + m_ttl});
+        }
+
+        void clear()
+        {
+            m_index.clear();
+            m_entries.clear();
+        }
+
+        size_t size() const { return m_entries.size(); }
+
+    private:
+        struct Entry {
+            Key key;
+            Value value;
+            Clock::time_point expiry;
+        };
+
+        size_t m_size;
+        Clock::duration m_ttl;
+        std::list<Entry> m_entries;
+        std::map<Key, typename std::list<Entry>::iterator> m_index;
+    };
+
+    std::mutex m_mutex;
+    Lru<DecisionKey, bool> m_decisions;
+    Lru<PolicyKey, int> m_types;
+    unsigned m_generation;
+    size_t m_hits;
+    size_t m_misses;
+    size_t m_clears;
+};
+
+} // namespace SecurityManager
@@ -0,0 +1,52 @@
+/*
+ *  Copyright (c) 2017 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License
+ */
+/*
+ * @file        group-generation.h
+ * @version     1.0
+ * @brief       Generation counter published by the service to invalidate
+ * @brief       privileged group information cached by clients
+ */
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace SecurityManager {
+namespace GroupGeneration {
+
+/**
+ * Return path to the world readable file holding the generation counter.
+ */
+const std::string &getGenerationFileLocation();
+
+/**
+ * Increment the published generation, creating the file if needed.
+ * Must be called by the service whenever privileged group information
+ * cached by clients may have become stale. Failures are only logged,
+ * clients not seeing the file simply don't cache.
+ */
+void bump();
+
+/**
+ * Read the currently published generation.
+ *
+ * @param[out] generation current generation
+ * @return false if no generation is published, caching must not be used then
+ */
+bool read(uint32_t &generation);
+
+} // GroupGeneration
+} // SecurityManager
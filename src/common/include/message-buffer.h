@@ -28,6 +28,7 @@
 
 #include <dpl/binary_queue.h>
 #include <dpl/exception.h>
+#include <dpl/flat_serialization.h>
 #include <dpl/serialization.h>
 
 namespace SecurityManager {
@@ -49,15 +50,55 @@ public:
 
     void Push(const RawBuffer &data);
 
+    /* Same as Push(), but takes over the data instead of copying it */
+    void Push(RawBuffer &&data);
+
     RawBuffer Pop();
 
     bool Ready();
 
     virtual void Read(size_t num, void *bytes);
 
+    /* Same as Read(), but leaves the bytes in the buffer */
+    void Peek(size_t num, void *bytes);
+
     virtual void Write(size_t num, const void *bytes);
 
+    /* Read value written with FlatSerialization::Encode(), in one pass */
+    template <typename T>
+    void ReadFlat(T &value) {
+        ReadFlatWith([&](const unsigned char *data, size_t size) {
+            return FlatDeserialization::Decode(data, size, value);
+        });
+    }
+
+    /* Read value written with FlatSerialization::EncodeAs<Fields>() */
+    template <typename Fields, typename T>
+    void ReadFlatAs(T &object) {
+        ReadFlatWith([&](const unsigned char *data, size_t size) {
+            return FlatDeserialization::DecodeAs<Fields>(data, size, object);
+        });
+    }
+
 protected:
+    /* Decode rest of the message and consume bytes used */
+    template <typename Decode>
+    void ReadFlatWith(Decode decode) {
+        RawBuffer flat;
+        const unsigned char *data = DataLeft(flat);
+        size_t used;
+        Try {
+            used = decode(data, m_bytesLeft);
+        } Catch(FlatReader::Exception::Base) {
+            ReThrowMsg(Exception::OutOfData, "Protocol broken");
+        }
+        m_buffer.Consume(used);
+        m_bytesLeft -= used;
+    }
+
+    /* Rest of the message in one piece: in place if it is stored so,
+     * flattened to the given buffer otherwise */
+    const unsigned char *DataLeft(RawBuffer &flat);
 
     inline void CountBytesLeft() {
         if (m_bytesLeft > 0)
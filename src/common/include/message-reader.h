@@ -0,0 +1,92 @@
+/*
+ *  Copyright (c) 2017 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License
+ */
+/*
+ * @file        message-reader.h
+ * @version     1.0
+ * @brief       Receiving of whole messages from a socket.
+ *
+ * Messages are framed the way MessageBuffer::Pop() does it: size_t length
+ * of the payload, then the payload. The first receive takes a small chunk,
+ * usually the whole message. Once the length is known, one buffer of the
+ * exact message size is allocated and the rest is received straight into
+ * it, so a big message takes only as many syscalls as the socket buffer
+ * requires and is handed over without copying. Messages over the limit
+ * given by the reader's side are received into a buffer growing with data.
+ */
+
+#pragma once
+
+#include <sys/types.h>
+
+#include <cstddef>
+
+#include <message-buffer.h>
+
+namespace SecurityManager {
+
+class MessageReader {
+public:
+    /* Replies of the service, which is trusted, may be taken in one buffer */
+    static const size_t REPLY_PREALLOC = 16 * 1024 * 1024;
+    /* Requests come from any local process, allocate about a socket buffer
+     * at once and the rest only as data comes */
+    static const size_t REQUEST_PREALLOC = 64 * 1024;
+
+    /**
+     * @param[in] maxPrealloc messages up to that size get their whole buffer
+     *                        at once, bigger ones grow as data comes, so a
+     *                        bogus length can't make us allocate it all
+     */
+    explicit MessageReader(size_t maxPrealloc = REPLY_PREALLOC);
+
+    /**
+     * Receive data of the current message.
+     *
+     * @param[in] sock socket to read from
+     * @return same as recv(): number of bytes received, 0 if the peer closed
+     *         the connection, -1 with errno set on error
+     */
+    ssize_t Receive(int sock);
+
+    /**
+     * Take next complete message, together with its length.
+     *
+     * @param[out] message the message, ready for MessageBuffer::Push()
+     * @return false if there is no complete message yet
+     */
+    bool Pop(RawBuffer &message);
+
+    /* Number of bytes received but not taken yet */
+    size_t Size() const { return m_size; }
+
+    /* Number of bytes allocated for messages being received */
+    size_t Allocated() const { return m_buffer.size(); }
+
+    void Clear();
+
+private:
+    /* Size of the first message, 0 if its length is not received yet */
+    size_t MessageSize() const;
+
+    /* Bytes received before the message length is known */
+    static const size_t CHUNK = 4096;
+
+    RawBuffer m_buffer;
+    size_t m_size;
+    size_t m_maxPrealloc;
+};
+
+} // namespace SecurityManager
@@ -27,6 +27,7 @@
 
 #include <cstdlib>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include <dpl/exception.h>
@@ -46,6 +47,59 @@ public:
     DECLARE_EXCEPTION_TYPE(Base, FileRemoveError)
 };
 
+/**
+ * Set of labels built by replaying records of a permissible file
+ */
+class LabelSet {
+public:
+    /**
+     * Apply one record (line) of a permissible file.
+     *
+     * @param[in] record label to be added or tombstone of label to be removed
+     * @return true if the set has changed
+     */
+    bool apply(const std::string &record);
+
+    void getLabels(std::vector<std::string> &labels) const;
+    void getLabels(std::vector<const char *> &labels) const;
+    void clear();
+
+    size_t records() const { return m_records; }
+    size_t live() const { return m_index.size(); }
+
+private:
+    size_t m_records = 0;
+    std::vector<std::string> m_labels;
+    std::vector<bool> m_present;
+    std::unordered_map<std::string, size_t> m_index;
+};
+
+/**
+ * Reader of a permissible file keeping its state between reads, so that
+ * only records appended since previous read are parsed.
+ */
+class PermissibleFileReader {
+public:
+    explicit PermissibleFileReader(const std::string &nameFile);
+
+    /**
+     * Read changes of the file
+     * @throws FileLockError
+     * @throws FileOpenError
+     * @throws FileReadError
+     *
+     * @return true if set of labels has changed since previous update
+     */
+    bool update();
+
+    const LabelSet &labels() const { return m_set; }
+
+private:
+    std::string m_nameFile;
+    std::string m_content;
+    LabelSet m_set;
+};
+
 /**
  * Return path to file with current list of application labels
  * installed globally or locally for the user.
@@ -57,7 +111,8 @@ public:
 std::string getPerrmissibleFileLocation(uid_t uid, int installationType);
 
 /**
- * Update permissable file with current content of database
+ * Update permissable file with current content of database, replacing
+ * whole content of the file
  * @throws FileLockError
  * @throws FileOpenError
  * @throws FileWriteError
@@ -71,7 +126,47 @@ void updatePermissibleFile(uid_t uid, int installationType,
                            const std::vector<std::string> &labelsForUser);
 
 /**
- * Read labels from a file into a vector
+ * Same as above, for the file at given path
+ *
+ * @param[in] nameFile path to the labels file
+ * @param[in] labelsForUser set of labels permitted
+ */
+void updatePermissibleFile(const std::string &nameFile,
+                           const std::vector<std::string> &labelsForUser);
+
+/**
+ * Update permissable file with labels added and removed since its last update.
+ * Changes are appended to the file (removals as tombstone records) and synced
+ * to disk once per call. The file is compacted when most of its records are
+ * no longer relevant.
+ * @throws FileLockError
+ * @throws FileOpenError
+ * @throws FileReadError
+ * @throws FileWriteError
+ *
+ * @param[in] uid user id
+ * @param[in] installationType type of installation (global or local)
+ * @param[in] labelsToAdd labels that are now permitted for given user
+ * @param[in] labelsToRemove labels that are no longer permitted for given user
+ */
+void updatePermissibleFile(uid_t uid, int installationType,
+                           const std::vector<std::string> &labelsToAdd,
+                           const std::vector<std::string> &labelsToRemove);
+
+/**
+ * Same as above, for the file at given path
+ *
+ * @param[in] nameFile path to the labels file
+ * @param[in] labelsToAdd labels that are now permitted
+ * @param[in] labelsToRemove labels that are no longer permitted
+ */
+void updatePermissibleFile(const std::string &nameFile,
+                           const std::vector<std::string> &labelsToAdd,
+                           const std::vector<std::string> &labelsToRemove);
+
+/**
+ * Read labels from a file into a vector. Both plain list of labels and
+ * log written by incremental updates are accepted.
  * @throws FileLockError
  * @throws FileOpenError
  * @throws FileReadError
@@ -47,11 +47,26 @@ public:
 
     bool hasAttribute(PrivilegeAttr attr);
 
+    /**
+     * Drop privilege types cached for given package. Must be called when
+     * the package is installed, updated or removed.
+     */
+    static void invalidateCache(const std::string &pkgName);
+
+    /**
+     * Drop all cached privilege types (e.g. after blacklist policy change).
+     */
+    static void invalidateCache();
+
 private:
+    int getType();
+
     uid_t m_uid;
     std::string m_appId;
     std::string m_pkgId;
     std::string m_privilege;
+    bool m_typeKnown;
+    int m_type;
 };
 
 } // namespace SecurityManager
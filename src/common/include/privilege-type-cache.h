@@ -0,0 +1,78 @@
+/*
+ *  Copyright (c) 2017 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License
+ */
+/*
+ * @file       privilege-type-cache.h
+ * @brief      Memoizing cache of privilege types used by PrivilegeInfo
+ */
+
+#pragma once
+
+#include <sys/types.h>
+
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+
+namespace SecurityManager {
+
+/**
+ * Memoizes privilege types returned by an external resolver.
+ *
+ * Entries are keyed by (uid, package, privilege) and grouped per package,
+ * so that a package (re)installation or removal drops exactly the types
+ * computed for it. The resolver is called without the cache lock held and
+ * may throw; failed lookups are not cached.
+ */
+class PrivilegeTypeCache {
+public:
+    typedef std::function<int(uid_t uid, const std::string &pkgName,
+                              const std::string &privilege)> Resolver;
+
+    explicit PrivilegeTypeCache(Resolver resolver);
+
+    /**
+     * Return the type of privilege for given user and package, calling
+     * the resolver only if it is not cached yet.
+     */
+    int get(uid_t uid, const std::string &pkgName, const std::string &privilege);
+
+    /**
+     * Drop all types cached for given package.
+     */
+    void invalidate(const std::string &pkgName);
+
+    /**
+     * Drop all cached types.
+     */
+    void invalidate();
+
+    size_t size() const;
+
+private:
+    typedef std::pair<uid_t, std::string> UidPrivilege;
+    typedef std::map<UidPrivilege, int> PkgTypes;
+
+    Resolver m_resolver;
+    mutable std::mutex m_mutex;
+    std::map<std::string, PkgTypes> m_types;
+    size_t m_size;
+    /* bumped on invalidation so that in-flight lookups are not stored */
+    unsigned m_generation;
+};
+
+} // namespace SecurityManager
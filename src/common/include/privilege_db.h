@@ -90,12 +90,30 @@ enum class StmtType {
     EGetLicenseForClientPrivilegeAndApp,
     EGetLicenseForClientPrivilegeAndPkg,
     EIsUserPkgInstalled,
+    EGetAppIdByName,
+    EGetForeignAppDefinedPrivileges,
+    EAddAppDefinedPrivilegeById,
+    EAddClientPrivilegeById,
+    EGetLicenseBundle,
 };
 
 // privilege, app_defined_privilege_type, license
 typedef std::tuple<std::string, int, std::string> AppDefinedPrivilege;
 typedef std::vector<AppDefinedPrivilege> AppDefinedPrivilegesVector;
 
+/*
+ * Everything license manager needs to verify access of a client application
+ * to an app defined privilege: provider of the privilege and licenses of both.
+ */
+struct LicenseBundle {
+    std::string providerAppName;
+    std::string providerPkgName;
+    std::string providerLicense;
+    bool clientHybrid = false;
+    bool clientLicenseFound = false;
+    std::string clientLicense;
+};
+
 class PrivilegeDb {
     /**
      * PrivilegeDb database class
@@ -157,6 +175,25 @@ private:
         { StmtType::EGetLicenseForClientPrivilegeAndApp, "SELECT license FROM client_license_view WHERE app_name = ? AND uid = ? AND privilege = ? "},
         { StmtType::EGetLicenseForClientPrivilegeAndPkg, "SELECT license FROM client_license_view WHERE pkg_name = ? AND uid = ? AND privilege = ? "},
         { StmtType::EIsUserPkgInstalled, "SELECT count(*) FROM user_app_pkg_view WHERE pkg_name = ? AND uid = ?"},
+        { StmtType::EGetAppIdByName, "SELECT app_id FROM app WHERE name = ?"},
+        { StmtType::EGetForeignAppDefinedPrivileges, "SELECT DISTINCT privilege FROM app_defined_privilege WHERE app_id != ?"},
+        { StmtType::EAddAppDefinedPrivilegeById, "INSERT INTO app_defined_privilege (app_id, uid, privilege, type, license) VALUES (?, ?, ?, ?, ?)"},
+        { StmtType::EAddClientPrivilegeById, "INSERT INTO client_license (app_id, uid, privilege, license) VALUES (?, ?, ?, ?)"},
+        // ?1 privilege, ?2 uid, ?3 global uid, ?4 client pkg_name, ?5 client app_name
+        { StmtType::EGetLicenseBundle,
+            "SELECT provider.app_name, provider.pkg_name, provider.license, client.is_hybrid,"
+            " (SELECT license FROM client_license_view"
+            "  WHERE privilege = ?1 AND uid = client.license_uid"
+            "  AND CASE WHEN client.is_hybrid THEN app_name = ?5 ELSE pkg_name = ?4 END"
+            "  LIMIT 1)"
+            " FROM (SELECT app_name, pkg_name, license, uid FROM app_defined_privilege_view AS adp"
+            "       WHERE privilege = ?1 AND (uid = ?2 OR (uid = ?3 AND NOT EXISTS"
+            "         (SELECT 1 FROM user_app_pkg_view WHERE pkg_name = adp.pkg_name AND uid = ?2)))"
+            "       ORDER BY uid = ?2 DESC LIMIT 1) AS provider"
+            " LEFT JOIN (SELECT is_hybrid, CASE WHEN EXISTS"
+            "              (SELECT 1 FROM user_app_pkg_view WHERE pkg_name = ?4 AND uid = ?2)"
+            "            THEN ?2 ELSE ?3 END AS license_uid"
+            "            FROM pkg WHERE name = ?4) AS client"},
     };
 
     /**
@@ -182,6 +219,16 @@ private:
      */
     StatementWrapper getStatement(StmtType queryType);
 
+    /**
+     * Resolve internal database identifier of application.
+     *
+     * @param appName application identifier
+     * @return internal application identifier
+     *
+     * @exception PrivilegeDb::Exception::ConstraintError if application does not exist
+     */
+    int getAppId(const std::string &appName);
+
 public:
     class Exception
     {
@@ -566,6 +613,10 @@ public:
     /**
      * Add vector of privileges defined by application
      *
+     * Application identifier is resolved once and all rows are inserted
+     * directly into the base table with a single reused statement, bypassing
+     * per-row view triggers. Should be called within a transaction.
+     *
      * @param[in] appName - application identifier
      * @param[in] uid - user identifier
      * @param[in] privileges - list of privileges
@@ -589,6 +640,24 @@ public:
     void AddClientPrivilege(const std::string &appName, uid_t uid, const std::string &privilege,
                             const std::string &license);
 
+    /**
+     * Add vector of privileges and licenses used by client application
+     *
+     * Application identifier is resolved once and all rows are inserted
+     * directly into the base table with a single reused statement.
+     * Privileges with empty license are skipped. Should be called within
+     * a transaction.
+     *
+     * @param[in] appName - application identifier
+     * @param[in] uid - user identifier
+     * @param[in] privileges - list of pairs: privilege (1st value) and license (2nd value)
+     *
+     * @exception PrivilegeDb::Exception::InternalError on internal error
+     * @exception PrivilegeDb::Exception::ConstraintError on constraint violation
+     */
+    void AddClientPrivileges(const std::string &appName, uid_t uid,
+                             const std::vector<std::pair<std::string, std::string>> &privileges);
+
     /**
      * Remove privileges/licenses defined by application
      *
@@ -676,6 +745,34 @@ public:
                                             std::string &license);
 
 
+    /**
+     * Retrieve provider of app defined privilege together with licenses of
+     * the provider and of a client application, in a single query.
+     *
+     * Provider installed for the user takes precedence over global one.
+     * Global provider is ignored if the user has its own installation of
+     * the provider's package. Client license is searched for the user if
+     * the client package is installed for the user, globally otherwise;
+     * by application for hybrid packages, by package for the rest.
+     *
+     * @param[in]  uid - user identifier
+     * @param[in]  globalUid - identifier of global user
+     * @param[in]  privilege - privilege identifier
+     * @param[in]  clientPkgName - client application package
+     * @param[in]  clientAppName - client application identifier (for hybrid packages)
+     * @param[out] bundle - provider and licenses
+     *
+     * @exception PrivilegeDb::Exception::InternalError on internal error
+     * @exception PrivilegeDb::Exception::ConstraintError on constraint violation
+     * @return true if the provider of the privilege was found in the database
+     */
+    bool GetLicenseBundle(uid_t uid,
+                          uid_t globalUid,
+                          const std::string &privilege,
+                          const std::string &clientPkgName,
+                          const std::string &clientAppName,
+                          LicenseBundle &bundle);
+
     /**
      * Check whether user has installed package
      *
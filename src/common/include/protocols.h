@@ -29,6 +29,7 @@
 #include <vector>
 #include <string>
 #include <dpl/serialization.h>
+#include <dpl/flat_serialization.h>
 #include <security-manager-types.h>
 
 typedef std::vector<std::pair<std::string, int>> pkg_paths;
@@ -92,6 +93,9 @@ enum class SecurityModuleCall
     GET_APP_DEFINED_PRIVILEGE_PROVIDER,
     GET_APP_DEFINED_PRIVILEGE_LICENSE,
     GET_CLIENT_PRIVILEGE_LICENSE,
+    POLICY_RESYNC,
+    GET_LICENSE_BUNDLE,
+    POLICY_CACHE_STATISTICS,
     NOOP = 0x90,
 };
 
@@ -133,3 +137,52 @@ typedef struct policy_entry policy_entry;
 struct policy_update_req {
     std::vector<const policy_entry *> units;
 };
+
+namespace SecurityManager {
+
+/*
+ * Wire layouts of requests, in the order the fields are sent. Encoded bytes
+ * are the same as with Serialization::Serialize() of the fields one by one.
+ */
+
+template <>
+struct FlatLayout<app_inst_req> : FlatFields<app_inst_req,
+    FLAT_FIELD(app_inst_req, appName),
+    FLAT_FIELD(app_inst_req, pkgName),
+    FLAT_FIELD(app_inst_req, privileges),
+    FLAT_FIELD(app_inst_req, appDefinedPrivileges),
+    FLAT_FIELD(app_inst_req, pkgPaths),
+    FLAT_FIELD(app_inst_req, uid),
+    FLAT_FIELD(app_inst_req, tizenVersion),
+    FLAT_FIELD(app_inst_req, authorName),
+    FLAT_FIELD(app_inst_req, installationType),
+    FLAT_FIELD(app_inst_req, isHybrid)> {};
+
+/* Uninstallation request doesn't carry isHybrid */
+struct AppUninstallLayout : FlatFields<app_inst_req,
+    FLAT_FIELD(app_inst_req, appName),
+    FLAT_FIELD(app_inst_req, pkgName),
+    FLAT_FIELD(app_inst_req, privileges),
+    FLAT_FIELD(app_inst_req, appDefinedPrivileges),
+    FLAT_FIELD(app_inst_req, pkgPaths),
+    FLAT_FIELD(app_inst_req, uid),
+    FLAT_FIELD(app_inst_req, tizenVersion),
+    FLAT_FIELD(app_inst_req, authorName),
+    FLAT_FIELD(app_inst_req, installationType)> {};
+
+template <>
+struct FlatLayout<path_req> : FlatFields<path_req,
+    FLAT_FIELD(path_req, pkgName),
+    FLAT_FIELD(path_req, uid),
+    FLAT_FIELD(path_req, pkgPaths),
+    FLAT_FIELD(path_req, installationType)> {};
+
+template <>
+struct FlatLayout<policy_entry> : FlatFields<policy_entry,
+    FLAT_FIELD(policy_entry, user),
+    FLAT_FIELD(policy_entry, appName),
+    FLAT_FIELD(policy_entry, privilege),
+    FLAT_FIELD(policy_entry, currentLevel),
+    FLAT_FIELD(policy_entry, maxLevel)> {};
+
+} // namespace SecurityManager
@@ -26,6 +26,10 @@
 #include <unistd.h>
 #include <sys/types.h>
 
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
 #include <vector>
 
 #include "credentials.h"
@@ -34,6 +38,7 @@
 #include "smack-rules.h"
 #include "protocols.h"
 #include "privilege_db.h"
+#include "user-groups-cache.h"
 
 namespace SecurityManager {
 
@@ -42,6 +47,34 @@ public:
     ServiceImpl();
     virtual ~ServiceImpl();
 
+    /**
+    * Prepare for serving requests in the daemon: drop caches of group
+    * information that might have changed while it wasn't running and load
+    * mirror of Cynara buckets. Off-line mode doesn't call it, as each of its
+    * calls runs only one request or one session.
+    */
+    void start();
+
+    /**
+    * Start a batch of requests processed by this object, used by off-line mode
+    * sessions. Each request still commits its own database, Cynara and Smack
+    * rule changes, but merged Smack rules and permissible sets are updated
+    * only once at the end instead of after every request. If the batch is cut
+    * short, only those files are left behind the database, until they are
+    * rewritten from it on their next update.
+    *
+    * @return API return code, as defined in protocols.h
+    */
+    int beginBatch();
+
+    /**
+    * Finish a batch started with beginBatch(): update files deferred during
+    * the batch.
+    *
+    * @return API return code, as defined in protocols.h
+    */
+    int endBatch();
+
     /**
     * Process application installation request.
     *
@@ -154,6 +187,28 @@ public:
     */
     int policyGetDesc(std::vector<std::string> &descriptions);
 
+    /**
+    * Process reloading of in-memory mirror of Cynara buckets owned by
+    * security-manager. Needed after those buckets were modified directly
+    * in Cynara.
+    *
+    * @param[in] creds credentials of the requesting process
+    *
+    * @return API return code, as defined in protocols.h
+    */
+    int policyResync(const Credentials &creds);
+
+    /**
+    * Process getting statistics of Cynara decisions cached by security-manager.
+    *
+    * @param[in] creds credentials of the requesting process
+    * @param[out] hits number of checks answered from the cache
+    * @param[out] misses number of checks passed to Cynara
+    *
+    * @return API return code, as defined in protocols.h
+    */
+    int policyCacheStatistics(const Credentials &creds, unsigned &hits, unsigned &misses);
+
     /**
      * Process getting resources group list.
      *
@@ -289,6 +344,24 @@ public:
                                   uid_t uid, const std::string &privilege,
                                   std::string &license);
 
+    /**
+     * Retrieves everything needed to verify license of a client for app defined
+     * privilege: provider application and package, provider license and client
+     * license, together with identity of the client.
+     *
+     * @param[in]  uid       user identifier
+     * @param[in]  client    Cynara client identifier (Smack label) of application using privilege
+     * @param[in]  privilege privilege name
+     * @param[out] clientAppName returns app_id of client (empty for non-hybrid packages)
+     * @param[out] clientPkgName returns pkg_id of client
+     * @param[out] bundle    returns provider and licenses
+     *
+     * @return API return code, as defined in protocols.h
+     */
+    int getLicenseBundle(uid_t uid, const std::string &client, const std::string &privilege,
+                         std::string &clientAppName, std::string &clientPkgName,
+                         LicenseBundle &bundle);
+
 private:
     bool authenticate(const Credentials &creds, const std::string &privilege);
 
@@ -322,6 +395,8 @@ private:
 
     void getPkgLabels(const std::string &pkgName, SmackRules::Labels &pkgsLabels);
 
+    void getUserPkgLabels(uid_t uid, const std::string &pkgName, SmackRules::Labels &pkgsLabels);
+
     static bool isSharedRO(const pkg_paths& paths);
 
     int squashDropPrivateSharing(const std::string &ownerAppName,
@@ -335,7 +410,15 @@ private:
                               const std::string &targetAppLabel,
                               const std::string &path);
 
-    void updatePermissibleSet(uid_t uid, int type);
+    typedef std::map<std::string, bool> PermissibleSetChanges;
+
+    void updatePermissibleSet(uid_t uid, int type, const SmackRules::Labels &oldLabels,
+                              const SmackRules::Labels &newLabels);
+
+    void writePermissibleSet(uid_t uid, int type, const PermissibleSetChanges &changes,
+                             bool consistent);
+
+    void mergeSmackRules();
 
     std::string getAppProcessLabel(const std::string &appName, const std::string &pkgName);
 
@@ -352,6 +435,13 @@ private:
     Cynara m_cynara;
     PrivilegeDb m_privilegeDb;
     CynaraAdmin m_cynaraAdmin;
+    UserGroupsCache m_userGroupsCache;
+
+    bool m_batch;
+    bool m_batchMergeRules;
+    std::map<std::pair<uid_t, int>, PermissibleSetChanges> m_batchPermissibleSets;
+    // permissible files rewritten from the database by this object and updated since
+    std::set<std::pair<uid_t, int>> m_consistentPermissibleSets;
 };
 
 } /* namespace SecurityManager */
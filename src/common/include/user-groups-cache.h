@@ -0,0 +1,80 @@
+/*
+ *  Copyright (c) 2017 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License
+ */
+/*
+ * @file        user-groups-cache.h
+ * @version     1.0
+ * @brief       Per-user cache files of privileged groups, maintained by the
+ * @brief       service and read by the NSS module
+ */
+#pragma once
+
+#include <sys/types.h>
+
+#include <string>
+#include <vector>
+
+namespace SecurityManager {
+
+/**
+ * Directory of world readable files, one per user, holding gids of
+ * privileged groups the user's processes should get. A file is written by
+ * the service when it computes the groups anyway and removed whenever they
+ * may change, so an existing file is always up to date. All operations are
+ * best effort: failures are logged and the caller falls back to asking
+ * the service.
+ */
+class UserGroupsCache {
+public:
+    explicit UserGroupsCache(const std::string &dir = LOCAL_STATE_DIR "/security-manager/groups");
+
+    /**
+     * Store groups of a user, atomically replacing previous entry.
+     *
+     * @param[in] uid user identifier
+     * @param[in] managed false if the user is not managed by security-manager
+     * @param[in] gids privileged groups of the user, all of them for an
+     *                 unmanaged user
+     * @return true on success
+     */
+    bool store(uid_t uid, bool managed, const std::vector<gid_t> &gids);
+
+    /**
+     * Read groups of a user.
+     *
+     * @param[in] uid user identifier
+     * @param[out] managed false if the user is not managed by security-manager
+     * @param[out] gids privileged groups of the user
+     * @return false if there is no valid entry for the user
+     */
+    bool load(uid_t uid, bool &managed, std::vector<gid_t> &gids) const;
+
+    /**
+     * Drop entry of a user.
+     */
+    void remove(uid_t uid);
+
+    /**
+     * Drop entries of all users.
+     */
+    void clear();
+
+private:
+    std::string getPath(uid_t uid) const;
+
+    std::string m_dir;
+};
+
+} // namespace SecurityManager
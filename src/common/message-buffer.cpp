@@ -26,12 +26,28 @@
 
 #include <dpl/log/log.h>
 
+namespace {
+
+void DeleteRawBuffer(const void *, size_t, void *userParam) {
+    delete static_cast<SecurityManager::RawBuffer *>(userParam);
+}
+
+} // namespace anonymous
+
 namespace SecurityManager {
 
 void MessageBuffer::Push(const RawBuffer &data) {
     m_buffer.AppendCopy(&data[0], data.size());
 }
 
+void MessageBuffer::Push(RawBuffer &&data) {
+    if (data.empty())
+        return;
+
+    RawBuffer *owned = new RawBuffer(std::move(data));
+    m_buffer.AppendUnmanaged(&(*owned)[0], owned->size(), &DeleteRawBuffer, owned);
+}
+
 RawBuffer MessageBuffer::Pop() {
     size_t size = m_buffer.Size();
     RawBuffer buffer;
@@ -61,6 +77,34 @@ void MessageBuffer::Read(size_t num, void *bytes) {
     m_bytesLeft -= num;
 }
 
+void MessageBuffer::Peek(size_t num, void *bytes) {
+    CountBytesLeft();
+    if (num > m_bytesLeft || num > m_buffer.Size()) {
+        LogError("Protocol broken. OutOfData. Asked for: " << num << " Ready: " << m_bytesLeft << " Buffer.size(): " << m_buffer.Size());
+        Throw(Exception::OutOfData);
+    }
+
+    m_buffer.Flatten(bytes, num);
+}
+
+const unsigned char *MessageBuffer::DataLeft(RawBuffer &flat) {
+    CountBytesLeft();
+    if (m_bytesLeft > m_buffer.Size()) {
+        LogError("Protocol broken. OutOfData. Ready: " << m_bytesLeft << " Buffer.size(): " << m_buffer.Size());
+        Throw(Exception::OutOfData);
+    }
+
+    // usually the whole request was pushed at once and sits in a single bucket
+    size_t frontSize;
+    const void *front = m_buffer.Front(frontSize);
+    if (frontSize >= m_bytesLeft)
+        return static_cast<const unsigned char *>(front);
+
+    flat.resize(m_bytesLeft);
+    m_buffer.Flatten(flat.data(), m_bytesLeft);
+    return flat.data();
+}
+
 void MessageBuffer::Write(size_t num, const void *bytes) {
     m_buffer.AppendCopy(bytes, num);
 }
@@ -0,0 +1,102 @@
+/*
+ *  Copyright (c) 2017 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License
+ */
+/*
+ * @file        message-reader.cpp
+ * @version     1.0
+ * @brief       Implementation of MessageReader.
+ */
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#include <message-reader.h>
+
+namespace SecurityManager {
+
+const size_t MessageReader::CHUNK;
+const size_t MessageReader::REPLY_PREALLOC;
+const size_t MessageReader::REQUEST_PREALLOC;
+
+MessageReader::MessageReader(size_t maxPrealloc)
+  : m_size(0)
+  , m_maxPrealloc(maxPrealloc)
+{}
+
+size_t MessageReader::MessageSize() const
+{
+    if (m_size < sizeof(size_t))
+        return 0;
+
+    size_t length;
+    memcpy(&length, &m_buffer[0], sizeof(length));
+    if (length > std::numeric_limits<size_t>::max() - sizeof(size_t))
+        return std::numeric_limits<size_t>::max();
+    return sizeof(size_t) + length;
+}
+
+ssize_t MessageReader::Receive(int sock)
+{
+    size_t messageSize = MessageSize();
+    size_t capacity;
+    if (messageSize <= m_size)
+        capacity = m_size + CHUNK;
+    else if (messageSize <= m_maxPrealloc)
+        capacity = messageSize;
+    else
+        capacity = std::min(messageSize, m_size + std::max(m_size, CHUNK));
+
+    if (m_buffer.size() < capacity)
+        m_buffer.resize(capacity);
+
+    ssize_t size = TEMP_FAILURE_RETRY(recv(sock, &m_buffer[m_size], capacity - m_size, 0));
+    if (size > 0)
+        m_size += size;
+    return size;
+}
+
+bool MessageReader::Pop(RawBuffer &message)
+{
+    size_t messageSize = MessageSize();
+    if (messageSize == 0 || messageSize > m_size)
+        return false;
+
+    if (messageSize == m_size) {
+        // the usual case, buffer holds just the message
+        m_buffer.resize(m_size);
+        message = std::move(m_buffer);
+        m_buffer = RawBuffer();
+        m_size = 0;
+        return true;
+    }
+
+    // more messages received at once, the rest stays
+    message.assign(m_buffer.begin(), m_buffer.begin() + messageSize);
+    m_buffer.erase(m_buffer.begin(), m_buffer.begin() + messageSize);
+    m_size -= messageSize;
+    return true;
+}
+
+void MessageReader::Clear()
+{
+    m_buffer = RawBuffer();
+    m_size = 0;
+}
+
+} // namespace SecurityManager
@@ -27,11 +27,15 @@
 #define _GNU_SOURCE
 #endif
 
+#include <algorithm>
 #include <cstdio>
 #include <cstring>
+#include <fcntl.h>
 #include <fstream>
 #include <linux/xattr.h>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <pwd.h>
 #include <string>
 #include <sys/file.h>
@@ -39,6 +43,7 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
+#include <unordered_map>
 
 #include <config.h>
 #include <dpl/errno_string.h>
@@ -51,6 +56,7 @@
 #include <security-manager-types.h>
 #include <smack-labels.h>
 #include <tzplatform_config.h>
+#include <utils.h>
 
 #include "tzplatform-config.h"
 
@@ -104,31 +110,298 @@ static void markPermissibleFileValid(int fd, const std::string &nameFile, bool v
     }
 }
 
-void updatePermissibleFile(uid_t uid, int installationType,
-                           const std::vector<std::string> &labelsForUser)
+namespace {
+
+/*
+ * Permissible file is a log of records, one per line. A plain label adds
+ * it to the set, a label preceded by TOMBSTONE removes it. Smack labels
+ * can't start with '-', so a file with only plain labels (the format used
+ * before) is a valid log as well. An unterminated last line is a leftover
+ * of an interrupted append and is ignored.
+ */
+const char TOMBSTONE = '-';
+
+/* Compaction is done when dead records outnumber live labels */
+const size_t COMPACTION_MIN_DEAD_RECORDS = 64;
+
+struct LogStats {
+    off_t size;
+    size_t records;
+    size_t live;
+};
+
+/* Stats of files written by this process, saving a scan on each append */
+std::mutex g_logStatsMutex;
+std::map<std::string, LogStats> g_logStats;
+
+/* Returns length of the content up to and including the last complete line */
+off_t parseLog(const std::string &content, LabelSet &set)
 {
-    std::string nameFile = getPerrmissibleFileLocation(uid, installationType);
-    std::ofstream fstream;
-    openAndLockNameFile(nameFile, fstream);
-    markPermissibleFileValid(getFd(fstream), nameFile, false);
+    size_t pos = 0, eol;
+    while ((eol = content.find('\n', pos)) != std::string::npos) {
+        set.apply(content.substr(pos, eol - pos));
+        pos = eol + 1;
+    }
+    return pos;
+}
 
-    for (auto &label : labelsForUser) {
-        fstream << label << '\n';
-        if (fstream.bad()) {
+std::string readFd(int fd, const std::string &nameFile)
+{
+    std::string content;
+    char buffer[4096];
+    off_t offset = 0;
+    ssize_t ret;
+    while ((ret = TEMP_FAILURE_RETRY(pread(fd, buffer, sizeof(buffer), offset))) > 0) {
+        content.append(buffer, ret);
+        offset += ret;
+    }
+    if (ret < 0) {
+        LogError("Unable to read file " << nameFile << ": " << GetErrnoString(errno));
+        ThrowMsg(PermissibleSetException::FileReadError, "Unable to read file");
+    }
+    return content;
+}
+
+void writeFd(int fd, const std::string &nameFile, const std::string &data)
+{
+    size_t written = 0;
+    while (written < data.size()) {
+        ssize_t ret = TEMP_FAILURE_RETRY(write(fd, data.data() + written, data.size() - written));
+        if (ret <= 0) {
             LogError("Unable to write to file " << nameFile << ": " << GetErrnoString(errno));
-            ThrowMsg(PermissibleSetException::PermissibleSetException::FileWriteError,
-                    "Unable to write to file");
+            ThrowMsg(PermissibleSetException::FileWriteError, "Unable to write to file");
         }
+        written += ret;
     }
-    if (fstream.flush().fail()) {
-        LogError("Error at fflush " << nameFile << ": " << GetErrnoString(errno));
-        ThrowMsg(PermissibleSetException::FileWriteError, "Error at fflush");
-    }
-    if (fsync(getFd(fstream)) == -1) {
+}
+
+void syncFd(int fd, const std::string &nameFile)
+{
+    if (fsync(fd) == -1) {
         LogError("Error at fsync " << nameFile << ": " << GetErrnoString(errno));
         ThrowMsg(PermissibleSetException::FileWriteError, "Error at fsync");
     }
-    markPermissibleFileValid(getFd(fstream), nameFile, true);
+}
+
+int openAndLockLogFile(const std::string &nameFile)
+{
+    int fd = TEMP_FAILURE_RETRY(open(nameFile.c_str(), O_RDWR | O_APPEND | O_CREAT | O_CLOEXEC, 0444));
+    if (fd == -1) {
+        LogError("Unable to open file" << nameFile << ": " << GetErrnoString(errno));
+        ThrowMsg(PermissibleSetException::FileOpenError, "Unable to open file ");
+    }
+
+    if (TEMP_FAILURE_RETRY(flock(fd, LOCK_EX)) == -1) {
+        LogError("Unable to lock file " << nameFile << ": " << GetErrnoString(errno));
+        close(fd);
+        ThrowMsg(PermissibleSetException::FileLockError, "Unable to lock file");
+    }
+    return fd;
+}
+
+/* Replace content of a locked file with given labels */
+LogStats rewriteLogFile(int fd, const std::string &nameFile,
+                        const std::vector<std::string> &labels)
+{
+    markPermissibleFileValid(fd, nameFile, false);
+
+    std::string data;
+    for (const auto &label : labels) {
+        data += label;
+        data += '\n';
+    }
+
+    if (TEMP_FAILURE_RETRY(ftruncate(fd, 0)) == -1) {
+        LogError("Error at ftruncate " << nameFile << ": " << GetErrnoString(errno));
+        ThrowMsg(PermissibleSetException::FileWriteError, "Error at ftruncate");
+    }
+    writeFd(fd, nameFile, data);
+    syncFd(fd, nameFile);
+
+    markPermissibleFileValid(fd, nameFile, true);
+    return LogStats{static_cast<off_t>(data.size()), labels.size(), labels.size()};
+}
+
+} // namespace anonymous
+
+bool LabelSet::apply(const std::string &record)
+{
+    if (record.empty())
+        return false;
+    ++m_records;
+    if (record[0] == TOMBSTONE) {
+        auto it = m_index.find(record.substr(1));
+        if (it == m_index.end())
+            return false;
+        m_present[it->second] = false;
+        m_index.erase(it);
+        return true;
+    }
+    if (m_index.find(record) != m_index.end())
+        return false;
+    m_index.emplace(record, m_labels.size());
+    m_labels.push_back(record);
+    m_present.push_back(true);
+    return true;
+}
+
+void LabelSet::getLabels(std::vector<std::string> &labels) const
+{
+    for (size_t i = 0; i < m_labels.size(); ++i)
+        if (m_present[i])
+            labels.push_back(m_labels[i]);
+}
+
+void LabelSet::getLabels(std::vector<const char *> &labels) const
+{
+    for (size_t i = 0; i < m_labels.size(); ++i)
+        if (m_present[i])
+            labels.push_back(m_labels[i].c_str());
+}
+
+void LabelSet::clear()
+{
+    m_records = 0;
+    m_labels.clear();
+    m_present.clear();
+    m_index.clear();
+}
+
+PermissibleFileReader::PermissibleFileReader(const std::string &nameFile) :
+    m_nameFile(nameFile)
+{
+}
+
+bool PermissibleFileReader::update()
+{
+    int fd = TEMP_FAILURE_RETRY(open(m_nameFile.c_str(), O_RDONLY | O_CLOEXEC));
+    if (fd == -1) {
+        LogError("Unable to open file" << m_nameFile << ": " << GetErrnoString(errno));
+        ThrowMsg(PermissibleSetException::FileOpenError, "Unable to open file ");
+    }
+    auto closeFd = makeUnique(&fd, [](int *fd) { close(*fd); });
+
+    if (TEMP_FAILURE_RETRY(flock(fd, LOCK_EX)) == -1) {
+        LogError("Unable to lock file " << m_nameFile << ": " << GetErrnoString(errno));
+        ThrowMsg(PermissibleSetException::FileLockError, "Unable to lock file");
+    }
+
+    // Incomplete last record is left for the next update
+    std::string content = readFd(fd, m_nameFile);
+    content.resize(content.rfind('\n') + 1);
+
+    /* Records appended since last update are parsed on top of current set.
+     * If the already parsed part was changed, the file was rewritten. */
+    bool changed = false;
+    size_t parsed = 0;
+    if (content.size() >= m_content.size() &&
+        content.compare(0, m_content.size(), m_content) == 0) {
+        parsed = m_content.size();
+    } else {
+        changed = m_set.live() > 0;
+        m_set.clear();
+    }
+
+    size_t eol;
+    while ((eol = content.find('\n', parsed)) != std::string::npos) {
+        changed |= m_set.apply(content.substr(parsed, eol - parsed));
+        parsed = eol + 1;
+    }
+
+    m_content = std::move(content);
+    return changed;
+}
+
+
+void updatePermissibleFile(uid_t uid, int installationType,
+                           const std::vector<std::string> &labelsForUser)
+{
+    updatePermissibleFile(getPerrmissibleFileLocation(uid, installationType), labelsForUser);
+}
+
+void updatePermissibleFile(const std::string &nameFile,
+                           const std::vector<std::string> &labelsForUser)
+{
+    std::lock_guard<std::mutex> lock(g_logStatsMutex);
+    g_logStats.erase(nameFile);
+
+    int fd = openAndLockLogFile(nameFile);
+    auto closeFd = makeUnique(&fd, [](int *fd) { close(*fd); });
+    g_logStats[nameFile] = rewriteLogFile(fd, nameFile, labelsForUser);
+}
+
+void updatePermissibleFile(uid_t uid, int installationType,
+                           const std::vector<std::string> &labelsToAdd,
+                           const std::vector<std::string> &labelsToRemove)
+{
+    updatePermissibleFile(getPerrmissibleFileLocation(uid, installationType),
+                          labelsToAdd, labelsToRemove);
+}
+
+void updatePermissibleFile(const std::string &nameFile,
+                           const std::vector<std::string> &labelsToAdd,
+                           const std::vector<std::string> &labelsToRemove)
+{
+    if (labelsToAdd.empty() && labelsToRemove.empty())
+        return;
+
+    std::lock_guard<std::mutex> lock(g_logStatsMutex);
+    int fd = openAndLockLogFile(nameFile);
+    auto closeFd = makeUnique(&fd, [](int *fd) { close(*fd); });
+
+    struct stat st;
+    if (fstat(fd, &st) == -1) {
+        LogError("Error at fstat " << nameFile << ": " << GetErrnoString(errno));
+        ThrowMsg(PermissibleSetException::FileReadError, "Error at fstat");
+    }
+
+    // File unknown or modified by another process - scan it
+    auto statsIt = g_logStats.find(nameFile);
+    if (statsIt == g_logStats.end() || statsIt->second.size != st.st_size) {
+        g_logStats.erase(nameFile);
+        LabelSet set;
+        off_t complete = parseLog(readFd(fd, nameFile), set);
+        if (complete != st.st_size) {
+            LogWarning("Dropping incomplete record at the end of " << nameFile);
+            if (TEMP_FAILURE_RETRY(ftruncate(fd, complete)) == -1) {
+                LogError("Error at ftruncate " << nameFile << ": " << GetErrnoString(errno));
+                ThrowMsg(PermissibleSetException::FileWriteError, "Error at ftruncate");
+            }
+        }
+        statsIt = g_logStats.emplace(nameFile, LogStats{complete, set.records(), set.live()}).first;
+    }
+    LogStats stats = statsIt->second;
+    g_logStats.erase(statsIt);
+
+    std::string data;
+    for (const auto &label : labelsToRemove) {
+        data += TOMBSTONE;
+        data += label;
+        data += '\n';
+    }
+    for (const auto &label : labelsToAdd) {
+        data += label;
+        data += '\n';
+    }
+
+    stats.records += labelsToAdd.size() + labelsToRemove.size();
+    stats.live += labelsToAdd.size();
+    stats.live -= std::min(stats.live, labelsToRemove.size());
+
+    size_t dead = stats.records - stats.live;
+    if (dead > COMPACTION_MIN_DEAD_RECORDS && dead > stats.live) {
+        LabelSet set;
+        parseLog(readFd(fd, nameFile) + data, set);
+        std::vector<std::string> labels;
+        set.getLabels(labels);
+        g_logStats[nameFile] = rewriteLogFile(fd, nameFile, labels);
+        return;
+    }
+
+    writeFd(fd, nameFile, data);
+    syncFd(fd, nameFile);
+    stats.size += data.size();
+    g_logStats[nameFile] = stats;
 }
 
 void readLabelsFromPermissibleFile(const std::string &nameFile, std::vector<std::string> &appLabels)
@@ -136,14 +409,22 @@ void readLabelsFromPermissibleFile(const std::string &nameFile, std::vector<std:
     std::ifstream fstream;
     openAndLockNameFile(nameFile, fstream);
 
+    LabelSet set;
     std::string line;
-    while (std::getline(fstream, line))
-        appLabels.push_back(line);
+    while (std::getline(fstream, line)) {
+        if (fstream.eof()) {
+            LogWarning("Ignoring incomplete record at the end of " << nameFile);
+            break;
+        }
+        set.apply(line);
+    }
 
     if (fstream.bad()) {
         LogError("Failure while reading file " << nameFile << ": " << GetErrnoString(errno));
         ThrowMsg(PermissibleSetException::FileReadError, "Failure while reading file");
     }
+
+    set.getLabels(appLabels);
 }
 
 void initializeUserPermissibleFile(uid_t uid)
@@ -24,13 +24,35 @@
 #include "privilege-info.h" // header for this file
 
 #include <dpl/log/log.h>
+#include <privilege-type-cache.h>
 #include <smack-labels.h>
 
 namespace SecurityManager {
 
+namespace {
+
+int resolvePrivilegeType(uid_t uid, const std::string &pkgName, const std::string &privilege)
+{
+    privilege_manager_privilege_type_e type;
+    int ret = privilege_info_get_privilege_type(uid, pkgName.c_str(), privilege.c_str(), &type);
+    if (ret != PRVMGR_ERR_NONE)
+        ThrowMsg(PrivilegeInfo::Exception::UnknownError, "Error while getting privilege type " << ret);
+    return static_cast<int>(type);
+}
+
+PrivilegeTypeCache &typeCache()
+{
+    static PrivilegeTypeCache cache(resolvePrivilegeType);
+    return cache;
+}
+
+} // namespace anonymous
+
 PrivilegeInfo::PrivilegeInfo(uid_t uid, const std::string &label, const std::string &privilege) :
     m_uid(uid),
-    m_privilege(privilege)
+    m_privilege(privilege),
+    m_typeKnown(false),
+    m_type(0)
 {
     try {
         SmackLabels::generateAppPkgNameFromLabel(label, m_appId, m_pkgId);
@@ -40,12 +62,18 @@ PrivilegeInfo::PrivilegeInfo(uid_t uid, const std::string &label, const std::str
     }
 }
 
+int PrivilegeInfo::getType()
+{
+    if (!m_typeKnown) {
+        m_type = typeCache().get(m_uid, m_pkgId, m_privilege);
+        m_typeKnown = true;
+    }
+    return m_type;
+}
+
 bool PrivilegeInfo::hasAttribute(PrivilegeAttr attr)
 {
-    privilege_manager_privilege_type_e type;
-    int ret = privilege_info_get_privilege_type(m_uid, m_pkgId.c_str(), m_privilege.c_str(), &type);
-    if (ret != PRVMGR_ERR_NONE)
-        ThrowMsg(Exception::UnknownError, "Error while getting privilege type " << ret);
+    int type = getType();
 
     switch (attr) {
     case PrivilegeAttr::PRIVACY:
@@ -57,5 +85,15 @@ bool PrivilegeInfo::hasAttribute(PrivilegeAttr attr)
     }
 }
 
+void PrivilegeInfo::invalidateCache(const std::string &pkgName)
+{
+    typeCache().invalidate(pkgName);
+}
+
+void PrivilegeInfo::invalidateCache()
+{
+    typeCache().invalidate();
+}
+
 } // namespace SecurityManager
 
@@ -0,0 +1,80 @@
+/*
+ *  Copyright (c) 2017 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License
+ */
+/*
+ * @file       privilege-type-cache.cpp
+ * @brief      Memoizing cache of privilege types used by PrivilegeInfo
+ */
+
+#include "privilege-type-cache.h"
+
+namespace SecurityManager {
+
+PrivilegeTypeCache::PrivilegeTypeCache(Resolver resolver) :
+    m_resolver(std::move(resolver)),
+    m_size(0),
+    m_generation(0)
+{
+}
+
+int PrivilegeTypeCache::get(uid_t uid, const std::string &pkgName, const std::string &privilege)
+{
+    UidPrivilege key(uid, privilege);
+    unsigned generation;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto pkgIt = m_types.find(pkgName);
+        if (pkgIt != m_types.end()) {
+            auto it = pkgIt->second.find(key);
+            if (it != pkgIt->second.end())
+                return it->second;
+        }
+        generation = m_generation;
+    }
+
+    int type = m_resolver(uid, pkgName, privilege);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (generation == m_generation && m_types[pkgName].emplace(key, type).second)
+        ++m_size;
+    return type;
+}
+
+void PrivilegeTypeCache::invalidate(const std::string &pkgName)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ++m_generation;
+    auto it = m_types.find(pkgName);
+    if (it == m_types.end())
+        return;
+    m_size -= it->second.size();
+    m_types.erase(it);
+}
+
+void PrivilegeTypeCache::invalidate()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ++m_generation;
+    m_types.clear();
+    m_size = 0;
+}
+
+size_t PrivilegeTypeCache::size() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_size;
+}
+
+} // namespace SecurityManager
@@ -29,6 +29,7 @@
 
 #include <cstdio>
 #include <list>
+#include <set>
 #include <utility>
 #include <string>
 #include <iostream>
@@ -99,6 +100,18 @@ PrivilegeDb::StatementWrapper PrivilegeDb::getStatement(StmtType queryType)
     return StatementWrapper(m_commands.at(static_cast<size_t>(queryType)));
 }
 
+int PrivilegeDb::getAppId(const std::string &appName)
+{
+    auto command = getStatement(StmtType::EGetAppIdByName);
+    command->BindString(1, appName);
+
+    if (!command->Step())
+        ThrowMsg(PrivilegeDb::Exception::ConstraintError,
+                 "Application " << appName << " does not exist");
+
+    return command->GetColumnInteger(0);
+}
+
 PrivilegeDb::~PrivilegeDb()
 {
     m_commands.clear();
@@ -318,11 +331,18 @@ void PrivilegeDb::DropPrivateSharing(const std::string &ownerAppName,
 void PrivilegeDb::GetAllPrivateSharing(std::map<std::string, std::vector<std::string>> &appPathMap) {
     try_catch<void>([&] {
         auto command = getStatement(StmtType::EGetAllSharedPaths);
+        std::vector<std::string> *paths = nullptr;
+        std::string lastAppName;
         while (command->Step()) {
-            std::string appName = command->GetColumnString(0);
-            std::string path = command->GetColumnString(1);
+            auto appName = command->GetColumnStringRef(0);
+            auto path = command->GetColumnStringRef(1);
             LogDebug("Got appName : " << appName << " and path : " << path);
-            appPathMap[appName].push_back(path);
+            // rows are ordered by owner, so the map is looked up only once per owner
+            if (!paths || appName != lastAppName) {
+                lastAppName.assign(appName.data(), appName.size());
+                paths = &appPathMap[lastAppName];
+            }
+            paths->emplace_back(path.data(), path.size());
         }
     });
 }
@@ -402,9 +422,9 @@ void PrivilegeDb::GetUserApps(uid_t uid, std::vector<std::string> &apps)
         command->BindInteger(1, static_cast<unsigned int>(uid));
         apps.clear();
         while (command->Step()) {
-            std::string app = command->GetColumnString(0);
+            auto app = command->GetColumnStringRef(0);
             LogDebug("User " << uid << " has app " << app << " installed");
-            apps.push_back(app);
+            apps.emplace_back(app.data(), app.size());
         };
     });
 }
@@ -520,10 +540,11 @@ void PrivilegeDb::GetGroupsRelatedPrivileges(std::vector<std::pair<std::string,
         auto command = getStatement(StmtType::EGetGroupsRelatedPrivileges);
 
         while (command->Step()) {
-            const auto &groupName = command->GetColumnString(0);
-            const auto &privName = command->GetColumnString(1);
+            auto groupName = command->GetColumnStringRef(0);
+            auto privName = command->GetColumnStringRef(1);
             LogDebug("Privilege " << privName << " Group " << groupName);
-            privileges.emplace_back(std::make_pair(groupName, privName));
+            privileges.emplace_back(std::string(groupName.data(), groupName.size()),
+                                    std::string(privName.data(), privName.size()));
         };
     });
 }
@@ -578,12 +599,13 @@ void PrivilegeDb::GetPackagesInfo(std::vector<PkgInfo> &packages)
         packages.clear();
         while (command->Step()) {
             PkgInfo info;
-            info.name = command->GetColumnString(0);
+            auto name = command->GetColumnStringRef(0);
+            info.name.assign(name.data(), name.size());
             info.sharedRO = command->GetColumnInteger(1) > 0;
             info.hybrid = command->GetColumnInteger(2) > 0;
             LogDebug("Found package info " << info.name << " shared ro: " <<
                      info.sharedRO << " hybrid: " << info.hybrid);
-            packages.push_back(info);
+            packages.push_back(std::move(info));
         };
      });
 }
@@ -612,8 +634,43 @@ void PrivilegeDb::AddAppDefinedPrivilege(const std::string &appName, uid_t uid,
 void PrivilegeDb::AddAppDefinedPrivileges(const std::string &appName, uid_t uid,
                                           const AppDefinedPrivilegesVector &privileges)
 {
-    for (const auto &privilege : privileges)
-        AddAppDefinedPrivilege(appName, uid, privilege);
+    if (privileges.empty())
+        return;
+
+    try_catch<void>([&] {
+        int appId = getAppId(appName);
+
+        std::set<std::string> foreignPrivileges;
+        {
+            auto command = getStatement(StmtType::EGetForeignAppDefinedPrivileges);
+            command->BindInteger(1, appId);
+            while (command->Step())
+                foreignPrivileges.insert(command->GetColumnString(0));
+        }
+
+        auto command = getStatement(StmtType::EAddAppDefinedPrivilegeById);
+        for (const auto &privilege : privileges) {
+            if (foreignPrivileges.count(std::get<0>(privilege)))
+                ThrowMsg(PrivilegeDb::Exception::ConstraintError,
+                         "Privilege " << std::get<0>(privilege) <<
+                         " already defined by different application");
+
+            command->BindInteger(1, appId);
+            command->BindInteger(2, uid);
+            command->BindString(3, std::get<0>(privilege));
+            command->BindInteger(4, std::get<1>(privilege));
+            command->BindString(5, std::get<2>(privilege));
+
+            if (command->Step()) {
+                LogDebug("Unexpected SQLITE_ROW answer to query: " <<
+                         Queries.at(StmtType::EAddAppDefinedPrivilegeById));
+            }
+            command->Reset();
+        }
+
+        LogDebug("Added " << privileges.size() << " privileges defined by: " << appName <<
+                 " and user: " << uid);
+     });
 }
 
 void PrivilegeDb::AddClientPrivilege(const std::string &appName, uid_t uid, const std::string &privilege,
@@ -636,6 +693,36 @@ void PrivilegeDb::AddClientPrivilege(const std::string &appName, uid_t uid, cons
      });
 }
 
+void PrivilegeDb::AddClientPrivileges(const std::string &appName, uid_t uid,
+                                      const std::vector<std::pair<std::string, std::string>> &privileges)
+{
+    try_catch<void>([&] {
+        int appId = -1;
+
+        auto command = getStatement(StmtType::EAddClientPrivilegeById);
+        for (const auto &privilege : privileges) {
+            if (privilege.second.empty())
+                continue;
+
+            if (appId < 0)
+                appId = getAppId(appName);
+
+            command->BindInteger(1, appId);
+            command->BindInteger(2, uid);
+            command->BindString(3, privilege.first);
+            command->BindString(4, privilege.second);
+
+            if (command->Step()) {
+                LogDebug("Unexpected SQLITE_ROW answer to query: " <<
+                         Queries.at(StmtType::EAddClientPrivilegeById));
+            }
+            command->Reset();
+        }
+
+        LogDebug("Added licensed privileges used by: " << appName << " and user: " << uid);
+     });
+}
+
 void PrivilegeDb::RemoveAppDefinedPrivileges(const std::string &appName, uid_t uid)
 {
     try_catch<void>([&] {
@@ -770,6 +857,42 @@ bool PrivilegeDb::GetLicenseForClientPrivilegeAndPkg(
     });
 }
 
+bool PrivilegeDb::GetLicenseBundle(
+        uid_t uid,
+        uid_t globalUid,
+        const std::string &privilege,
+        const std::string &clientPkgName,
+        const std::string &clientAppName,
+        LicenseBundle &bundle)
+{
+    return try_catch<bool>([&] {
+        bundle = LicenseBundle();
+
+        auto command = getStatement(StmtType::EGetLicenseBundle);
+        command->BindString(1, privilege);
+        command->BindInteger(2, uid);
+        command->BindInteger(3, globalUid);
+        command->BindString(4, clientPkgName);
+        command->BindString(5, clientAppName);
+
+        if (!command->Step()) {
+            LogDebug("Privilege: " << privilege << " has no provider for uid: " << uid);
+            return false;
+        }
+
+        bundle.providerAppName = command->GetColumnString(0);
+        bundle.providerPkgName = command->GetColumnString(1);
+        bundle.providerLicense = command->GetColumnString(2);
+        bundle.clientHybrid = command->GetColumnInteger(3) > 0;
+        bundle.clientLicenseFound = !command->IsColumnNull(4);
+        bundle.clientLicense = command->GetColumnString(4);
+        LogDebug("Privilege: " << privilege << " defined by " << bundle.providerAppName <<
+                 " " << bundle.providerPkgName << ", client pkg: " << clientPkgName <<
+                 " license found: " << bundle.clientLicenseFound);
+        return true;
+    });
+}
+
 bool PrivilegeDb::IsUserPkgInstalled(const std::string& pkgName, uid_t uid)
 {
     return try_catch<bool>([&]() -> bool {
@@ -47,12 +47,14 @@
 #include "protocols.h"
 #include "privilege_db.h"
 #include "cynara.h"
+#include "group-generation.h"
 #include "permissible-set.h"
 #include "smack-exceptions.h"
 #include "smack-rules.h"
 #include "smack-labels.h"
 #include "security-manager.h"
 #include "tzplatform-config.h"
+#include "user-groups-cache.h"
 #include "utils.h"
 #include "privilege-info.h"
 
@@ -78,6 +80,30 @@ std::string realPath(const std::string &path)
     return real_pathPtr.get();
 }
 
+std::vector<gid_t> groupNamesToGids(const std::vector<std::string> &groupNames)
+{
+    std::vector<gid_t> gids;
+    std::vector<char> buffer(4096);
+
+    for (const auto &groupName : groupNames) {
+        struct group grpBuff;
+        struct group *grp = nullptr;
+        int ret;
+
+        while (ERANGE == (ret = TEMP_FAILURE_RETRY(getgrnam_r(groupName.c_str(), &grpBuff,
+                buffer.data(), buffer.size(), &grp))))
+            buffer.resize(buffer.size() << 1);
+
+        if (ret != 0 || grp == nullptr) {
+            LogWarning("Group " << groupName << " not found");
+            continue;
+        }
+        gids.push_back(grp->gr_gid);
+    }
+
+    return gids;
+}
+
 class ScopedTransaction {
 public:
     ScopedTransaction(PrivilegeDb &privilegeDb) : m_isCommited(false), m_privilegeDb(privilegeDb) {
@@ -151,12 +177,94 @@ bool verifyAppDefinedPrivileges(app_inst_req &req) {
 
 } // end of anonymous namespace
 
-ServiceImpl::ServiceImpl()
+ServiceImpl::ServiceImpl() :
+    m_cynara([this](const std::string &label, const std::string &user, const std::string &privilege) {
+        int result;
+        std::string resultExtra;
+        // checks of clients start in the default bucket
+        m_cynaraAdmin.check(label, user, privilege,
+            CynaraAdmin::Buckets.at(Bucket::PRIVACY_MANAGER), result, resultExtra, true);
+        return result;
+    }),
+    m_batch(false),
+    m_batchMergeRules(false)
 {
 }
 
 ServiceImpl::~ServiceImpl()
 {
+    if (m_batch) {
+        LogWarning("Batch of requests not finished, finishing it now");
+        endBatch();
+    }
+}
+
+void ServiceImpl::start()
+{
+    /* Group information might have changed while the service wasn't running */
+    GroupGeneration::bump();
+    m_userGroupsCache.clear();
+
+    try {
+        m_cynaraAdmin.syncMirror();
+    } catch (const CynaraException::Base &e) {
+        // buckets will be fetched on first use
+        LogWarning("Unable to mirror Cynara buckets: " << e.DumpToString());
+    }
+}
+
+int ServiceImpl::beginBatch()
+{
+    if (m_batch) {
+        LogError("Batch of requests already started");
+        return SECURITY_MANAGER_ERROR_BAD_REQUEST;
+    }
+
+    m_batch = true;
+    m_batchMergeRules = false;
+    m_batchPermissibleSets.clear();
+    return SECURITY_MANAGER_SUCCESS;
+}
+
+int ServiceImpl::endBatch()
+{
+    if (!m_batch) {
+        LogError("No batch of requests started");
+        return SECURITY_MANAGER_ERROR_BAD_REQUEST;
+    }
+    m_batch = false;
+
+    // files whose changes fail to be written are rewritten on their next update
+    std::set<std::pair<uid_t, int>> consistent;
+    for (const auto &permissibleSet : m_batchPermissibleSets)
+        if (m_consistentPermissibleSets.erase(permissibleSet.first) > 0)
+            consistent.insert(permissibleSet.first);
+
+    try {
+        for (const auto &permissibleSet : m_batchPermissibleSets)
+            writePermissibleSet(permissibleSet.first.first, permissibleSet.first.second,
+                                permissibleSet.second, consistent.count(permissibleSet.first) > 0);
+        m_batchPermissibleSets.clear();
+
+        if (m_batchMergeRules) {
+            m_batchMergeRules = false;
+            SmackRules::mergeRules();
+        }
+    } catch (const PrivilegeDb::Exception::Base &e) {
+        LogError("Error while reading application labels from database: " << e.DumpToString());
+        return SECURITY_MANAGER_ERROR_SERVER_ERROR;
+    } catch (const PermissibleSet::PermissibleSetException::Base &e) {
+        LogError("Error while updating permissible file: " << e.DumpToString());
+        return SECURITY_MANAGER_ERROR_SERVER_ERROR;
+    } catch (const SmackException::Base &e) {
+        LogError("Error while merging Smack rules: " << e.DumpToString());
+        return SECURITY_MANAGER_ERROR_SETTING_FILE_LABEL_FAILED;
+    } catch (const std::bad_alloc &e) {
+        LogError("Memory allocation error: " << e.what());
+        return SECURITY_MANAGER_ERROR_MEMORY;
+    }
+
+    return SECURITY_MANAGER_SUCCESS;
 }
 
 int ServiceImpl::validatePolicy(const Credentials &creds, policy_entry &policyEntry, CynaraAdminPolicy &cyap)
@@ -295,6 +403,7 @@ bool ServiceImpl::authenticate(const Credentials &creds, const std::string &priv
 {
     if (creds.authenticated)
         return true;
+    // plain ALLOW/DENY decisions are cached per caller's session by m_cynara
     return m_cynara.check(creds.label, privilege,
         std::to_string(creds.uid), std::to_string(creds.pid));
 }
@@ -525,8 +634,65 @@ void ServiceImpl::getPkgLabels(const std::string &pkgName, SmackRules::Labels &p
     }
 }
 
-void ServiceImpl::updatePermissibleSet(uid_t uid, int type)
+void ServiceImpl::getUserPkgLabels(uid_t uid, const std::string &pkgName,
+                                   SmackRules::Labels &pkgsLabels)
+{
+    if (m_privilegeDb.IsUserPkgInstalled(pkgName, uid))
+        getPkgLabels(pkgName, pkgsLabels);
+}
+
+void ServiceImpl::updatePermissibleSet(uid_t uid, int type, const SmackRules::Labels &oldLabels,
+                                       const SmackRules::Labels &newLabels)
+{
+    auto key = std::make_pair(uid, type);
+    // database is already ahead of the file, until the changes are recorded
+    bool consistent = m_consistentPermissibleSets.erase(key) > 0;
+
+    PermissibleSetChanges changes;
+    PermissibleSetChanges &pending = m_batch ? m_batchPermissibleSets[key] : changes;
+
+    for (const auto &label : oldLabels)
+        if (std::find(newLabels.begin(), newLabels.end(), label) == newLabels.end())
+            pending[label] = false;
+    for (const auto &label : newLabels)
+        if (std::find(oldLabels.begin(), oldLabels.end(), label) == oldLabels.end())
+            pending[label] = true;
+
+    if (!m_batch)
+        writePermissibleSet(uid, type, changes, consistent);
+    else if (consistent)
+        m_consistentPermissibleSets.insert(key);
+}
+
+void ServiceImpl::mergeSmackRules()
 {
+    if (m_batch)
+        m_batchMergeRules = true;
+    else
+        SmackRules::mergeRules();
+}
+
+void ServiceImpl::writePermissibleSet(uid_t uid, int type, const PermissibleSetChanges &changes,
+                                      bool consistent)
+{
+    auto key = std::make_pair(uid, type);
+
+    /* Only changes since the file was last rewritten by this service are
+     * appended. File not yet rewritten since service start might have missed
+     * changes, so it is rebuilt from the database as it was before. */
+    if (consistent) {
+        std::vector<std::string> labelsToAdd, labelsToRemove;
+        for (const auto &change : changes)
+            (change.second ? labelsToAdd : labelsToRemove).push_back(change.first);
+        try {
+            PermissibleSet::updatePermissibleFile(uid, type, labelsToAdd, labelsToRemove);
+            m_consistentPermissibleSets.insert(key);
+            return;
+        } catch (const PermissibleSet::PermissibleSetException::Base &e) {
+            LogWarning("Unable to append to permissible file, rewriting it: " << e.DumpToString());
+        }
+    }
+
     std::vector<std::string> userPkgs;
     m_privilegeDb.GetUserPkgs(uid, userPkgs);
     std::vector<std::string> labelsForUser;
@@ -536,6 +702,7 @@ void ServiceImpl::updatePermissibleSet(uid_t uid, int type)
         labelsForUser.insert(labelsForUser.end(), pkgLabels.begin(), pkgLabels.end());
     }
     PermissibleSet::updatePermissibleFile(uid, type, labelsForUser);
+    m_consistentPermissibleSets.insert(key);
 }
 
 int ServiceImpl::appInstall(const Credentials &creds, app_inst_req &&req)
@@ -579,6 +746,9 @@ int ServiceImpl::appInstall(const Credentials &creds, app_inst_req &&req)
 
         ScopedTransaction trans(m_privilegeDb);
 
+        SmackRules::Labels oldUserPkgLabels, newUserPkgLabels;
+        getUserPkgLabels(req.uid, req.pkgName, oldUserPkgLabels);
+
         m_privilegeDb.AddApplication(req.appName, req.pkgName, req.uid,
                                      req.tizenVersion, req.authorName, req.isHybrid);
         /* Get all application ids in the package to generate rules withing the package */
@@ -590,28 +760,29 @@ int ServiceImpl::appInstall(const Credentials &creds, app_inst_req &&req)
 
         bool global = req.installationType == SM_APP_INSTALL_GLOBAL ||
                       req.installationType == SM_APP_INSTALL_PRELOADED;
+        PrivilegeInfo::invalidateCache(req.pkgName);
         m_cynaraAdmin.updateAppPolicy(appLabel, global, req.uid, privilegeList,
                                       oldAppDefinedPrivileges, req.appDefinedPrivileges);
+        m_cynara.invalidateCache();
+        GroupGeneration::bump();
 
         m_privilegeDb.RemoveAppDefinedPrivileges(req.appName, req.uid);
         m_privilegeDb.AddAppDefinedPrivileges(req.appName, req.uid, req.appDefinedPrivileges);
 
         m_privilegeDb.RemoveClientPrivileges(req.appName, req.uid);
-        for (auto &e : req.privileges) {
-            if (!e.second.empty())
-                m_privilegeDb.AddClientPrivilege(req.appName, req.uid, e.first, e.second);
-        }
+        m_privilegeDb.AddClientPrivileges(req.appName, req.uid, req.privileges);
 
         if (hasSharedRO)
             m_privilegeDb.SetSharedROPackage(req.pkgName);
 
         m_privilegeDb.GetPackagesInfo(pkgsInfo);
         getPkgsProcessLabels(pkgsInfo, pkgsProcessLabels);
+        getUserPkgLabels(req.uid, req.pkgName, newUserPkgLabels);
 
         // WTF? Why this commit is here? Shouldn't it be at the end of this function?
         trans.commit();
         LogDebug("Application installation commited to database");
-        updatePermissibleSet(req.uid, req.installationType);
+        updatePermissibleSet(req.uid, req.installationType, oldUserPkgLabels, newUserPkgLabels);
     } catch (const PrivilegeDb::Exception::IOError &e) {
         LogError("Cannot access application database: " << e.DumpToString());
         return SECURITY_MANAGER_ERROR_SERVER_ERROR;
@@ -653,7 +824,7 @@ int ServiceImpl::appInstall(const Credentials &creds, app_inst_req &&req)
 
         SmackRules::generateSharedRORules(pkgsProcessLabels, pkgsInfo);
 
-        SmackRules::mergeRules();
+        mergeSmackRules();
     } catch (const SmackException::InvalidParam &e) {
         LogError("Invalid paramater during labeling: " << e.GetMessage());
         return SECURITY_MANAGER_ERROR_INPUT_PARAM;
@@ -765,19 +936,27 @@ int ServiceImpl::appUninstall(const Credentials &creds, app_inst_req &&req)
         AppDefinedPrivilegesVector oldAppDefinedPrivileges;
         m_privilegeDb.GetAppDefinedPrivileges(req.appName, req.uid, oldAppDefinedPrivileges);
 
+        SmackRules::Labels oldUserPkgLabels, newUserPkgLabels;
+        getUserPkgLabels(req.uid, req.pkgName, oldUserPkgLabels);
+
         m_privilegeDb.RemoveApplication(req.appName, req.uid, removeApp, removePkg, removeAuthor);
 
         m_privilegeDb.GetPackagesInfo(pkgsInfo);
         getPkgsProcessLabels(pkgsInfo, pkgsProcessLabels);
+        getUserPkgLabels(req.uid, req.pkgName, newUserPkgLabels);
 
         bool global = req.installationType == SM_APP_INSTALL_GLOBAL ||
                       req.installationType == SM_APP_INSTALL_PRELOADED;
         m_cynaraAdmin.updateAppPolicy(processLabel, global, req.uid, std::vector<std::string>(),
                                       oldAppDefinedPrivileges, AppDefinedPrivilegesVector(), true);
+        m_cynara.invalidateCache();
+        if (removePkg)
+            PrivilegeInfo::invalidateCache(req.pkgName);
+        GroupGeneration::bump();
         trans.commit();
 
         LogDebug("Application uninstallation commited to database");
-        updatePermissibleSet(req.uid, req.installationType);
+        updatePermissibleSet(req.uid, req.installationType, oldUserPkgLabels, newUserPkgLabels);
     } catch (const PrivilegeDb::Exception::IOError &e) {
         LogError("Cannot access application database: " << e.DumpToString());
         return SECURITY_MANAGER_ERROR_SERVER_ERROR;
@@ -830,7 +1009,7 @@ int ServiceImpl::appUninstall(const Credentials &creds, app_inst_req &&req)
             SmackRules::uninstallAuthorRules(authorId);
         }
 
-        SmackRules::mergeRules();
+        mergeSmackRules();
     } catch (const SmackException::Base &e) {
         LogError("Error while removing Smack rules for application: " << e.DumpToString());
         return SECURITY_MANAGER_ERROR_SETTING_FILE_LABEL_FAILED;
@@ -929,7 +1108,13 @@ int ServiceImpl::userAdd(const Credentials &creds, uid_t uidAdded, int userType)
     }
     try {
         m_cynaraAdmin.userInit(uidAdded, static_cast<security_manager_user_type>(userType));
+        m_cynara.invalidateCache();
         PermissibleSet::initializeUserPermissibleFile(uidAdded);
+
+        // Prepare groups cache for the first login of the new user
+        m_userGroupsCache.remove(uidAdded);
+        std::vector<std::string> groups;
+        policyGroupsForUid(uidAdded, groups);
     } catch (CynaraException::InvalidParam &e) {
         return SECURITY_MANAGER_ERROR_INPUT_PARAM;
     } catch (const PermissibleSet::PermissibleSetException::FileInitError &e) {
@@ -994,6 +1179,9 @@ int ServiceImpl::userDelete(const Credentials &creds, uid_t uidDeleted)
     }
 
     m_cynaraAdmin.userRemove(uidDeleted);
+    m_cynara.invalidateCache();
+    PrivilegeInfo::invalidateCache();
+    m_userGroupsCache.remove(uidDeleted);
 
     return ret;
 }
@@ -1019,6 +1207,10 @@ int ServiceImpl::policyUpdate(const Credentials &creds, const std::vector<policy
 
         // Apply updates
         m_cynaraAdmin.setPolicies(validatedPolicies);
+        m_cynara.invalidateCache();
+        GroupGeneration::bump();
+        // Cache files are recreated lazily on next groups query of each user
+        m_userGroupsCache.clear();
 
     } catch (const CynaraException::Base &e) {
         LogError("Error while updating Cynara rules: " << e.DumpToString());
@@ -1306,6 +1498,47 @@ int ServiceImpl::policyGetDesc(std::vector<std::string> &levels)
     return ret;
 }
 
+int ServiceImpl::policyResync(const Credentials &creds)
+{
+    if (!authenticate(creds, Config::PRIVILEGE_POLICY_ADMIN)) {
+        LogError("Not enough privilege to reload policy mirror");
+        return SECURITY_MANAGER_ERROR_ACCESS_DENIED;
+    }
+
+    try {
+        m_cynaraAdmin.syncMirror();
+        m_cynara.invalidateCache();
+        PrivilegeInfo::invalidateCache();
+        GroupGeneration::bump();
+        m_userGroupsCache.clear();
+    } catch (const CynaraException::Base &e) {
+        LogError("Error while reloading Cynara buckets: " << e.DumpToString());
+        return SECURITY_MANAGER_ERROR_SERVER_ERROR;
+    } catch (const std::bad_alloc &e) {
+        LogError("Memory allocation error while reloading Cynara buckets: " << e.what());
+        return SECURITY_MANAGER_ERROR_MEMORY;
+    }
+
+    return SECURITY_MANAGER_SUCCESS;
+}
+
+int ServiceImpl::policyCacheStatistics(const Credentials &creds, unsigned &hits,
+                                       unsigned &misses)
+{
+    if (!authenticate(creds, Config::PRIVILEGE_POLICY_ADMIN)) {
+        LogError("Not enough privilege to get statistics of decision cache");
+        return SECURITY_MANAGER_ERROR_ACCESS_DENIED;
+    }
+
+    auto statistics = m_cynara.getCacheStatistics();
+    hits = statistics.hits;
+    misses = statistics.misses;
+    LogInfo("Decision cache hits: " << statistics.hits << ", misses: " << statistics.misses <<
+            ", entries: " << statistics.entries << ", dropped: " << statistics.clears);
+
+    return SECURITY_MANAGER_SUCCESS;
+}
+
 int ServiceImpl::policyGetGroups(std::vector<std::string> &groups)
 {
     int ret = SECURITY_MANAGER_SUCCESS;
@@ -1328,6 +1561,10 @@ int ServiceImpl::policyGroupsForUid(uid_t uid, std::vector<std::string> &groups)
         auto userType = m_cynaraAdmin.getUserType(uid);
 
         if (userType == SM_USER_TYPE_NONE) {
+            // User not managed by security-manager gets all the groups
+            std::vector<std::string> allGroups;
+            if (policyGetGroups(allGroups) == SECURITY_MANAGER_SUCCESS)
+                m_userGroupsCache.store(uid, false, groupNamesToGids(allGroups));
             return SECURITY_MANAGER_ERROR_NO_SUCH_OBJECT;
         }
 
@@ -1354,15 +1591,18 @@ int ServiceImpl::policyGroupsForUid(uid_t uid, std::vector<std::string> &groups)
                 return SECURITY_MANAGER_ERROR_UNKNOWN;
         }
 
+        // rows are taken first, so the statement is not held open across Cynara calls
         std::vector<std::pair<std::string, std::string>> group2privVector;
         m_privilegeDb.GetGroupsRelatedPrivileges(group2privVector);
 
         for (const auto &g2p : group2privVector) {
             m_cynaraAdmin.check(CYNARA_ADMIN_ANY, uidStr, g2p.second,
-                                             bucket, result, resultExtra, true);
+                                bucket, result, resultExtra, true);
             if (result == CYNARA_ADMIN_ALLOW)
                 groups.push_back(g2p.first);
         }
+
+        m_userGroupsCache.store(uid, true, groupNamesToGids(groups));
     } catch (const CynaraException::Base &e) {
         LogError("Error while getting user type from Cynara: " << e.DumpToString());
         return SECURITY_MANAGER_ERROR_SERVER_ERROR;
@@ -1674,7 +1914,7 @@ int ServiceImpl::pathsRegister(const Credentials &creds, path_req req)
                 getPkgsProcessLabels(pkgsInfo, pkgsLabels);
 
                 SmackRules::generateSharedRORules(pkgsLabels, pkgsInfo);
-                SmackRules::mergeRules();
+                mergeSmackRules();
             }
             trans.commit();
         }
@@ -1865,4 +2105,50 @@ int ServiceImpl::getClientPrivilegeLicense(
     return SECURITY_MANAGER_SUCCESS;
 }
 
+int ServiceImpl::getLicenseBundle(
+        uid_t uid,
+        const std::string &client,
+        const std::string &privilege,
+        std::string &clientAppName,
+        std::string &clientPkgName,
+        LicenseBundle &bundle)
+{
+    try {
+        std::string appName, pkgName;
+        SmackLabels::generateAppPkgNameFromLabel(client, appName, pkgName);
+
+        if (!m_privilegeDb.GetLicenseBundle(uid, getGlobalUserId(), privilege, pkgName, appName, bundle)) {
+            LogDebug("Privilege " << privilege << " not found in database");
+            return SECURITY_MANAGER_ERROR_NO_SUCH_OBJECT;
+        }
+
+        if (bundle.providerLicense.empty()) {
+            LogDebug("Privilege " << privilege << " has no license");
+            return SECURITY_MANAGER_ERROR_NO_SUCH_OBJECT;
+        }
+
+        if (bundle.clientHybrid && appName.empty()) {
+            LogDebug("appName could not be empty if you ask about hybrid application");
+            return SECURITY_MANAGER_ERROR_INPUT_PARAM;
+        }
+
+        if (!bundle.clientLicenseFound) {
+            LogDebug("License was not found for privilege: " << privilege << " client: " << client
+                     << " and uid: " << uid);
+            return SECURITY_MANAGER_ERROR_NO_SUCH_OBJECT;
+        }
+
+        clientAppName = std::move(appName);
+        clientPkgName = std::move(pkgName);
+    } catch (const SmackException::InvalidLabel &e) {
+        LogDebug("Invalid client label: " << client);
+        return SECURITY_MANAGER_ERROR_NO_SUCH_OBJECT;
+    } catch (const PrivilegeDb::Exception::Base &e) {
+        LogError("Error while getting license bundle from database: " << e.DumpToString());
+        return SECURITY_MANAGER_ERROR_SERVER_ERROR;
+    }
+
+    return SECURITY_MANAGER_SUCCESS;
+}
+
 } /* namespace SecurityManager */
@@ -0,0 +1,184 @@
+/*
+ *  Copyright (c) 2017 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License
+ */
+/*
+ * @file        user-groups-cache.cpp
+ * @version     1.0
+ * @brief       Per-user cache files of privileged groups, maintained by the
+ * @brief       service and read by the NSS module
+ */
+#ifndef _GNU_SOURCE //for TEMP_FAILURE_RETRY
+#define _GNU_SOURCE
+#endif
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#include <dpl/errno_string.h>
+#include <dpl/log/log.h>
+#include <filesystem.h>
+#include <smack-exceptions.h>
+#include <smack-labels.h>
+#include <user-groups-cache.h>
+
+namespace SecurityManager {
+
+namespace {
+
+const uint32_t CACHE_MAGIC = 0x434d5353; // "SSMC"
+const uint32_t CACHE_VERSION = 1;
+const uint32_t FLAG_MANAGED = 1;
+
+struct CacheHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t flags;
+    uint32_t count;
+};
+
+const char *const TEMPORARY_FILE_SUFFIX = ".temp";
+
+bool writeAll(int fd, const void *data, size_t size)
+{
+    const char *p = static_cast<const char *>(data);
+    while (size > 0) {
+        ssize_t ret = TEMP_FAILURE_RETRY(write(fd, p, size));
+        if (ret <= 0)
+            return false;
+        p += ret;
+        size -= ret;
+    }
+    return true;
+}
+
+} // namespace anonymous
+
+UserGroupsCache::UserGroupsCache(const std::string &dir) : m_dir(dir)
+{
+}
+
+std::string UserGroupsCache::getPath(uid_t uid) const
+{
+    return m_dir + "/" + std::to_string(uid);
+}
+
+bool UserGroupsCache::store(uid_t uid, bool managed, const std::vector<gid_t> &gids)
+{
+    if (mkdir(m_dir.c_str(), 0755) != 0 && errno != EEXIST) {
+        LogError("Unable to create directory " << m_dir << ": " << GetErrnoString(errno));
+        return false;
+    }
+
+    std::string path = getPath(uid);
+    std::string tempPath = path + TEMPORARY_FILE_SUFFIX;
+    int fd = TEMP_FAILURE_RETRY(open(tempPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644));
+    if (fd < 0) {
+        LogError("Unable to create " << tempPath << ": " << GetErrnoString(errno));
+        return false;
+    }
+
+    CacheHeader header;
+    header.magic = CACHE_MAGIC;
+    header.version = CACHE_VERSION;
+    header.flags = managed ? FLAG_MANAGED : 0;
+    header.count = gids.size();
+
+    std::vector<uint32_t> data(gids.begin(), gids.end());
+    bool ok = fchmod(fd, 0644) == 0 &&
+              writeAll(fd, &header, sizeof(header)) &&
+              writeAll(fd, data.data(), data.size() * sizeof(uint32_t));
+    if (ok) {
+        try {
+            SmackLabels::setSmackLabelForFd(fd, "_");
+        } catch (const SmackException::Base &e) {
+            LogWarning("Unable to set Smack label of " << tempPath << ": " << e.DumpToString());
+        }
+    }
+    close(fd);
+
+    if (!ok || rename(tempPath.c_str(), path.c_str()) != 0) {
+        LogError("Unable to store groups of user " << uid << " in " << path << ": " <<
+                 GetErrnoString(errno));
+        unlink(tempPath.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+bool UserGroupsCache::load(uid_t uid, bool &managed, std::vector<gid_t> &gids) const
+{
+    std::string path = getPath(uid);
+    int fd = TEMP_FAILURE_RETRY(open(path.c_str(), O_RDONLY | O_CLOEXEC));
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    void *addr = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) >= sizeof(CacheHeader))
+        addr = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED)
+        return false;
+
+    const CacheHeader *header = static_cast<const CacheHeader *>(addr);
+    bool valid = header->magic == CACHE_MAGIC &&
+                 header->version == CACHE_VERSION &&
+                 static_cast<size_t>(st.st_size) ==
+                     sizeof(CacheHeader) + header->count * sizeof(uint32_t);
+    if (valid) {
+        const uint32_t *data = reinterpret_cast<const uint32_t *>(header + 1);
+        managed = header->flags & FLAG_MANAGED;
+        gids.assign(data, data + header->count);
+    } else {
+        LogWarning("Invalid groups cache file " << path);
+    }
+
+    munmap(addr, st.st_size);
+    return valid;
+}
+
+void UserGroupsCache::remove(uid_t uid)
+{
+    std::string path = getPath(uid);
+    if (unlink(path.c_str()) != 0 && errno != ENOENT)
+        LogError("Unable to remove " << path << ": " << GetErrnoString(errno));
+}
+
+void UserGroupsCache::clear()
+{
+    FS::FileNameVector files;
+    try {
+        files = FS::getFilesFromDirectory(m_dir);
+    } catch (const FS::Exception::Base &e) {
+        // directory doesn't exist yet
+        return;
+    }
+
+    for (const auto &file : files) {
+        std::string path = m_dir + "/" + file;
+        if (unlink(path.c_str()) != 0 && errno != ENOENT)
+            LogError("Unable to remove " << path << ": " << GetErrnoString(errno));
+    }
+}
+
+} // namespace SecurityManager
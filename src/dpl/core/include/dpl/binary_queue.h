@@ -272,6 +272,15 @@ class BinaryQueue
      */
     void FlattenConsume(void *buffer, size_t bufferSize);
 
+    /**
+     * Get data at the beginning of binary queue that is stored contiguously,
+     * without copying it. Pointer is valid until the queue is modified.
+     *
+     * @return Pointer to the data, NULL if binary queue is empty
+     * @param[out] size Number of bytes available at the returned pointer
+     */
+    const void *Front(size_t &size) const;
+
     /**
      * Visit each buffer with data using visitor object
      *
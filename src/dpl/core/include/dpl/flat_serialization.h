@@ -0,0 +1,421 @@
+/*
+ *  Copyright (c) 2017 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License
+ */
+/*
+ * @file        flat_serialization.h
+ * @version     1.0
+ * @brief       Serialization of described structs into flat buffers.
+ *
+ * Produces the same bytes as Serialization/Deserialization from
+ * serialization.h, but instead of a Write() to the stream per field, the
+ * encoded size is computed first, one buffer of that size is allocated and
+ * filled in a single pass. Decoding goes over a flat buffer in one pass as
+ * well.
+ *
+ * Structs are described by a FlatLayout specialization listing their fields
+ * in wire order:
+ *
+ *   template <>
+ *   struct FlatLayout<user_req> : FlatFields<user_req,
+ *       FLAT_FIELD(user_req, uid),
+ *       FLAT_FIELD(user_req, utype)> {};
+ */
+#pragma once
+
+#include <cstring>
+#include <list>
+#include <map>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <dpl/exception.h>
+
+namespace SecurityManager {
+
+/* Fills buffer big enough for everything written */
+class FlatWriter {
+public:
+    explicit FlatWriter(unsigned char *data)
+      : m_pos(data)
+    {}
+
+    void Write(size_t num, const void *bytes)
+    {
+        memcpy(m_pos, bytes, num);
+        m_pos += num;
+    }
+
+private:
+    unsigned char *m_pos;
+};
+
+class FlatReader {
+public:
+    class Exception {
+    public:
+        DECLARE_EXCEPTION_TYPE(SecurityManager::Exception, Base)
+        DECLARE_EXCEPTION_TYPE(Base, OutOfData)
+    };
+
+    FlatReader(const unsigned char *data, size_t size)
+      : m_begin(data)
+      , m_pos(data)
+      , m_end(data + size)
+    {}
+
+    void Read(size_t num, void *bytes)
+    {
+        memcpy(bytes, Take(num), num);
+    }
+
+    /* Skip num bytes, returning pointer to them */
+    const unsigned char *Take(size_t num)
+    {
+        if (num > Left())
+            ThrowMsg(Exception::OutOfData, "Asked for: " << num << " Left: " << Left());
+        const unsigned char *bytes = m_pos;
+        m_pos += num;
+        return bytes;
+    }
+
+    /* Read length of a string or container */
+    size_t Length()
+    {
+        int length;
+        Read(sizeof(length), &length);
+        if (length < 0)
+            ThrowMsg(Exception::OutOfData, "Negative length: " << length);
+        return length;
+    }
+
+    size_t Left() const { return m_end - m_pos; }
+
+    size_t Used() const { return m_pos - m_begin; }
+
+private:
+    const unsigned char *m_begin;
+    const unsigned char *m_pos;
+    const unsigned char *m_end;
+};
+
+/* Specialize for structs to be (de)serialized, see FlatFields */
+template <typename T>
+struct FlatLayout {
+    static const bool described = false;
+};
+
+struct FlatSerialization {
+    // scalars
+    template <typename T>
+    static typename std::enable_if<std::is_arithmetic<T>::value, size_t>::type
+    Size(T)
+    {
+        return sizeof(T);
+    }
+    template <typename T>
+    static typename std::enable_if<std::is_arithmetic<T>::value>::type
+    Write(FlatWriter &writer, T value)
+    {
+        writer.Write(sizeof(value), &value);
+    }
+
+    // std::string
+    static size_t Size(const std::string &str)
+    {
+        return sizeof(int) + str.size();
+    }
+    static void Write(FlatWriter &writer, const std::string &str)
+    {
+        int length = str.size();
+        writer.Write(sizeof(length), &length);
+        writer.Write(length, str.data());
+    }
+
+    // described structs
+    template <typename T>
+    static typename std::enable_if<FlatLayout<T>::described, size_t>::type
+    Size(const T &object)
+    {
+        return FlatLayout<T>::Size(object);
+    }
+    template <typename T>
+    static typename std::enable_if<FlatLayout<T>::described>::type
+    Write(FlatWriter &writer, const T &object)
+    {
+        FlatLayout<T>::Write(writer, object);
+    }
+
+    // pointers to described structs
+    template <typename T>
+    static size_t Size(const T *object)
+    {
+        return Size(*object);
+    }
+    template <typename T>
+    static void Write(FlatWriter &writer, const T *object)
+    {
+        Write(writer, *object);
+    }
+
+    // std::vector, std::list, std::map
+    template <typename Container>
+    static size_t SizeAll(const Container &container)
+    {
+        size_t size = sizeof(int);
+        for (const auto &item : container)
+            size += Size(item);
+        return size;
+    }
+    template <typename Container>
+    static void WriteAll(FlatWriter &writer, const Container &container)
+    {
+        int length = container.size();
+        writer.Write(sizeof(length), &length);
+        for (const auto &item : container)
+            Write(writer, item);
+    }
+
+    template <typename T>
+    static size_t Size(const std::vector<T> &vec) { return SizeAll(vec); }
+    template <typename T>
+    static void Write(FlatWriter &writer, const std::vector<T> &vec) { WriteAll(writer, vec); }
+
+    template <typename T>
+    static size_t Size(const std::list<T> &list) { return SizeAll(list); }
+    template <typename T>
+    static void Write(FlatWriter &writer, const std::list<T> &list) { WriteAll(writer, list); }
+
+    template <typename K, typename T>
+    static size_t Size(const std::map<K, T> &map) { return SizeAll(map); }
+    template <typename K, typename T>
+    static void Write(FlatWriter &writer, const std::map<K, T> &map) { WriteAll(writer, map); }
+
+    // std::pair
+    template <typename A, typename B>
+    static size_t Size(const std::pair<A, B> &p)
+    {
+        return Size(p.first) + Size(p.second);
+    }
+    template <typename A, typename B>
+    static void Write(FlatWriter &writer, const std::pair<A, B> &p)
+    {
+        Write(writer, p.first);
+        Write(writer, p.second);
+    }
+
+    // std::tuple
+    template <std::size_t I = 0, typename... Tp>
+    static typename std::enable_if<I == sizeof...(Tp), size_t>::type
+    Size(const std::tuple<Tp...> &)
+    {
+        return 0;
+    }
+    template <std::size_t I = 0, typename... Tp>
+    static typename std::enable_if<I < sizeof...(Tp), size_t>::type
+    Size(const std::tuple<Tp...> &t)
+    {
+        return Size(std::get<I>(t)) + Size<I + 1>(t);
+    }
+    template <std::size_t I = 0, typename... Tp>
+    static typename std::enable_if<I == sizeof...(Tp)>::type
+    Write(FlatWriter &, const std::tuple<Tp...> &)
+    {}
+    template <std::size_t I = 0, typename... Tp>
+    static typename std::enable_if<I < sizeof...(Tp)>::type
+    Write(FlatWriter &writer, const std::tuple<Tp...> &t)
+    {
+        Write(writer, std::get<I>(t));
+        Write<I + 1>(writer, t);
+    }
+
+    /* Encode value into buffer of its exact size */
+    template <typename T>
+    static std::vector<unsigned char> Encode(const T &value)
+    {
+        std::vector<unsigned char> buffer(Size(value));
+        FlatWriter writer(buffer.data());
+        Write(writer, value);
+        return buffer;
+    }
+
+    /* Encode struct with field list other than its FlatLayout */
+    template <typename Fields, typename T>
+    static std::vector<unsigned char> EncodeAs(const T &object)
+    {
+        std::vector<unsigned char> buffer(Fields::Size(object));
+        FlatWriter writer(buffer.data());
+        Fields::Write(writer, object);
+        return buffer;
+    }
+}; // struct FlatSerialization
+
+struct FlatDeserialization {
+    // scalars
+    template <typename T>
+    static typename std::enable_if<std::is_arithmetic<T>::value>::type
+    Read(FlatReader &reader, T &value)
+    {
+        reader.Read(sizeof(value), &value);
+    }
+
+    // std::string
+    static void Read(FlatReader &reader, std::string &str)
+    {
+        size_t length = reader.Length();
+        str.assign(reinterpret_cast<const char *>(reader.Take(length)), length);
+    }
+
+    // described structs
+    template <typename T>
+    static typename std::enable_if<FlatLayout<T>::described>::type
+    Read(FlatReader &reader, T &object)
+    {
+        FlatLayout<T>::Read(reader, object);
+    }
+
+    // std::vector, std::list
+    template <typename T>
+    static void Read(FlatReader &reader, std::vector<T> &vec)
+    {
+        size_t length = reader.Length();
+        // each item takes at least a byte, don't trust length any further
+        if (length <= reader.Left())
+            vec.reserve(vec.size() + length);
+        for (size_t i = 0; i < length; ++i) {
+            T obj;
+            Read(reader, obj);
+            vec.push_back(std::move(obj));
+        }
+    }
+    template <typename T>
+    static void Read(FlatReader &reader, std::list<T> &list)
+    {
+        size_t length = reader.Length();
+        for (size_t i = 0; i < length; ++i) {
+            T obj;
+            Read(reader, obj);
+            list.push_back(std::move(obj));
+        }
+    }
+
+    // std::map
+    template <typename K, typename T>
+    static void Read(FlatReader &reader, std::map<K, T> &map)
+    {
+        size_t length = reader.Length();
+        for (size_t i = 0; i < length; ++i) {
+            K key;
+            T obj;
+            Read(reader, key);
+            Read(reader, obj);
+            map[key] = std::move(obj);
+        }
+    }
+
+    // std::pair
+    template <typename A, typename B>
+    static void Read(FlatReader &reader, std::pair<A, B> &p)
+    {
+        Read(reader, p.first);
+        Read(reader, p.second);
+    }
+
+    // std::tuple
+    template <std::size_t I = 0, typename... Tp>
+    static typename std::enable_if<I == sizeof...(Tp)>::type
+    Read(FlatReader &, std::tuple<Tp...> &)
+    {}
+    template <std::size_t I = 0, typename... Tp>
+    static typename std::enable_if<I < sizeof...(Tp)>::type
+    Read(FlatReader &reader, std::tuple<Tp...> &t)
+    {
+        Read(reader, std::get<I>(t));
+        Read<I + 1>(reader, t);
+    }
+
+    /**
+     * Decode value from the beginning of buffer
+     *
+     * @return number of bytes used
+     * @throw FlatReader::Exception::OutOfData if buffer ends too early
+     */
+    template <typename T>
+    static size_t Decode(const unsigned char *data, size_t size, T &value)
+    {
+        FlatReader reader(data, size);
+        Read(reader, value);
+        return reader.Used();
+    }
+
+    /* Decode struct with field list other than its FlatLayout */
+    template <typename Fields, typename T>
+    static size_t DecodeAs(const unsigned char *data, size_t size, T &object)
+    {
+        FlatReader reader(data, size);
+        Fields::Read(reader, object);
+        return reader.Used();
+    }
+}; // struct FlatDeserialization
+
+/* Field of Struct, see FLAT_FIELD */
+template <typename Struct, typename Type, Type Struct::*Member>
+struct FlatField {
+    static const Type &Get(const Struct &object) { return object.*Member; }
+    static Type &Get(Struct &object) { return object.*Member; }
+};
+
+#define FLAT_FIELD(Struct, member) \
+    SecurityManager::FlatField<Struct, decltype(Struct::member), &Struct::member>
+
+/* Fields of Struct in wire order, base of FlatLayout specializations */
+template <typename Struct, typename... Fields>
+struct FlatFields;
+
+template <typename Struct>
+struct FlatFields<Struct> {
+    static const bool described = true;
+
+    static size_t Size(const Struct &) { return 0; }
+    static void Write(FlatWriter &, const Struct &) {}
+    static void Read(FlatReader &, Struct &) {}
+};
+
+template <typename Struct, typename Field, typename... Tail>
+struct FlatFields<Struct, Field, Tail...> {
+    static const bool described = true;
+
+    static size_t Size(const Struct &object)
+    {
+        return FlatSerialization::Size(Field::Get(object)) +
+               FlatFields<Struct, Tail...>::Size(object);
+    }
+
+    static void Write(FlatWriter &writer, const Struct &object)
+    {
+        FlatSerialization::Write(writer, Field::Get(object));
+        FlatFields<Struct, Tail...>::Write(writer, object);
+    }
+
+    static void Read(FlatReader &reader, Struct &object)
+    {
+        FlatDeserialization::Read(reader, Field::Get(object));
+        FlatFields<Struct, Tail...>::Read(reader, object);
+    }
+};
+
+} // namespace SecurityManager
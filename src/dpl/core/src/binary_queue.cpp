@@ -25,6 +25,7 @@
 #include <algorithm>
 #include <malloc.h>
 #include <cstring>
+#include <functional>
 #include <new>
 
 namespace SecurityManager {
@@ -186,6 +187,17 @@ void BinaryQueue::Consume(size_t size)
     }
 }
 
+const void *BinaryQueue::Front(size_t &size) const
+{
+    if (m_buckets.empty()) {
+        size = 0;
+        return NULL;
+    }
+
+    size = m_buckets.front()->left;
+    return m_buckets.front()->ptr;
+}
+
 void BinaryQueue::Flatten(void *buffer, size_t bufferSize) const
 {
     // Check parameters
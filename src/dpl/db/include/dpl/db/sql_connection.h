@@ -26,6 +26,7 @@
 #include <dpl/availability.h>
 #include <memory>
 #include <boost/optional.hpp>
+#include <boost/utility/string_ref.hpp>
 #include <dpl/log/log.h>
 #include <sqlite3.h>
 #include <string>
@@ -299,6 +300,16 @@ class SqlConnection
          */
         std::string GetColumnString(ColumnIndex column);
 
+        /**
+         * Get string value from column in current row without copying it.
+         * Returned reference points to sqlite internal buffer and is valid
+         * only until next call to Step() or Reset() on this command.
+         * Null value is returned as empty reference.
+         *
+         * @throw Exception::InvalidColumn
+         */
+        boost::string_ref GetColumnStringRef(ColumnIndex column);
+
         /**
          * Get optional integer value from column in current row.
          *
@@ -487,6 +487,24 @@ std::string SqlConnection::DataCommand::GetColumnString(
     return std::string(value);
 }
 
+boost::string_ref SqlConnection::DataCommand::GetColumnStringRef(
+    SqlConnection::ColumnIndex column)
+{
+    LogDB("SQL data command get column string reference: [" << column << "]");
+    CheckColumnIndex(column);
+
+    // sqlite3_column_bytes must be called after sqlite3_column_text
+    // so that it reports the size of the text representation
+    const char *value = reinterpret_cast<const char *>(
+            sqlite3_column_text(m_stmt, column));
+
+    if (value == NULL) {
+        return boost::string_ref();
+    }
+
+    return boost::string_ref(value, sqlite3_column_bytes(m_stmt, column));
+}
+
 boost::optional<int> SqlConnection::DataCommand::GetColumnOptionalInteger(
     SqlConnection::ColumnIndex column)
 {
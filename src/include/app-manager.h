@@ -298,6 +298,40 @@ int security_manager_path_req_set_uid(path_req *p_req, const uid_t uid);
  */
 int security_manager_paths_register(const path_req *p_req);
 
+/**
+ * This function starts an off-line mode session, meant for preinstalling
+ * many applications while building an image. Application install and
+ * uninstall, user add and paths registration requests made by this process
+ * until security_manager_offline_session_end() share one service instance
+ * and regenerate merged Smack rules and permissible sets only once, when the
+ * session ends. Each request still commits its own changes. The service lock
+ * is held for the whole session.
+ *
+ * Only one session may be active in a process. Requests made from multiple
+ * threads during the session are processed one at a time. A session not
+ * ended by the process is ended when the process exits.
+ *
+ * \param[out] session  Pointer to the started session
+ * \return API return code or error code: it would be
+ * - SECURITY_MANAGER_SUCCESS on success,
+ * - SECURITY_MANAGER_ERROR_INPUT_PARAM when session is NULL,
+ * - SECURITY_MANAGER_ERROR_BAD_REQUEST when a session is already active,
+ * - SECURITY_MANAGER_ERROR_ACCESS_DENIED when off-line mode is not
+ * possible (caller isn't root or the service is running),
+ * - SECURITY_MANAGER_ERROR_SERVER_ERROR on other errors.
+ */
+int security_manager_offline_session_begin(offline_session **session);
+
+/**
+ * This function finishes an off-line mode session started by
+ * security_manager_offline_session_begin(), writes files deferred during
+ * the session and frees it.
+ *
+ * \param[in] session  Session to be finished
+ * \return API return code or error code
+ */
+int security_manager_offline_session_end(offline_session *session);
+
 #ifdef __cplusplus
 }
 #endif
@@ -88,6 +88,52 @@ int security_manager_drop_process_privileges(void);
  */
 int security_manager_prepare_app(const char *app_id);
 
+/**
+ * First phase of security_manager_prepare_app() for launchers that know which
+ * application will be started before they fork. It asks security-manager
+ * for everything needed to prepare the application process (supplementary
+ * groups and Smack label) and stores it in a handle, so that the process
+ * after fork doesn't need to communicate with the service.
+ *
+ * The handle must be freed with security_manager_prepare_app_handle_free().
+ * It should be fetched shortly before launch, since it reflects the policy at
+ * the time of this call.
+ *
+ * Policy is checked for the credentials of the calling process, so it must run
+ * as the user the application is launched for, with the same uid the forked
+ * process will have. A launcher serving several users (or changing uid after
+ * fork) has to prefetch from a process of each user or use
+ * security_manager_prepare_app() in the forked process instead.
+ * security_manager_prepare_app_apply() refuses a handle fetched under
+ * another uid.
+ *
+ * \param[in]  app_id  Application identifier
+ * \param[out] handle  Pointer to prefetched application security context
+ * \return API return code or error code
+ */
+int security_manager_prepare_app_prefetch(const char *app_id, prepare_app_handle **handle);
+
+/**
+ * Second phase of security_manager_prepare_app(). It should be called after
+ * fork in the new process, before running the application in it. Applies
+ * supplementary groups, Smack label and drops capabilities of all threads of
+ * the process using only data prefetched by
+ * security_manager_prepare_app_prefetch(). The same handle may be applied in
+ * any number of forked processes.
+ *
+ * \param[in] handle  Prefetched application security context
+ * \return API return code or error code, SECURITY_MANAGER_ERROR_INPUT_PARAM
+ *         if the handle was fetched by a process of another uid
+ */
+int security_manager_prepare_app_apply(const prepare_app_handle *handle);
+
+/**
+ * This function frees memory allocated by security_manager_prepare_app_prefetch().
+ *
+ * \param[in] handle  Handle to be freed
+ */
+void security_manager_prepare_app_handle_free(prepare_app_handle *handle);
+
 /**
  * This function returns array of groups bound to privileges of file resources.
  *
@@ -283,6 +329,43 @@ int security_manager_get_client_privilege_license(const char *privilege,
                                                   uid_t uid,
                                                   char **license);
 
+/**
+ * Get provider of privilege together with licenses of the provider and of an application
+ * that requested access to privilege, in a single request to security-manager.
+ *
+ * This is equivalent to calling security_manager_identify_app_from_cynara_client(),
+ * security_manager_get_app_defined_privilege_provider(),
+ * security_manager_get_app_defined_privilege_license() and
+ * security_manager_get_client_privilege_license() one after another.
+ *
+ * On successful call all returned strings should be freed with free() function when
+ * caller is done with them. Any of output parameters may be NULL, NULL-ed argument will be
+ * ignored. client_app_id is set to NULL for non-hybrid applications.
+ * When privilege/client/uid is incorrect or not related to any license, this function
+ * will return SECURITY_MANAGER_ERROR_NO_SUCH_OBJECT.
+ *
+ * \param[in]   client             Cynara client identifier of application that requests
+ *                                  access to privilege
+ * \param[in]   privilege          Privilege name
+ * \param[in]   uid                User identifier
+ * \param[out]  provider_pkg_id    Package id of the provider application
+ * \param[out]  provider_app_id    Application id of the provider application
+ * \param[out]  provider_license   License of the provider application
+ * \param[out]  client_pkg_id      Package id of the client application
+ * \param[out]  client_app_id      Application id of the client application
+ * \param[out]  client_license     License of the client application
+ * \return API return code or error code
+ */
+int security_manager_get_license_bundle(const char *client,
+                                        const char *privilege,
+                                        uid_t uid,
+                                        char **provider_pkg_id,
+                                        char **provider_app_id,
+                                        char **provider_license,
+                                        char **client_pkg_id,
+                                        char **client_app_id,
+                                        char **client_license);
+
 #ifdef __cplusplus
 }
 #endif
@@ -385,6 +385,34 @@ int security_manager_get_configured_policy_for_self(
         policy_entry ***ppp_privs_policy,
         size_t *p_size);
 
+/**
+ * \brief Function makes security-manager reload policies it keeps cached from Cynara.
+ *
+ * Security-manager keeps in memory a copy of Cynara buckets it manages
+ * exclusively. This function should be called after such buckets were modified
+ * directly in Cynara (e.g. by policy update scripts), bypassing security-manager.
+ *
+ * Required privileges:
+ * - http://tizen.org/privilege/internal/usermanagement
+ *
+ * \return API return code or error code
+ */
+int security_manager_policy_resync(void);
+
+/**
+ * \brief Function gets statistics of Cynara decisions cached by security-manager.
+ *
+ * Counters are kept since security-manager started and wrap around on overflow.
+ *
+ * Required privileges:
+ * - http://tizen.org/privilege/internal/usermanagement
+ *
+ * \param[out] p_hits number of privilege checks answered from the cache
+ * \param[out] p_misses number of privilege checks passed to Cynara
+ * \return API return code or error code
+ */
+int security_manager_policy_cache_statistics(unsigned *p_hits, unsigned *p_misses);
+
 /**
  * \brief Function gets the whole policy for all users, their applications and privileges
  *        based on the provided filter. The result is stored in the policy_entry array.
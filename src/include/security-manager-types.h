@@ -136,6 +136,16 @@ typedef struct path_req path_req;
 struct app_labels_monitor;
 typedef struct app_labels_monitor app_labels_monitor;
 
+/*! \brief data structure holding application security context prefetched
+ * by launcher before fork, to be applied in the application process */
+struct prepare_app_handle;
+typedef struct prepare_app_handle prepare_app_handle;
+
+/*! \brief data structure holding state shared by off-line mode requests
+ * made within one session */
+struct offline_session;
+typedef struct offline_session offline_session;
+
 /*! \brief wildcard to be used in requests to match all possible values of given field.
  *         Use it, for example when it is desired to list or apply policy change for all
  *         users or all apps for selected user.
@@ -18,6 +18,9 @@
  * @author      Bartlomiej Grzelewski <b.grzelewski@samsung.com>
  * @brief       Implementation of main loop of the license manager agent
  */
+#include <algorithm>
+#include <cstdlib>
+
 #include <lm-config.h>
 
 #include <alog.h>
@@ -25,75 +28,228 @@
 
 namespace LicenseManager {
 
-bool Agent::initialize(AgentLogic *logic) {
-    if (m_logic || m_cynara)
+bool CynaraAgentTransport::initialize() {
+    if (m_cynara)
         return false;
+    return CYNARA_API_SUCCESS == cynara_agent_initialize(&m_cynara, Config::AgentName);
+}
 
-    m_logic = logic;
+bool CynaraAgentTransport::getRequest(cynara_agent_msg_type &type, cynara_agent_req_id &id,
+                                      std::string &data) {
+    size_t dataSize = 0;
+    void *rawData = nullptr;
 
-    if (!m_cynara) {
-        return CYNARA_API_SUCCESS == cynara_agent_initialize(&m_cynara, Config::AgentName);
+    if (CYNARA_API_SUCCESS != cynara_agent_get_request(m_cynara, &type, &id, &rawData, &dataSize))
+        return false;
+
+    data.clear();
+    if (rawData) {
+        data.assign(static_cast<char*>(rawData), dataSize);
+        free(rawData);
     }
-    return false;
+    return true;
 }
 
-void Agent::exitLoop() {
+bool CynaraAgentTransport::putResponse(cynara_agent_msg_type type, cynara_agent_req_id id,
+                                       const std::string &data) {
+    return CYNARA_API_SUCCESS == cynara_agent_put_response(m_cynara, type, id,
+                                                           data.data(), data.size());
+}
+
+void CynaraAgentTransport::cancelWaiting() {
     cynara_agent_cancel_waiting(m_cynara);
 }
 
+CynaraAgentTransport::~CynaraAgentTransport() {
+    if (m_cynara && CYNARA_API_SUCCESS != cynara_agent_finish(m_cynara))
+        ALOGE("cynara_agent_finish failed");
+}
+
+bool Agent::initialize(AgentLogic *logic, size_t workers) {
+    if (m_logic || m_transport)
+        return false;
+
+    CynaraAgentTransport *transport = new CynaraAgentTransport;
+    if (!transport->initialize()) {
+        delete transport;
+        return false;
+    }
+    return initialize(logic, transport, workers);
+}
+
+bool Agent::initialize(AgentLogic *logic, AgentTransport *transport, size_t workers) {
+    if (m_logic || m_transport)
+        return false;
+
+    m_logic = logic;
+    m_transport = transport;
+    m_workers = std::max<size_t>(workers, 1);
+    return true;
+}
+
+void Agent::exitLoop() {
+    m_exit = true;
+    m_transport->cancelWaiting();
+}
+
+bool Agent::respond(cynara_agent_msg_type type, cynara_agent_req_id id, const std::string &data) {
+    if (m_transport->putResponse(type, id, data))
+        return true;
+
+    ALOGE("Sending response to cynara failed");
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_failed = true;
+    return false;
+}
+
+void Agent::queueResponse(cynara_agent_msg_type type, cynara_agent_req_id id, std::string &&data) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_responses.push_back(Response{type, id, std::move(data)});
+    // one wakeup of the main loop sends all responses queued until then
+    if (!m_wakeup) {
+        m_wakeup = true;
+        m_transport->cancelWaiting();
+    }
+}
+
+void Agent::cancel(cynara_agent_req_id id) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    auto inProgress = m_inProgress.find(id);
+    if (inProgress != m_inProgress.end()) {
+        // Response will be queued by worker when it's done
+        inProgress->second = true;
+        return;
+    }
+
+    auto done = std::find_if(m_responses.begin(), m_responses.end(),
+                             [&](const Response &response) { return response.id == id; });
+    if (done != m_responses.end()) {
+        // Response not sent yet, answer with cancel instead
+        done->type = CYNARA_MSG_TYPE_CANCEL;
+        done->data.clear();
+        return;
+    }
+
+    auto queued = std::find_if(m_queue.begin(), m_queue.end(),
+                               [&](const Request &request) { return request.id == id; });
+    if (queued == m_queue.end()) {
+        ALOGD("Request already answered, cancel ignored");
+        return;
+    }
+    m_queue.erase(queued);
+    lock.unlock();
+
+    respond(CYNARA_MSG_TYPE_CANCEL, id, std::string());
+}
+
+void Agent::workerLoop() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        m_cv.wait(lock, [&] { return m_finish || !m_queue.empty(); });
+        if (m_finish)
+            return;
+
+        Request request = std::move(m_queue.front());
+        m_queue.pop_front();
+        m_inProgress[request.id] = false;
+        lock.unlock();
+
+        std::string response = m_logic->process(request.data);
+
+        lock.lock();
+        auto inProgress = m_inProgress.find(request.id);
+        bool canceled = inProgress->second;
+        m_inProgress.erase(inProgress);
+        lock.unlock();
+
+        if (canceled)
+            queueResponse(CYNARA_MSG_TYPE_CANCEL, request.id, std::string());
+        else
+            queueResponse(CYNARA_MSG_TYPE_ACTION, request.id, std::move(response));
+
+        lock.lock();
+    }
+}
+
 bool Agent::mainLoop() {
-    if (!m_cynara || !m_logic)
+    if (!m_transport || !m_logic)
         return false;
 
+    m_finish = false;
+    m_failed = false;
+    m_wakeup = false;
+    m_exit = false;
+
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < m_workers; ++i)
+        workers.emplace_back(&Agent::workerLoop, this);
+
     cynara_agent_msg_type reqType;
     cynara_agent_req_id reqId;
-    size_t dataSize = 0;
-    void *data = nullptr;
+    std::string data;
 
+    /* cynara-agent is not thread safe, so responses of workers are sent from here */
     ALOGD("Waiting for request");
-    while (CYNARA_API_SUCCESS == cynara_agent_get_request(m_cynara, &reqType, &reqId, &data, &dataSize))
-    {
-        ALOGD("Request received ....");
-        // Too late, all request are processed immediately
-        if (CYNARA_MSG_TYPE_CANCEL == reqType) {
-            ALOGD("Request for canceling. Ignored...");
-            continue;
-        }
+    while (true) {
+        if (m_transport->getRequest(reqType, reqId, data)) {
+            ALOGD("Request received ....");
+            if (CYNARA_MSG_TYPE_CANCEL == reqType) {
+                ALOGD("Request for canceling.");
+                cancel(reqId);
+            } else {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_queue.push_back(Request{reqId, std::move(data)});
+                m_cv.notify_one();
+            }
+        } else {
+            if (m_exit)
+                break;
 
-        std::string request;
-        if (data) {
-            request = std::string(static_cast<char*>(data), dataSize);
+            std::deque<Response> responses;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                if (!m_wakeup) {
+                    ALOGE("Receiving request from cynara failed");
+                    break;
+                }
+                m_wakeup = false;
+                responses.swap(m_responses);
+            }
+
+            ALOGD("LICENSE_MANAGER cynara_agent_put_response.");
+            for (const auto &response : responses)
+                if (!respond(response.type, response.id, response.data))
+                    break;
         }
 
-        ALOGD("LICENSE_MANAGER cynara_agent_put_response.");
-        std::string response = m_logic->process(request);
-        int ret = cynara_agent_put_response(
-                m_cynara,
-                CYNARA_MSG_TYPE_ACTION,
-                reqId,
-                response.data(),
-                response.size());
-
-        if (CYNARA_API_SUCCESS != ret)
-            return false;
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_failed)
+            break;
     }
-    return true;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_finish = true;
+        m_queue.clear();
+        m_responses.clear();
+    }
+    m_cv.notify_all();
+    for (auto &worker : workers)
+        worker.join();
+
+    return !m_failed;
 }
 
 bool Agent::deinitialize() {
-    if (!m_cynara && !m_logic)
+    if (!m_transport && !m_logic)
         return false;
 
     delete m_logic;
     m_logic = nullptr;
 
-    if (m_cynara) {
-        if (CYNARA_API_SUCCESS == cynara_agent_finish(m_cynara)) {
-            m_cynara = nullptr;
-        } else {
-            return false;
-        }
-    }
+    delete m_transport;
+    m_transport = nullptr;
 
     return true;
 }
@@ -103,4 +259,3 @@ Agent::~Agent() {
 }
 
 } // namespace LicenseManager
-
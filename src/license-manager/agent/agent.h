@@ -20,17 +20,68 @@
  */
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
 #include <cynara-agent.h>
 
 #include <agent_logic.h>
 
 namespace LicenseManager {
 
+/**
+ * Channel of requests from and responses to cynara. Like cynara-agent, it is
+ * not thread safe: all calls but cancelWaiting() must be made from one thread.
+ * cancelWaiting() may be called from any thread or signal handler, it makes
+ * pending or next getRequest() return false.
+ */
+class AgentTransport {
+public:
+    virtual bool getRequest(cynara_agent_msg_type &type, cynara_agent_req_id &id,
+                            std::string &data) = 0;
+    virtual bool putResponse(cynara_agent_msg_type type, cynara_agent_req_id id,
+                             const std::string &data) = 0;
+    virtual void cancelWaiting() = 0;
+    virtual ~AgentTransport() {}
+};
+
+class CynaraAgentTransport : public AgentTransport {
+public:
+    CynaraAgentTransport() : m_cynara(nullptr) {}
+
+    CynaraAgentTransport(const CynaraAgentTransport &) = delete;
+    CynaraAgentTransport& operator=(const CynaraAgentTransport &) = delete;
+
+    bool initialize();
+
+    bool getRequest(cynara_agent_msg_type &type, cynara_agent_req_id &id,
+                    std::string &data) override;
+    bool putResponse(cynara_agent_msg_type type, cynara_agent_req_id id,
+                     const std::string &data) override;
+    void cancelWaiting() override;
+
+    virtual ~CynaraAgentTransport();
+
+private:
+    cynara_agent *m_cynara;
+};
+
 class Agent {
 public:
     Agent()
       : m_logic(nullptr)
-      , m_cynara(nullptr)
+      , m_transport(nullptr)
+      , m_workers(1)
+      , m_finish(false)
+      , m_failed(false)
+      , m_wakeup(false)
+      , m_exit(false)
     {}
 
     Agent(const Agent &) = delete;
@@ -39,17 +90,61 @@ public:
     Agent& operator=(const Agent &) = delete;
     Agent& operator=(Agent &&) = delete;
 
-    bool initialize(AgentLogic *logic);
+    /**
+     * Initialize agent connected to cynara. Takes ownership of logic.
+     *
+     * @param[in] logic verification logic
+     * @param[in] workers number of threads processing requests
+     */
+    bool initialize(AgentLogic *logic, size_t workers = 1);
+
+    /**
+     * Initialize agent using given transport. Takes ownership of logic and transport.
+     */
+    bool initialize(AgentLogic *logic, AgentTransport *transport, size_t workers = 1);
+
     bool mainLoop();
+
+    /**
+     * Make mainLoop() return, may be called from a signal handler
+     */
     void exitLoop();
     bool deinitialize();
 
     virtual ~Agent();
 
 private:
+    struct Request {
+        cynara_agent_req_id id;
+        std::string data;
+    };
+
+    struct Response {
+        cynara_agent_msg_type type;
+        cynara_agent_req_id id;
+        std::string data;
+    };
+
+    void workerLoop();
+    void cancel(cynara_agent_req_id id);
+    void queueResponse(cynara_agent_msg_type type, cynara_agent_req_id id, std::string &&data);
+    bool respond(cynara_agent_msg_type type, cynara_agent_req_id id, const std::string &data);
+
     AgentLogic *m_logic;
-    cynara_agent *m_cynara;
+    AgentTransport *m_transport;
+    size_t m_workers;
+
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::deque<Request> m_queue;
+    /* Requests being processed, with flag telling whether they were canceled */
+    std::map<cynara_agent_req_id, bool> m_inProgress;
+    /* Responses of workers, sent by the main loop woken up with cancelWaiting() */
+    std::deque<Response> m_responses;
+    bool m_finish;
+    bool m_failed;
+    bool m_wakeup;
+    std::atomic<bool> m_exit;
 };
 
 } // namespace LicenseManager
-
@@ -18,15 +18,20 @@
  * @author      Bartlomiej Grzelewski <b.grzelewski@samsung.com>
  * @brief       This is the place where verification should take place
  */
+#include <sys/stat.h>
+
+#include <cstring>
 #include <fstream>
+#include <limits>
 #include <sstream>
 #include <string>
 #include <memory>
 
 #include <alog.h>
+#include <lm-config.h>
+#include <payload.h>
 
 #include <agent_logic.h>
-#include <app-runtime.h>
 
 #include <openssl/x509.h>
 #include <openssl/x509v3.h>
@@ -34,12 +39,53 @@
 
 namespace LicenseManager {
 
-typedef std::unique_ptr<char, decltype(free)*> CString;
-typedef std::unique_ptr<X509, decltype(X509_free)*> CertPtr;
-typedef std::unique_ptr<X509_STORE, decltype(X509_STORE_free)*> StorePtr;
+namespace {
+
+/* Upper limit of cached verifications, the cache is flushed when reached */
+const size_t VERIFICATION_CACHE_SIZE = 1024;
+
+/* Verifications depend on current time (certificate validity), so they aren't kept forever */
+const std::chrono::seconds VERIFICATION_TTL(300);
+
+bool parseUid(const Payload::StringView &view, int &uid)
+{
+    if (view.size == 0 || view.size > 10)
+        return false;
+    long long value = 0;
+    for (size_t i = 0; i < view.size; ++i) {
+        if (view.data[i] < '0' || view.data[i] > '9')
+            return false;
+        value = value * 10 + (view.data[i] - '0');
+    }
+    if (value > std::numeric_limits<int>::max())
+        return false;
+    uid = static_cast<int>(value);
+    return true;
+}
+
+} // namespace anonymous
+
 typedef std::unique_ptr<X509_STORE_CTX, decltype(X509_STORE_CTX_free)*> StoreCtxPtr;
 
-CertPtr readCertificate(const char *path) {
+bool FileStamp::operator==(const FileStamp &other) const {
+    return dev == other.dev && ino == other.ino && size == other.size &&
+           mtime == other.mtime && mtimeNsec == other.mtimeNsec;
+}
+
+bool getFileStamp(const std::string &path, FileStamp &stamp) {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0)
+        return false;
+
+    stamp.dev = st.st_dev;
+    stamp.ino = st.st_ino;
+    stamp.size = st.st_size;
+    stamp.mtime = st.st_mtim.tv_sec;
+    stamp.mtimeNsec = st.st_mtim.tv_nsec;
+    return true;
+}
+
+CertificateCache::CertPtr readCertificate(const char *path) {
     std::ifstream input(path);
     std::stringstream ss;
     ss << input.rdbuf();
@@ -48,7 +94,7 @@ CertPtr readCertificate(const char *path) {
     auto size = static_cast<int>(data.size());
     X509 *cert = d2i_X509(nullptr, &ptr, size);
     if (cert)
-        return CertPtr(cert, X509_free);
+        return CertificateCache::CertPtr(cert, X509_free);
 
     FILE *file = NULL;
     file = fopen(path, "r");
@@ -56,10 +102,55 @@ CertPtr readCertificate(const char *path) {
         cert = PEM_read_X509(file, NULL, NULL, NULL);
         fclose(file);
     }
-    return CertPtr(cert, X509_free);
+    if (!cert)
+        return CertificateCache::CertPtr();
+    return CertificateCache::CertPtr(cert, X509_free);
 }
 
-int verifyCommonName(const CertPtr &cert, const char *pkgId) {
+CertificateCache::Entry *CertificateCache::getEntry(const std::string &path,
+                                                    const FileStamp &stamp) {
+    auto it = m_entries.find(path);
+    if (it != m_entries.end() && it->second.stamp == stamp)
+        return &it->second;
+
+    auto cert = readCertificate(path.c_str());
+    if (!cert) {
+        if (it != m_entries.end())
+            m_entries.erase(it);
+        return nullptr;
+    }
+
+    Entry &entry = m_entries[path];
+    entry.stamp = stamp;
+    entry.cert = std::move(cert);
+    entry.store.reset();
+    return &entry;
+}
+
+CertificateCache::CertPtr CertificateCache::getCertificate(const std::string &path,
+                                                           const FileStamp &stamp) {
+    Entry *entry = getEntry(path, stamp);
+    return entry ? entry->cert : CertPtr();
+}
+
+CertificateCache::StorePtr CertificateCache::getStore(const std::string &path,
+                                                      const FileStamp &stamp) {
+    Entry *entry = getEntry(path, stamp);
+    if (!entry)
+        return StorePtr();
+
+    if (!entry->store) {
+        StorePtr store(X509_STORE_new(), X509_STORE_free);
+        if (!store || 1 != X509_STORE_add_cert(store.get(), entry->cert.get())) {
+            ALOGD("X509_STORE_add_cert failed");
+            return StorePtr();
+        }
+        entry->store = std::move(store);
+    }
+    return entry->store;
+}
+
+int verifyCommonName(const CertificateCache::CertPtr &cert, const char *pkgId) {
     int cn_pos = -1;
     X509_NAME_ENTRY *cn_entry = nullptr;
     ASN1_STRING *cn_asn1 = nullptr;
@@ -97,62 +188,57 @@ int verifyCommonName(const CertPtr &cert, const char *pkgId) {
     }
 }
 
-int verify(const std::string &smack, int uid, const std::string &privilege) {
-    char *providerPkgId = nullptr, *providerAppId = nullptr;
-    char *clientAppId = nullptr, *clientPkgId = nullptr;
-    char *providerLicensePath = nullptr;
-    char *clientLicensePath = nullptr;
-    int status = -1; // error
+AgentLogic::AgentLogic(LicenseInfoSource source)
+  : m_source(std::move(source))
+{}
 
-    if (SECURITY_MANAGER_SUCCESS != security_manager_get_app_defined_privilege_provider(
-            privilege.c_str(),
-            uid,
-            &providerPkgId,
-            &providerAppId))
+bool AgentLogic::getCachedVerification(const VerificationKey &key, const FileStamp &providerStamp,
+                                       const FileStamp &clientStamp, int &status) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_verifications.find(key);
+    if (it == m_verifications.end())
+        return false;
+
+    const Verification &verification = it->second;
+    if (std::chrono::steady_clock::now() < verification.expires &&
+        providerStamp == verification.providerStamp &&
+        clientStamp == verification.clientStamp)
     {
-        ALOGD("Error in security_manager_get_app_defined_privilege_provider");
-        return -1;
+        status = verification.status;
+        return true;
     }
-    CString pPI(providerPkgId, free);
-    CString pAI(providerAppId, free);
 
-    if (SECURITY_MANAGER_SUCCESS != security_manager_get_app_defined_privilege_license(
-            privilege.c_str(),
-            uid,
-            &providerLicensePath))
-    {
-        ALOGD("Error in security_manager_get_app_defined_privilege_license");
+    ALOGD("License files changed, verifying again");
+    m_verifications.erase(it);
+    return false;
+}
+
+int AgentLogic::verify(const std::string &smack, int uid, const std::string &privilege) {
+    int status = -1; // error
+
+    // license information is always current, only verification of its files is cached
+    LicenseInfo info;
+    if (!m_source(smack, uid, privilege, info))
         return -1;
-    }
-    CString pLP(providerLicensePath, free);
 
-    if (SECURITY_MANAGER_SUCCESS != security_manager_identify_app_from_cynara_client(
-            smack.c_str(),
-            &clientPkgId,
-            &clientAppId))
+    FileStamp providerStamp, clientStamp;
+    if (!getFileStamp(info.providerLicensePath, providerStamp) ||
+        !getFileStamp(info.clientLicensePath, clientStamp))
     {
-        ALOGD("Error in security_manager_identify_app_from_cynara_client");
+        ALOGD("Error accessing certificates");
         return -1;
     }
-    CString cAI(clientAppId, free);
-    CString cPI(clientPkgId, free);
 
-    if (SECURITY_MANAGER_SUCCESS != security_manager_get_client_privilege_license(
-            privilege.c_str(),
-            clientPkgId,
-            clientAppId,
-            uid,
-            &clientLicensePath))
+    CertificateCache::StorePtr providerStore;
+    CertificateCache::CertPtr providerCert, clientCert;
     {
-        ALOGD("Error in security_manager_get_client_privilege_license");
-        return -1;
+        std::lock_guard<std::mutex> lock(m_mutex);
+        providerStore = m_certificates.getStore(info.providerLicensePath, providerStamp);
+        providerCert = m_certificates.getCertificate(info.providerLicensePath, providerStamp);
+        clientCert = m_certificates.getCertificate(info.clientLicensePath, clientStamp);
     }
-    CString cLP(clientLicensePath, free);
 
-    auto providerCert = readCertificate(providerLicensePath);
-    auto clientCert = readCertificate(clientLicensePath);
-
-    if (!providerCert) {
+    if (!providerCert || !providerStore) {
         ALOGD("Error reading provider certificate");
         return -1;
     }
@@ -162,44 +248,76 @@ int verify(const std::string &smack, int uid, const std::string &privilege) {
         return -1;
     }
 
-    if (1 != verifyCommonName(providerCert, providerPkgId) ||
-        1 != verifyCommonName(clientCert, clientPkgId)) {
+    VerificationKey key(info.providerLicensePath, info.clientLicensePath);
+    if (1 != verifyCommonName(providerCert, info.providerPkgId.c_str()) ||
+        1 != verifyCommonName(clientCert, info.clientPkgId.c_str())) {
         ALOGD("Certificate issued for another application package");
-        return -1;
-    }
-
-    StorePtr store(X509_STORE_new(), X509_STORE_free);
-    StoreCtxPtr storeCtx(X509_STORE_CTX_new(), X509_STORE_CTX_free);
-
-    if (1 != X509_STORE_add_cert(store.get(), providerCert.get())) {
-        ALOGD("X509_STORE_add_cert failed");
-    } else if (0 == X509_STORE_CTX_init(storeCtx.get(), store.get(), clientCert.get(), nullptr)) { // check this nullptr
-        ALOGD("X509_STORE_CTX_init failed");
+    } else if (getCachedVerification(key, providerStamp, clientStamp, status)) {
+        ALOGD("Cached verification status of client license: %s", info.clientLicensePath.c_str());
     } else {
-        X509_VERIFY_PARAM_set_flags(storeCtx->param, X509_V_FLAG_X509_STRICT);
+        StoreCtxPtr storeCtx(X509_STORE_CTX_new(), X509_STORE_CTX_free);
+
+        if (0 == X509_STORE_CTX_init(storeCtx.get(), providerStore.get(), clientCert.get(), nullptr)) { // check this nullptr
+            ALOGD("X509_STORE_CTX_init failed");
+            return -1;
+        }
+        X509_STORE_CTX_set_flags(storeCtx.get(), X509_V_FLAG_X509_STRICT);
         status = X509_verify_cert(storeCtx.get()); // 1 == ok; 0 == fail; -1 == error
+
+        if (status != -1)
+            storeVerification(key, Verification{status, providerStamp, clientStamp, {}});
     }
 
     ALOGD("App: %s Uid: %d Privilege: %s", smack.c_str(), uid, privilege.c_str());
-    ALOGD("Privilege: %s is Provided by: %s/%s", privilege.c_str(), providerAppId, providerPkgId);
-    ALOGD("Certificate paths client: %s provider: %s", clientLicensePath, providerLicensePath);
+    ALOGD("Privilege: %s is Provided by: %s/%s", privilege.c_str(),
+          info.providerAppId.c_str(), info.providerPkgId.c_str());
+    ALOGD("Certificate paths client: %s provider: %s",
+          info.clientLicensePath.c_str(), info.providerLicensePath.c_str());
     ALOGD("Verification status (1 means good, 0 means fail, -1 means error): %d", status);
+
     return status;
 }
 
+void AgentLogic::storeVerification(const VerificationKey &key, Verification &&verification) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_verifications.size() >= VERIFICATION_CACHE_SIZE)
+        m_verifications.clear();
+    verification.expires = std::chrono::steady_clock::now() + VERIFICATION_TTL;
+    m_verifications[key] = std::move(verification);
+}
+
 std::string AgentLogic::process(const std::string &data) {
-    std::stringstream ss(data);
     std::string smack, privilege;
-    int uid;
-    ss >> smack >> uid >> privilege;
+    int uid = -1;
+    int status = -1;
+
+    bool binary = Payload::isBinary(data);
+    if (binary) {
+        Payload::RequestView request;
+        if (Payload::decodeRequest(data, request) && parseUid(request.user, uid)) {
+            smack = request.client.str();
+            privilege = request.privilege.str();
+            status = verify(smack, uid, privilege);
+        } else {
+            ALOGE("Malformed or unsupported request from plugin");
+        }
+    } else {
+        // text request of plugins predating binary payloads
+        std::stringstream ss(data);
+        ss >> smack >> uid >> privilege;
+        status = verify(smack, uid, privilege);
+    }
+
+    // Errors may be temporary, don't let the plugin cache them
+    unsigned ttl = (status == -1) ? 0 : Config::AnswerTtl;
+    unsigned answer = (status == 1) ? 1 : 0;
 
-    int status = verify(smack, uid, privilege);
-    status = (status == 1) ? 1 : 0;
+    if (binary)
+        return Payload::encodeAnswer(answer, ttl);
 
     std::stringstream out;
-    out << status;
+    out << answer << " " << ttl;
     return out.str();
 }
 
 } // namespace LicenseManager
-
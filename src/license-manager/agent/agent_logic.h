@@ -19,17 +19,123 @@
  * @brief       This is the place where verification should take place
  */
 #pragma once
+
+#include <sys/types.h>
+
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <utility>
+#include <unordered_map>
+
+#include <openssl/x509.h>
+
+#include <license_info.h>
 
 namespace LicenseManager {
 
-struct AgentLogic {
-    AgentLogic() {}
+/* Identity of a file version, changed by any modification or replacement */
+struct FileStamp {
+    dev_t dev;
+    ino_t ino;
+    off_t size;
+    time_t mtime;
+    long mtimeNsec;
+
+    bool operator==(const FileStamp &other) const;
+};
+
+/**
+ * Read identity of a file
+ *
+ * @return false if the file is not accessible
+ */
+bool getFileStamp(const std::string &path, FileStamp &stamp);
+
+/**
+ * Parsed certificates, reused as long as their files don't change
+ */
+class CertificateCache {
+public:
+    typedef std::shared_ptr<X509> CertPtr;
+    typedef std::shared_ptr<X509_STORE> StorePtr;
+
+    /**
+     * Get certificate from a file
+     *
+     * @param[in] path path to the certificate file (DER or PEM)
+     * @param[in] stamp current identity of the file
+     * @return certificate or nullptr if it couldn't be read
+     */
+    CertPtr getCertificate(const std::string &path, const FileStamp &stamp);
 
+    /**
+     * Get store trusting only certificate from a file
+     *
+     * @param[in] path path to the certificate file (DER or PEM)
+     * @param[in] stamp current identity of the file
+     * @return store or nullptr if the certificate couldn't be read
+     */
+    StorePtr getStore(const std::string &path, const FileStamp &stamp);
+
+    size_t size() const { return m_entries.size(); }
+
+private:
+    struct Entry {
+        FileStamp stamp;
+        CertPtr cert;
+        StorePtr store;
+    };
+
+    Entry *getEntry(const std::string &path, const FileStamp &stamp);
+
+    std::unordered_map<std::string, Entry> m_entries;
+};
+
+class AgentLogic {
+public:
+    AgentLogic() : AgentLogic(getLicenseInfoFromSecurityManager) {}
+
+    explicit AgentLogic(LicenseInfoSource source);
+
+    /**
+     * Verify request from the service plugin
+     *
+     * @param[in] data request encoded by Payload::encodeRequest, or
+     *            "<smack label> <uid> <privilege>" text of older plugins
+     * @return answer (1 if access is allowed, 0 otherwise) and number of
+     *         seconds the plugin may reuse it, encoded the same way as data
+     */
     std::string process(const std::string &data);
 
     virtual ~AgentLogic(){}
+
+private:
+    /* Provider and client license paths */
+    typedef std::pair<std::string, std::string> VerificationKey;
+
+    /* Result of X509 verification of client license against provider license,
+     * valid as long as the files don't change */
+    struct Verification {
+        int status;
+        FileStamp providerStamp;
+        FileStamp clientStamp;
+        std::chrono::steady_clock::time_point expires;
+    };
+
+    int verify(const std::string &smack, int uid, const std::string &privilege);
+    bool getCachedVerification(const VerificationKey &key, const FileStamp &providerStamp,
+                               const FileStamp &clientStamp, int &status);
+    void storeVerification(const VerificationKey &key, Verification &&verification);
+
+    LicenseInfoSource m_source;
+
+    /* Requests are processed concurrently, caches are shared */
+    std::mutex m_mutex;
+    CertificateCache m_certificates;
+    std::map<VerificationKey, Verification> m_verifications;
 };
 
 } // namespace LicenseManager
-
@@ -0,0 +1,70 @@
+/*
+ *  Copyright (c) 2017 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License
+ */
+/**
+ * @file        src/license-manager/agent/license_info.cpp
+ * @brief       Information about providers and licenses of app defined privileges
+ */
+#include <cstdlib>
+#include <memory>
+
+#include <alog.h>
+
+#include <app-runtime.h>
+#include <license_info.h>
+
+namespace LicenseManager {
+
+typedef std::unique_ptr<char, decltype(free)*> CString;
+
+bool getLicenseInfoFromSecurityManager(const std::string &smack, int uid,
+                                       const std::string &privilege, LicenseInfo &info)
+{
+    char *providerPkgId = nullptr, *providerAppId = nullptr;
+    char *providerLicensePath = nullptr;
+    char *clientPkgId = nullptr, *clientAppId = nullptr;
+    char *clientLicensePath = nullptr;
+
+    int ret = security_manager_get_license_bundle(
+            smack.c_str(),
+            privilege.c_str(),
+            uid,
+            &providerPkgId,
+            &providerAppId,
+            &providerLicensePath,
+            &clientPkgId,
+            &clientAppId,
+            &clientLicensePath);
+    if (SECURITY_MANAGER_SUCCESS != ret) {
+        ALOGD("Error in security_manager_get_license_bundle: %d", ret);
+        return false;
+    }
+    CString pPI(providerPkgId, free);
+    CString pAI(providerAppId, free);
+    CString pLP(providerLicensePath, free);
+    CString cPI(clientPkgId, free);
+    CString cAI(clientAppId, free);
+    CString cLP(clientLicensePath, free);
+
+    info.providerPkgId = providerPkgId;
+    info.providerAppId = providerAppId ? providerAppId : "";
+    info.providerLicensePath = providerLicensePath;
+    info.clientPkgId = clientPkgId;
+    info.clientAppId = clientAppId ? clientAppId : "";
+    info.clientLicensePath = clientLicensePath;
+    return true;
+}
+
+} // namespace LicenseManager
@@ -0,0 +1,51 @@
+/*
+ *  Copyright (c) 2017 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License
+ */
+/**
+ * @file        src/license-manager/agent/license_info.h
+ * @brief       Information about providers and licenses of app defined privileges
+ */
+#pragma once
+
+#include <functional>
+#include <string>
+
+namespace LicenseManager {
+
+struct LicenseInfo {
+    std::string providerPkgId;
+    std::string providerAppId;
+    std::string providerLicensePath;
+    std::string clientPkgId;
+    std::string clientAppId;
+    std::string clientLicensePath;
+};
+
+/**
+ * Function gathering license information needed to check access of
+ * a client (identified by Smack label) to an app defined privilege.
+ *
+ * @return true on success
+ */
+typedef std::function<bool(const std::string &smack, int uid, const std::string &privilege,
+                           LicenseInfo &info)> LicenseInfoSource;
+
+/**
+ * License information source asking security-manager
+ */
+bool getLicenseInfoFromSecurityManager(const std::string &smack, int uid,
+                                       const std::string &privilege, LicenseInfo &info);
+
+} // namespace LicenseManager
@@ -23,6 +23,8 @@
 #include <cstdlib>
 #include <cstring>
 #include <exception>
+#include <mutex>
+#include <vector>
 
 #include <systemd/sd-daemon.h>
 #include <openssl/evp.h>
@@ -30,12 +32,44 @@
 #include <openssl/conf.h>
 #include <openssl/err.h>
 
+#include <lm-config.h>
+
 #include <alog.h>
 #include <agent_logic.h>
 #include <agent.h>
 
 static LicenseManager::Agent *s_agentPtr = nullptr;
 
+#if OPENSSL_VERSION_NUMBER < 0x10100000L
+/* Older OpenSSL is thread safe only with locking callbacks provided */
+static std::vector<std::mutex> *s_opensslLocks = nullptr;
+
+static void openssl_locking(int mode, int n, const char *, int) {
+    if (mode & CRYPTO_LOCK)
+        (*s_opensslLocks)[n].lock();
+    else
+        (*s_opensslLocks)[n].unlock();
+}
+
+static void init_openssl_locking() {
+    s_opensslLocks = new std::vector<std::mutex>(CRYPTO_num_locks());
+    CRYPTO_set_locking_callback(openssl_locking);
+}
+#else
+static void init_openssl_locking() {}
+#endif
+
+static unsigned get_workers_count() {
+    const char *env_val = getenv(LicenseManager::Config::AgentWorkersEnv);
+    if (env_val) {
+        int workers = atoi(env_val);
+        if (workers > 0)
+            return workers;
+        ALOGW("Invalid number of workers: " << env_val);
+    }
+    return LicenseManager::Config::AgentDefaultWorkers;
+}
+
 void kill_handler(int sig UNUSED) {
     ALOGD("License manager service is going down now");
     if (s_agentPtr)
@@ -55,6 +89,7 @@ int main(int, char **) {
         return EXIT_FAILURE;
     }
 
+    init_openssl_locking();
     OpenSSL_add_all_algorithms();
     SSL_library_init();
     OPENSSL_config(NULL);
@@ -64,7 +99,7 @@ int main(int, char **) {
 
         LicenseManager::AgentLogic *logic = new LicenseManager::AgentLogic;
         LicenseManager::Agent agent;
-        if (!agent.initialize(logic)) {
+        if (!agent.initialize(logic, get_workers_count())) {
             ALOGE("cynara initialization failed");
             return -1;
         }
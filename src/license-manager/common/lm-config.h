@@ -20,6 +20,8 @@
  */
 #pragma once
 
+#include <cstddef>
+
 #include <cynara-plugin.h>
 
 namespace LicenseManager {
@@ -27,6 +29,16 @@ namespace Config {
 
 const char * const AgentName = "LicenseManager";
 
+/* Number of threads verifying licenses, may be overridden by environment */
+const char * const AgentWorkersEnv = "LM_AGENT_WORKERS";
+const unsigned AgentDefaultWorkers = 4;
+
+/* Seconds the service plugin may reuse a verdict returned by the agent */
+const unsigned AnswerTtl = 60;
+
+/* Maximum number of verdicts kept by the service plugin */
+const size_t AnswerCacheSize = 1024;
+
 const Cynara::PolicyType LM_ASK = 32; // 0x20
 
 const Cynara::PolicyType LM_ALLOW = 33; // 0x21
@@ -0,0 +1,147 @@
+/*
+ *  Copyright (c) 2017 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License
+ */
+/**
+ * @file        payload.cpp
+ * @brief       Binary encoding of data exchanged between license manager plugin and agent
+ */
+
+#include <payload.h>
+
+#include <cstdint>
+#include <limits>
+
+namespace LicenseManager {
+namespace Payload {
+
+namespace {
+
+const size_t MAX_VARINT_SIZE = 5;
+
+void putNumber(std::string &out, uint32_t value)
+{
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+void putString(std::string &out, const std::string &value)
+{
+    putNumber(out, static_cast<uint32_t>(value.size()));
+    out.append(value);
+}
+
+class Reader {
+public:
+    explicit Reader(const std::string &data)
+      : m_pos(data.data())
+      , m_end(data.data() + data.size())
+    {}
+
+    bool tag() {
+        if (m_pos == m_end || static_cast<unsigned char>(*m_pos) != TAG)
+            return false;
+        ++m_pos;
+        return true;
+    }
+
+    bool number(uint32_t &value) {
+        uint64_t result = 0;
+        for (size_t i = 0; i < MAX_VARINT_SIZE && m_pos != m_end; ++i) {
+            unsigned char byte = static_cast<unsigned char>(*m_pos++);
+            result |= static_cast<uint64_t>(byte & 0x7f) << (7 * i);
+            if (!(byte & 0x80)) {
+                if (result > std::numeric_limits<uint32_t>::max())
+                    return false;
+                value = static_cast<uint32_t>(result);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool string(StringView &value) {
+        uint32_t size;
+        if (!number(size) || size > static_cast<size_t>(m_end - m_pos))
+            return false;
+        value = StringView(m_pos, size);
+        m_pos += size;
+        return true;
+    }
+
+    bool finished() const {
+        return m_pos == m_end;
+    }
+
+private:
+    const char *m_pos;
+    const char *m_end;
+};
+
+} // namespace anonymous
+
+bool isBinary(const Cynara::PluginData &data)
+{
+    return !data.empty() && (static_cast<unsigned char>(data[0]) & TAG_FLAG);
+}
+
+Cynara::PluginData encodeRequest(const std::string &client,
+                                 const std::string &user,
+                                 const std::string &privilege)
+{
+    Cynara::PluginData out;
+    out.reserve(1 + 3 * MAX_VARINT_SIZE + client.size() + user.size() + privilege.size());
+    out.push_back(static_cast<char>(TAG));
+    putString(out, client);
+    putString(out, user);
+    putString(out, privilege);
+    return out;
+}
+
+bool decodeRequest(const Cynara::PluginData &data, RequestView &request)
+{
+    Reader reader(data);
+    return reader.tag() &&
+           reader.string(request.client) &&
+           reader.string(request.user) &&
+           reader.string(request.privilege) &&
+           reader.finished();
+}
+
+Cynara::PluginData encodeAnswer(unsigned answer, unsigned ttl)
+{
+    Cynara::PluginData out;
+    out.reserve(1 + 2 * MAX_VARINT_SIZE);
+    out.push_back(static_cast<char>(TAG));
+    putNumber(out, answer);
+    putNumber(out, ttl);
+    return out;
+}
+
+bool decodeAnswer(const Cynara::PluginData &data, unsigned &answer, unsigned &ttl)
+{
+    Reader reader(data);
+    uint32_t a, t;
+    if (!reader.tag() || !reader.number(a) || !reader.number(t) || !reader.finished())
+        return false;
+    answer = a;
+    ttl = t;
+    return true;
+}
+
+} // namespace Payload
+} // namespace LicenseManager
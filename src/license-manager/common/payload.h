@@ -0,0 +1,96 @@
+/*
+ *  Copyright (c) 2017 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License
+ */
+/**
+ * @file        payload.h
+ * @brief       Binary encoding of data exchanged between license manager plugin and agent
+ *
+ * Every payload starts with a tag byte: high bit set (never the first byte
+ * of the old text payloads) and payload version in the low bits. Strings
+ * and numbers follow, numbers encoded as LEB128 varints and strings as
+ * varint length followed by raw bytes.
+ *
+ * Request:  tag, client, user, privilege
+ * Answer:   tag, answer, ttl
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <string>
+
+#include <cynara-plugin.h>
+
+namespace LicenseManager {
+namespace Payload {
+
+const unsigned char VERSION = 1;
+const unsigned char TAG_FLAG = 0x80;
+const unsigned char TAG = TAG_FLAG | VERSION;
+
+/* Bytes of a string living in a decoded payload, valid as long as the payload */
+struct StringView {
+    StringView() : data(nullptr), size(0) {}
+    StringView(const char *d, size_t s) : data(d), size(s) {}
+
+    std::string str() const { return std::string(data, size); }
+
+    bool operator==(const std::string &other) const {
+        return size == other.size() && 0 == memcmp(data, other.data(), size);
+    }
+    bool operator!=(const std::string &other) const { return !(*this == other); }
+
+    const char *data;
+    size_t size;
+};
+
+struct RequestView {
+    StringView client;
+    StringView user;
+    StringView privilege;
+};
+
+/**
+ * Check whether payload was encoded with this module (of any version)
+ */
+bool isBinary(const Cynara::PluginData &data);
+
+Cynara::PluginData encodeRequest(const std::string &client,
+                                 const std::string &user,
+                                 const std::string &privilege);
+
+/**
+ * Decode request without copying its strings
+ *
+ * @param[in] data encoded request
+ * @param[out] request views into data
+ * @return false if data is not a valid request of the current version
+ */
+bool decodeRequest(const Cynara::PluginData &data, RequestView &request);
+
+Cynara::PluginData encodeAnswer(unsigned answer, unsigned ttl);
+
+/**
+ * Decode answer
+ *
+ * @param[in] data encoded answer
+ * @param[out] answer 1 if access is allowed, 0 otherwise
+ * @param[out] ttl number of seconds the answer may be reused
+ * @return false if data is not a valid answer of the current version
+ */
+bool decodeAnswer(const Cynara::PluginData &data, unsigned &answer, unsigned &ttl);
+
+} // namespace Payload
+} // namespace LicenseManager
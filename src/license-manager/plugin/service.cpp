@@ -20,11 +20,16 @@
  * @brief       Implementation of cynara server side license manager plugin.
  */
 
+#include <chrono>
+#include <map>
 #include <string>
+#include <sstream>
 #include <iostream>
+#include <tuple>
 #include <cynara-plugin.h>
 
 #include <lm-config.h>
+#include <payload.h>
 
 using namespace Cynara;
 
@@ -45,14 +50,15 @@ public:
     PluginStatus check(const std::string &client,
                        const std::string &user,
                        const std::string &privilege,
-                       PolicyResult &/*result*/,
+                       PolicyResult &result,
                        AgentType &requiredAgent,
                        PluginData &pluginData) noexcept
     {
         try {
-            std::stringstream ss;
-            ss << client << " " << user << " " << privilege;
-            pluginData = ss.str();
+            if (getCachedAnswer(AnswerKey(client, user, privilege), result))
+                return PluginStatus::ANSWER_READY;
+
+            pluginData = Payload::encodeRequest(client, user, privilege);
 
             requiredAgent = Config::AgentName;
 
@@ -65,18 +71,31 @@ public:
         return PluginStatus::ERROR;
     }
 
-    PluginStatus update(const std::string & /*client*/,
-                        const std::string & /*user*/,
-                        const std::string & /*privilege*/,
+    PluginStatus update(const std::string &client,
+                        const std::string &user,
+                        const std::string &privilege,
                         const PluginData &agentData,
                         PolicyResult &result) noexcept
     {
         try {
-            int answer;
-            std::stringstream ss(agentData);
-            ss >> answer;
+            unsigned answer = 0, ttl = 0;
+            if (Payload::isBinary(agentData)) {
+                if (!Payload::decodeAnswer(agentData, answer, ttl)) {
+                    LOGE("Malformed or unsupported answer from agent");
+                    return PluginStatus::ERROR;
+                }
+            } else {
+                // text answer of older agents, ttl is optional
+                std::stringstream ss(agentData);
+                ss >> answer;
+                if (!(ss >> ttl))
+                    ttl = 0;
+            }
 
             result = PolicyResult(answer ? Config::LM_ALLOW : Config::LM_DENY);
+            if (ttl > 0)
+                storeAnswer(AnswerKey(client, user, privilege), result.policyType(),
+                            std::chrono::seconds(ttl));
             return PluginStatus::SUCCESS;
         } catch (const std::exception &e) {
             LOGE("Failed with std exception: " << e.what());
@@ -86,7 +105,49 @@ public:
         return PluginStatus::ERROR;
     }
 
-    void invalidate() {}
+    void invalidate() {
+        m_answers.clear();
+    }
+
+private:
+    typedef std::tuple<std::string, std::string, std::string> AnswerKey;
+
+    struct Answer {
+        PolicyType type;
+        std::chrono::steady_clock::time_point expires;
+    };
+
+    bool getCachedAnswer(const AnswerKey &key, PolicyResult &result) {
+        auto it = m_answers.find(key);
+        if (it == m_answers.end())
+            return false;
+
+        if (std::chrono::steady_clock::now() >= it->second.expires) {
+            m_answers.erase(it);
+            return false;
+        }
+
+        result = PolicyResult(it->second.type);
+        return true;
+    }
+
+    void storeAnswer(const AnswerKey &key, PolicyType type, std::chrono::seconds ttl) {
+        auto now = std::chrono::steady_clock::now();
+        if (m_answers.size() >= Config::AnswerCacheSize) {
+            for (auto it = m_answers.begin(); it != m_answers.end();) {
+                if (now >= it->second.expires)
+                    it = m_answers.erase(it);
+                else
+                    ++it;
+            }
+            if (m_answers.size() >= Config::AnswerCacheSize)
+                m_answers.clear();
+        }
+        m_answers[key] = Answer{type, now + ttl};
+    }
+
+    /* Cynara calls plugins from its single service thread, no locking needed */
+    std::map<AnswerKey, Answer> m_answers;
 };
 
 } // namespace LicenseManager
@@ -36,6 +36,7 @@
 #include <vector>
 
 #include <security-manager.h>
+#include <user-groups-cache.h>
 
 namespace {
 
@@ -46,6 +47,32 @@ size_t getBufferSize()
     return max < (tmp = sysconf(_SC_GETGR_R_SIZE_MAX)) ? tmp : max;
 }
 
+enum nss_status appendGroups(const std::vector<gid_t> &result, long int *start, long int *size,
+                             gid_t **groupsp, long int limit, int *errnop)
+{
+    if (((*size) - (*start)) < static_cast<long int>(result.size())) {
+        long int required = (*start) + result.size();
+        // value bigger is the lowest power of 2 that is bigger than required value
+        long int bigger = 1 << ((sizeof(unsigned long) << 3) - __builtin_clzl(static_cast<unsigned long>(required)));
+
+        gid_t *ptr = static_cast<gid_t*>(realloc(*groupsp, sizeof(gid_t) * (bigger)));
+        if (!ptr) {
+            *errnop = ENOMEM;
+            return NSS_STATUS_UNAVAIL;
+        }
+        *size = bigger;
+        *groupsp = ptr;
+    }
+
+    for (auto e : result) {
+        (*groupsp)[(*start)++] = e;
+        if (limit > 0 && (*start) >= limit)
+            break;
+    }
+
+    return NSS_STATUS_SUCCESS;
+}
+
 } // anonymous namespace
 
 extern "C" {
@@ -82,6 +109,14 @@ enum nss_status _nss_securitymanager_initgroups_dyn(const char *user, gid_t grou
             return NSS_STATUS_NOTFOUND;
         }
 
+        std::vector<gid_t> result;
+        bool managed;
+
+        // Groups cached by the service spare both IPC and group name lookups,
+        // an unmanaged user's file holds all privileged groups
+        if (SecurityManager::UserGroupsCache().load(pwnam->pw_uid, managed, result))
+            return appendGroups(result, start, size, groupsp, limit, errnop);
+
         char **groups;
         size_t groupsCount;
         ret = security_manager_groups_get_for_user(pwnam->pw_uid, &groups, &groupsCount);
@@ -106,8 +141,6 @@ enum nss_status _nss_securitymanager_initgroups_dyn(const char *user, gid_t grou
             return NSS_STATUS_UNAVAIL;
         }
 
-        std::vector<gid_t> result;
-
         for (size_t i = 0; i < groupsCount; ++i) {
             group *grnam = NULL;
             group groupbuff;
@@ -127,32 +160,12 @@ enum nss_status _nss_securitymanager_initgroups_dyn(const char *user, gid_t grou
                 result.push_back(grnam->gr_gid);
         }
 
-        if (((*size) - (*start)) < static_cast<long int>(result.size())) {
-            long int required = (*start) + result.size();
-            // value bigger is the lowest power of 2 that is bigger than required value
-            long int bigger = 1 << ((sizeof(unsigned long) << 3) - __builtin_clzl(static_cast<unsigned long>(required)));
-
-            gid_t *ptr = static_cast<gid_t*>(realloc(*groupsp, sizeof(gid_t) * (bigger)));
-            if (!ptr) {
-                *errnop = ENOMEM;
-                return NSS_STATUS_UNAVAIL;
-            }
-            *size = bigger;
-            *groupsp = ptr;
-        }
-
-        for (auto e : result) {
-            (*groupsp)[(*start)++] = e;
-            if (limit > 0 && (*start) >= limit)
-                break;
-        }
-
+        return appendGroups(result, start, size, groupsp, limit, errnop);
     } catch (...) {
         // We are leaving c++ code and going to pure c so this
         // Pokemon catch (catch them all) is realy required here.
         return NSS_STATUS_UNAVAIL;
     }
-    return NSS_STATUS_SUCCESS;
 }
 
 } /* extern "C" */
@@ -0,0 +1,137 @@
+/*
+ *  Copyright (c) 2017 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License
+ */
+/*
+ * @file        fair-queue.h
+ * @version     1.0
+ * @brief       Weighted fair queue of work items from many peers.
+ *
+ * Items are kept in one FIFO per flow. Flows having items take turns and
+ * in each turn a flow gives up to its weight of items (deficit round robin
+ * with all items of the same cost), so a flow with lots of items waiting
+ * delays others by at most its weight.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <deque>
+#include <unordered_map>
+
+namespace SecurityManager {
+
+template <typename Flow, typename Item>
+class FairQueue {
+public:
+    FairQueue()
+      : m_size(0)
+      , m_quantum(0)
+    {}
+
+    void Push(const Flow &flow, unsigned weight, const Item &item) {
+        auto &queue = m_queues[flow];
+        queue.weight = std::max(weight, 1u);
+        if (queue.items.empty())
+            m_active.push_back(flow);
+        queue.items.push_back(item);
+        ++m_size;
+    }
+
+    /* Take next item, false if there is none */
+    bool Pop(Item &item) {
+        if (m_active.empty())
+            return false;
+
+        Flow flow = m_active.front();
+        auto it = m_queues.find(flow);
+        auto &queue = it->second;
+        if (m_quantum == 0)
+            m_quantum = queue.weight;
+
+        item = queue.items.front();
+        queue.items.pop_front();
+        --m_size;
+        --m_quantum;
+
+        if (queue.items.empty()) {
+            m_queues.erase(it);
+            m_active.pop_front();
+            m_quantum = 0;
+        } else if (m_quantum == 0) {
+            m_active.pop_front();
+            m_active.push_back(flow);
+        }
+        return true;
+    }
+
+    size_t Size() const { return m_size; }
+
+    bool Empty() const { return m_size == 0; }
+
+    /* Number of flows having items */
+    size_t Flows() const { return m_active.size(); }
+
+private:
+    struct Queue {
+        Queue() : weight(1) {}
+
+        std::deque<Item> items;
+        unsigned weight;
+    };
+
+    std::unordered_map<Flow, Queue> m_queues;
+    /* Flows having items, the first one has its turn */
+    std::deque<Flow> m_active;
+    size_t m_size;
+    /* Items the flow having its turn may still give */
+    unsigned m_quantum;
+};
+
+/*
+ * Fair queues of a few priority classes. Items of a class are given only
+ * when all classes of higher priority (lower number) are empty.
+ */
+template <typename Flow, typename Item, size_t CLASSES>
+class PriorityFairQueue {
+public:
+    void Push(size_t priority, const Flow &flow, unsigned weight, const Item &item) {
+        m_queues[priority].Push(flow, weight, item);
+    }
+
+    /* Take next item of the highest priority, false if there is none */
+    bool Pop(Item &item) {
+        for (auto &queue : m_queues)
+            if (queue.Pop(item))
+                return true;
+        return false;
+    }
+
+    size_t Size(size_t priority) const { return m_queues[priority].Size(); }
+
+    size_t Size() const {
+        size_t size = 0;
+        for (const auto &queue : m_queues)
+            size += queue.Size();
+        return size;
+    }
+
+    bool Empty() const { return Size() == 0; }
+
+private:
+    FairQueue<Flow, Item> m_queues[CLASSES];
+};
+
+} // namespace SecurityManager
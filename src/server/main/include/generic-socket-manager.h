@@ -27,6 +27,8 @@
 #include <vector>
 #include <string>
 
+#include <sys/types.h>
+
 #include <dpl/exception.h>
 
 #include <generic-event.h>
@@ -79,6 +81,8 @@ struct GenericSocketService {
     struct AcceptEvent : public GenericEvent {
         ConnectionID connectionID;
         InterfaceID interfaceID;
+        uid_t uid;                            // Peer credentials, -1 if unknown
+        pid_t pid;
     };
 
     struct WriteEvent : public GenericEvent {
@@ -106,6 +110,11 @@ struct GenericSocketService {
     virtual void Event(const ReadEvent &event) = 0;
     virtual void Event(const CloseEvent &event) = 0;
 
+    /* Read data may be taken over, services not doing so get a const event */
+    virtual void Event(ReadEvent &&event) {
+        Event(static_cast<const ReadEvent &>(event));
+    }
+
     virtual void Start() {};
     virtual void Stop() {};
 
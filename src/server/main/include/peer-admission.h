@@ -0,0 +1,154 @@
+/*
+ *  Copyright (c) 2017 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License
+ */
+/*
+ * @file        peer-admission.h
+ * @version     1.0
+ * @brief       Per-peer rate limits of connections and reads.
+ *
+ * Each client process and each user has its own token buckets, one for
+ * accepted connections and one for reads. A connection or read is admitted
+ * only when both the process and the user bucket have a token, so a flood
+ * from a single process is cut off early, while a respawning process (new
+ * pid every time) is still held back by the limit of its user.
+ *
+ * Nothing is refused for good: a connection or read that is not admitted
+ * waits until the peer gets its tokens back (see AcceptWait() and
+ * ReadWait()). The limits themselves are set by the socket manager.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <unordered_map>
+
+#include <sys/types.h>
+
+namespace SecurityManager {
+
+class TokenBucket {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    /**
+     * @param rate tokens added per second
+     * @param burst bucket capacity, the bucket starts full
+     */
+    TokenBucket(double rate, double burst, Clock::time_point now);
+
+    bool Available(Clock::time_point now) const;
+
+    /* Take a token if available */
+    bool Take(Clock::time_point now);
+
+    /* Time until a token is available, zero if there is one already */
+    Clock::duration Wait(Clock::time_point now) const;
+
+    /* Full bucket behaves as a new one and can be forgotten */
+    bool Full(Clock::time_point now) const;
+
+private:
+    double Tokens(Clock::time_point now) const;
+
+    double m_rate;
+    double m_burst;
+    double m_tokens;
+    Clock::time_point m_last;
+};
+
+class PeerAdmission {
+public:
+    typedef TokenBucket::Clock Clock;
+
+    struct Limit {
+        double rate;
+        double burst;
+    };
+
+    struct Limits {
+        Limit processAccept;
+        Limit processRead;
+        Limit userAccept;
+        Limit userRead;
+    };
+
+    struct Stats {
+        Stats() : rejected(0), deferred(0) {}
+
+        /* Connections closed without being served */
+        std::atomic<size_t> rejected;
+        /* Connections and reads postponed until the peer gets more tokens */
+        std::atomic<size_t> deferred;
+    };
+
+    explicit PeerAdmission(const Limits &limits);
+
+    /* Check new connection of the peer, counted as deferred if refused */
+    bool Accept(uid_t uid, pid_t pid, Clock::time_point now);
+
+    /* Time until Accept() of the peer may succeed */
+    Clock::duration AcceptWait(uid_t uid, pid_t pid, Clock::time_point now);
+
+    /* Count connection closed instead of waiting for Accept() */
+    void Reject() { ++m_stats.rejected; }
+
+    /* Check read from connection of the peer, counted as deferred if refused */
+    bool Read(uid_t uid, pid_t pid, Clock::time_point now);
+
+    /* Time until Read() of the peer may succeed */
+    Clock::duration ReadWait(uid_t uid, pid_t pid, Clock::time_point now);
+
+    const Stats &GetStats() const { return m_stats; }
+
+    /* Number of peers with buckets kept */
+    size_t PeerCount() const { return m_processes.size() + m_users.size(); }
+
+private:
+    /* Buckets of idle peers are dropped once there are that many */
+    static const size_t PRUNE_SIZE = 256;
+
+    struct Buckets {
+        Buckets(const Limit &accept, const Limit &read, Clock::time_point now)
+          : accept(accept.rate, accept.burst, now)
+          , read(read.rate, read.burst, now)
+        {}
+
+        TokenBucket accept;
+        TokenBucket read;
+    };
+
+    template <typename Key>
+    struct Peers {
+        Peers() : pruneAt(PRUNE_SIZE) {}
+
+        std::unordered_map<Key, Buckets> buckets;
+        size_t pruneAt;
+
+        size_t size() const { return buckets.size(); }
+    };
+
+    template <typename Key>
+    Buckets &Get(Peers<Key> &peers, Key key, const Limit &accept, const Limit &read,
+                 Clock::time_point now);
+
+    Limits m_limits;
+    Peers<pid_t> m_processes;
+    Peers<uid_t> m_users;
+    Stats m_stats;
+};
+
+} // namespace SecurityManager
@@ -25,14 +25,22 @@
 #pragma once
 
 #include <cassert>
-#include <queue>
+#include <cerrno>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
 #include <mutex>
+#include <new>
 #include <thread>
-#include <memory>
-#include <condition_variable>
+#include <type_traits>
+#include <utility>
 
+#include <cstdint>
 #include <cstdio>
+#include <sys/eventfd.h>
+#include <unistd.h>
 
+#include <dpl/errno_string.h>
 #include <dpl/exception.h>
 
 #include "generic-event.h"
@@ -56,6 +64,16 @@
 
 namespace SecurityManager {
 
+/*
+ * Events are passed to the service thread through a bounded ring of
+ * preallocated slots, each big enough to hold an event copy. Any thread
+ * may post events, only the service thread takes them. The service thread
+ * sleeps on an eventfd, written only when it is actually waiting. A posting
+ * thread finding all slots taken sleeps until the service thread frees one.
+ *
+ * Services may keep work of their own to be done between events, see
+ * ProcessPending().
+ */
 template <class Service>
 class ServiceThread {
 public:
@@ -65,13 +83,40 @@ public:
         Work,
     };
 
+    class Exception {
+    public:
+        DECLARE_EXCEPTION_TYPE(SecurityManager::Exception, Base)
+        DECLARE_EXCEPTION_TYPE(Base, InitFailed)
+    };
+
+    /* Number of slots, posting threads sleep when all of them are taken */
+    static const size_t QUEUE_SIZE = 1024;
+
+    /* Space for an event in a slot */
+    static const size_t EVENT_SIZE = 128;
+
     ServiceThread()
       : m_state(State::NoThread)
       , m_quit(false)
-    {}
+      , m_waiting(false)
+      , m_slots(new Slot[QUEUE_SIZE])
+      , m_enqueuePos(0)
+      , m_dequeuePos(0)
+      , m_blockedPosters(0)
+    {
+        for (size_t i = 0; i < QUEUE_SIZE; ++i)
+            m_slots[i].sequence.store(i, std::memory_order_relaxed);
+
+        m_wakeupFd = eventfd(0, EFD_CLOEXEC);
+        if (m_wakeupFd == -1) {
+            int err = errno;
+            ThrowMsg(typename Exception::InitFailed, "Error in eventfd: " << GetErrnoString(err));
+        }
+    }
 
     void StartThread() {
         assert(m_state == State::NoThread);
+        m_quit.store(false);
         m_thread = std::thread(ThreadLoopStatic, this);
         m_state = State::Work;
     }
@@ -80,20 +125,17 @@ public:
         // finish the thread if necessary
         if(m_state != State::NoThread)
         {
-            {
-                std::lock_guard<std::mutex> lock(m_eventQueueMutex);
-                m_quit = true;
-                m_waitCondition.notify_one();
-            }
+            m_quit.store(true);
+            Wakeup();
             m_thread.join();
             m_state = State::NoThread;
         }
 
         // clear the event queue
-        while (!m_eventQueue.empty()) {
-            auto front = m_eventQueue.front();
-            delete front.eventPtr;
-            m_eventQueue.pop();
+        while (Slot *slot = Front()) {
+            if (slot->destroy)
+                slot->destroy(slot->storage);
+            Pop();
         }
     }
 
@@ -101,6 +143,7 @@ public:
     {
         // FinishThread() has to be called before destructor
         assert(m_state == State::NoThread);
+        close(m_wakeupFd);
     }
 
     template <class T>
@@ -108,33 +151,163 @@ public:
                Service *servicePtr,
                void (Service::*serviceFunction)(const T &))
     {
-        EventDescription description;
-        description.serviceFunctionPtr =
-            reinterpret_cast<void (Service::*)(void*)>(serviceFunction);
-        description.servicePtr = servicePtr;
-        description.eventFunctionPtr = &ServiceThread::EventCall<T>;
-        description.eventPtr = new T(event);
-        {
-            std::lock_guard<std::mutex> lock(m_eventQueueMutex);
-            m_eventQueue.push(description);
-        }
-        m_waitCondition.notify_one();
+        Post<EventHolder<T, void (Service::*)(const T &)>>(event, servicePtr, serviceFunction);
+    }
+
+    /* Same as above, but the event is moved to the queue and the handler may
+     * take its data over, only rvalues are taken */
+    template <class T>
+    typename std::enable_if<!std::is_reference<T>::value>::type
+    Event(T &&event,
+          Service *servicePtr,
+          void (Service::*serviceFunction)(T &))
+    {
+        Post<EventHolder<T, void (Service::*)(T &)>>(std::move(event), servicePtr,
+                                                      serviceFunction);
     }
 
 protected:
+    /**
+     * Called by the service thread after the events posted so far are
+     * handled and before it goes to sleep, so work queued by event handlers
+     * is interleaved with events
+     *
+     * @return true if there was some work done, false if there is none left
+     */
+    virtual bool ProcessPending() {
+        return false;
+    }
+
+    template <class T, class Function>
+    struct EventHolder {
+        template <class E>
+        EventHolder(E &&e, Function f)
+          : event(std::forward<E>(e)), serviceFunction(f)
+        {}
 
-    struct EventDescription {
-        void (Service::*serviceFunctionPtr)(void *);
+        static void Dispatch(Service *servicePtr, void *storage) {
+            EventHolder *holder = static_cast<EventHolder *>(storage);
+            (servicePtr->*(holder->serviceFunction))(holder->event);
+        }
+
+        static void Destroy(void *storage) {
+            static_cast<EventHolder *>(storage)->~EventHolder();
+        }
+
+        T event;
+        Function serviceFunction;
+    };
+
+    struct Slot {
+        /* Position of the slot in the queue, tells whether it is free or filled */
+        std::atomic<size_t> sequence;
         Service *servicePtr;
-        void (ServiceThread::*eventFunctionPtr)(const EventDescription &event);
-        GenericEvent* eventPtr;
+        void (*dispatch)(Service *servicePtr, void *storage);
+        void (*destroy)(void *storage);
+        typename std::aligned_storage<EVENT_SIZE>::type storage[1];
     };
 
-    template <class T>
-    void EventCall(const EventDescription &desc) {
-        auto fun = reinterpret_cast<void (Service::*)(const T&)>(desc.serviceFunctionPtr);
-        const T& eventLocale = *(static_cast<T*>(desc.eventPtr));
-        (desc.servicePtr->*fun)(eventLocale);
+    template <class Holder, class E, class Function>
+    void Post(E &&event, Service *servicePtr, Function serviceFunction) {
+        static_assert(sizeof(Holder) <= EVENT_SIZE,
+                      "Event too big for service thread queue slot");
+
+        Slot &slot = Claim();
+        try {
+            new (slot.storage) Holder(std::forward<E>(event), serviceFunction);
+            slot.servicePtr = servicePtr;
+            slot.dispatch = &Holder::Dispatch;
+            slot.destroy = &Holder::Destroy;
+        } catch (...) {
+            // slot is already claimed, leave it empty so the queue keeps going
+            slot.dispatch = nullptr;
+            slot.destroy = nullptr;
+            Publish(slot);
+            throw;
+        }
+        Publish(slot);
+    }
+
+    Slot &Claim() {
+        size_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+        for (;;) {
+            Slot &slot = m_slots[pos % QUEUE_SIZE];
+            size_t sequence = slot.sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    return slot;
+            } else if (diff < 0) {
+                // queue full, the service thread is busy with events already queued
+                WaitForSlot(slot, pos);
+                pos = m_enqueuePos.load(std::memory_order_relaxed);
+            } else {
+                pos = m_enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /* Sleep until the slot at given position of the queue is freed */
+    void WaitForSlot(Slot &slot, size_t pos) {
+        std::unique_lock<std::mutex> lock(m_freedMutex);
+        m_blockedPosters.fetch_add(1);
+        // pairs with the fence in Pop
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        m_freedCv.wait(lock, [&] {
+            size_t sequence = slot.sequence.load(std::memory_order_acquire);
+            return static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos) >= 0;
+        });
+        m_blockedPosters.fetch_sub(1);
+    }
+
+    void Publish(Slot &slot) {
+        size_t pos = slot.sequence.load(std::memory_order_relaxed);
+        slot.sequence.store(pos + 1, std::memory_order_release);
+
+        // pairs with the fence in WaitForEvent
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (m_waiting.load(std::memory_order_relaxed) && m_waiting.exchange(false))
+            Wakeup();
+    }
+
+    /* Only the service thread (or anyone once it's finished) may take events */
+    Slot *Front() {
+        Slot &slot = m_slots[m_dequeuePos % QUEUE_SIZE];
+        if (slot.sequence.load(std::memory_order_acquire) != m_dequeuePos + 1)
+            return nullptr;
+        return &slot;
+    }
+
+    void Pop() {
+        Slot &slot = m_slots[m_dequeuePos % QUEUE_SIZE];
+        slot.sequence.store(m_dequeuePos + QUEUE_SIZE, std::memory_order_release);
+        ++m_dequeuePos;
+
+        // pairs with the fence in WaitForSlot
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (m_blockedPosters.load(std::memory_order_relaxed) > 0) {
+            std::lock_guard<std::mutex> lock(m_freedMutex);
+            m_freedCv.notify_all();
+        }
+    }
+
+    void Wakeup() {
+        uint64_t one = 1;
+        while (-1 == write(m_wakeupFd, &one, sizeof(one)) && errno == EINTR);
+    }
+
+    void WaitForEvent() {
+        m_waiting.store(true, std::memory_order_relaxed);
+        // pairs with the fence in Publish
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (Front() || m_quit.load()) {
+            m_waiting.store(false, std::memory_order_relaxed);
+            return;
+        }
+
+        uint64_t count;
+        while (-1 == read(m_wakeupFd, &count, sizeof(count)) && errno == EINTR);
+        m_waiting.store(false, std::memory_order_relaxed);
     }
 
     static void ThreadLoopStatic(ServiceThread *ptr) {
@@ -143,37 +316,54 @@ protected:
 
     void ThreadLoop(){
         for (;;) {
-            EventDescription description = {NULL, NULL, NULL, NULL};
-            {
-                std::unique_lock<std::mutex> ulock(m_eventQueueMutex);
-                if (m_quit)
-                    return;
-                if (!m_eventQueue.empty()) {
-                    description = m_eventQueue.front();
-                    m_eventQueue.pop();
-                } else {
-                    m_waitCondition.wait(ulock);
+            if (m_quit.load())
+                return;
+
+            // take all events posted so far, so pending work is picked
+            // from everything that came in and not in arrival order
+            bool dispatched = false;
+            while (Slot *slot = Front()) {
+                if (slot->dispatch) {
+                    UNHANDLED_EXCEPTION_HANDLER_BEGIN
+                    {
+                        slot->dispatch(slot->servicePtr, slot->storage);
+                    }
+                    UNHANDLED_EXCEPTION_HANDLER_END
+                    slot->destroy(slot->storage);
                 }
+                Pop();
+                dispatched = true;
+                if (m_quit.load())
+                    return;
             }
 
-            if (description.eventPtr != NULL) {
-                UNHANDLED_EXCEPTION_HANDLER_BEGIN
-                {
-                    (this->*description.eventFunctionPtr)(description);
-                    delete description.eventPtr;
-                }
-                UNHANDLED_EXCEPTION_HANDLER_END
+            bool pending = false;
+            UNHANDLED_EXCEPTION_HANDLER_BEGIN
+            {
+                pending = ProcessPending();
             }
+            UNHANDLED_EXCEPTION_HANDLER_END
+
+            if (!dispatched && !pending)
+                WaitForEvent();
         }
     }
 
     std::thread m_thread;
-    std::mutex m_eventQueueMutex;
-    std::queue<EventDescription> m_eventQueue;
-    std::condition_variable m_waitCondition;
 
     State m_state;
-    bool m_quit;
+    std::atomic<bool> m_quit;
+    std::atomic<bool> m_waiting;
+    int m_wakeupFd;
+
+    std::unique_ptr<Slot[]> m_slots;
+    std::atomic<size_t> m_enqueuePos;
+    size_t m_dequeuePos;
+
+    /* Posting threads waiting for a free slot */
+    std::atomic<unsigned> m_blockedPosters;
+    std::mutex m_freedMutex;
+    std::condition_variable m_freedCv;
 };
 
 } // namespace SecurityManager
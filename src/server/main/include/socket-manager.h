@@ -33,6 +33,9 @@
 #include <dpl/exception.h>
 
 #include <generic-socket-manager.h>
+#include <message-reader.h>
+#include <peer-admission.h>
+#include <timing-wheel.h>
 
 namespace SecurityManager {
 
@@ -53,6 +56,9 @@ public:
     virtual void Write(ConnectionID connectionID, const RawBuffer &rawBuffer);
     virtual void Write(ConnectionID connectionID, const SendMsgData &sendMsgData);
 
+    /* Counters of connections and reads held back by per-peer limits */
+    const PeerAdmission::Stats &GetAdmissionStats() const;
+
 protected:
     void CreateDomainSocket(
         GenericSocketService *service,
@@ -67,19 +73,28 @@ protected:
     void ReadyForWriteBuffer(int sock);
     void ReadyForSendMsg(int sock);
     void ReadyForAccept(int sock);
+    void NotifyAccepted(int sock);
     void ProcessQueue(void);
     void NotifyMe(void);
     void CloseSocket(int sock);
+    void RefreshTimeout(int sock);
+    void CloseExpired(void);
+    PeerAdmission::Clock::duration ResumeDeferred(void);
 
     struct SocketDescription {
         bool isListen;
         bool isOpen;
         bool isTimeout;
         bool useSendMsg;
+        bool isLimited;
+        bool isFramed;              // client connection, read message by message
+        bool isWaiting;             // accepted, service not told until the peer has a token
+        uid_t uid;
+        pid_t pid;
         InterfaceID interfaceID;
         GenericSocketService *service;
-        time_t timeout;
         RawBuffer rawBuffer;
+        MessageReader reader;
         std::queue<SendMsgData> sendMsgDataQueue;
         int counter;
 
@@ -88,8 +103,14 @@ protected:
           , isOpen(false)
           , isTimeout(false)
           , useSendMsg(false)
+          , isLimited(false)
+          , isFramed(false)
+          , isWaiting(false)
+          , uid(-1)
+          , pid(-1)
           , interfaceID(-1)
           , service(NULL)
+          , reader(MessageReader::REQUEST_PREALLOC)
         {}
     };
 
@@ -107,14 +128,6 @@ protected:
         SendMsgData sendMsgData;
     };
 
-    struct Timeout {
-        time_t time;
-        int sock;
-        bool operator<(const Timeout &second) const {
-            return time > second.time; // mininum first!
-        }
-    };
-
     SocketDescriptionVector m_socketDescriptionVector;
     fd_set m_readSet;
     fd_set m_writeSet;
@@ -126,7 +139,11 @@ protected:
     std::queue<ConnectionID> m_closeQueue;
     int m_notifyMe[2];
     int m_counter;
-    std::priority_queue<Timeout> m_timeoutQueue;
+    TimingWheel m_timeouts;
+    std::vector<int> m_expired;
+    PeerAdmission m_admission;
+    std::vector<ConnectionID> m_deferred;
+    size_t m_waitingAccepts;
 };
 
 } // namespace SecurityManager
@@ -0,0 +1,97 @@
+/*
+ *  Copyright (c) 2017 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License
+ */
+/*
+ * @file        timing-wheel.h
+ * @version     1.0
+ * @brief       Hierarchical timing wheel for socket timeouts.
+ *
+ * Timers are identified by small non-negative integers (socket descriptors)
+ * and expire with one second resolution. Each level has 64 slots, a slot of
+ * level L spanning 64^L seconds. Timers far in the future sit in coarse slots
+ * and are moved to finer levels as their time approaches. Setting, moving and
+ * removing a timer takes constant time and there is at most one timer per id.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <ctime>
+#include <limits>
+#include <vector>
+
+namespace SecurityManager {
+
+class TimingWheel {
+public:
+    static const time_t NEVER = std::numeric_limits<time_t>::max();
+
+    explicit TimingWheel(time_t now);
+
+    /**
+     * Arm timer of given id to expire at deadline (moving it if already armed)
+     */
+    void Set(int id, time_t deadline);
+
+    void Remove(int id);
+
+    bool IsSet(int id) const;
+
+    size_t Size() const { return m_size; }
+
+    /**
+     * Earliest time at which Expire() may have to do some work
+     *
+     * It never comes later than the nearest deadline, but may come earlier
+     * when timers have to be moved from coarser to finer slots first.
+     *
+     * @return NEVER if no timer is armed
+     */
+    time_t NextExpiry() const;
+
+    /**
+     * Disarm timers with deadline not later than now
+     *
+     * @param[in] now current time
+     * @param[out] expired ids of expired timers are appended here
+     */
+    void Expire(time_t now, std::vector<int> &expired);
+
+private:
+    static const int SLOT_BITS = 6;
+    static const int SLOTS = 1 << SLOT_BITS;
+    static const int LEVELS = 4;
+
+    struct Timer {
+        Timer() : deadline(0), slot(-1), prev(-1), next(-1) {}
+
+        time_t deadline;
+        int slot;
+        int prev;
+        int next;
+    };
+
+    void Link(int id);
+    void Unlink(int id);
+    void Cascade(int level);
+
+    std::vector<Timer> m_timers;
+    int m_head[LEVELS * SLOTS];
+    uint64_t m_occupied[LEVELS];
+    time_t m_current;
+    size_t m_size;
+};
+
+} // namespace SecurityManager
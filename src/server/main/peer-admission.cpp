@@ -0,0 +1,146 @@
+/*
+ *  Copyright (c) 2017 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License
+ */
+/*
+ * @file        peer-admission.cpp
+ * @version     1.0
+ * @brief       Implementation of PeerAdmission.
+ */
+
+#include <algorithm>
+
+#include <peer-admission.h>
+
+namespace SecurityManager {
+
+const size_t PeerAdmission::PRUNE_SIZE;
+
+TokenBucket::TokenBucket(double rate, double burst, Clock::time_point now)
+  : m_rate(rate)
+  , m_burst(burst)
+  , m_tokens(burst)
+  , m_last(now)
+{}
+
+double TokenBucket::Tokens(Clock::time_point now) const
+{
+    if (now <= m_last)
+        return m_tokens;
+    std::chrono::duration<double> elapsed = now - m_last;
+    return std::min(m_burst, m_tokens + elapsed.count() * m_rate);
+}
+
+bool TokenBucket::Available(Clock::time_point now) const
+{
+    return Tokens(now) >= 1.0;
+}
+
+bool TokenBucket::Take(Clock::time_point now)
+{
+    double tokens = Tokens(now);
+    if (tokens < 1.0)
+        return false;
+    m_tokens = tokens - 1.0;
+    m_last = std::max(m_last, now);
+    return true;
+}
+
+TokenBucket::Clock::duration TokenBucket::Wait(Clock::time_point now) const
+{
+    double missing = 1.0 - Tokens(now);
+    if (missing <= 0.0)
+        return Clock::duration::zero();
+    std::chrono::duration<double> wait(missing / m_rate);
+    // round up, so the token is there when the wait is over
+    return std::chrono::duration_cast<Clock::duration>(wait) + Clock::duration(1);
+}
+
+bool TokenBucket::Full(Clock::time_point now) const
+{
+    return Tokens(now) >= m_burst;
+}
+
+PeerAdmission::PeerAdmission(const Limits &limits)
+  : m_limits(limits)
+{}
+
+template <typename Key>
+PeerAdmission::Buckets &PeerAdmission::Get(Peers<Key> &peers, Key key,
+                                           const Limit &accept, const Limit &read,
+                                           Clock::time_point now)
+{
+    auto it = peers.buckets.find(key);
+    if (it != peers.buckets.end())
+        return it->second;
+
+    if (peers.size() >= peers.pruneAt) {
+        for (auto pit = peers.buckets.begin(); pit != peers.buckets.end();) {
+            if (pit->second.accept.Full(now) && pit->second.read.Full(now))
+                pit = peers.buckets.erase(pit);
+            else
+                ++pit;
+        }
+        // peers still active stay, prune again when their number doubles
+        peers.pruneAt = std::max(PRUNE_SIZE, 2 * peers.size());
+    }
+
+    return peers.buckets.emplace(key, Buckets(accept, read, now)).first->second;
+}
+
+bool PeerAdmission::Accept(uid_t uid, pid_t pid, Clock::time_point now)
+{
+    auto &process = Get(m_processes, pid, m_limits.processAccept, m_limits.processRead, now);
+    auto &user = Get(m_users, uid, m_limits.userAccept, m_limits.userRead, now);
+
+    if (!process.accept.Available(now) || !user.accept.Available(now)) {
+        ++m_stats.deferred;
+        return false;
+    }
+    process.accept.Take(now);
+    user.accept.Take(now);
+    return true;
+}
+
+bool PeerAdmission::Read(uid_t uid, pid_t pid, Clock::time_point now)
+{
+    auto &process = Get(m_processes, pid, m_limits.processAccept, m_limits.processRead, now);
+    auto &user = Get(m_users, uid, m_limits.userAccept, m_limits.userRead, now);
+
+    if (!process.read.Available(now) || !user.read.Available(now)) {
+        ++m_stats.deferred;
+        return false;
+    }
+    process.read.Take(now);
+    user.read.Take(now);
+    return true;
+}
+
+PeerAdmission::Clock::duration PeerAdmission::AcceptWait(uid_t uid, pid_t pid,
+                                                         Clock::time_point now)
+{
+    auto &process = Get(m_processes, pid, m_limits.processAccept, m_limits.processRead, now);
+    auto &user = Get(m_users, uid, m_limits.userAccept, m_limits.userRead, now);
+    return std::max(process.accept.Wait(now), user.accept.Wait(now));
+}
+
+PeerAdmission::Clock::duration PeerAdmission::ReadWait(uid_t uid, pid_t pid,
+                                                       Clock::time_point now)
+{
+    auto &process = Get(m_processes, pid, m_limits.processAccept, m_limits.processRead, now);
+    auto &user = Get(m_users, uid, m_limits.userAccept, m_limits.userRead, now);
+    return std::max(process.read.Wait(now), user.read.Wait(now));
+}
+
+} // namespace SecurityManager
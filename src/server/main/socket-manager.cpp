@@ -22,6 +22,8 @@
  * @brief       Implementation of SocketManager.
  */
 
+#include <algorithm>
+#include <chrono>
 #include <set>
 
 #include <signal.h>
@@ -52,6 +54,25 @@ namespace {
 
 const time_t SOCKET_TIMEOUT = 300;
 
+/* Connections and reads per second (and bursts) allowed to a single client
+ * process and to all processes of a user. A peer over its limit is not
+ * refused, its new connections and requests just wait in the socket until it
+ * gets tokens back. Connections are closed only when more than
+ * MAX_WAITING_ACCEPTS of them wait at once. */
+const SecurityManager::PeerAdmission::Limits PEER_LIMITS = {
+    {100, 200},  // accepts of a process
+    {200, 400},  // reads of a process
+    {400, 800},  // accepts of a user
+    {800, 1600}, // reads of a user
+};
+
+const size_t MAX_WAITING_ACCEPTS = 256;
+
+/* Root and platform system daemons (uids below 5000, see
+ * https://wiki.tizen.org/wiki/Security/User_and_group_ID_assignment_policy)
+ * are trusted and not limited, only users and their applications are */
+const uid_t LIMITED_UID_MIN = 5000;
+
 } // namespace anonymous
 
 namespace SecurityManager {
@@ -116,21 +137,15 @@ SocketManager::CreateDefaultReadSocketDescription(int sock, bool timeout)
     auto &desc = m_socketDescriptionVector[sock];
     desc.isListen = false;
     desc.isOpen = true;
+    desc.isLimited = false;
+    desc.isFramed = false;
+    desc.isWaiting = false;
     desc.interfaceID = 0;
     desc.service = NULL;
     desc.counter = ++m_counter;
 
-    if (timeout) {
-        desc.timeout = time(NULL) + SOCKET_TIMEOUT;
-        if (false == desc.isTimeout) {
-            Timeout tm;
-            tm.time = desc.timeout;
-            tm.sock = sock;
-            m_timeoutQueue.push(tm);
-        }
-    }
-
     desc.isTimeout = timeout;
+    RefreshTimeout(sock);
 
     FD_SET(sock, &m_readSet);
     m_maxDesc = sock > m_maxDesc ? sock : m_maxDesc;
@@ -140,6 +155,9 @@ SocketManager::CreateDefaultReadSocketDescription(int sock, bool timeout)
 SocketManager::SocketManager()
   : m_maxDesc(0)
   , m_counter(0)
+  , m_timeouts(time(NULL))
+  , m_admission(PEER_LIMITS)
+  , m_waitingAccepts(0)
 {
     FD_ZERO(&m_readSet);
     FD_ZERO(&m_writeSet);
@@ -207,15 +225,57 @@ void SocketManager::ReadyForAccept(int sock) {
         return;
     }
 
+    ucred peerCred;
+    socklen_t length = sizeof(peerCred);
+    bool hasPeer = (0 == getsockopt(client, SOL_SOCKET, SO_PEERCRED, &peerCred, &length));
+    if (!hasPeer) {
+        int err = errno;
+        LogError("Error in getsockopt(SO_PEERCRED): " << GetErrnoString(err));
+    }
+
+    bool isLimited = hasPeer && peerCred.uid >= LIMITED_UID_MIN;
+    bool admitted = !isLimited ||
+        m_admission.Accept(peerCred.uid, peerCred.pid, PeerAdmission::Clock::now());
+    if (!admitted && m_waitingAccepts >= MAX_WAITING_ACCEPTS) {
+        m_admission.Reject();
+        LogError("Too many connections waiting, closing connection of pid " << peerCred.pid <<
+                 " uid " << peerCred.uid << ", rejected so far: " <<
+                 m_admission.GetStats().rejected);
+        TEMP_FAILURE_RETRY(close(client));
+        return;
+    }
+
     auto &desc = CreateDefaultReadSocketDescription(client, true);
     desc.interfaceID = m_socketDescriptionVector[sock].interfaceID;
     desc.service = m_socketDescriptionVector[sock].service;
     desc.useSendMsg = m_socketDescriptionVector[sock].useSendMsg;
+    desc.isLimited = isLimited;
+    desc.isFramed = true;
+    desc.uid = hasPeer ? peerCred.uid : -1;
+    desc.pid = hasPeer ? peerCred.pid : -1;
+
+    if (!admitted) {
+        // peer is over its limit, the connection waits unread until it may be served
+        LogDebug("Connection of pid " << peerCred.pid << " uid " << peerCred.uid << " deferred");
+        desc.isWaiting = true;
+        ++m_waitingAccepts;
+        FD_CLR(client, &m_readSet);
+        m_deferred.push_back(ConnectionID{client, desc.counter});
+        return;
+    }
+
+    NotifyAccepted(client);
+}
+
+void SocketManager::NotifyAccepted(int sock) {
+    auto &desc = m_socketDescriptionVector[sock];
 
     GenericSocketService::AcceptEvent event;
-    event.connectionID.sock = client;
+    event.connectionID.sock = sock;
     event.connectionID.counter = desc.counter;
     event.interfaceID = desc.interfaceID;
+    event.uid = desc.uid;
+    event.pid = desc.pid;
     desc.service->Event(event);
 }
 
@@ -225,21 +285,38 @@ void SocketManager::ReadyForRead(int sock) {
         return;
     }
 
+    auto &desc = m_socketDescriptionVector[sock];
+    if (desc.isLimited && !m_admission.Read(desc.uid, desc.pid, PeerAdmission::Clock::now())) {
+        // peer is over its limit, data waits in the socket until it may be read
+        LogDebug("Read from pid " << desc.pid << " uid " << desc.uid << " deferred");
+        FD_CLR(sock, &m_readSet);
+        m_deferred.push_back(ConnectionID{sock, desc.counter});
+        return;
+    }
+
     GenericSocketService::ReadEvent event;
     event.connectionID.sock = sock;
-    event.connectionID.counter = m_socketDescriptionVector[sock].counter;
-    event.rawBuffer.resize(4096);
+    event.connectionID.counter = desc.counter;
 
-    auto &desc = m_socketDescriptionVector[sock];
-    desc.timeout = time(NULL) + SOCKET_TIMEOUT;
+    RefreshTimeout(sock);
 
-    ssize_t size = read(sock, &event.rawBuffer[0], 4096);
+    ssize_t size;
+    if (desc.isFramed) {
+        // services get whole requests, received into buffers of their size
+        size = desc.reader.Receive(sock);
+    } else {
+        event.rawBuffer.resize(4096);
+        size = read(sock, &event.rawBuffer[0], 4096);
+    }
 
     if (size == 0) {
         CloseSocket(sock);
+    } else if (size >= 0 && desc.isFramed) {
+        while (desc.reader.Pop(event.rawBuffer))
+            desc.service->Event(std::move(event));
     } else if (size >= 0) {
         event.rawBuffer.resize(size);
-        desc.service->Event(event);
+        desc.service->Event(std::move(event));
     } else if (size == -1) {
         int err = errno;
         switch(err) {
@@ -285,7 +362,7 @@ void SocketManager::ReadyForSendMsg(int sock) {
         FD_CLR(sock, &m_writeSet);
     }
 
-    desc.timeout = time(NULL) + SOCKET_TIMEOUT;
+    RefreshTimeout(sock);
 
     GenericSocketService::WriteEvent event;
     event.connectionID.sock = sock;
@@ -318,7 +395,7 @@ void SocketManager::ReadyForWriteBuffer(int sock) {
 
     desc.rawBuffer.erase(desc.rawBuffer.begin(), desc.rawBuffer.begin()+result);
 
-    desc.timeout = time(NULL) + SOCKET_TIMEOUT;
+    RefreshTimeout(sock);
 
     if (desc.rawBuffer.empty())
         FD_CLR(sock, &m_writeSet);
@@ -346,78 +423,40 @@ void SocketManager::MainLoop() {
 
     m_working = true;
     while(m_working) {
+        // sockets of peers with tokens again go back to m_readSet, before it is copied
+        auto deferredWait = ResumeDeferred();
         fd_set readSet = m_readSet;
         fd_set writeSet = m_writeSet;
 
         timeval localTempTimeout;
         timeval *ptrTimeout = &localTempTimeout;
 
-        // I need to extract timeout from priority_queue.
-        // Timeout in priority_queue may be deprecated.
-        // I need to find some actual one.
-        while(!m_timeoutQueue.empty()) {
-            auto &top = m_timeoutQueue.top();
-            auto &desc = m_socketDescriptionVector[top.sock];
-
-            if (top.time == desc.timeout) {
-                // This timeout matches timeout from socket.
-                // It can be used.
-                break;
-            } else {
-                // This socket was used after timeout in priority queue was set up.
-                // We need to update timeout and find some useable one.
-                Timeout tm = { desc.timeout , top.sock};
-                m_timeoutQueue.pop();
-                m_timeoutQueue.push(tm);
-            }
-        }
-
-        if (m_timeoutQueue.empty()) {
+        time_t nextTimeout = m_timeouts.NextExpiry();
+        if (nextTimeout == TimingWheel::NEVER &&
+            deferredWait == PeerAdmission::Clock::duration::max()) {
             LogDebug("No usaable timeout found.");
             ptrTimeout = NULL; // select will wait without timeout
         } else {
-            time_t currentTime = time(NULL);
-            auto &pqTimeout = m_timeoutQueue.top();
-
-            // 0 means that select won't block and socket will be closed ;-)
-            ptrTimeout->tv_sec =
-              currentTime < pqTimeout.time ? pqTimeout.time - currentTime : 0;
-            ptrTimeout->tv_usec = 0;
-//            LogDebug("Set up timeout: " << (int)ptrTimeout->tv_sec
-//                << " seconds. Socket: " << pqTimeout.sock);
-        }
+            auto wait = std::chrono::microseconds::max();
+            if (nextTimeout != TimingWheel::NEVER) {
+                time_t currentTime = time(NULL);
 
-        int ret = select(m_maxDesc+1, &readSet, &writeSet, NULL, ptrTimeout);
-
-        if (0 == ret) { // timeout
-            Assert(!m_timeoutQueue.empty());
-
-            Timeout pqTimeout = m_timeoutQueue.top();
-            m_timeoutQueue.pop();
-
-            auto &desc = m_socketDescriptionVector[pqTimeout.sock];
-
-            if (!desc.isTimeout || !desc.isOpen) {
-                // Connection was closed. Timeout is useless...
-                desc.isTimeout = false;
-                continue;
+                // 0 means that select won't block and socket will be closed ;-)
+                wait = std::chrono::seconds(
+                  currentTime < nextTimeout ? nextTimeout - currentTime : 0);
             }
+            if (deferredWait != PeerAdmission::Clock::duration::max())
+                wait = std::min(wait, std::chrono::duration_cast<std::chrono::microseconds>(
+                  deferredWait) + std::chrono::microseconds(1));
 
-            if (pqTimeout.time < desc.timeout) {
-                // Is it possible?
-                // This socket was used after timeout. We need to update timeout.
-                pqTimeout.time = desc.timeout;
-                m_timeoutQueue.push(pqTimeout);
-                continue;
-            }
+            ptrTimeout->tv_sec = wait.count() / 1000000;
+            ptrTimeout->tv_usec = wait.count() % 1000000;
+        }
 
-            // timeout from m_timeoutQueue matches with socket.timeout
-            // and connection is open. Time to close it!
-            // Putting new timeout in queue here is pointless.
-            desc.isTimeout = false;
-            CloseSocket(pqTimeout.sock);
+        int ret = select(m_maxDesc+1, &readSet, &writeSet, NULL, ptrTimeout);
 
-            // All done. Now we should process next select ;-)
+        if (0 == ret) { // timeout
+            CloseExpired();
             continue;
         }
 
@@ -444,6 +483,7 @@ void SocketManager::MainLoop() {
             }
         }
         ProcessQueue();
+        CloseExpired();
     }
 }
 
@@ -711,6 +751,62 @@ void SocketManager::ProcessQueue() {
     }
 }
 
+void SocketManager::RefreshTimeout(int sock) {
+    if (m_socketDescriptionVector[sock].isTimeout)
+        m_timeouts.Set(sock, time(NULL) + SOCKET_TIMEOUT);
+}
+
+void SocketManager::CloseExpired() {
+    m_expired.clear();
+    m_timeouts.Expire(time(NULL), m_expired);
+    for (int sock : m_expired) {
+        // timeout is over and connection is still open. Time to close it!
+        m_socketDescriptionVector[sock].isTimeout = false;
+        CloseSocket(sock);
+    }
+}
+
+PeerAdmission::Clock::duration SocketManager::ResumeDeferred() {
+    auto now = PeerAdmission::Clock::now();
+    auto wait = PeerAdmission::Clock::duration::max();
+    size_t kept = 0;
+
+    for (const auto &conn : m_deferred) {
+        auto &desc = m_socketDescriptionVector[conn.sock];
+        if (!desc.isOpen || desc.counter != conn.counter)
+            continue;
+
+        if (desc.isWaiting) {
+            auto peerWait = m_admission.AcceptWait(desc.uid, desc.pid, now);
+            if (peerWait == PeerAdmission::Clock::duration::zero() &&
+                m_admission.Accept(desc.uid, desc.pid, now)) {
+                desc.isWaiting = false;
+                --m_waitingAccepts;
+                FD_SET(conn.sock, &m_readSet);
+                NotifyAccepted(conn.sock);
+                continue;
+            }
+            wait = std::min(wait, peerWait);
+            m_deferred[kept++] = conn;
+            continue;
+        }
+
+        auto peerWait = m_admission.ReadWait(desc.uid, desc.pid, now);
+        if (peerWait == PeerAdmission::Clock::duration::zero()) {
+            FD_SET(conn.sock, &m_readSet);
+            continue;
+        }
+        wait = std::min(wait, peerWait);
+        m_deferred[kept++] = conn;
+    }
+    m_deferred.resize(kept);
+    return wait;
+}
+
+const PeerAdmission::Stats &SocketManager::GetAdmissionStats() const {
+    return m_admission.GetStats();
+}
+
 void SocketManager::CloseSocket(int sock) {
 //    LogInfo("Closing socket: " << sock);
     auto &desc = m_socketDescriptionVector[sock];
@@ -728,13 +824,20 @@ void SocketManager::CloseSocket(int sock) {
     auto service = desc.service;
 
     desc.isOpen = false;
+    desc.isTimeout = false;
+    m_timeouts.Remove(sock);
     desc.service = NULL;
     desc.interfaceID = -1;
     desc.rawBuffer.clear();
+    desc.reader.Clear();
     while(!desc.sendMsgDataQueue.empty())
         desc.sendMsgDataQueue.pop();
 
-    if (service)
+    if (desc.isWaiting) {
+        // service was not told about the connection yet
+        desc.isWaiting = false;
+        --m_waitingAccepts;
+    } else if (service)
         service->Event(event);
     else
         LogError("Critical! Service is NULL! This should never happend!");
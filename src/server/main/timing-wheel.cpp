@@ -0,0 +1,173 @@
+/*
+ *  Copyright (c) 2017 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License
+ */
+/*
+ * @file        timing-wheel.cpp
+ * @version     1.0
+ * @brief       Implementation of TimingWheel.
+ */
+
+#include <algorithm>
+
+#include <timing-wheel.h>
+
+namespace SecurityManager {
+
+const time_t TimingWheel::NEVER;
+
+TimingWheel::TimingWheel(time_t now)
+  : m_current(now)
+  , m_size(0)
+{
+    std::fill(m_head, m_head + LEVELS * SLOTS, -1);
+    std::fill(m_occupied, m_occupied + LEVELS, 0);
+}
+
+void TimingWheel::Set(int id, time_t deadline)
+{
+    if (static_cast<size_t>(id) >= m_timers.size())
+        m_timers.resize(id + 1);
+
+    auto &timer = m_timers[id];
+    if (timer.slot != -1) {
+        if (timer.deadline == deadline)
+            return;
+        Unlink(id);
+    } else {
+        ++m_size;
+    }
+
+    timer.deadline = deadline;
+    Link(id);
+}
+
+void TimingWheel::Remove(int id)
+{
+    if (!IsSet(id))
+        return;
+    Unlink(id);
+    --m_size;
+}
+
+bool TimingWheel::IsSet(int id) const
+{
+    return static_cast<size_t>(id) < m_timers.size() && m_timers[id].slot != -1;
+}
+
+time_t TimingWheel::NextExpiry() const
+{
+    time_t next = NEVER;
+    for (int level = 0; level < LEVELS; ++level) {
+        uint64_t occupied = m_occupied[level];
+        if (!occupied)
+            continue;
+
+        // first slot of this level to be handled from now on
+        int shift = SLOT_BITS * level;
+        time_t unit = (m_current + (static_cast<time_t>(1) << shift) - 1) >> shift;
+        int start = unit & (SLOTS - 1);
+        if (start)
+            occupied = (occupied >> start) | (occupied << (SLOTS - start));
+
+        next = std::min(next, (unit + __builtin_ctzll(occupied)) << shift);
+    }
+    return next;
+}
+
+void TimingWheel::Expire(time_t now, std::vector<int> &expired)
+{
+    while (m_current <= now) {
+        time_t next = NextExpiry();
+        if (next > now)
+            break;
+        m_current = next;
+
+        // timers of coarse slots due now are moved to finer ones
+        for (int level = 1; level < LEVELS; ++level) {
+            if (m_current & ((static_cast<time_t>(1) << (SLOT_BITS * level)) - 1))
+                break;
+            Cascade(level);
+        }
+
+        int *head = &m_head[m_current & (SLOTS - 1)];
+        while (*head != -1) {
+            int id = *head;
+            Unlink(id);
+            --m_size;
+            expired.push_back(id);
+        }
+        ++m_current;
+    }
+
+    // timers set from now on with deadline already passed go to slot of now
+    if (m_current <= now + 1)
+        m_current = now;
+}
+
+void TimingWheel::Link(int id)
+{
+    auto &timer = m_timers[id];
+    time_t when = std::max(timer.deadline, m_current);
+    time_t distance = when - m_current;
+
+    int level = 0;
+    while (level < LEVELS - 1 && distance >= static_cast<time_t>(1) << (SLOT_BITS * (level + 1)))
+        ++level;
+    if (distance >= static_cast<time_t>(1) << (SLOT_BITS * LEVELS))
+        when = m_current + (static_cast<time_t>(1) << (SLOT_BITS * LEVELS)) - 1;
+
+    int index = (when >> (SLOT_BITS * level)) & (SLOTS - 1);
+    int slot = level * SLOTS + index;
+
+    timer.slot = slot;
+    timer.prev = -1;
+    timer.next = m_head[slot];
+    if (timer.next != -1)
+        m_timers[timer.next].prev = id;
+    m_head[slot] = id;
+    m_occupied[level] |= static_cast<uint64_t>(1) << index;
+}
+
+void TimingWheel::Unlink(int id)
+{
+    auto &timer = m_timers[id];
+    if (timer.prev != -1)
+        m_timers[timer.prev].next = timer.next;
+    else
+        m_head[timer.slot] = timer.next;
+    if (timer.next != -1)
+        m_timers[timer.next].prev = timer.prev;
+
+    if (m_head[timer.slot] == -1)
+        m_occupied[timer.slot / SLOTS] &= ~(static_cast<uint64_t>(1) << (timer.slot % SLOTS));
+    timer.slot = -1;
+}
+
+void TimingWheel::Cascade(int level)
+{
+    int index = (m_current >> (SLOT_BITS * level)) & (SLOTS - 1);
+    int slot = level * SLOTS + index;
+    int id = m_head[slot];
+
+    m_head[slot] = -1;
+    m_occupied[level] &= ~(static_cast<uint64_t>(1) << index);
+    while (id != -1) {
+        int next = m_timers[id].next;
+        Link(id);
+        id = next;
+    }
+}
+
+} // namespace SecurityManager
@@ -33,6 +33,15 @@
 
 #include "base-service.h"
 
+namespace {
+
+/* Share of requests served to root processes (installers, launchers) for
+ * each request of other processes, when they all have requests queued */
+const unsigned ROOT_WEIGHT = 4;
+const unsigned USER_WEIGHT = 1;
+
+} // namespace anonymous
+
 namespace SecurityManager {
 
 BaseService::BaseService()
@@ -47,6 +56,9 @@ void BaseService::accept(const AcceptEvent &event)
 
     auto &info = m_connectionInfoMap[event.connectionID.counter];
     info.interfaceID = event.interfaceID;
+    info.uid = event.uid;
+    info.pid = event.pid;
+    info.queued = false;
 }
 
 void BaseService::write(const WriteEvent &event)
@@ -60,14 +72,59 @@ void BaseService::write(const WriteEvent &event)
 }
 
 void BaseService::process(const ReadEvent &event)
+{
+    ReadEvent copy(event);
+    process(copy);
+}
+
+void BaseService::process(ReadEvent &event)
 {
     LogDebug("Read event for counter: " << event.connectionID.counter);
     auto &info = m_connectionInfoMap[event.connectionID.counter];
-    info.buffer.Push(event.rawBuffer);
+    info.buffer.Push(std::move(event.rawBuffer));
+
+    // Requests are processed in turns of client processes, so a process
+    // flooding us with requests doesn't hold back the others
+    if (!info.queued && info.buffer.Ready())
+        queueRequest(event.connectionID, info);
+}
+
+void BaseService::queueRequest(const ConnectionID &conn, ConnectionInfo &info)
+{
+    Priority priority = Priority::NORMAL;
+    try {
+        priority = classify(info.buffer, info.interfaceID);
+    } catch (...) {
+        // broken request, processOne will tell
+    }
+
+    info.queued = true;
+    m_requestQueue.Push(static_cast<size_t>(priority), info.pid,
+                        info.uid == 0 ? ROOT_WEIGHT : USER_WEIGHT, conn);
+}
+
+BaseService::Priority BaseService::classify(MessageBuffer &, InterfaceID)
+{
+    return Priority::NORMAL;
+}
+
+bool BaseService::ProcessPending()
+{
+    ConnectionID conn;
+    if (!m_requestQueue.Pop(conn))
+        return false;
+
+    auto it = m_connectionInfoMap.find(conn.counter);
+    if (it == m_connectionInfoMap.end())
+        return true; // closed in the meantime
 
     // We can get several requests in one package.
-    // Extract and process them all
-    while (processOne(event.connectionID, info.buffer, info.interfaceID));
+    // Process one now, the rest in the next turn of the client
+    auto &info = it->second;
+    info.queued = false;
+    if (processOne(conn, info) && info.buffer.Ready())
+        queueRequest(conn, info);
+    return true;
 }
 
 void BaseService::close(const CloseEvent &event)
@@ -78,6 +135,7 @@ void BaseService::close(const CloseEvent &event)
 
 void BaseService::Start()
 {
+    serviceImpl.start();
     StartThread();
 }
 
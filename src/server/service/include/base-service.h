@@ -25,6 +25,7 @@
 #pragma once
 
 #include <service-thread.h>
+#include <fair-queue.h>
 #include <generic-socket-manager.h>
 #include <message-buffer.h>
 #include <connection-info.h>
@@ -47,14 +48,28 @@ public:
     BaseService();
     virtual ServiceDescriptionVector GetServiceDescription() = 0;
 
+    /* Classes of requests, served in strict priority order */
+    enum class Priority {
+        LAUNCH,     // calls on the application launch path
+        NORMAL,
+        BULK,       // long running calls: installation, user and policy changes
+        COUNT
+    };
+
     DECLARE_THREAD_EVENT(AcceptEvent, accept)
     DECLARE_THREAD_EVENT(WriteEvent, write)
     DECLARE_THREAD_EVENT(ReadEvent, process)
     DECLARE_THREAD_EVENT(CloseEvent, close)
 
+    /* Requests are moved to the service thread, not copied */
+    void Event(ReadEvent &&event) {
+        ServiceThread<BaseService>::Event(std::move(event), this, &BaseService::process);
+    }
+
     void accept(const AcceptEvent &event);
     void write(const WriteEvent &event);
     void process(const ReadEvent &event);
+    void process(ReadEvent &event);
     void close(const CloseEvent &event);
 
     void Start();
@@ -65,17 +80,33 @@ protected:
 
     ConnectionInfoMap m_connectionInfoMap;
 
+    /* Connections having complete requests, by priority of the request,
+     * each client process is a flow */
+    PriorityFairQueue<pid_t, ConnectionID, static_cast<size_t>(Priority::COUNT)> m_requestQueue;
+
+    /* Process one request taken from m_requestQueue */
+    virtual bool ProcessPending();
+
+    void queueRequest(const ConnectionID &conn, ConnectionInfo &info);
+
+    /**
+     * Tell priority of the next request in buffer
+     *
+     * @param  buffer      Buffer with complete request, left unchanged
+     * @param  interfaceID identifier used to distinguish source socket
+     * @return             class of the request
+     */
+    virtual Priority classify(MessageBuffer &buffer, InterfaceID interfaceID);
+
     /**
      * Handle request from a client
      *
      * @param  conn        Socket connection information
-     * @param  buffer      Raw received data buffer
-     * @param  interfaceID identifier used to distinguish source socket
+     * @param  info        Connection state, with raw received data buffer
      * @return             true on success
      */
     virtual bool processOne(const ConnectionID &conn,
-                            MessageBuffer &buffer,
-                            InterfaceID interfaceID) = 0;
+                            ConnectionInfo &info) = 0;
 };
 
 } // namespace SecurityManager
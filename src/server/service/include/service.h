@@ -50,11 +50,18 @@ private:
      * Handle request from a client
      *
      * @param  conn        Socket connection information
-     * @param  buffer      Raw received data buffer
-     * @param  interfaceID identifier used to distinguish source socket
+     * @param  info        Connection state, with raw received data buffer
      * @return             true on success
      */
-    bool processOne(const ConnectionID &conn, MessageBuffer &buffer, InterfaceID interfaceID);
+    bool processOne(const ConnectionID &conn, ConnectionInfo &info);
+
+    /**
+     * Tell priority of request by its call type
+     *
+     * Calls made while launching an application go first, installation
+     * and other long running calls last.
+     */
+    Priority classify(MessageBuffer &buffer, InterfaceID interfaceID);
 
     /**
      * Process application installation
@@ -137,6 +144,22 @@ private:
      */
     void processPolicyGetDesc(MessageBuffer &send);
 
+    /**
+     * Process reloading of Cynara buckets mirrored by security-manager
+     *
+     * @param  send   Raw data buffer to be sent
+     * @param  creds  credentials of the requesting process
+     */
+    void processPolicyResync(MessageBuffer &send, const Credentials &creds);
+
+    /**
+     * Process getting statistics of Cynara decisions cached by security-manager
+     *
+     * @param  send   Raw data buffer to be sent
+     * @param  creds  credentials of the requesting process
+     */
+    void processPolicyCacheStatistics(MessageBuffer &send, const Credentials &creds);
+
     /**
      * Process getting groups bound with privileges
      *
@@ -226,6 +249,14 @@ private:
      * @param  send   Raw data buffer to be sent
      */
     void processGetClientPrivilegeLicense(MessageBuffer &buffer, MessageBuffer &send);
+
+    /**
+     * Process getting provider and licenses of privilege for a client at once
+     *
+     * @param  buffer Raw received data buffer
+     * @param  send   Raw data buffer to be sent
+     */
+    void processGetLicenseBundle(MessageBuffer &buffer, MessageBuffer &send);
 };
 
 } // namespace SecurityManager
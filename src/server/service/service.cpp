@@ -51,9 +51,39 @@ GenericSocketService::ServiceDescriptionVector Service::GetServiceDescription()
     };
 }
 
-bool Service::processOne(const ConnectionID &conn, MessageBuffer &buffer,
-                                  InterfaceID interfaceID)
+BaseService::Priority Service::classify(MessageBuffer &buffer, InterfaceID interfaceID)
 {
+    if (IFACE != interfaceID)
+        return Priority::NORMAL;
+
+    int call_type_int;
+    buffer.Peek(sizeof(call_type_int), &call_type_int);
+
+    switch (static_cast<SecurityModuleCall>(call_type_int)) {
+        case SecurityModuleCall::APP_GET_GROUPS:
+        case SecurityModuleCall::GROUPS_GET:
+        case SecurityModuleCall::GROUPS_FOR_UID:
+        case SecurityModuleCall::LABEL_FOR_PROCESS:
+        case SecurityModuleCall::SHM_APP_NAME:
+            return Priority::LAUNCH;
+        case SecurityModuleCall::APP_INSTALL:
+        case SecurityModuleCall::APP_UNINSTALL:
+        case SecurityModuleCall::USER_ADD:
+        case SecurityModuleCall::USER_DELETE:
+        case SecurityModuleCall::POLICY_UPDATE:
+        case SecurityModuleCall::POLICY_RESYNC:
+        case SecurityModuleCall::PATHS_REGISTER:
+            return Priority::BULK;
+        default:
+            return Priority::NORMAL;
+    }
+}
+
+bool Service::processOne(const ConnectionID &conn, ConnectionInfo &info)
+{
+    MessageBuffer &buffer = info.buffer;
+    InterfaceID interfaceID = info.interfaceID;
+
     LogDebug("Iteration begin. Interface = " << interfaceID);
 
     //waiting for all data
@@ -66,7 +96,10 @@ bool Service::processOne(const ConnectionID &conn, MessageBuffer &buffer,
 
     if (IFACE == interfaceID) {
         Try {
-            Credentials creds = Credentials::getCredentialsFromSocket(conn.sock);
+            // peer of a socket doesn't change, read its credentials once
+            if (!info.creds)
+                info.creds = Credentials::getCredentialsFromSocket(conn.sock);
+            const Credentials &creds = *info.creds;
 
             // deserialize API call type
             int call_type_int;
@@ -162,6 +195,18 @@ bool Service::processOne(const ConnectionID &conn, MessageBuffer &buffer,
                     LogDebug("call_type: SecurityModuleCall::GET_CLIENT_PRIVILEGE_PROVIDER");
                     processGetClientPrivilegeLicense(buffer, send);
                     break;
+                case SecurityModuleCall::GET_LICENSE_BUNDLE:
+                    LogDebug("call_type: SecurityModuleCall::GET_LICENSE_BUNDLE");
+                    processGetLicenseBundle(buffer, send);
+                    break;
+                case SecurityModuleCall::POLICY_RESYNC:
+                    LogDebug("call_type: SecurityModuleCall::POLICY_RESYNC");
+                    processPolicyResync(send, creds);
+                    break;
+                case SecurityModuleCall::POLICY_CACHE_STATISTICS:
+                    LogDebug("call_type: SecurityModuleCall::POLICY_CACHE_STATISTICS");
+                    processPolicyCacheStatistics(send, creds);
+                    break;
                 default:
                     LogError("Invalid call: " << call_type_int);
                     Throw(ServiceException::InvalidAction);
@@ -196,16 +241,7 @@ void Service::processAppInstall(MessageBuffer &buffer, MessageBuffer &send, cons
 {
     app_inst_req req;
 
-    Deserialization::Deserialize(buffer, req.appName);
-    Deserialization::Deserialize(buffer, req.pkgName);
-    Deserialization::Deserialize(buffer, req.privileges);
-    Deserialization::Deserialize(buffer, req.appDefinedPrivileges);
-    Deserialization::Deserialize(buffer, req.pkgPaths);
-    Deserialization::Deserialize(buffer, req.uid);
-    Deserialization::Deserialize(buffer, req.tizenVersion);
-    Deserialization::Deserialize(buffer, req.authorName);
-    Deserialization::Deserialize(buffer, req.installationType);
-    Deserialization::Deserialize(buffer, req.isHybrid);
+    buffer.ReadFlat(req);
     Serialization::Serialize(send, serviceImpl.appInstall(creds, std::move(req)));
 }
 
@@ -213,15 +249,7 @@ void Service::processAppUninstall(MessageBuffer &buffer, MessageBuffer &send, co
 {
     app_inst_req req;
 
-    Deserialization::Deserialize(buffer, req.appName);
-    Deserialization::Deserialize(buffer, req.pkgName);
-    Deserialization::Deserialize(buffer, req.privileges);
-    Deserialization::Deserialize(buffer, req.appDefinedPrivileges);
-    Deserialization::Deserialize(buffer, req.pkgPaths);
-    Deserialization::Deserialize(buffer, req.uid);
-    Deserialization::Deserialize(buffer, req.tizenVersion);
-    Deserialization::Deserialize(buffer, req.authorName);
-    Deserialization::Deserialize(buffer, req.installationType);
+    buffer.ReadFlatAs<AppUninstallLayout>(req);
     Serialization::Serialize(send, serviceImpl.appUninstall(creds, std::move(req)));
 }
 
@@ -280,12 +308,27 @@ void Service::processPolicyUpdate(MessageBuffer &buffer, MessageBuffer &send, co
     int ret;
     std::vector<policy_entry> policyEntries;
 
-    Deserialization::Deserialize(buffer, policyEntries);
+    buffer.ReadFlat(policyEntries);
 
     ret = serviceImpl.policyUpdate(creds, policyEntries);
     Serialization::Serialize(send, ret);
 }
 
+void Service::processPolicyResync(MessageBuffer &send, const Credentials &creds)
+{
+    int ret = serviceImpl.policyResync(creds);
+    Serialization::Serialize(send, ret);
+}
+
+void Service::processPolicyCacheStatistics(MessageBuffer &send, const Credentials &creds)
+{
+    unsigned hits, misses;
+    int ret = serviceImpl.policyCacheStatistics(creds, hits, misses);
+    Serialization::Serialize(send, ret);
+    if (ret == SECURITY_MANAGER_SUCCESS)
+        Serialization::Serialize(send, hits, misses);
+}
+
 void Service::processGetConfiguredPolicy(MessageBuffer &buffer, MessageBuffer &send, const Credentials &creds, bool forAdmin)
 {
     int ret;
@@ -404,10 +447,7 @@ void Service::processDropPrivateSharing(MessageBuffer &recv, MessageBuffer &send
 void Service::processPathsRegister(MessageBuffer &recv, MessageBuffer &send, const Credentials &creds)
 {
     path_req req;
-    Deserialization::Deserialize(recv, req.pkgName);
-    Deserialization::Deserialize(recv, req.uid);
-    Deserialization::Deserialize(recv, req.pkgPaths);
-    Deserialization::Deserialize(recv, req.installationType);
+    recv.ReadFlat(req);
     int ret = serviceImpl.pathsRegister(creds, std::move(req));
     Serialization::Serialize(send, ret);
 }
@@ -470,4 +510,20 @@ void Service::processGetClientPrivilegeLicense(MessageBuffer &buffer, MessageBuf
         Serialization::Serialize(send, license);
 }
 
+void Service::processGetLicenseBundle(MessageBuffer &buffer, MessageBuffer &send)
+{
+    int ret;
+    std::string client, privilege, clientAppName, clientPkgName;
+    LicenseBundle bundle;
+    uid_t uid;
+
+    Deserialization::Deserialize(buffer, uid, client, privilege);
+    ret = serviceImpl.getLicenseBundle(uid, client, privilege, clientAppName, clientPkgName, bundle);
+    Serialization::Serialize(send, ret);
+    if (ret == SECURITY_MANAGER_SUCCESS)
+        Serialization::Serialize(send, bundle.providerAppName, bundle.providerPkgName,
+                                 bundle.providerLicense, clientAppName, clientPkgName,
+                                 bundle.clientLicense);
+}
+
 } // namespace SecurityManager
@@ -0,0 +1,482 @@
+/*
+ *  Copyright (c) 2017 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License
+ */
+/*
+ * @file       cynara_fake.cpp
+ * @version    1.0
+ * @brief      In-process replacement of Cynara libraries used by cynara.cpp
+ */
+
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <set>
+#include <tuple>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+#include <cynara-admin.h>
+#include <cynara-client-async.h>
+#include <cynara-error.h>
+
+#include "cynara_fake.h"
+
+namespace CynaraFake {
+
+namespace {
+
+/* client, user, privilege */
+typedef std::tuple<std::string, std::string, std::string> Key;
+
+/* client, session, user, privilege */
+typedef std::tuple<std::string, std::string, std::string, std::string> CheckKey;
+
+struct Request {
+    cynara_check_id id;
+    CheckKey key;
+    cynara_response_callback callback;
+    void *userData;
+};
+
+/* The only async client, connected on first request */
+struct Client {
+    int fd = -1;
+    bool connected = false;
+    bool dropped = false;
+    cynara_status_callback callback = nullptr;
+    void *userData = nullptr;
+    cynara_check_id nextId = 0;
+    std::vector<Request> requests;
+    std::map<CheckKey, int> cache;
+};
+
+struct State {
+    std::mutex mutex;
+    std::map<std::string, std::map<Key, Policy>> buckets;
+    std::vector<Policy> setPolicies;
+    Calls calls;
+    std::map<std::string, privilege_manager_privilege_type_e> privilegeTypes;
+    std::map<std::string, bool> askUserAnswers;
+    Client client;
+};
+
+State &state()
+{
+    static State s;
+    return s;
+}
+
+bool matches(const char *filter, const std::string &value)
+{
+    return !strcmp(filter, CYNARA_ADMIN_ANY) || value == filter;
+}
+
+bool covers(const std::string &field, const char *value)
+{
+    return field == CYNARA_ADMIN_WILDCARD || field == value;
+}
+
+/* Wake up the client, cynara_async_process() has something to do */
+void notify()
+{
+    if (state().client.fd != -1)
+        eventfd_write(state().client.fd, 1);
+}
+
+/* Cynara disconnects its clients after policy change, so they clear caches */
+void dropClient()
+{
+    Client &client = state().client;
+    client.cache.clear();
+    if (client.connected) {
+        client.dropped = true;
+        notify();
+    }
+}
+
+void apply(const Policy &policy)
+{
+    auto &bucket = state().buckets[policy.bucket];
+    Key key(policy.client, policy.user, policy.privilege);
+    if (policy.result == CYNARA_ADMIN_DELETE)
+        bucket.erase(key);
+    else
+        bucket[key] = policy;
+    dropClient();
+}
+
+void erase(const std::string &name, bool recursive, const char *client, const char *user,
+           const char *privilege, std::set<std::string> &visited)
+{
+    if (!visited.insert(name).second)
+        return;
+
+    auto &bucket = state().buckets[name];
+    std::vector<std::string> linked;
+    for (auto it = bucket.begin(); it != bucket.end();) {
+        const Policy &policy = it->second;
+        if (policy.result == CYNARA_ADMIN_BUCKET)
+            linked.push_back(policy.resultExtra);
+        if (matches(client, policy.client) && matches(user, policy.user) &&
+            matches(privilege, policy.privilege))
+            it = bucket.erase(it);
+        else
+            ++it;
+    }
+
+    if (recursive)
+        for (const auto &link : linked)
+            erase(link, true, client, user, privilege, visited);
+}
+
+/* The most specific policy of bucket applying to the key, DENY if there is none */
+void check(const std::string &name, bool recursive, const char *client, const char *user,
+           const char *privilege, int &result, std::string &resultExtra)
+{
+    const Policy *found = nullptr;
+    int foundWildcards = 4;
+    for (const auto &it : state().buckets[name]) {
+        const Policy &policy = it.second;
+        if (!covers(policy.client, client) || !covers(policy.user, user) ||
+            !covers(policy.privilege, privilege))
+            continue;
+        int wildcards = (policy.client == CYNARA_ADMIN_WILDCARD) +
+                        (policy.user == CYNARA_ADMIN_WILDCARD) +
+                        (policy.privilege == CYNARA_ADMIN_WILDCARD);
+        if (wildcards < foundWildcards) {
+            found = &policy;
+            foundWildcards = wildcards;
+        }
+    }
+
+    if (!found) {
+        result = CYNARA_ADMIN_DENY;
+        resultExtra.clear();
+        return;
+    }
+
+    if (found->result == CYNARA_ADMIN_BUCKET && recursive) {
+        check(found->resultExtra, true, client, user, privilege, result, resultExtra);
+        return;
+    }
+
+    result = found->result;
+    resultExtra = found->resultExtra;
+}
+
+/* Answer given to client, plain results are cached by it */
+int answer(const CheckKey &key)
+{
+    int result;
+    std::string extra;
+    ++state().calls.request;
+    check("", true, std::get<0>(key).c_str(), std::get<2>(key).c_str(),
+          std::get<3>(key).c_str(), result, extra);
+
+    switch (result) {
+    case CYNARA_ADMIN_ALLOW:
+        state().client.cache[key] = CYNARA_API_ACCESS_ALLOWED;
+        return CYNARA_API_ACCESS_ALLOWED;
+    case ASK_USER:
+        return state().askUserAnswers[std::get<1>(key)] ? CYNARA_API_ACCESS_ALLOWED
+                                                        : CYNARA_API_ACCESS_DENIED;
+    default:
+        state().client.cache[key] = CYNARA_API_ACCESS_DENIED;
+        return CYNARA_API_ACCESS_DENIED;
+    }
+}
+
+} // namespace anonymous
+
+void reset()
+{
+    std::lock_guard<std::mutex> guard(state().mutex);
+    state().buckets.clear();
+    state().setPolicies.clear();
+    state().calls = Calls();
+    state().privilegeTypes.clear();
+    state().askUserAnswers.clear();
+    dropClient();
+}
+
+void setPolicy(const Policy &policy)
+{
+    std::lock_guard<std::mutex> guard(state().mutex);
+    apply(policy);
+}
+
+std::vector<Policy> policies(const std::string &bucket)
+{
+    std::lock_guard<std::mutex> guard(state().mutex);
+    std::vector<Policy> result;
+    for (const auto &it : state().buckets[bucket])
+        result.push_back(it.second);
+    return result;
+}
+
+std::vector<Policy> takeSetPolicies()
+{
+    std::lock_guard<std::mutex> guard(state().mutex);
+    std::vector<Policy> result;
+    result.swap(state().setPolicies);
+    return result;
+}
+
+void setAskUserAnswer(const std::string &session, bool allowed)
+{
+    std::lock_guard<std::mutex> guard(state().mutex);
+    state().askUserAnswers[session] = allowed;
+}
+
+Calls calls()
+{
+    std::lock_guard<std::mutex> guard(state().mutex);
+    return state().calls;
+}
+
+void setPrivilegeType(const std::string &privilege, privilege_manager_privilege_type_e type)
+{
+    std::lock_guard<std::mutex> guard(state().mutex);
+    state().privilegeTypes[privilege] = type;
+}
+
+} // namespace CynaraFake
+
+using namespace CynaraFake;
+
+extern "C" {
+
+int cynara_admin_initialize(struct cynara_admin **pp_cynara_admin)
+{
+    *pp_cynara_admin = reinterpret_cast<struct cynara_admin *>(&state());
+    return CYNARA_API_SUCCESS;
+}
+
+int cynara_admin_finish(struct cynara_admin *)
+{
+    return CYNARA_API_SUCCESS;
+}
+
+int cynara_admin_set_policies(struct cynara_admin *,
+                              const struct cynara_admin_policy *const *policies)
+{
+    std::lock_guard<std::mutex> guard(state().mutex);
+    ++state().calls.set;
+    for (size_t i = 0; policies[i] != nullptr; ++i) {
+        const auto *p = policies[i];
+        Policy policy{p->bucket, p->client, p->user, p->privilege, p->result,
+                      p->result_extra ? p->result_extra : ""};
+        state().setPolicies.push_back(policy);
+        apply(policy);
+    }
+    return CYNARA_API_SUCCESS;
+}
+
+int cynara_admin_list_policies(struct cynara_admin *, const char *bucket, const char *client,
+                               const char *user, const char *privilege,
+                               struct cynara_admin_policy ***policies)
+{
+    std::lock_guard<std::mutex> guard(state().mutex);
+    ++state().calls.list;
+
+    std::vector<const Policy *> found;
+    for (const auto &it : state().buckets[bucket]) {
+        const Policy &policy = it.second;
+        if (matches(client, policy.client) && matches(user, policy.user) &&
+            matches(privilege, policy.privilege))
+            found.push_back(&policy);
+    }
+
+    auto list = static_cast<struct cynara_admin_policy **>(
+        calloc(found.size() + 1, sizeof(struct cynara_admin_policy *)));
+    for (size_t i = 0; i < found.size(); ++i) {
+        auto p = static_cast<struct cynara_admin_policy *>(
+            calloc(1, sizeof(struct cynara_admin_policy)));
+        p->bucket = strdup(found[i]->bucket.c_str());
+        p->client = strdup(found[i]->client.c_str());
+        p->user = strdup(found[i]->user.c_str());
+        p->privilege = strdup(found[i]->privilege.c_str());
+        p->result = found[i]->result;
+        p->result_extra = found[i]->resultExtra.empty() ? nullptr
+                                                        : strdup(found[i]->resultExtra.c_str());
+        list[i] = p;
+    }
+    *policies = list;
+    return CYNARA_API_SUCCESS;
+}
+
+int cynara_admin_erase(struct cynara_admin *, const char *start_bucket, int recursive,
+                       const char *client, const char *user, const char *privilege)
+{
+    std::lock_guard<std::mutex> guard(state().mutex);
+    ++state().calls.erase;
+    std::set<std::string> visited;
+    erase(start_bucket, recursive, client, user, privilege, visited);
+    dropClient();
+    return CYNARA_API_SUCCESS;
+}
+
+int cynara_admin_list_policies_descriptions(struct cynara_admin *,
+                                            struct cynara_admin_policy_descr ***descriptions)
+{
+    const std::vector<std::pair<int, const char *>> known = {
+        {CYNARA_ADMIN_DENY, "Deny"},
+        {CYNARA_ADMIN_ALLOW, "Allow"},
+        {ASK_USER, "Ask user"},
+    };
+
+    auto list = static_cast<struct cynara_admin_policy_descr **>(
+        calloc(known.size() + 1, sizeof(struct cynara_admin_policy_descr *)));
+    for (size_t i = 0; i < known.size(); ++i) {
+        auto descr = static_cast<struct cynara_admin_policy_descr *>(
+            calloc(1, sizeof(struct cynara_admin_policy_descr)));
+        descr->result = known[i].first;
+        descr->name = strdup(known[i].second);
+        list[i] = descr;
+    }
+    *descriptions = list;
+    return CYNARA_API_SUCCESS;
+}
+
+int cynara_admin_check(struct cynara_admin *, const char *start_bucket, const int recursive,
+                       const char *client, const char *user, const char *privilege,
+                       int *result, char **result_extra)
+{
+    std::lock_guard<std::mutex> guard(state().mutex);
+    ++state().calls.check;
+    std::string extra;
+    check(start_bucket, recursive, client, user, privilege, *result, extra);
+    *result_extra = extra.empty() ? nullptr : strdup(extra.c_str());
+    return CYNARA_API_SUCCESS;
+}
+
+int cynara_async_configuration_create(cynara_async_configuration **pp_conf)
+{
+    *pp_conf = reinterpret_cast<cynara_async_configuration *>(&state());
+    return CYNARA_API_SUCCESS;
+}
+
+int cynara_async_configuration_set_cache_size(cynara_async_configuration *, size_t)
+{
+    return CYNARA_API_SUCCESS;
+}
+
+void cynara_async_configuration_destroy(cynara_async_configuration *)
+{}
+
+int cynara_async_initialize(cynara_async **pp_cynara, const cynara_async_configuration *,
+                            cynara_status_callback callback, void *user_status_data)
+{
+    std::lock_guard<std::mutex> guard(state().mutex);
+    Client &client = state().client;
+    client = Client();
+    client.fd = eventfd(0, EFD_NONBLOCK);
+    if (client.fd == -1)
+        return CYNARA_API_UNKNOWN_ERROR;
+    client.callback = callback;
+    client.userData = user_status_data;
+    *pp_cynara = reinterpret_cast<cynara_async *>(&state());
+    return CYNARA_API_SUCCESS;
+}
+
+void cynara_async_finish(cynara_async *)
+{
+    std::vector<Request> requests;
+    {
+        std::lock_guard<std::mutex> guard(state().mutex);
+        Client &client = state().client;
+        requests.swap(client.requests);
+        if (client.fd != -1)
+            close(client.fd);
+        client = Client();
+    }
+    for (const auto &request : requests)
+        request.callback(request.id, CYNARA_CALL_CAUSE_FINISH, 0, request.userData);
+}
+
+int cynara_async_check_cache(cynara_async *, const char *client, const char *client_session,
+                             const char *user, const char *privilege)
+{
+    std::lock_guard<std::mutex> guard(state().mutex);
+    const auto &cache = state().client.cache;
+    auto it = cache.find(CheckKey(client, client_session, user, privilege));
+    return it != cache.end() ? it->second : CYNARA_API_CACHE_MISS;
+}
+
+int cynara_async_create_request(cynara_async *, const char *client, const char *client_session,
+                                const char *user, const char *privilege,
+                                cynara_check_id *p_check_id, cynara_response_callback callback,
+                                void *user_response_data)
+{
+    std::function<void()> connect;
+    {
+        std::lock_guard<std::mutex> guard(state().mutex);
+        Client &async = state().client;
+        *p_check_id = async.nextId++;
+        async.requests.push_back({*p_check_id, CheckKey(client, client_session, user, privilege),
+                                    callback, user_response_data});
+        if (!async.connected) {
+            async.connected = true;
+            connect = std::bind(async.callback, -1, async.fd, CYNARA_STATUS_FOR_READ,
+                                async.userData);
+        }
+        notify();
+    }
+    if (connect)
+        connect();
+    return CYNARA_API_SUCCESS;
+}
+
+int cynara_async_process(cynara_async *)
+{
+    std::vector<std::function<void()>> callbacks;
+    {
+        std::lock_guard<std::mutex> guard(state().mutex);
+        Client &client = state().client;
+        eventfd_t value;
+        eventfd_read(client.fd, &value);
+
+        if (client.dropped) {
+            client.dropped = false;
+            callbacks.push_back(std::bind(client.callback, client.fd, -1,
+                                          CYNARA_STATUS_FOR_READ, client.userData));
+            callbacks.push_back(std::bind(client.callback, -1, client.fd,
+                                          CYNARA_STATUS_FOR_READ, client.userData));
+        }
+
+        for (const auto &request : client.requests)
+            callbacks.push_back(std::bind(request.callback, request.id,
+                                          CYNARA_CALL_CAUSE_ANSWER, answer(request.key),
+                                          request.userData));
+        client.requests.clear();
+    }
+    for (const auto &callback : callbacks)
+        callback();
+    return CYNARA_API_SUCCESS;
+}
+
+int privilege_info_get_privilege_type(uid_t, const char *, const char *privilege,
+                                      privilege_manager_privilege_type_e *type)
+{
+    std::lock_guard<std::mutex> guard(state().mutex);
+    auto it = state().privilegeTypes.find(privilege);
+    *type = it != state().privilegeTypes.end() ? it->second
+                                               : PRIVILEGE_MANAGER_PRIVILEGE_TYPE_NORMAL;
+    return PRVMGR_ERR_NONE;
+}
+
+} // extern "C"
@@ -0,0 +1,81 @@
+/*
+ *  Copyright (c) 2017 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License
+ */
+/*
+ * @file       cynara_fake.h
+ * @version    1.0
+ * @brief      In-process replacement of Cynara libraries used by cynara.cpp
+ *
+ * Tests linking cynara.cpp get cynara_admin_*, cynara_async_* and
+ * privilege_info_* functions from cynara_fake.cpp instead of the real
+ * libraries. Policies are kept in memory and every call is recorded, so tests
+ * may check what security-manager asked Cynara for.
+ *
+ * Checks of the async client start in the default bucket. Like Cynara, the
+ * client is disconnected after every change of policy and caches plain
+ * ALLOW/DENY answers only.
+ */
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <privilege_info.h>
+
+namespace CynaraFake {
+
+struct Policy {
+    std::string bucket;
+    std::string client;
+    std::string user;
+    std::string privilege;
+    int result;
+    std::string resultExtra;
+};
+
+/* Number of calls made */
+struct Calls {
+    unsigned list;
+    unsigned set;
+    unsigned erase;
+    unsigned check;
+    /* checks of async client not answered from its cache */
+    unsigned request;
+};
+
+/* Policy type of "Ask user" plugin, as listed in descriptions */
+const int ASK_USER = 10;
+
+/* Forget all policies, recorded calls and privilege types */
+void reset();
+
+/* Set policy bypassing security-manager, like cyad does */
+void setPolicy(const Policy &policy);
+
+/* Policies of bucket, sorted by client, user and privilege */
+std::vector<Policy> policies(const std::string &bucket);
+
+/* Policies passed to cynara_admin_set_policies() since last call */
+std::vector<Policy> takeSetPolicies();
+
+/* Answer of "Ask user" plugin given in session, denied if not set */
+void setAskUserAnswer(const std::string &session, bool allowed);
+
+Calls calls();
+
+/* Type returned by privilege_info_get_privilege_type() for privilege */
+void setPrivilegeType(const std::string &privilege, privilege_manager_privilege_type_e type);
+
+} // namespace CynaraFake
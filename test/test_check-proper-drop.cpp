@@ -0,0 +1,126 @@
+/*
+ *  Copyright (c) 2017 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License
+ */
+
+/**
+ * @file       test_check-proper-drop.cpp
+ * @version    1.0
+ */
+
+#include <boost/test/unit_test.hpp>
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <sys/syscall.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <check-proper-drop.h>
+#ifdef CHECK_PROPER_DROP_WITH_PROCPS
+#include <check-proper-drop-procps.h>
+#endif
+
+using namespace SecurityManager;
+
+namespace {
+
+/* Keeps a number of threads alive, optionally running setup code in one of them */
+class ThreadsFixture {
+public:
+    ThreadsFixture(unsigned count, std::function<void()> firstThreadSetup = nullptr) :
+        m_started(0), m_stop(false)
+    {
+        for (unsigned i = 0; i < count; ++i)
+            m_threads.emplace_back([this, i, firstThreadSetup] {
+                if (i == 0 && firstThreadSetup)
+                    firstThreadSetup();
+                std::unique_lock<std::mutex> lock(m_mutex);
+                ++m_started;
+                m_cv.notify_all();
+                m_cv.wait(lock, [this] { return m_stop; });
+            });
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_cv.wait(lock, [this, count] { return m_started == count; });
+    }
+
+    ~ThreadsFixture()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_cv.notify_all();
+        for (auto &thread : m_threads)
+            thread.join();
+    }
+
+private:
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    unsigned m_started;
+    bool m_stop;
+    std::vector<std::thread> m_threads;
+};
+
+template <typename T>
+bool verdict()
+{
+    T cpd;
+    cpd.getThreads();
+    return cpd.checkThreads();
+}
+
+void dropGroupsInThread()
+{
+    /* raw syscall changes credentials of the calling thread only */
+    gid_t group = 12345;
+    BOOST_REQUIRE(syscall(SYS_setgroups, 1, &group) == 0);
+}
+
+} // namespace anonymous
+
+BOOST_AUTO_TEST_SUITE(CHECK_PROPER_DROP_TEST)
+
+BOOST_AUTO_TEST_CASE(T1200_aligned_threads)
+{
+    for (unsigned count : {0, 1, 16, 128}) {
+        ThreadsFixture threads(count);
+        BOOST_REQUIRE_MESSAGE(verdict<CheckProperDrop>(), "Threads: " << count);
+#ifdef CHECK_PROPER_DROP_WITH_PROCPS
+        BOOST_REQUIRE_MESSAGE(verdict<CheckProperDropProcps>(), "Threads: " << count);
+#endif
+    }
+}
+
+BOOST_AUTO_TEST_CASE(T1210_misaligned_groups)
+{
+    if (geteuid() != 0) {
+        BOOST_TEST_MESSAGE("Changing thread groups requires root, skipping");
+        return;
+    }
+
+    ThreadsFixture threads(16, dropGroupsInThread);
+    BOOST_REQUIRE(!verdict<CheckProperDrop>());
+#ifdef CHECK_PROPER_DROP_WITH_PROCPS
+    BOOST_REQUIRE(!verdict<CheckProperDropProcps>());
+#endif
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,207 @@
+/*
+ *  Copyright (c) 2017 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License
+ */
+
+/**
+ * @file       test_cynara-admin-mirror.cpp
+ * @version    1.0
+ * @brief      Cynara administrative calls made with buckets mirrored in memory
+ */
+
+#include <boost/test/unit_test.hpp>
+
+#include <set>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include <cynara.h>
+#include <smack-labels.h>
+
+#include "cynara_fake.h"
+
+using namespace SecurityManager;
+
+namespace {
+
+/* bucket, client, user, privilege, result */
+typedef std::tuple<std::string, std::string, std::string, std::string, int> Op;
+typedef std::set<Op> Ops;
+
+const int ALLOW = CYNARA_ADMIN_ALLOW;
+const int DELETE = CYNARA_ADMIN_DELETE;
+const int BUCKET = CYNARA_ADMIN_BUCKET;
+
+const std::string USER = "5001";
+const std::string CAMERA = "http://tizen.org/privilege/camera";
+const std::string LOCATION = "http://tizen.org/privilege/location";
+const std::string INTERNET = "http://tizen.org/privilege/internet";
+const std::string OWN = "http://org.tizen.pkg/privilege/own";
+
+const std::string &bucket(Bucket b)
+{
+    return CynaraAdmin::Buckets.at(b);
+}
+
+Ops takeOps()
+{
+    Ops ops;
+    for (const auto &p : CynaraFake::takeSetPolicies())
+        ops.emplace(p.bucket, p.client, p.user, p.privilege, p.result);
+    return ops;
+}
+
+/* Mirrored content of bucket must be the same as the one in Cynara */
+void checkMirror(CynaraAdmin &admin, Bucket b)
+{
+    std::vector<CynaraAdminPolicy> mirrored;
+    admin.listPolicies(bucket(b), CYNARA_ADMIN_ANY, CYNARA_ADMIN_ANY, CYNARA_ADMIN_ANY,
+                       mirrored);
+    std::set<std::tuple<std::string, std::string, std::string, int>> fromMirror, fromCynara;
+    for (const auto &p : mirrored)
+        fromMirror.emplace(p.client, p.user, p.privilege, p.result);
+    for (const auto &p : CynaraFake::policies(bucket(b)))
+        fromCynara.emplace(p.client, p.user, p.privilege, p.result);
+    BOOST_REQUIRE(fromMirror == fromCynara);
+}
+
+struct MirrorFixture {
+    MirrorFixture()
+    {
+        CynaraFake::reset();
+        CynaraFake::setPrivilegeType(LOCATION, PRIVILEGE_MANAGER_PRIVILEGE_TYPE_PRIVACY);
+        label = SmackLabels::generateProcessLabel("org.tizen.app", "org.tizen.pkg", false);
+    }
+
+    std::string label;
+};
+
+} // namespace anonymous
+
+BOOST_FIXTURE_TEST_SUITE(CYNARA_ADMIN_MIRROR_TEST, MirrorFixture)
+
+BOOST_AUTO_TEST_CASE(T2500_install_update_uninstall)
+{
+    CynaraAdmin admin;
+    admin.syncMirror();
+    unsigned lists = CynaraFake::calls().list;
+
+    // install: only buckets that are not mirrored are listed
+    admin.updateAppPolicy(label, false, 5001, {CAMERA, LOCATION}, {},
+                          {AppDefinedPrivilege(OWN, SM_APP_DEFINED_PRIVILEGE_TYPE_UNTRUSTED, "")});
+    BOOST_REQUIRE(CynaraFake::calls().list == lists + 2);
+    BOOST_REQUIRE(takeOps() == Ops({
+        Op(bucket(Bucket::MANIFESTS_GLOBAL), label, USER, "*", BUCKET),
+        Op(bucket(Bucket::MANIFESTS_LOCAL), label, USER, CAMERA, ALLOW),
+        Op(bucket(Bucket::MANIFESTS_LOCAL), label, USER, LOCATION, ALLOW),
+        Op(bucket(Bucket::PRIVACY_MANAGER), label, USER, LOCATION, CynaraFake::ASK_USER),
+        Op(bucket(Bucket::APPDEFINED), "*", USER, OWN, ALLOW),
+    }));
+    checkMirror(admin, Bucket::MANIFESTS_GLOBAL);
+    checkMirror(admin, Bucket::MANIFESTS_LOCAL);
+    checkMirror(admin, Bucket::APPDEFINED);
+
+    // update: removed privileges are deleted, kept ones set again, new ones added
+    lists = CynaraFake::calls().list;
+    admin.updateAppPolicy(label, false, 5001, {CAMERA, INTERNET},
+                          {AppDefinedPrivilege(OWN, SM_APP_DEFINED_PRIVILEGE_TYPE_UNTRUSTED, "")},
+                          {AppDefinedPrivilege(OWN, SM_APP_DEFINED_PRIVILEGE_TYPE_UNTRUSTED, "")});
+    BOOST_REQUIRE(CynaraFake::calls().list == lists + 2);
+    BOOST_REQUIRE(takeOps() == Ops({
+        Op(bucket(Bucket::MANIFESTS_GLOBAL), label, USER, "*", BUCKET),
+        Op(bucket(Bucket::MANIFESTS_LOCAL), label, USER, CAMERA, ALLOW),
+        Op(bucket(Bucket::MANIFESTS_LOCAL), label, USER, LOCATION, DELETE),
+        Op(bucket(Bucket::MANIFESTS_LOCAL), label, USER, INTERNET, ALLOW),
+        Op(bucket(Bucket::PRIVACY_MANAGER), label, USER, LOCATION, DELETE),
+        Op(bucket(Bucket::APPDEFINED), "*", USER, OWN, ALLOW),
+    }));
+    checkMirror(admin, Bucket::MANIFESTS_LOCAL);
+
+    std::vector<std::string> privileges;
+    admin.getAppPolicy(label, USER, privileges);
+    BOOST_REQUIRE(std::set<std::string>(privileges.begin(), privileges.end()) ==
+                  std::set<std::string>({CAMERA, INTERNET}));
+
+    // uninstall
+    lists = CynaraFake::calls().list;
+    admin.updateAppPolicy(label, false, 5001, {},
+                          {AppDefinedPrivilege(OWN, SM_APP_DEFINED_PRIVILEGE_TYPE_UNTRUSTED, "")},
+                          {}, true);
+    BOOST_REQUIRE(CynaraFake::calls().list == lists + 2);
+    BOOST_REQUIRE(takeOps() == Ops({
+        Op(bucket(Bucket::MANIFESTS_GLOBAL), label, USER, "*", DELETE),
+        Op(bucket(Bucket::MANIFESTS_LOCAL), label, USER, CAMERA, DELETE),
+        Op(bucket(Bucket::MANIFESTS_LOCAL), label, USER, INTERNET, DELETE),
+        Op(bucket(Bucket::APPDEFINED), "*", USER, OWN, DELETE),
+    }));
+    checkMirror(admin, Bucket::MANIFESTS_GLOBAL);
+    checkMirror(admin, Bucket::MANIFESTS_LOCAL);
+    checkMirror(admin, Bucket::APPDEFINED);
+    BOOST_REQUIRE(CynaraFake::policies(bucket(Bucket::MANIFESTS_LOCAL)).empty());
+}
+
+BOOST_AUTO_TEST_CASE(T2510_user_links)
+{
+    CynaraAdmin admin;
+    admin.syncMirror();
+
+    admin.userInit(5001, SM_USER_TYPE_NORMAL);
+    admin.userInit(5002, SM_USER_TYPE_ADMIN);
+    Ops ops = takeOps();
+    BOOST_REQUIRE(ops.count(Op(bucket(Bucket::MAIN), "*", USER, "*", BUCKET)));
+    BOOST_REQUIRE(ops.count(Op(bucket(Bucket::MAIN), "*", "5002", "*", BUCKET)));
+
+    // rules of MAIN other than user links are not mirrored
+    CynaraFake::setPolicy({bucket(Bucket::MAIN), "User", "*", CAMERA, ALLOW, ""});
+
+    unsigned lists = CynaraFake::calls().list;
+    BOOST_REQUIRE(admin.getUserType(5001) == SM_USER_TYPE_NORMAL);
+    BOOST_REQUIRE(admin.getUserType(5002) == SM_USER_TYPE_ADMIN);
+    BOOST_REQUIRE(admin.getUserType(5003) == SM_USER_TYPE_NONE);
+    std::vector<uid_t> users;
+    admin.listUsers(users);
+    BOOST_REQUIRE(std::set<uid_t>(users.begin(), users.end()) == std::set<uid_t>({5001, 5002}));
+    BOOST_REQUIRE(CynaraFake::calls().list == lists);
+
+    std::vector<CynaraAdminPolicy> policies;
+    admin.listPolicies(bucket(Bucket::MAIN), "User", CYNARA_ADMIN_ANY, CYNARA_ADMIN_ANY, policies);
+    BOOST_REQUIRE(CynaraFake::calls().list == lists + 1);
+    BOOST_REQUIRE(policies.size() == 1);
+    BOOST_REQUIRE(policies[0].privilege == CAMERA);
+
+    // recursive erase may reach mirrored buckets, they are fetched again
+    admin.userRemove(5002);
+    lists = CynaraFake::calls().list;
+    BOOST_REQUIRE(admin.getUserType(5001) == SM_USER_TYPE_NORMAL);
+    BOOST_REQUIRE(CynaraFake::calls().list == lists + 1);
+}
+
+BOOST_AUTO_TEST_CASE(T2520_changed_bypassing_mirror)
+{
+    CynaraAdmin admin;
+    admin.syncMirror();
+
+    CynaraFake::setPolicy({bucket(Bucket::MANIFESTS_GLOBAL), label, "*", CAMERA, ALLOW, ""});
+    std::vector<std::string> privileges;
+    admin.getAppPolicy(label, "*", privileges);
+    BOOST_REQUIRE(privileges.empty());
+
+    admin.syncMirror();
+    admin.getAppPolicy(label, "*", privileges);
+    BOOST_REQUIRE(privileges == std::vector<std::string>({CAMERA}));
+    checkMirror(admin, Bucket::MANIFESTS_GLOBAL);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,194 @@
+/*
+ *  Copyright (c) 2017 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License
+ */
+
+/**
+ * @file       test_cynara-decision-cache.cpp
+ * @version    1.0
+ * @brief      Cynara decisions cached by security-manager
+ */
+
+#include <boost/test/unit_test.hpp>
+
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include <cynara.h>
+#include <decision-cache.h>
+
+#include "cynara_fake.h"
+
+using namespace SecurityManager;
+
+namespace {
+
+const std::string LABEL = "User::Pkg::org.tizen.pkg";
+const std::string USER = "5001";
+const std::string CAMERA = "http://tizen.org/privilege/camera";
+const std::string LOCATION = "http://tizen.org/privilege/location";
+const std::string INTERNET = "http://tizen.org/privilege/internet";
+
+const std::string &defaultBucket()
+{
+    return CynaraAdmin::Buckets.at(Bucket::PRIVACY_MANAGER);
+}
+
+/* Wait for Cynara thread to get disconnected after policy change */
+bool waitForGeneration(Cynara &cynara, unsigned generation)
+{
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (cynara.getCacheGeneration() == generation) {
+        if (std::chrono::steady_clock::now() > deadline)
+            return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+struct FakeReset {
+    FakeReset()
+    {
+        CynaraFake::reset();
+    }
+};
+
+struct CynaraFixture : FakeReset {
+    CynaraFixture()
+      : cynara([this](const std::string &label, const std::string &user,
+                      const std::string &privilege) {
+            int result;
+            std::string resultExtra;
+            admin.check(label, user, privilege, defaultBucket(), result, resultExtra, true);
+            return result;
+        })
+    {
+        CynaraFake::setPolicy({defaultBucket(), LABEL, USER, CAMERA, CYNARA_ADMIN_ALLOW, ""});
+        CynaraFake::setPolicy({defaultBucket(), LABEL, USER, LOCATION, CynaraFake::ASK_USER, ""});
+    }
+
+    CynaraAdmin admin;
+    Cynara cynara;
+};
+
+} // namespace anonymous
+
+BOOST_FIXTURE_TEST_SUITE(CYNARA_DECISION_CACHE_TEST, CynaraFixture)
+
+BOOST_AUTO_TEST_CASE(T2600_plain_results_cached)
+{
+    BOOST_REQUIRE(cynara.check(LABEL, CAMERA, USER, "1"));
+    BOOST_REQUIRE(!cynara.check(LABEL, INTERNET, USER, "1"));
+    unsigned requests = CynaraFake::calls().request;
+    unsigned checks = CynaraFake::calls().check;
+
+    BOOST_REQUIRE(cynara.check(LABEL, CAMERA, USER, "1"));
+    BOOST_REQUIRE(!cynara.check(LABEL, INTERNET, USER, "1"));
+    auto statistics = cynara.getCacheStatistics();
+    BOOST_REQUIRE(statistics.hits == 2);
+    BOOST_REQUIRE(statistics.misses == 2);
+    BOOST_REQUIRE(statistics.entries == 2);
+
+    // type of policy is known, only decision is missing in another session
+    BOOST_REQUIRE(cynara.check(LABEL, CAMERA, USER, "2"));
+    BOOST_REQUIRE(CynaraFake::calls().request == requests + 1);
+    BOOST_REQUIRE(CynaraFake::calls().check == checks);
+    BOOST_REQUIRE(cynara.getCacheStatistics().entries == 3);
+}
+
+BOOST_AUTO_TEST_CASE(T2610_plugin_answers_per_session)
+{
+    CynaraFake::setAskUserAnswer("1", true);
+    unsigned requests = CynaraFake::calls().request;
+
+    for (int i = 0; i < 2; ++i) {
+        BOOST_REQUIRE(cynara.check(LABEL, LOCATION, USER, "1"));
+        BOOST_REQUIRE(!cynara.check(LABEL, LOCATION, USER, "2"));
+    }
+
+    // every answer of plugin is left to Cynara
+    BOOST_REQUIRE(CynaraFake::calls().request == requests + 4);
+    auto statistics = cynara.getCacheStatistics();
+    BOOST_REQUIRE(statistics.hits == 0);
+    BOOST_REQUIRE(statistics.entries == 0);
+}
+
+BOOST_AUTO_TEST_CASE(T2620_dropped_on_policy_change)
+{
+    BOOST_REQUIRE(cynara.check(LABEL, CAMERA, USER, "1"));
+    BOOST_REQUIRE(cynara.check(LABEL, CAMERA, USER, "1"));
+    BOOST_REQUIRE(cynara.getCacheStatistics().hits == 1);
+
+    // policy changed with cyad, not by security-manager
+    unsigned generation = cynara.getCacheGeneration();
+    unsigned clears = cynara.getCacheStatistics().clears;
+    CynaraFake::setPolicy({defaultBucket(), LABEL, USER, CAMERA, CYNARA_ADMIN_DENY, ""});
+    BOOST_REQUIRE(waitForGeneration(cynara, generation));
+
+    auto statistics = cynara.getCacheStatistics();
+    BOOST_REQUIRE(statistics.entries == 0);
+    BOOST_REQUIRE(statistics.clears == clears + 1);
+    BOOST_REQUIRE(!cynara.check(LABEL, CAMERA, USER, "1"));
+    BOOST_REQUIRE(!cynara.check(LABEL, CAMERA, USER, "1"));
+    BOOST_REQUIRE(cynara.getCacheStatistics().hits == 2);
+}
+
+BOOST_AUTO_TEST_CASE(T2630_time_to_live)
+{
+    DecisionCache cache(10, std::chrono::milliseconds(50));
+    DecisionCache::PolicyKey key(LABEL, USER, CAMERA);
+    bool allowed;
+
+    cache.put(key, "1", true, cache.generation());
+    cache.putType(key, CYNARA_ADMIN_ALLOW, cache.generation());
+    BOOST_REQUIRE(cache.get(key, "1", allowed) && allowed);
+    BOOST_REQUIRE(!cache.get(key, "2", allowed));
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    int type;
+    BOOST_REQUIRE(!cache.get(key, "1", allowed));
+    BOOST_REQUIRE(!cache.getType(key, type));
+
+    // answer asked for before drop is stale
+    unsigned generation = cache.generation();
+    cache.clear();
+    cache.put(key, "1", true, generation);
+    BOOST_REQUIRE(!cache.get(key, "1", allowed));
+
+    auto statistics = cache.statistics();
+    BOOST_REQUIRE(statistics.hits == 1);
+    BOOST_REQUIRE(statistics.misses == 3);
+    BOOST_REQUIRE(statistics.clears == 1);
+}
+
+BOOST_AUTO_TEST_CASE(T2640_least_recently_used_dropped)
+{
+    DecisionCache cache(2, std::chrono::seconds(60));
+    DecisionCache::PolicyKey camera(LABEL, USER, CAMERA), location(LABEL, USER, LOCATION),
+                             internet(LABEL, USER, INTERNET);
+    bool allowed;
+
+    cache.put(camera, "1", true, cache.generation());
+    cache.put(location, "1", true, cache.generation());
+    BOOST_REQUIRE(cache.get(camera, "1", allowed));
+    cache.put(internet, "1", false, cache.generation());
+
+    BOOST_REQUIRE(cache.get(camera, "1", allowed) && allowed);
+    BOOST_REQUIRE(cache.get(internet, "1", allowed) && !allowed);
+    BOOST_REQUIRE(!cache.get(location, "1", allowed));
+    BOOST_REQUIRE(cache.statistics().entries == 2);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,265 @@
+/*
+ *  Copyright (c) 2017 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License
+ */
+
+/**
+ * @file       test_flat-serialization.cpp
+ * @version    1.0
+ * @brief      Flat encoding of requests, compared with field by field one
+ */
+
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include <message-buffer.h>
+#include <protocols.h>
+
+using namespace SecurityManager;
+
+namespace {
+
+app_inst_req installRequest(int privileges, int paths)
+{
+    app_inst_req req;
+    req.appName = "org.tizen.app";
+    req.pkgName = "org.tizen.pkg";
+    for (int i = 0; i < privileges; ++i)
+        req.privileges.emplace_back("http://tizen.org/privilege/p" + std::to_string(i),
+                                    i % 2 ? "" : "Public");
+    req.appDefinedPrivileges.emplace_back("http://org.tizen.pkg/privilege/own", 1, "/license");
+    req.appDefinedPrivileges.emplace_back("http://org.tizen.pkg/privilege/other", 0, "");
+    for (int i = 0; i < paths; ++i)
+        req.pkgPaths.emplace_back("/opt/usr/apps/org.tizen.pkg/data/" + std::to_string(i), i % 4);
+    req.uid = 5001;
+    req.tizenVersion = "4.0";
+    req.authorName = "";
+    req.installationType = SM_APP_INSTALL_LOCAL;
+    req.isHybrid = true;
+    return req;
+}
+
+/* Request encoded by client before flat encoding was there */
+RawBuffer installFields(const app_inst_req &req, bool withHybrid)
+{
+    MessageBuffer buffer;
+    Serialization::Serialize(buffer,
+                             req.appName,
+                             req.pkgName,
+                             req.privileges,
+                             req.appDefinedPrivileges,
+                             req.pkgPaths,
+                             req.uid,
+                             req.tizenVersion,
+                             req.authorName,
+                             req.installationType);
+    if (withHybrid)
+        Serialization::Serialize(buffer, req.isHybrid);
+    return buffer.Pop();
+}
+
+RawBuffer flat(RawBuffer &&encoded)
+{
+    MessageBuffer buffer;
+    buffer.Push(std::move(encoded));
+    return buffer.Pop();
+}
+
+void checkEqual(const app_inst_req &a, const app_inst_req &b)
+{
+    BOOST_REQUIRE(a.appName == b.appName);
+    BOOST_REQUIRE(a.pkgName == b.pkgName);
+    BOOST_REQUIRE(a.privileges == b.privileges);
+    BOOST_REQUIRE(a.appDefinedPrivileges == b.appDefinedPrivileges);
+    BOOST_REQUIRE(a.pkgPaths == b.pkgPaths);
+    BOOST_REQUIRE(a.uid == b.uid);
+    BOOST_REQUIRE(a.tizenVersion == b.tizenVersion);
+    BOOST_REQUIRE(a.authorName == b.authorName);
+    BOOST_REQUIRE(a.installationType == b.installationType);
+    BOOST_REQUIRE(a.isHybrid == b.isHybrid);
+}
+
+std::vector<policy_entry> policyEntries(int count)
+{
+    std::vector<policy_entry> entries(count);
+    for (int i = 0; i < count; ++i) {
+        entries[i].user = std::to_string(5000 + i);
+        entries[i].appName = "app" + std::to_string(i);
+        entries[i].privilege = "http://tizen.org/privilege/camera";
+        entries[i].currentLevel = i % 2 ? "Allow" : "";
+        entries[i].maxLevel = "Deny";
+    }
+    return entries;
+}
+
+/* Time of f(), in microseconds per call */
+template <typename F>
+double timeOf(int rounds, F f)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; ++i)
+        f();
+    return std::chrono::duration<double, std::micro>(
+        std::chrono::steady_clock::now() - start).count() / rounds;
+}
+
+} // namespace anonymous
+
+BOOST_AUTO_TEST_SUITE(FLAT_SERIALIZATION_TEST)
+
+BOOST_AUTO_TEST_CASE(T2400_byte_identical)
+{
+    app_inst_req empty;
+    empty.uid = 0;
+    for (const auto &req : {installRequest(10, 5), installRequest(0, 0), empty}) {
+        BOOST_REQUIRE(flat(FlatSerialization::Encode(req)) == installFields(req, true));
+        BOOST_REQUIRE(flat(FlatSerialization::EncodeAs<AppUninstallLayout>(req)) ==
+                      installFields(req, false));
+    }
+
+    path_req paths;
+    paths.pkgName = "org.tizen.pkg";
+    paths.uid = 5001;
+    paths.pkgPaths = installRequest(0, 7).pkgPaths;
+    paths.installationType = SM_APP_INSTALL_GLOBAL;
+    MessageBuffer pathFields;
+    Serialization::Serialize(pathFields, paths.pkgName, paths.uid, paths.pkgPaths,
+                             paths.installationType);
+    BOOST_REQUIRE(flat(FlatSerialization::Encode(paths)) == pathFields.Pop());
+
+    auto entries = policyEntries(20);
+    policy_update_req update;
+    for (const auto &entry : entries)
+        update.units.push_back(&entry);
+    MessageBuffer policyFields;
+    Serialization::Serialize(policyFields, update.units);
+    BOOST_REQUIRE(flat(FlatSerialization::Encode(update.units)) == policyFields.Pop());
+}
+
+BOOST_AUTO_TEST_CASE(T2410_decode_field_by_field_encoding)
+{
+    app_inst_req sent = installRequest(10, 5);
+
+    // request as sent by client, followed by something else
+    MessageBuffer message;
+    Serialization::Serialize(message, static_cast<int>(SecurityModuleCall::APP_INSTALL));
+    message.Push(FlatSerialization::Encode(sent));
+    Serialization::Serialize(message, 42);
+
+    MessageBuffer buffer;
+    buffer.Push(message.Pop());
+    BOOST_REQUIRE(buffer.Ready());
+    int call, next;
+    app_inst_req received;
+    Deserialization::Deserialize(buffer, call);
+    buffer.ReadFlat(received);
+    Deserialization::Deserialize(buffer, next);
+    BOOST_REQUIRE(call == static_cast<int>(SecurityModuleCall::APP_INSTALL));
+    checkEqual(sent, received);
+    BOOST_REQUIRE(next == 42);
+
+    // policy entries read by old decoder
+    auto entries = policyEntries(5);
+    std::vector<const policy_entry *> units;
+    for (const auto &entry : entries)
+        units.push_back(&entry);
+    MessageBuffer policy;
+    policy.Push(flat(FlatSerialization::Encode(units)));
+    std::vector<policy_entry> decoded;
+    Deserialization::Deserialize(policy, decoded);
+    BOOST_REQUIRE(decoded.size() == entries.size());
+    for (size_t i = 0; i < entries.size(); ++i) {
+        BOOST_REQUIRE(decoded[i].user == entries[i].user);
+        BOOST_REQUIRE(decoded[i].currentLevel == entries[i].currentLevel);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(T2415_decode_fragmented_message)
+{
+    app_inst_req sent = installRequest(10, 5);
+    RawBuffer data = installFields(sent, true);
+
+    // message received in pieces is flattened, in one piece decoded in place
+    for (size_t pieces : {1, 2, 7}) {
+        MessageBuffer buffer;
+        size_t step = data.size() / pieces + 1;
+        for (size_t pos = 0; pos < data.size(); pos += step)
+            buffer.Push(RawBuffer(data.begin() + pos,
+                                  data.begin() + std::min(pos + step, data.size())));
+        BOOST_REQUIRE(buffer.Ready());
+        app_inst_req received;
+        buffer.ReadFlat(received);
+        checkEqual(sent, received);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(T2420_broken_data)
+{
+    RawBuffer data = installFields(installRequest(3, 3), true);
+
+    for (size_t cut : {sizeof(size_t) + 2, data.size() / 2, data.size() - 1}) {
+        MessageBuffer buffer;
+        RawBuffer truncated(data.begin(), data.begin() + cut);
+        size_t length = cut - sizeof(size_t);
+        memcpy(&truncated[0], &length, sizeof(length));
+        buffer.Push(truncated);
+        app_inst_req req;
+        BOOST_REQUIRE_THROW(buffer.ReadFlat(req), MessageBuffer::Exception::OutOfData);
+    }
+
+    // negative length of appName
+    int negative = -5;
+    memcpy(&data[sizeof(size_t)], &negative, sizeof(negative));
+    MessageBuffer buffer;
+    buffer.Push(data);
+    app_inst_req req;
+    BOOST_REQUIRE_THROW(buffer.ReadFlat(req), MessageBuffer::Exception::OutOfData);
+}
+
+BOOST_AUTO_TEST_CASE(T2430_benchmark)
+{
+    const int ROUNDS = 2000;
+    app_inst_req req = installRequest(100, 20);
+
+    double fieldsEncode = timeOf(ROUNDS, [&] { installFields(req, true); });
+    double flatEncode = timeOf(ROUNDS, [&] { flat(FlatSerialization::Encode(req)); });
+
+    RawBuffer data = installFields(req, true);
+    double fieldsDecode = timeOf(ROUNDS, [&] {
+        MessageBuffer buffer;
+        buffer.Push(data);
+        app_inst_req out;
+        Deserialization::Deserialize(buffer, out.appName, out.pkgName, out.privileges,
+                                     out.appDefinedPrivileges, out.pkgPaths, out.uid,
+                                     out.tizenVersion, out.authorName,
+                                     out.installationType, out.isHybrid);
+    });
+    double flatDecode = timeOf(ROUNDS, [&] {
+        MessageBuffer buffer;
+        buffer.Push(data);
+        app_inst_req out;
+        buffer.ReadFlat(out);
+    });
+
+    BOOST_TEST_MESSAGE("install request, " << data.size() << " bytes, in us: encode field by field " <<
+                       fieldsEncode << ", flat " << flatEncode << "; decode field by field " <<
+                       fieldsDecode << ", flat " << flatDecode);
+    BOOST_REQUIRE(flatEncode < fieldsEncode);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
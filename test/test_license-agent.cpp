@@ -0,0 +1,509 @@
+/*
+ *  Copyright (c) 2017 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License
+ */
+
+/**
+ * @file       test_license-agent.cpp
+ * @version    1.0
+ * @brief      License manager agent fed with synthetic requests
+ */
+
+#include <boost/test/unit_test.hpp>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <openssl/evp.h>
+#include <openssl/ec.h>
+#include <openssl/pem.h>
+#include <openssl/x509.h>
+#include <openssl/x509v3.h>
+
+#include <agent.h>
+#include <agent_logic.h>
+#include <lm-config.h>
+#include <payload.h>
+
+using namespace LicenseManager;
+
+namespace {
+
+typedef std::unique_ptr<EVP_PKEY, decltype(EVP_PKEY_free)*> KeyPtr;
+typedef std::unique_ptr<X509, decltype(X509_free)*> CertPtr;
+
+KeyPtr generateKey()
+{
+    std::unique_ptr<EVP_PKEY_CTX, decltype(EVP_PKEY_CTX_free)*> ctx(
+        EVP_PKEY_CTX_new_id(EVP_PKEY_EC, nullptr), EVP_PKEY_CTX_free);
+    EVP_PKEY *key = nullptr;
+    BOOST_REQUIRE(ctx);
+    BOOST_REQUIRE(EVP_PKEY_keygen_init(ctx.get()) == 1);
+    BOOST_REQUIRE(EVP_PKEY_CTX_set_ec_paramgen_curve_nid(ctx.get(), NID_X9_62_prime256v1) == 1);
+    BOOST_REQUIRE(EVP_PKEY_keygen(ctx.get(), &key) == 1);
+    return KeyPtr(key, EVP_PKEY_free);
+}
+
+void addExtension(X509 *cert, X509 *issuer, int nid, const char *value)
+{
+    X509V3_CTX ctx;
+    X509V3_set_ctx_nodb(&ctx);
+    X509V3_set_ctx(&ctx, issuer, cert, nullptr, nullptr, 0);
+    X509_EXTENSION *ext = X509V3_EXT_conf_nid(nullptr, &ctx, nid, const_cast<char *>(value));
+    BOOST_REQUIRE(ext);
+    BOOST_REQUIRE(X509_add_ext(cert, ext, -1) == 1);
+    X509_EXTENSION_free(ext);
+}
+
+/* Certificate for package pkgId, self-signed if issuer is not given */
+CertPtr makeCertificate(const std::string &pkgId, EVP_PKEY *key,
+                        X509 *issuer = nullptr, EVP_PKEY *issuerKey = nullptr)
+{
+    static long serial = 1;
+    CertPtr cert(X509_new(), X509_free);
+    BOOST_REQUIRE(cert);
+    X509_set_version(cert.get(), 2);
+    ASN1_INTEGER_set(X509_get_serialNumber(cert.get()), serial++);
+    X509_gmtime_adj(X509_get_notBefore(cert.get()), -3600);
+    X509_gmtime_adj(X509_get_notAfter(cert.get()), 3600);
+    X509_set_pubkey(cert.get(), key);
+
+    X509_NAME *name = X509_get_subject_name(cert.get());
+    X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC,
+        reinterpret_cast<const unsigned char *>(pkgId.c_str()), -1, -1, 0);
+    X509_set_issuer_name(cert.get(), issuer ? X509_get_subject_name(issuer) : name);
+
+    X509 *signer = issuer ? issuer : cert.get();
+    addExtension(cert.get(), signer, NID_subject_key_identifier, "hash");
+    if (issuer) {
+        addExtension(cert.get(), signer, NID_authority_key_identifier, "keyid");
+        addExtension(cert.get(), signer, NID_basic_constraints, "CA:FALSE");
+    } else {
+        addExtension(cert.get(), signer, NID_basic_constraints, "critical,CA:TRUE");
+        addExtension(cert.get(), signer, NID_key_usage, "critical,keyCertSign,digitalSignature");
+    }
+
+    BOOST_REQUIRE(X509_sign(cert.get(), issuerKey ? issuerKey : key, EVP_sha256()) > 0);
+    return cert;
+}
+
+void writeCertificate(const std::string &path, X509 *cert)
+{
+    // Replaced, not overwritten, as by package manager
+    std::string tmpPath = path + ".tmp";
+    FILE *file = fopen(tmpPath.c_str(), "w");
+    BOOST_REQUIRE(file);
+    BOOST_REQUIRE(PEM_write_X509(file, cert) == 1);
+    fclose(file);
+    BOOST_REQUIRE(rename(tmpPath.c_str(), path.c_str()) == 0);
+}
+
+const std::string PROVIDER_PKG = "org.example.provider";
+const std::string CLIENT_PKG = "org.example.client";
+const std::string PRIVILEGE = "http://example.com/appdefined/privilege";
+
+struct LicenseFixture {
+    LicenseFixture()
+      : providerKey(generateKey())
+      , clientKey(generateKey())
+      , otherKey(generateKey())
+      , clientPkgId(CLIENT_PKG)
+      , licensed(true)
+      , sourceCalls(0)
+      , sourceDelayUs(0)
+    {
+        char tmpl[] = "/tmp/sm-license-XXXXXX";
+        BOOST_REQUIRE(mkdtemp(tmpl));
+        dir = tmpl;
+        providerPath = dir + "/provider.pem";
+        clientPath = dir + "/client.pem";
+
+        providerCert = makeCertificate(PROVIDER_PKG, providerKey.get()).release();
+        writeCertificate(providerPath, providerCert);
+        auto clientCert = makeCertificate(CLIENT_PKG, clientKey.get(), providerCert, providerKey.get());
+        writeCertificate(clientPath, clientCert.get());
+    }
+
+    ~LicenseFixture()
+    {
+        X509_free(providerCert);
+        unlink(providerPath.c_str());
+        unlink(clientPath.c_str());
+        rmdir(dir.c_str());
+    }
+
+    /* Stand-in for security-manager, answering with the generated licenses */
+    LicenseInfoSource source()
+    {
+        return [this](const std::string &smack, int, const std::string &privilege,
+                      LicenseInfo &info) {
+            ++sourceCalls;
+            if (sourceDelayUs)
+                std::this_thread::sleep_for(std::chrono::microseconds(sourceDelayUs));
+            if (smack.find("slow") != std::string::npos)
+                std::this_thread::sleep_for(std::chrono::milliseconds(200));
+            if (!licensed || privilege != PRIVILEGE || smack.compare(0, 5, "User:") != 0)
+                return false;
+            info.providerPkgId = PROVIDER_PKG;
+            info.providerAppId = PROVIDER_PKG + ".app";
+            info.providerLicensePath = providerPath;
+            info.clientPkgId = clientPkgId;
+            info.clientAppId = CLIENT_PKG + ".app";
+            info.clientLicensePath = clientPath;
+            return true;
+        };
+    }
+
+    static std::string request(const std::string &smack, int uid = 5001,
+                               const std::string &privilege = PRIVILEGE)
+    {
+        return smack + " " + std::to_string(uid) + " " + privilege;
+    }
+
+    /* Access granted by the agent response "<answer> <ttl>" */
+    static int answer(const std::string &response)
+    {
+        int value = -1;
+        std::stringstream(response) >> value;
+        return value;
+    }
+
+    static unsigned ttl(const std::string &response)
+    {
+        int value;
+        unsigned seconds = 0;
+        std::stringstream(response) >> value >> seconds;
+        return seconds;
+    }
+
+    KeyPtr providerKey, clientKey, otherKey;
+    X509 *providerCert;
+    std::string dir, providerPath, clientPath;
+    std::string clientPkgId;
+    bool licensed;
+    std::atomic<unsigned> sourceCalls;
+    unsigned sourceDelayUs;
+};
+
+/* Stand-in for cynara, passing requests to the agent in the same process.
+ * Like cynara-agent, it may be used only from one thread, except for
+ * cancelWaiting(), which interrupts one getRequest(). */
+class LocalTransport : public AgentTransport {
+public:
+    struct Response {
+        cynara_agent_msg_type type;
+        cynara_agent_req_id id;
+        std::string data;
+    };
+
+    LocalTransport() : m_interrupted(false) {}
+
+    void pushRequest(cynara_agent_msg_type type, cynara_agent_req_id id,
+                     const std::string &data = std::string())
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_requests.push_back(Response{type, id, data});
+        m_cv.notify_all();
+    }
+
+    std::vector<Response> waitForResponses(size_t count)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_cv.wait_for(lock, std::chrono::seconds(10), [&] { return m_responses.size() >= count; });
+        return m_responses;
+    }
+
+    /* Number of threads which called the agent side of the transport */
+    unsigned threads()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_threads.size();
+    }
+
+    bool getRequest(cynara_agent_msg_type &type, cynara_agent_req_id &id,
+                    std::string &data) override
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        checkThread();
+        m_cv.wait(lock, [&] { return m_interrupted || !m_requests.empty(); });
+        if (m_interrupted) {
+            m_interrupted = false;
+            return false;
+        }
+        type = m_requests.front().type;
+        id = m_requests.front().id;
+        data = std::move(m_requests.front().data);
+        m_requests.pop_front();
+        return true;
+    }
+
+    bool putResponse(cynara_agent_msg_type type, cynara_agent_req_id id,
+                     const std::string &data) override
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        checkThread();
+        m_responses.push_back(Response{type, id, data});
+        m_cv.notify_all();
+        return true;
+    }
+
+    void cancelWaiting() override
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_interrupted = true;
+        m_cv.notify_all();
+    }
+
+private:
+    void checkThread()
+    {
+        m_threads.insert(std::this_thread::get_id());
+    }
+
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::deque<Response> m_requests;
+    std::vector<Response> m_responses;
+    bool m_interrupted;
+    std::set<std::thread::id> m_threads;
+};
+
+/* Agent running its main loop in a separate thread */
+struct RunningAgent {
+    RunningAgent(AgentLogic *logic, size_t workers) : transport(new LocalTransport)
+    {
+        BOOST_REQUIRE(agent.initialize(logic, transport, workers));
+        thread = std::thread([this] { result = agent.mainLoop(); });
+    }
+
+    ~RunningAgent()
+    {
+        agent.exitLoop();
+        thread.join();
+        BOOST_CHECK_MESSAGE(transport->threads() == 1, "Transport used from many threads");
+    }
+
+    Agent agent;
+    LocalTransport *transport;
+    std::thread thread;
+    bool result;
+};
+
+} // namespace anonymous
+
+BOOST_FIXTURE_TEST_SUITE(LICENSE_AGENT_TEST, LicenseFixture)
+
+BOOST_AUTO_TEST_CASE(T1500_verify)
+{
+    AgentLogic logic(source());
+    BOOST_REQUIRE(answer(logic.process(request("User::Pkg::client"))) == 1);
+    BOOST_REQUIRE(answer(logic.process(request("User::Pkg::client", 5001, "unknown"))) == 0);
+    BOOST_REQUIRE(answer(logic.process(request("invalid"))) == 0);
+
+    // verdicts may be reused by the plugin, errors may not
+    BOOST_REQUIRE(ttl(logic.process(request("User::Pkg::client"))) == Config::AnswerTtl);
+    BOOST_REQUIRE(ttl(logic.process(request("invalid"))) == 0);
+
+    // binary requests are answered in binary
+    unsigned value, seconds;
+    BOOST_REQUIRE(Payload::decodeAnswer(logic.process(
+        Payload::encodeRequest("User::Pkg::client", "5001", PRIVILEGE)), value, seconds));
+    BOOST_REQUIRE(value == 1 && seconds == Config::AnswerTtl);
+    BOOST_REQUIRE(Payload::decodeAnswer(logic.process(
+        Payload::encodeRequest("User::Pkg::client", "user", PRIVILEGE)), value, seconds));
+    BOOST_REQUIRE(value == 0 && seconds == 0);
+
+    // client license not issued by the provider
+    auto other = makeCertificate(CLIENT_PKG, clientKey.get(), nullptr, nullptr);
+    writeCertificate(clientPath, other.get());
+    BOOST_REQUIRE(answer(logic.process(request("User::Pkg::client"))) == 0);
+
+    // license issued for another package
+    auto wrongCn = makeCertificate("org.example.other", clientKey.get(), providerCert, providerKey.get());
+    writeCertificate(clientPath, wrongCn.get());
+    BOOST_REQUIRE(answer(logic.process(request("User::Pkg::client"))) == 0);
+}
+
+BOOST_AUTO_TEST_CASE(T1510_verification_cache)
+{
+    // license information is looked up for every request
+    AgentLogic logic(source());
+    BOOST_REQUIRE(answer(logic.process(request("User::Pkg::client"))) == 1);
+    BOOST_REQUIRE(answer(logic.process(request("User::Pkg::client"))) == 1);
+    BOOST_REQUIRE(answer(logic.process(request("User::Pkg::client", 5002))) == 1);
+    BOOST_REQUIRE(sourceCalls == 3);
+
+    // application defined privilege removed from database, license files left
+    licensed = false;
+    BOOST_REQUIRE(answer(logic.process(request("User::Pkg::client"))) == 0);
+    licensed = true;
+    BOOST_REQUIRE(answer(logic.process(request("User::Pkg::client"))) == 1);
+
+    // cached verification of the same files doesn't hide change of the package
+    clientPkgId = "org.example.other";
+    BOOST_REQUIRE(answer(logic.process(request("User::Pkg::client"))) == 0);
+    clientPkgId = CLIENT_PKG;
+    BOOST_REQUIRE(answer(logic.process(request("User::Pkg::client"))) == 1);
+    BOOST_REQUIRE(sourceCalls == 7);
+}
+
+BOOST_AUTO_TEST_CASE(T1520_license_change)
+{
+    AgentLogic logic(source());
+    BOOST_REQUIRE(answer(logic.process(request("User::Pkg::client"))) == 1);
+
+    // client reinstalled with license from someone else
+    auto other = makeCertificate(CLIENT_PKG, clientKey.get(), nullptr, nullptr);
+    writeCertificate(clientPath, other.get());
+    BOOST_REQUIRE(answer(logic.process(request("User::Pkg::client"))) == 0);
+    BOOST_REQUIRE(sourceCalls == 2);
+
+    // provider reinstalled with new key, client license no longer valid
+    auto newKey = generateKey();
+    auto newProvider = makeCertificate(PROVIDER_PKG, newKey.get());
+    auto client = makeCertificate(CLIENT_PKG, clientKey.get(), providerCert, providerKey.get());
+    writeCertificate(clientPath, client.get());
+    BOOST_REQUIRE(answer(logic.process(request("User::Pkg::client"))) == 1);
+    writeCertificate(providerPath, newProvider.get());
+    BOOST_REQUIRE(answer(logic.process(request("User::Pkg::client"))) == 0);
+
+    // license removed
+    BOOST_REQUIRE(unlink(clientPath.c_str()) == 0);
+    BOOST_REQUIRE(answer(logic.process(request("User::Pkg::client"))) == 0);
+    BOOST_REQUIRE(sourceCalls == 5);
+}
+
+BOOST_AUTO_TEST_CASE(T1530_requests_per_second)
+{
+    /* Synthetic load of requests from CLIENT_COUNT different clients.
+     * Each request to security-manager for license information is
+     * simulated as sourceDelayUs. */
+    const unsigned CLIENT_COUNT = 20;
+    const unsigned REQUEST_COUNT = 2000;
+    sourceDelayUs = 50;
+
+    auto run = [&](const std::function<std::string(const std::string &)> &process) {
+        auto start = std::chrono::steady_clock::now();
+        for (unsigned i = 0; i < REQUEST_COUNT; ++i)
+            BOOST_REQUIRE(answer(process(request("User::Pkg::client" + std::to_string(i % CLIENT_COUNT)))) == 1);
+        auto end = std::chrono::steady_clock::now();
+        return REQUEST_COUNT / std::chrono::duration<double>(end - start).count();
+    };
+
+    // no state kept between requests, as before
+    double uncachedRps = run([&](const std::string &data) {
+        return AgentLogic(source()).process(data);
+    });
+
+    AgentLogic logic(source());
+    sourceCalls = 0;
+    double cachedRps = run([&](const std::string &data) {
+        return logic.process(data);
+    });
+    BOOST_REQUIRE(sourceCalls == REQUEST_COUNT);
+
+    BOOST_TEST_MESSAGE("license agent, " << CLIENT_COUNT << " clients: " << uncachedRps <<
+                       " requests/s without caches, " << cachedRps << " requests/s with caches");
+}
+
+BOOST_AUTO_TEST_CASE(T1540_slow_request_not_blocking)
+{
+    RunningAgent running(new AgentLogic(source()), 4);
+    auto &transport = *running.transport;
+
+    transport.pushRequest(CYNARA_MSG_TYPE_ACTION, 1, request("User::Pkg::slow"));
+    for (cynara_agent_req_id id = 2; id <= 5; ++id)
+        transport.pushRequest(CYNARA_MSG_TYPE_ACTION, id, request("User::Pkg::client"));
+
+    auto responses = transport.waitForResponses(5);
+    BOOST_REQUIRE(responses.size() == 5);
+    BOOST_REQUIRE(responses.back().id == 1);
+    for (const auto &response : responses) {
+        BOOST_REQUIRE(response.type == CYNARA_MSG_TYPE_ACTION);
+        BOOST_REQUIRE(answer(response.data) == 1);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(T1550_cancel)
+{
+    RunningAgent running(new AgentLogic(source()), 1);
+    auto &transport = *running.transport;
+
+    // second request waits in queue while the only worker is busy
+    transport.pushRequest(CYNARA_MSG_TYPE_ACTION, 1, request("User::Pkg::slow"));
+    transport.pushRequest(CYNARA_MSG_TYPE_ACTION, 2, request("User::Pkg::client"));
+    transport.pushRequest(CYNARA_MSG_TYPE_CANCEL, 2);
+    auto responses = transport.waitForResponses(1);
+    BOOST_REQUIRE(responses.size() == 1);
+    BOOST_REQUIRE(responses[0].id == 2);
+    BOOST_REQUIRE(responses[0].type == CYNARA_MSG_TYPE_CANCEL);
+
+    // request being processed is answered with cancel when done
+    transport.pushRequest(CYNARA_MSG_TYPE_CANCEL, 1);
+    responses = transport.waitForResponses(2);
+    BOOST_REQUIRE(responses.size() == 2);
+    BOOST_REQUIRE(responses[1].id == 1);
+    BOOST_REQUIRE(responses[1].type == CYNARA_MSG_TYPE_CANCEL);
+
+    // request already answered
+    transport.pushRequest(CYNARA_MSG_TYPE_CANCEL, 1);
+    transport.pushRequest(CYNARA_MSG_TYPE_ACTION, 3, request("User::Pkg::client"));
+    responses = transport.waitForResponses(3);
+    BOOST_REQUIRE(responses.size() == 3);
+    BOOST_REQUIRE(responses[2].id == 3);
+    BOOST_REQUIRE(responses[2].type == CYNARA_MSG_TYPE_ACTION);
+    BOOST_REQUIRE(transport.waitForResponses(3).size() == 3);
+}
+
+BOOST_AUTO_TEST_CASE(T1560_load)
+{
+    /* Requests from different users, each looking up license information */
+    const unsigned REQUEST_COUNT = 400;
+    sourceDelayUs = 50;
+
+    auto run = [&](size_t workers) {
+        RunningAgent running(new AgentLogic(source()), workers);
+        auto start = std::chrono::steady_clock::now();
+        for (unsigned i = 0; i < REQUEST_COUNT; ++i)
+            running.transport->pushRequest(CYNARA_MSG_TYPE_ACTION, i,
+                                           request("User::Pkg::client", 5000 + i));
+        auto responses = running.transport->waitForResponses(REQUEST_COUNT);
+        auto end = std::chrono::steady_clock::now();
+        BOOST_REQUIRE(responses.size() == REQUEST_COUNT);
+        for (const auto &response : responses)
+            BOOST_REQUIRE(answer(response.data) == 1);
+        return REQUEST_COUNT / std::chrono::duration<double>(end - start).count();
+    };
+
+    double singleRps = run(1);
+    double poolRps = run(4);
+    BOOST_TEST_MESSAGE("license agent, " << REQUEST_COUNT << " requests: " <<
+                       singleRps << " requests/s with 1 worker, " <<
+                       poolRps << " requests/s with 4 workers");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,208 @@
+/*
+ *  Copyright (c) 2017 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License
+ */
+
+/**
+ * @file       test_license-payload.cpp
+ * @version    1.0
+ * @brief      Encoding of license manager plugin and agent payloads
+ */
+
+#include <boost/test/unit_test.hpp>
+
+#include <chrono>
+#include <random>
+#include <sstream>
+#include <string>
+
+#include <payload.h>
+
+using namespace LicenseManager;
+
+namespace {
+
+const std::string CLIENT = "User::Pkg::org.example.client";
+const std::string USER = "5001";
+const std::string PRIVILEGE = "http://example.com/appdefined/privilege";
+
+std::string randomString(std::mt19937 &gen)
+{
+    // lengths crossing one and two byte varint boundaries
+    static const size_t lengths[] = {0, 1, 5, 127, 128, 300, 16384};
+    std::uniform_int_distribution<size_t> pickLength(0, sizeof(lengths) / sizeof(lengths[0]) - 1);
+    std::uniform_int_distribution<int> byte(0, 255);
+
+    std::string result(lengths[pickLength(gen)], '\0');
+    for (auto &c : result)
+        c = static_cast<char>(byte(gen));
+    return result;
+}
+
+bool viewInside(const Payload::StringView &view, const std::string &data)
+{
+    return view.data >= data.data() && view.data + view.size <= data.data() + data.size();
+}
+
+} // namespace anonymous
+
+BOOST_AUTO_TEST_SUITE(LICENSE_PAYLOAD_TEST)
+
+BOOST_AUTO_TEST_CASE(T1700_request_round_trip)
+{
+    std::mt19937 gen(1700);
+    for (int i = 0; i < 2000; ++i) {
+        std::string client = randomString(gen);
+        std::string user = randomString(gen);
+        std::string privilege = randomString(gen);
+
+        Cynara::PluginData data = Payload::encodeRequest(client, user, privilege);
+        BOOST_REQUIRE(Payload::isBinary(data));
+
+        Payload::RequestView request;
+        BOOST_REQUIRE(Payload::decodeRequest(data, request));
+        BOOST_REQUIRE(request.client == client);
+        BOOST_REQUIRE(request.user == user);
+        BOOST_REQUIRE(request.privilege == privilege);
+
+        // decoded strings point into the payload
+        BOOST_REQUIRE(viewInside(request.client, data));
+        BOOST_REQUIRE(viewInside(request.privilege, data));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(T1710_answer_round_trip)
+{
+    std::mt19937 gen(1710);
+    std::uniform_int_distribution<unsigned> number;
+    const unsigned edges[] = {0, 1, 127, 128, 16383, 16384, 0xffffffffu};
+
+    for (int i = 0; i < 10000; ++i) {
+        unsigned answer = (i < 7) ? edges[i] : number(gen);
+        unsigned ttl = (i < 7) ? edges[6 - i] : number(gen);
+        unsigned decodedAnswer, decodedTtl;
+
+        Cynara::PluginData data = Payload::encodeAnswer(answer, ttl);
+        BOOST_REQUIRE(Payload::decodeAnswer(data, decodedAnswer, decodedTtl));
+        BOOST_REQUIRE(decodedAnswer == answer);
+        BOOST_REQUIRE(decodedTtl == ttl);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(T1720_malformed)
+{
+    Cynara::PluginData request = Payload::encodeRequest(CLIENT, USER, PRIVILEGE);
+    Cynara::PluginData answer = Payload::encodeAnswer(1, 60);
+    Payload::RequestView view;
+    unsigned a, t;
+
+    // text payloads of older versions
+    BOOST_REQUIRE(!Payload::isBinary(CLIENT + " " + USER + " " + PRIVILEGE));
+    BOOST_REQUIRE(!Payload::isBinary("1 60"));
+    BOOST_REQUIRE(!Payload::isBinary(""));
+
+    // truncated or extended payloads
+    for (size_t i = 0; i < request.size(); ++i)
+        BOOST_REQUIRE(!Payload::decodeRequest(request.substr(0, i), view));
+    for (size_t i = 0; i < answer.size(); ++i)
+        BOOST_REQUIRE(!Payload::decodeAnswer(answer.substr(0, i), a, t));
+    BOOST_REQUIRE(!Payload::decodeRequest(request + '\0', view));
+    BOOST_REQUIRE(!Payload::decodeAnswer(answer + '\0', a, t));
+
+    // other versions and kinds of payload
+    Cynara::PluginData otherVersion = request;
+    otherVersion[0] = static_cast<char>(Payload::TAG_FLAG | (Payload::VERSION + 1));
+    BOOST_REQUIRE(Payload::isBinary(otherVersion));
+    BOOST_REQUIRE(!Payload::decodeRequest(otherVersion, view));
+    BOOST_REQUIRE(!Payload::decodeRequest(answer, view));
+
+    // numbers not fitting 32 bits
+    BOOST_REQUIRE(!Payload::decodeAnswer(std::string("\x81\xff\xff\xff\xff\x1f\x00", 7), a, t));
+    BOOST_REQUIRE(!Payload::decodeAnswer(std::string("\x81\x80\x80\x80\x80\x80\x00", 7), a, t));
+}
+
+BOOST_AUTO_TEST_CASE(T1730_fuzz)
+{
+    std::mt19937 gen(1730);
+    std::uniform_int_distribution<int> byte(0, 255);
+    Cynara::PluginData base = Payload::encodeRequest(CLIENT, USER, PRIVILEGE);
+
+    for (int i = 0; i < 20000; ++i) {
+        Cynara::PluginData data = base;
+        std::uniform_int_distribution<size_t> pos(0, data.size() - 1);
+        for (int j = 0; j < 1 + i % 4; ++j)
+            data[pos(gen)] = static_cast<char>(byte(gen));
+        data.resize(pos(gen) + 1 + i % 2 * data.size());
+
+        Payload::RequestView view;
+        if (Payload::decodeRequest(data, view)) {
+            BOOST_REQUIRE(viewInside(view.client, data));
+            BOOST_REQUIRE(viewInside(view.user, data));
+            BOOST_REQUIRE(viewInside(view.privilege, data));
+            BOOST_REQUIRE(Payload::encodeRequest(view.client.str(), view.user.str(),
+                                                 view.privilege.str()) == data);
+        }
+
+        unsigned a, t;
+        if (Payload::decodeAnswer(data, a, t))
+            BOOST_REQUIRE(Payload::encodeAnswer(a, t) == data);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(T1740_benchmark)
+{
+    const int ROUNDS = 100000;
+    size_t sink = 0;
+    bool decoded = true;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < ROUNDS; ++i) {
+        // plugin side
+        std::stringstream request;
+        request << CLIENT << " " << USER << " " << PRIVILEGE;
+        // agent side
+        std::stringstream in(request.str());
+        std::string smack, privilege;
+        int uid;
+        in >> smack >> uid >> privilege;
+        std::stringstream out;
+        out << 1 << " " << 60;
+        // plugin side
+        std::stringstream answerIn(out.str());
+        unsigned answer, ttl;
+        answerIn >> answer >> ttl;
+        sink += smack.size() + privilege.size() + uid + answer + ttl;
+    }
+    std::chrono::duration<double> text = std::chrono::steady_clock::now() - start;
+
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < ROUNDS; ++i) {
+        Cynara::PluginData request = Payload::encodeRequest(CLIENT, USER, PRIVILEGE);
+        Payload::RequestView view;
+        decoded &= Payload::decodeRequest(request, view);
+        Cynara::PluginData out = Payload::encodeAnswer(1, 60);
+        unsigned answer = 0, ttl = 0;
+        decoded &= Payload::decodeAnswer(out, answer, ttl);
+        sink += view.client.size + view.privilege.size + view.user.size + answer + ttl;
+    }
+    std::chrono::duration<double> binary = std::chrono::steady_clock::now() - start;
+
+    BOOST_REQUIRE(decoded);
+    BOOST_REQUIRE(sink > 0);
+    BOOST_TEST_MESSAGE("license payloads, request and answer round trip: " <<
+                       text.count() * 1e9 / ROUNDS << " ns with stringstream, " <<
+                       binary.count() * 1e9 / ROUNDS << " ns binary");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
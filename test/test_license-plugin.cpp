@@ -0,0 +1,180 @@
+/*
+ *  Copyright (c) 2017 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License
+ */
+
+/**
+ * @file       test_license-plugin.cpp
+ * @version    1.0
+ * @brief      License manager service plugin driven the way cynara drives it
+ */
+
+#include <boost/test/unit_test.hpp>
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include <cynara-plugin.h>
+
+#include <lm-config.h>
+#include <payload.h>
+
+using namespace Cynara;
+using namespace LicenseManager;
+
+extern "C" {
+ExternalPluginInterface *create(void);
+void destroy(ExternalPluginInterface *ptr);
+}
+
+namespace {
+
+const std::string CLIENT = "User::Pkg::client";
+const std::string USER = "5001";
+const std::string PRIVILEGE = "http://example.com/appdefined/privilege";
+
+struct PluginFixture {
+    PluginFixture()
+      : plugin(create(), destroy)
+      , service(dynamic_cast<ServicePluginInterface *>(plugin.get()))
+      , agentResponse(Payload::encodeAnswer(1, 60))
+      , agentCalls(0)
+    {
+        BOOST_REQUIRE(service);
+    }
+
+    /* Stand-in for the agent, answering with agentResponse */
+    PluginData agent(const AgentType &type, const PluginData &data,
+                     const std::string &client, const std::string &user,
+                     const std::string &privilege)
+    {
+        BOOST_REQUIRE(type == Config::AgentName);
+        Payload::RequestView request;
+        BOOST_REQUIRE(Payload::decodeRequest(data, request));
+        BOOST_REQUIRE(request.client == client);
+        BOOST_REQUIRE(request.user == user);
+        BOOST_REQUIRE(request.privilege == privilege);
+        ++agentCalls;
+        return agentResponse;
+    }
+
+    /* Same steps as cynara service takes to resolve plugin policy */
+    PolicyType check(const std::string &client = CLIENT,
+                     const std::string &user = USER,
+                     const std::string &privilege = PRIVILEGE)
+    {
+        PolicyResult result;
+        AgentType agentType;
+        PluginData pluginData;
+
+        PluginStatus status = service->check(client, user, privilege, result,
+                                             agentType, pluginData);
+        if (status == PluginStatus::ANSWER_READY)
+            return result.policyType();
+        BOOST_REQUIRE(status == PluginStatus::ANSWER_NOTREADY);
+
+        PluginData agentData = agent(agentType, pluginData, client, user, privilege);
+        BOOST_REQUIRE(service->update(client, user, privilege, agentData, result) ==
+                      PluginStatus::SUCCESS);
+        return result.policyType();
+    }
+
+    std::unique_ptr<ExternalPluginInterface, void(*)(ExternalPluginInterface *)> plugin;
+    ServicePluginInterface *service;
+    std::string agentResponse;
+    unsigned agentCalls;
+};
+
+} // namespace anonymous
+
+BOOST_FIXTURE_TEST_SUITE(LICENSE_PLUGIN_TEST, PluginFixture)
+
+BOOST_AUTO_TEST_CASE(T1600_answer_cached)
+{
+    BOOST_REQUIRE(check() == Config::LM_ALLOW);
+    BOOST_REQUIRE(check() == Config::LM_ALLOW);
+    BOOST_REQUIRE(agentCalls == 1);
+
+    // each (client, user, privilege) has its own verdict
+    agentResponse = Payload::encodeAnswer(0, 60);
+    BOOST_REQUIRE(check(CLIENT, "5002") == Config::LM_DENY);
+    BOOST_REQUIRE(check(CLIENT + "2") == Config::LM_DENY);
+    BOOST_REQUIRE(check(CLIENT, USER, PRIVILEGE + "2") == Config::LM_DENY);
+    BOOST_REQUIRE(agentCalls == 4);
+
+    BOOST_REQUIRE(check(CLIENT, "5002") == Config::LM_DENY);
+    BOOST_REQUIRE(check() == Config::LM_ALLOW);
+    BOOST_REQUIRE(agentCalls == 4);
+}
+
+BOOST_AUTO_TEST_CASE(T1610_answer_ttl)
+{
+    // text answers of older agents, without ttl and errors aren't cached
+    agentResponse = "1";
+    BOOST_REQUIRE(check() == Config::LM_ALLOW);
+    BOOST_REQUIRE(check() == Config::LM_ALLOW);
+    BOOST_REQUIRE(agentCalls == 2);
+
+    agentResponse = "0 0";
+    BOOST_REQUIRE(check() == Config::LM_DENY);
+    BOOST_REQUIRE(check() == Config::LM_DENY);
+    BOOST_REQUIRE(agentCalls == 4);
+
+    agentResponse = Payload::encodeAnswer(0, 0);
+    BOOST_REQUIRE(check() == Config::LM_DENY);
+    BOOST_REQUIRE(check() == Config::LM_DENY);
+    BOOST_REQUIRE(agentCalls == 6);
+
+    agentResponse = Payload::encodeAnswer(1, 1);
+    BOOST_REQUIRE(check() == Config::LM_ALLOW);
+    BOOST_REQUIRE(check() == Config::LM_ALLOW);
+    BOOST_REQUIRE(agentCalls == 7);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+    agentResponse = Payload::encodeAnswer(0, 1);
+    BOOST_REQUIRE(check() == Config::LM_DENY);
+    BOOST_REQUIRE(agentCalls == 8);
+}
+
+BOOST_AUTO_TEST_CASE(T1620_invalidate)
+{
+    BOOST_REQUIRE(check() == Config::LM_ALLOW);
+    BOOST_REQUIRE(check() == Config::LM_ALLOW);
+    BOOST_REQUIRE(agentCalls == 1);
+
+    // policy change, e.g. license package uninstalled
+    plugin->invalidate();
+    agentResponse = Payload::encodeAnswer(0, 60);
+    BOOST_REQUIRE(check() == Config::LM_DENY);
+    BOOST_REQUIRE(agentCalls == 2);
+}
+
+BOOST_AUTO_TEST_CASE(T1630_cache_bounded)
+{
+    for (size_t i = 0; i < Config::AnswerCacheSize; ++i)
+        BOOST_REQUIRE(check(CLIENT + std::to_string(i)) == Config::LM_ALLOW);
+    BOOST_REQUIRE(agentCalls == Config::AnswerCacheSize);
+
+    BOOST_REQUIRE(check(CLIENT + "0") == Config::LM_ALLOW);
+    BOOST_REQUIRE(agentCalls == Config::AnswerCacheSize);
+
+    // full cache makes room for new verdicts
+    BOOST_REQUIRE(check() == Config::LM_ALLOW);
+    BOOST_REQUIRE(check() == Config::LM_ALLOW);
+    BOOST_REQUIRE(agentCalls == Config::AnswerCacheSize + 1);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,242 @@
+/*
+ *  Copyright (c) 2017 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License
+ */
+
+/**
+ * @file       test_message-reader.cpp
+ * @version    1.0
+ * @brief      Receiving whole messages into buffers of their size
+ */
+
+#include <boost/test/unit_test.hpp>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include <message-buffer.h>
+#include <message-reader.h>
+
+using namespace SecurityManager;
+
+namespace {
+
+struct SocketPair {
+    SocketPair()
+    {
+        BOOST_REQUIRE(0 == socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+    }
+
+    ~SocketPair()
+    {
+        close(fds[0]);
+        close(fds[1]);
+    }
+
+    void send(const RawBuffer &data, size_t from, size_t to)
+    {
+        while (from < to) {
+            ssize_t size = ::send(fds[1], &data[from], to - from, MSG_NOSIGNAL);
+            BOOST_REQUIRE(size > 0);
+            from += size;
+        }
+    }
+
+    int fds[2];
+};
+
+RawBuffer message(const std::string &payload)
+{
+    MessageBuffer buffer;
+    Serialization::Serialize(buffer, payload);
+    return buffer.Pop();
+}
+
+std::string payload(RawBuffer &&message)
+{
+    MessageBuffer buffer;
+    buffer.Push(std::move(message));
+    BOOST_REQUIRE(buffer.Ready());
+    std::string result;
+    Deserialization::Deserialize(buffer, result);
+    return result;
+}
+
+/* Receive loop of sendToServer before messages were read by their size */
+void receiveInChunks(int sock, MessageBuffer &recv, unsigned &calls)
+{
+    char buffer[2048];
+    do {
+        ssize_t size = TEMP_FAILURE_RETRY(::recv(sock, buffer, sizeof(buffer), 0));
+        BOOST_REQUIRE(size > 0);
+        ++calls;
+        RawBuffer raw(buffer, buffer + size);
+        recv.Push(raw);
+    } while (!recv.Ready());
+}
+
+void receiveBySize(int sock, MessageBuffer &recv, unsigned &calls)
+{
+    MessageReader reader;
+    RawBuffer data;
+    do {
+        BOOST_REQUIRE(reader.Receive(sock) > 0);
+        ++calls;
+    } while (!reader.Pop(data));
+    recv.Push(std::move(data));
+}
+
+/* Time to receive and deserialize a reply of given size, in microseconds */
+template <typename Receive>
+double replyTime(size_t size, Receive receive, unsigned &calls)
+{
+    const int ROUNDS = 8;
+    RawBuffer reply = message(std::string(size, 'x'));
+
+    double total = 0;
+    calls = 0;
+    for (int i = 0; i < ROUNDS; ++i) {
+        SocketPair sockets;
+        std::thread server([&] { sockets.send(reply, 0, reply.size()); });
+
+        auto start = std::chrono::steady_clock::now();
+        MessageBuffer recv;
+        receive(sockets.fds[0], recv, calls);
+        std::string result;
+        Deserialization::Deserialize(recv, result);
+        total += std::chrono::duration<double, std::micro>(
+            std::chrono::steady_clock::now() - start).count();
+
+        server.join();
+        BOOST_REQUIRE(result.size() == size);
+    }
+    calls /= ROUNDS;
+    return total / ROUNDS;
+}
+
+} // namespace anonymous
+
+BOOST_AUTO_TEST_SUITE(MESSAGE_READER_TEST)
+
+BOOST_AUTO_TEST_CASE(T2300_split_and_joined_messages)
+{
+    SocketPair sockets;
+    MessageReader reader;
+    RawBuffer data;
+
+    // length comes in pieces
+    RawBuffer first = message("first message");
+    sockets.send(first, 0, 3);
+    BOOST_REQUIRE(reader.Receive(sockets.fds[0]) == 3);
+    BOOST_REQUIRE(!reader.Pop(data));
+    sockets.send(first, 3, first.size() - 1);
+    BOOST_REQUIRE(reader.Receive(sockets.fds[0]) > 0);
+    BOOST_REQUIRE(!reader.Pop(data));
+    sockets.send(first, first.size() - 1, first.size());
+    BOOST_REQUIRE(reader.Receive(sockets.fds[0]) == 1);
+    BOOST_REQUIRE(reader.Pop(data));
+    BOOST_REQUIRE(data == first);
+    BOOST_REQUIRE(reader.Size() == 0);
+
+    // several messages at once
+    RawBuffer second = message("second");
+    RawBuffer third = message(std::string(100, 't'));
+    RawBuffer joined = second;
+    joined.insert(joined.end(), third.begin(), third.end());
+    joined.insert(joined.end(), first.begin(), first.begin() + 5);
+    sockets.send(joined, 0, joined.size());
+    BOOST_REQUIRE(reader.Receive(sockets.fds[0]) == static_cast<ssize_t>(joined.size()));
+    BOOST_REQUIRE(reader.Pop(data));
+    BOOST_REQUIRE(payload(std::move(data)) == "second");
+    BOOST_REQUIRE(reader.Pop(data));
+    BOOST_REQUIRE(payload(std::move(data)) == std::string(100, 't'));
+    BOOST_REQUIRE(!reader.Pop(data));
+    BOOST_REQUIRE(reader.Size() == 5);
+
+    sockets.send(first, 5, first.size());
+    BOOST_REQUIRE(reader.Receive(sockets.fds[0]) > 0);
+    BOOST_REQUIRE(reader.Pop(data));
+    BOOST_REQUIRE(payload(std::move(data)) == "first message");
+
+    reader.Clear();
+    BOOST_REQUIRE(reader.Size() == 0);
+    close(sockets.fds[1]);
+    sockets.fds[1] = -1;
+    BOOST_REQUIRE(reader.Receive(sockets.fds[0]) == 0);
+}
+
+BOOST_AUTO_TEST_CASE(T2310_big_message_exact_buffer)
+{
+    const size_t SIZE = 1024 * 1024;
+    SocketPair sockets;
+    RawBuffer big = message(std::string(SIZE, 'b'));
+    std::thread server([&] { sockets.send(big, 0, big.size()); });
+
+    MessageReader reader;
+    RawBuffer data;
+    while (!reader.Pop(data))
+        BOOST_REQUIRE(reader.Receive(sockets.fds[0]) > 0);
+    server.join();
+
+    BOOST_REQUIRE(data.size() == big.size());
+    BOOST_REQUIRE(data.capacity() == big.size());
+    BOOST_REQUIRE(payload(std::move(data)) == std::string(SIZE, 'b'));
+}
+
+BOOST_AUTO_TEST_CASE(T2315_bogus_request_length)
+{
+    // a client announcing a huge request gets no buffer for data it didn't send
+    SocketPair sockets;
+    MessageReader reader(MessageReader::REQUEST_PREALLOC);
+    RawBuffer data;
+
+    size_t length = 16 * 1024 * 1024;
+    RawBuffer header(reinterpret_cast<unsigned char *>(&length),
+                     reinterpret_cast<unsigned char *>(&length) + sizeof(length));
+    sockets.send(header, 0, header.size());
+    BOOST_REQUIRE(reader.Receive(sockets.fds[0]) == static_cast<ssize_t>(header.size()));
+    BOOST_REQUIRE(!reader.Pop(data));
+    BOOST_REQUIRE(reader.Allocated() <= MessageReader::REQUEST_PREALLOC);
+
+    // a real big request still arrives whole, in a buffer grown with the data
+    reader.Clear();
+    RawBuffer big = message(std::string(1024 * 1024, 'r'));
+    std::thread client([&] { sockets.send(big, 0, big.size()); });
+    while (!reader.Pop(data)) {
+        BOOST_REQUIRE(reader.Receive(sockets.fds[0]) > 0);
+        BOOST_REQUIRE(reader.Allocated() <= 2 * reader.Size() + MessageReader::REQUEST_PREALLOC);
+    }
+    client.join();
+    BOOST_REQUIRE(payload(std::move(data)) == std::string(1024 * 1024, 'r'));
+}
+
+BOOST_AUTO_TEST_CASE(T2320_reply_benchmark)
+{
+    for (size_t size = 1024; size <= 4 * 1024 * 1024; size *= 4) {
+        unsigned chunkCalls, sizeCalls;
+        double chunks = replyTime(size, receiveInChunks, chunkCalls);
+        double bySize = replyTime(size, receiveBySize, sizeCalls);
+
+        BOOST_TEST_MESSAGE("reply of " << size / 1024 << " KB: 2 KB chunks " << chunks <<
+                           " us, " << chunkCalls << " recv calls; read by size " << bySize <<
+                           " us, " << sizeCalls << " recv calls");
+        BOOST_REQUIRE(sizeCalls <= chunkCalls);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
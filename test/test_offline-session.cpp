@@ -0,0 +1,112 @@
+/*
+ *  Copyright (c) 2017 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License
+ */
+
+/**
+ * @file       test_offline-session.cpp
+ * @version    1.0
+ * @brief      Image build with database and Cynara kept open across installs
+ */
+
+#include <boost/test/unit_test.hpp>
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <cynara.h>
+#include <privilege_db.h>
+#include <smack-labels.h>
+
+#include "cynara_fake.h"
+#include "privilege_db_fixture.h"
+
+namespace {
+
+const uid_t USER = 5001;
+const unsigned APPS = 200;
+
+const std::vector<std::string> PRIVILEGES = {
+    "http://tizen.org/privilege/camera",
+    "http://tizen.org/privilege/internet",
+    "http://tizen.org/privilege/location",
+};
+
+/* Database and Cynara part of appInstall(), committed per application */
+void install(PrivilegeDb &db, CynaraAdmin &admin, unsigned i)
+{
+    std::string appName = "bench.app" + std::to_string(i);
+    std::string pkgName = "bench.pkg" + std::to_string(i);
+    std::string label = SmackLabels::generateProcessLabel(appName, pkgName, false);
+
+    std::vector<std::pair<std::string, std::string>> clientPrivileges;
+    for (const auto &privilege : PRIVILEGES)
+        clientPrivileges.emplace_back(privilege, "");
+
+    db.BeginTransaction();
+    db.AddApplication(appName, pkgName, USER, "4.0", "", false);
+    AppDefinedPrivilegesVector oldAppDefinedPrivileges;
+    db.GetAppDefinedPrivileges(appName, USER, oldAppDefinedPrivileges);
+    admin.updateAppPolicy(label, false, USER, PRIVILEGES, oldAppDefinedPrivileges, {});
+    db.AddClientPrivileges(appName, USER, clientPrivileges);
+    std::vector<PkgInfo> pkgsInfo;
+    db.GetPackagesInfo(pkgsInfo);
+    db.CommitTransaction();
+}
+
+template <typename F>
+double elapsedMs(F &&f)
+{
+    auto start = std::chrono::steady_clock::now();
+    f();
+    return std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace anonymous
+
+BOOST_FIXTURE_TEST_SUITE(OFFLINE_SESSION_TEST, PrivilegeDBFixture)
+
+BOOST_AUTO_TEST_CASE(T2800_image_build_benchmark)
+{
+    CynaraFake::reset();
+
+    // off-line mode without a session opens the database and Cynara per request
+    double perRequestMs = elapsedMs([] {
+        for (unsigned i = 0; i < APPS; ++i) {
+            PrivilegeDb db(TEST_PRIVILEGE_DB_PATH);
+            CynaraAdmin admin;
+            install(db, admin, i);
+        }
+    });
+
+    // a session keeps them for all requests
+    double sessionMs = elapsedMs([&] {
+        CynaraAdmin admin;
+        for (unsigned i = APPS; i < 2 * APPS; ++i)
+            install(*getPrivDb(), admin, i);
+    });
+
+    for (unsigned i = 0; i < 2 * APPS; ++i)
+        BOOST_REQUIRE(getPrivDb()->AppNameExists("bench.app" + std::to_string(i)));
+
+    BOOST_TEST_MESSAGE("image build of " << APPS << " apps, database and Cynara part: " <<
+                       "per request " << perRequestMs << " ms, in session " << sessionMs <<
+                       " ms");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,282 @@
+/*
+ *  Copyright (c) 2017 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License
+ */
+
+/**
+ * @file       test_peer-admission.cpp
+ * @version    1.0
+ * @brief      Per-peer limits and fair queuing of requests
+ */
+
+#include <boost/test/unit_test.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fair-queue.h>
+#include <peer-admission.h>
+#include <service-thread.h>
+
+using namespace SecurityManager;
+
+namespace {
+
+typedef PeerAdmission::Clock Clock;
+
+const uid_t USER = 5001;
+const uid_t OTHER_USER = 5002;
+
+const PeerAdmission::Limits LIMITS = {
+    {10, 20},   // accepts of a process
+    {20, 40},   // reads of a process
+    {40, 80},   // accepts of a user
+    {80, 160},  // reads of a user
+};
+
+std::chrono::milliseconds ms(int count)
+{
+    return std::chrono::milliseconds(count);
+}
+
+struct RequestEvent : public GenericEvent {
+    pid_t pid;
+    unsigned weight;
+    int request;
+};
+
+/* Service queueing requests by client process, the way BaseService does */
+class FloodService : public ServiceThread<FloodService> {
+public:
+    FloodService() : m_received(0), m_served(0), m_blocked(true) {}
+
+    DECLARE_THREAD_EVENT(RequestEvent, request)
+
+    void request(const RequestEvent &event) {
+        m_queue.Push(event.pid, event.weight, event);
+        m_received.fetch_add(1, std::memory_order_release);
+    }
+
+    virtual bool ProcessPending() {
+        // nothing is served before all requests are queued
+        if (m_blocked.load())
+            return false;
+        RequestEvent event;
+        if (!m_queue.Pop(event))
+            return false;
+        m_order.push_back(event.pid);
+        m_served.fetch_add(1, std::memory_order_release);
+        return true;
+    }
+
+    static void waitFor(const std::atomic<unsigned> &counter, unsigned count) {
+        while (counter.load(std::memory_order_acquire) < count)
+            std::this_thread::yield();
+    }
+
+    FairQueue<pid_t, RequestEvent> m_queue;
+    std::vector<pid_t> m_order;
+    std::atomic<unsigned> m_received;
+    std::atomic<unsigned> m_served;
+    std::atomic<bool> m_blocked;
+};
+
+void post(FloodService &service, pid_t pid, unsigned weight, int request)
+{
+    RequestEvent event;
+    event.pid = pid;
+    event.weight = weight;
+    event.request = request;
+    service.Event(event);
+}
+
+} // namespace anonymous
+
+BOOST_AUTO_TEST_SUITE(PEER_ADMISSION_TEST)
+
+BOOST_AUTO_TEST_CASE(T2000_token_bucket)
+{
+    auto now = Clock::now();
+    TokenBucket bucket(10, 3, now);
+
+    BOOST_REQUIRE(bucket.Full(now));
+    BOOST_REQUIRE(bucket.Take(now));
+    BOOST_REQUIRE(bucket.Take(now));
+    BOOST_REQUIRE(bucket.Take(now));
+    BOOST_REQUIRE(!bucket.Take(now));
+    BOOST_REQUIRE(!bucket.Available(now));
+
+    // 10 tokens per second, next one in 100 ms
+    auto wait = bucket.Wait(now);
+    BOOST_REQUIRE(wait >= ms(100) && wait <= ms(101));
+    BOOST_REQUIRE(!bucket.Available(now + ms(99)));
+    BOOST_REQUIRE(bucket.Available(now + wait));
+    BOOST_REQUIRE(bucket.Wait(now + wait) == Clock::duration::zero());
+
+    BOOST_REQUIRE(bucket.Take(now + ms(250)));
+    BOOST_REQUIRE(bucket.Take(now + ms(250)));
+    BOOST_REQUIRE(!bucket.Take(now + ms(250)));
+
+    // never more than burst
+    BOOST_REQUIRE(!bucket.Full(now + ms(450)));
+    BOOST_REQUIRE(bucket.Full(now + ms(550)));
+    BOOST_REQUIRE(bucket.Full(now + std::chrono::hours(1)));
+    for (int i = 0; i < 3; ++i)
+        BOOST_REQUIRE(bucket.Take(now + std::chrono::hours(1)));
+    BOOST_REQUIRE(!bucket.Take(now + std::chrono::hours(1)));
+}
+
+BOOST_AUTO_TEST_CASE(T2010_process_and_user_limits)
+{
+    auto now = Clock::now();
+    PeerAdmission admission(LIMITS);
+
+    // burst of a process, then one connection per 100 ms
+    for (int i = 0; i < 20; ++i)
+        BOOST_REQUIRE(admission.Accept(USER, 100, now));
+    BOOST_REQUIRE(!admission.Accept(USER, 100, now));
+    BOOST_REQUIRE(admission.Accept(USER, 100, now + ms(100)));
+    BOOST_REQUIRE(!admission.Accept(USER, 100, now + ms(100)));
+
+    // other processes of the user still get in, until the user limit
+    int accepted = 0;
+    for (pid_t pid = 101; pid < 200; ++pid)
+        accepted += admission.Accept(USER, pid, now + ms(100));
+    BOOST_REQUIRE(accepted == 80 + 4 - 21);
+    BOOST_REQUIRE(admission.Accept(OTHER_USER, 300, now + ms(100)));
+
+    const size_t deferred = 2 + 99 - accepted;
+    BOOST_REQUIRE(admission.GetStats().deferred == deferred);
+    BOOST_REQUIRE(admission.GetStats().rejected == 0);
+    auto acceptWait = admission.AcceptWait(USER, 100, now + ms(100));
+    BOOST_REQUIRE(acceptWait > ms(99) && acceptWait <= ms(101));
+    BOOST_REQUIRE(admission.AcceptWait(OTHER_USER, 301, now + ms(100)) == Clock::duration::zero());
+
+    // reads are limited separately
+    for (int i = 0; i < 40; ++i)
+        BOOST_REQUIRE(admission.Read(USER, 100, now + ms(100)));
+    BOOST_REQUIRE(!admission.Read(USER, 100, now + ms(100)));
+    BOOST_REQUIRE(admission.GetStats().deferred == deferred + 1);
+    auto wait = admission.ReadWait(USER, 100, now + ms(100));
+    BOOST_REQUIRE(wait > ms(49) && wait <= ms(51));
+    BOOST_REQUIRE(admission.Read(USER, 100, now + ms(100) + wait));
+    BOOST_REQUIRE(admission.ReadWait(USER, 101, now + ms(100)) == Clock::duration::zero());
+}
+
+BOOST_AUTO_TEST_CASE(T2020_idle_peers_forgotten)
+{
+    auto now = Clock::now();
+    PeerAdmission admission(LIMITS);
+
+    for (pid_t pid = 1; pid <= 10000; ++pid)
+        BOOST_REQUIRE(admission.Accept(static_cast<uid_t>(pid), pid, now + pid * ms(10)));
+
+    // peers idle for a few seconds have full buckets and may be dropped
+    BOOST_REQUIRE(admission.PeerCount() < 2 * 2 * 256);
+}
+
+BOOST_AUTO_TEST_CASE(T2030_weighted_turns)
+{
+    FairQueue<int, int> queue;
+    BOOST_REQUIRE(queue.Empty());
+
+    for (int i = 0; i < 10; ++i) {
+        queue.Push(1, 1, 100 + i);
+        queue.Push(2, 3, 200 + i);
+    }
+    queue.Push(3, 1, 300);
+    BOOST_REQUIRE(queue.Size() == 21);
+    BOOST_REQUIRE(queue.Flows() == 3);
+
+    std::vector<int> order;
+    int item;
+    while (queue.Pop(item))
+        order.push_back(item);
+
+    const std::vector<int> expected = {
+        100, 200, 201, 202, 300, 101, 203, 204, 205, 102, 206, 207, 208,
+        103, 209, 104, 105, 106, 107, 108, 109,
+    };
+    BOOST_REQUIRE(order == expected);
+    BOOST_REQUIRE(queue.Empty() && queue.Flows() == 0);
+
+    // flow coming back starts at the end of the line
+    queue.Push(1, 1, 1);
+    queue.Push(1, 1, 2);
+    queue.Push(2, 1, 3);
+    BOOST_REQUIRE(queue.Pop(item) && item == 1);
+    queue.Push(3, 1, 4);
+    BOOST_REQUIRE(queue.Pop(item) && item == 3);
+    BOOST_REQUIRE(queue.Pop(item) && item == 2);
+    BOOST_REQUIRE(queue.Pop(item) && item == 4);
+    BOOST_REQUIRE(!queue.Pop(item));
+}
+
+BOOST_AUTO_TEST_CASE(T2040_flood)
+{
+    const int FLOOD = 5000;
+    const int REQUESTS = 10;
+    const pid_t FLOODER = 100;
+    const pid_t CLIENT = 200;
+    const pid_t INSTALLER = 300;
+
+    // a process in a loop is cut off by its limits
+    auto now = Clock::now();
+    PeerAdmission admission(LIMITS);
+    int admitted = 0;
+    for (int i = 0; i < FLOOD; ++i) {
+        auto when = now + std::chrono::microseconds(200 * i);
+        admitted += admission.Accept(USER, FLOODER, when) && admission.Read(USER, FLOODER, when);
+    }
+    auto end = now + std::chrono::microseconds(200 * FLOOD);
+    BOOST_REQUIRE(admitted <= 20 + 10 + 1);
+    BOOST_REQUIRE(admission.GetStats().deferred == static_cast<size_t>(FLOOD - admitted));
+    BOOST_REQUIRE(admission.Accept(USER, CLIENT, end));
+    BOOST_REQUIRE(admission.Read(USER, CLIENT, end));
+
+    // requests of the flooding process got in anyway, others queue behind them
+    FloodService service;
+    service.StartThread();
+    for (int i = 0; i < FLOOD; ++i)
+        post(service, FLOODER, 1, i);
+    for (int i = 0; i < REQUESTS; ++i) {
+        post(service, CLIENT, 1, i);
+        post(service, INSTALLER, 4, i);
+    }
+    post(service, FLOODER, 1, FLOOD);
+    FloodService::waitFor(service.m_received, FLOOD + 1 + 2 * REQUESTS);
+
+    service.m_blocked.store(false);
+    post(service, FLOODER, 1, FLOOD + 1); // wakes the service thread up
+    FloodService::waitFor(service.m_served, FLOOD + 2 + 2 * REQUESTS);
+    service.FinishThread();
+
+    std::map<pid_t, size_t> last;
+    for (size_t i = 0; i < service.m_order.size(); ++i)
+        last[service.m_order[i]] = i;
+
+    // in each round flooder and client get one request served, installer four
+    BOOST_TEST_MESSAGE("flood of " << FLOOD << " requests, last request served at: client " <<
+                       last[CLIENT] << ", installer " << last[INSTALLER] <<
+                       " (" << FLOOD + 2 + 2 * REQUESTS << " requests queued)");
+    BOOST_REQUIRE(last[CLIENT] < (1 + 1 + 4) * REQUESTS);
+    BOOST_REQUIRE(last[INSTALLER] < (1 + 1 + 4) * REQUESTS / 4 + 4);
+    BOOST_REQUIRE(last[FLOODER] == service.m_order.size() - 1);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,287 @@
+/*
+ *  Copyright (c) 2017 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License
+ */
+
+/**
+ * @file       test_permissible-set.cpp
+ * @version    1.0
+ */
+
+#include <boost/test/unit_test.hpp>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <permissible-set.h>
+
+using namespace SecurityManager;
+using namespace SecurityManager::PermissibleSet;
+
+namespace {
+
+struct TempFile {
+    explicit TempFile(const std::string &dir = "/tmp")
+    {
+        std::string tmpl = dir + "/sm-apps-labels-XXXXXX";
+        int fd = mkstemp(&tmpl[0]);
+        BOOST_REQUIRE(fd >= 0);
+        close(fd);
+        path = tmpl;
+    }
+
+    ~TempFile()
+    {
+        unlink(path.c_str());
+    }
+
+    std::vector<std::string> read() const
+    {
+        std::vector<std::string> labels;
+        readLabelsFromPermissibleFile(path, labels);
+        std::sort(labels.begin(), labels.end());
+        return labels;
+    }
+
+    off_t size() const
+    {
+        struct stat st;
+        BOOST_REQUIRE(stat(path.c_str(), &st) == 0);
+        return st.st_size;
+    }
+
+    void write(const std::string &content) const
+    {
+        std::ofstream file(path, std::ios::trunc);
+        file << content;
+    }
+
+    void append(const std::string &content) const
+    {
+        std::ofstream file(path, std::ios::app);
+        file << content;
+    }
+
+    std::string path;
+};
+
+std::string label(unsigned i)
+{
+    return "User::Pkg::pkg" + std::to_string(i);
+}
+
+typedef std::vector<std::string> Labels;
+
+} // namespace anonymous
+
+BOOST_AUTO_TEST_SUITE(PERMISSIBLE_SET_TEST)
+
+BOOST_AUTO_TEST_CASE(T1400_read_plain_list)
+{
+    TempFile file;
+    file.write("User::Pkg::a\nUser::Pkg::b\n");
+    BOOST_REQUIRE((file.read() == Labels{"User::Pkg::a", "User::Pkg::b"}));
+
+    file.write("");
+    BOOST_REQUIRE(file.read().empty());
+}
+
+BOOST_AUTO_TEST_CASE(T1410_append_and_remove)
+{
+    TempFile file;
+    file.write("User::Pkg::a\nUser::Pkg::b\n");
+
+    updatePermissibleFile(file.path, {"User::Pkg::c"}, {"User::Pkg::a"});
+    BOOST_REQUIRE((file.read() == Labels{"User::Pkg::b", "User::Pkg::c"}));
+
+    updatePermissibleFile(file.path, {"User::Pkg::a"}, {});
+    BOOST_REQUIRE((file.read() == Labels{"User::Pkg::a", "User::Pkg::b", "User::Pkg::c"}));
+
+    updatePermissibleFile(file.path, {}, {"User::Pkg::b", "User::Pkg::c", "User::Pkg::none"});
+    BOOST_REQUIRE((file.read() == Labels{"User::Pkg::a"}));
+
+    // no change, no write
+    off_t size = file.size();
+    updatePermissibleFile(file.path, {}, {});
+    BOOST_REQUIRE(file.size() == size);
+}
+
+BOOST_AUTO_TEST_CASE(T1420_incomplete_record)
+{
+    TempFile file;
+    file.write("User::Pkg::a\n-User::Pkg::a\nUser::Pkg::b\nUser::Pkg::");
+    BOOST_REQUIRE((file.read() == Labels{"User::Pkg::b"}));
+
+    updatePermissibleFile(file.path, {"User::Pkg::c"}, {});
+    BOOST_REQUIRE((file.read() == Labels{"User::Pkg::b", "User::Pkg::c"}));
+}
+
+BOOST_AUTO_TEST_CASE(T1430_compaction)
+{
+    TempFile file;
+    const unsigned LIVE_COUNT = 10;
+    const unsigned CYCLES = 1000;
+
+    for (unsigned i = 0; i < LIVE_COUNT; ++i)
+        updatePermissibleFile(file.path, {label(i)}, {});
+    off_t liveSize = file.size();
+
+    for (unsigned i = 0; i < CYCLES; ++i) {
+        updatePermissibleFile(file.path, {label(LIVE_COUNT)}, {});
+        updatePermissibleFile(file.path, {}, {label(LIVE_COUNT)});
+    }
+
+    Labels expected;
+    for (unsigned i = 0; i < LIVE_COUNT; ++i)
+        expected.push_back(label(i));
+    std::sort(expected.begin(), expected.end());
+    BOOST_REQUIRE(file.read() == expected);
+
+    // dead records are bounded by compaction
+    BOOST_REQUIRE(file.size() < liveSize + 200 * static_cast<off_t>(label(LIVE_COUNT).size() + 2));
+}
+
+BOOST_AUTO_TEST_CASE(T1440_install_many_apps)
+{
+    /* Each installation used to rewrite the whole file; now it appends
+     * one record. Gathering all labels from the database, which was also
+     * done on every installation before, is not included in the baseline */
+    const unsigned APP_COUNT = 1000;
+    const unsigned INSTALL_COUNT = 50;
+
+    Labels labels;
+    for (unsigned i = 0; i < APP_COUNT; ++i)
+        labels.push_back(label(i));
+
+    TempFile rewritten;
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned i = 0; i < INSTALL_COUNT; ++i) {
+        labels.push_back(label(APP_COUNT + i));
+        updatePermissibleFile(rewritten.path, labels);
+    }
+    auto end = std::chrono::steady_clock::now();
+    double rewriteMs = std::chrono::duration<double, std::milli>(end - start).count() / INSTALL_COUNT;
+    labels.resize(APP_COUNT);
+
+    TempFile appended;
+    updatePermissibleFile(appended.path, labels, {});
+    start = std::chrono::steady_clock::now();
+    for (unsigned i = 0; i < INSTALL_COUNT; ++i)
+        updatePermissibleFile(appended.path, {label(APP_COUNT + i)}, {});
+    end = std::chrono::steady_clock::now();
+    double appendMs = std::chrono::duration<double, std::milli>(end - start).count() / INSTALL_COUNT;
+
+    BOOST_REQUIRE(appended.read().size() == APP_COUNT + INSTALL_COUNT);
+    BOOST_TEST_MESSAGE("install with " << APP_COUNT << " apps: whole file rewrite " <<
+                       rewriteMs << " ms, append " << appendMs << " ms");
+}
+
+BOOST_AUTO_TEST_CASE(T1450_incremental_reader)
+{
+    TempFile file;
+    file.write("User::Pkg::a\nUser::Pkg::b\n");
+
+    PermissibleFileReader reader(file.path);
+    auto labels = [&]() {
+        Labels result;
+        reader.labels().getLabels(result);
+        std::sort(result.begin(), result.end());
+        return result;
+    };
+
+    BOOST_REQUIRE(reader.update());
+    BOOST_REQUIRE((labels() == Labels{"User::Pkg::a", "User::Pkg::b"}));
+    BOOST_REQUIRE(!reader.update());
+
+    updatePermissibleFile(file.path, {"User::Pkg::c"}, {"User::Pkg::a"});
+    BOOST_REQUIRE(reader.update());
+    BOOST_REQUIRE((labels() == Labels{"User::Pkg::b", "User::Pkg::c"}));
+
+    // records not changing the set
+    updatePermissibleFile(file.path, {"User::Pkg::c"}, {"User::Pkg::none"});
+    BOOST_REQUIRE(!reader.update());
+
+    // incomplete record is read when finished
+    file.append("User::Pkg::d");
+    BOOST_REQUIRE(!reader.update());
+    file.append("\n");
+    BOOST_REQUIRE(reader.update());
+    BOOST_REQUIRE((labels() == Labels{"User::Pkg::b", "User::Pkg::c", "User::Pkg::d"}));
+
+    // rewritten file
+    updatePermissibleFile(file.path, Labels{"User::Pkg::e"});
+    BOOST_REQUIRE(reader.update());
+    BOOST_REQUIRE((labels() == Labels{"User::Pkg::e"}));
+}
+
+BOOST_AUTO_TEST_CASE(T1460_monitor_app_install)
+{
+    /* Label monitor reacting to installation of an app, with permissible
+     * files on tmpfs as on target. The relabel list passed to the kernel
+     * is built in both cases, smack_set_relabel_self() itself isn't called */
+    const unsigned LABEL_COUNT = 5000;
+    const unsigned INSTALL_COUNT = 100;
+    const std::string dir = access("/dev/shm", W_OK) == 0 ? "/dev/shm" : "/tmp";
+
+    TempFile global(dir), user(dir);
+    Labels labels;
+    for (unsigned i = 0; i < LABEL_COUNT; ++i)
+        labels.push_back(label(i));
+    updatePermissibleFile(global.path, labels);
+    updatePermissibleFile(user.path, labels);
+
+    double fullUs = 0;
+    for (unsigned i = 0; i < INSTALL_COUNT; ++i) {
+        updatePermissibleFile(user.path, {label(LABEL_COUNT + i)}, {});
+        auto start = std::chrono::steady_clock::now();
+        Labels appLabels;
+        readLabelsFromPermissibleFile(global.path, appLabels);
+        readLabelsFromPermissibleFile(user.path, appLabels);
+        std::vector<const char *> relabel;
+        for (const auto &l : appLabels)
+            relabel.push_back(l.c_str());
+        auto end = std::chrono::steady_clock::now();
+        BOOST_REQUIRE(relabel.size() == 2 * LABEL_COUNT + i + 1);
+        fullUs += std::chrono::duration<double, std::micro>(end - start).count();
+    }
+
+    PermissibleFileReader globalReader(global.path), userReader(user.path);
+    BOOST_REQUIRE(globalReader.update());
+    BOOST_REQUIRE(userReader.update());
+    double incrementalUs = 0;
+    for (unsigned i = 0; i < INSTALL_COUNT; ++i) {
+        updatePermissibleFile(user.path, {label(2 * LABEL_COUNT + i)}, {});
+        auto start = std::chrono::steady_clock::now();
+        BOOST_REQUIRE(userReader.update());
+        std::vector<const char *> relabel;
+        globalReader.labels().getLabels(relabel);
+        userReader.labels().getLabels(relabel);
+        auto end = std::chrono::steady_clock::now();
+        BOOST_REQUIRE(relabel.size() == 2 * LABEL_COUNT + INSTALL_COUNT + i + 1);
+        incrementalUs += std::chrono::duration<double, std::micro>(end - start).count();
+    }
+
+    BOOST_TEST_MESSAGE("monitor update with " << LABEL_COUNT << " labels per file: full read " <<
+                       fullUs / INSTALL_COUNT << " us, incremental " <<
+                       incrementalUs / INSTALL_COUNT << " us");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,171 @@
+/*
+ *  Copyright (c) 2017 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License
+ */
+
+/**
+ * @file       test_privilege-type-cache.cpp
+ * @version    1.0
+ */
+
+#include <boost/test/unit_test.hpp>
+
+#include <chrono>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include <privilege-type-cache.h>
+
+using namespace SecurityManager;
+
+namespace {
+
+const int TYPE_NORMAL = 0;
+const int TYPE_PRIVACY = 1;
+const int TYPE_BLACKLIST = 2;
+
+/* Stand-in for privilege_info_get_privilege_type(), which parses the
+ * privilege database on every call */
+struct CountingResolver {
+    explicit CountingResolver(unsigned delayUs = 0) : calls(0), delayUs(delayUs) {}
+
+    int operator()(uid_t uid, const std::string &, const std::string &privilege)
+    {
+        ++calls;
+        if (delayUs)
+            std::this_thread::sleep_for(std::chrono::microseconds(delayUs));
+        if (privilege.empty())
+            throw std::runtime_error("unknown privilege");
+        if (uid == 0)
+            return TYPE_BLACKLIST;
+        return privilege.back() == 'p' ? TYPE_PRIVACY : TYPE_NORMAL;
+    }
+
+    unsigned calls;
+    unsigned delayUs;
+};
+
+std::string pkgName(unsigned i)
+{
+    return "pkg" + std::to_string(i);
+}
+
+std::string privName(unsigned i)
+{
+    return "http://tizen.org/privilege/priv" + std::to_string(i) + (i % 3 ? "" : "p");
+}
+
+} // namespace anonymous
+
+BOOST_AUTO_TEST_SUITE(PRIVILEGE_TYPE_CACHE_TEST)
+
+BOOST_AUTO_TEST_CASE(T1100_memoize_type)
+{
+    CountingResolver resolver;
+    PrivilegeTypeCache cache(std::ref(resolver));
+
+    BOOST_REQUIRE(cache.get(5001, "pkg", "privp") == TYPE_PRIVACY);
+    BOOST_REQUIRE(cache.get(5001, "pkg", "privp") == TYPE_PRIVACY);
+    BOOST_REQUIRE(resolver.calls == 1);
+
+    BOOST_REQUIRE(cache.get(0, "pkg", "privp") == TYPE_BLACKLIST);
+    BOOST_REQUIRE(cache.get(5001, "pkg2", "privp") == TYPE_PRIVACY);
+    BOOST_REQUIRE(resolver.calls == 3);
+    BOOST_REQUIRE(cache.size() == 3);
+}
+
+BOOST_AUTO_TEST_CASE(T1110_failed_lookup_not_cached)
+{
+    CountingResolver resolver;
+    PrivilegeTypeCache cache(std::ref(resolver));
+
+    BOOST_REQUIRE_THROW(cache.get(5001, "pkg", ""), std::runtime_error);
+    BOOST_REQUIRE_THROW(cache.get(5001, "pkg", ""), std::runtime_error);
+    BOOST_REQUIRE(resolver.calls == 2);
+    BOOST_REQUIRE(cache.size() == 0);
+}
+
+BOOST_AUTO_TEST_CASE(T1120_invalidate_package)
+{
+    CountingResolver resolver;
+    PrivilegeTypeCache cache(std::ref(resolver));
+
+    cache.get(5001, "pkg", "priv");
+    cache.get(5002, "pkg", "priv");
+    cache.get(5001, "pkg2", "priv");
+    BOOST_REQUIRE(cache.size() == 3);
+
+    cache.invalidate("pkg");
+    BOOST_REQUIRE(cache.size() == 1);
+    cache.get(5001, "pkg2", "priv");
+    BOOST_REQUIRE(resolver.calls == 3);
+    cache.get(5001, "pkg", "priv");
+    BOOST_REQUIRE(resolver.calls == 4);
+
+    cache.invalidate();
+    BOOST_REQUIRE(cache.size() == 0);
+    cache.get(5001, "pkg2", "priv");
+    BOOST_REQUIRE(resolver.calls == 5);
+}
+
+BOOST_AUTO_TEST_CASE(T1130_user_init_large_manifest_set)
+{
+    /* userInit() asks for PRIVACY and BLACKLIST of every privilege of every
+     * global app; the type should be resolved once for both attributes */
+    const unsigned PKG_COUNT = 200;
+    const unsigned PRIVILEGE_COUNT = 20;
+    const uid_t UID = 5001;
+    const unsigned RESOLVE_DELAY_US = 20;
+
+    auto runUserInit = [&](const std::function<int(const std::string&, const std::string&)> &getType) {
+        unsigned privacy = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (unsigned i = 0; i < PKG_COUNT; ++i)
+            for (unsigned j = 0; j < PRIVILEGE_COUNT; ++j) {
+                if (getType(pkgName(i), privName(j)) == TYPE_PRIVACY)
+                    ++privacy;
+                if (getType(pkgName(i), privName(j)) == TYPE_BLACKLIST)
+                    ++privacy;
+            }
+        auto end = std::chrono::steady_clock::now();
+        BOOST_REQUIRE(privacy == PKG_COUNT * ((PRIVILEGE_COUNT + 2) / 3));
+        return std::chrono::duration<double, std::milli>(end - start).count();
+    };
+
+    CountingResolver uncached(RESOLVE_DELAY_US);
+    double uncachedMs = runUserInit([&](const std::string &pkg, const std::string &priv) {
+        return uncached(UID, pkg, priv);
+    });
+    BOOST_REQUIRE(uncached.calls == 2 * PKG_COUNT * PRIVILEGE_COUNT);
+
+    CountingResolver resolver(RESOLVE_DELAY_US);
+    PrivilegeTypeCache cache(std::ref(resolver));
+    double firstMs = runUserInit([&](const std::string &pkg, const std::string &priv) {
+        return cache.get(UID, pkg, priv);
+    });
+    BOOST_REQUIRE(resolver.calls == PKG_COUNT * PRIVILEGE_COUNT);
+
+    double secondMs = runUserInit([&](const std::string &pkg, const std::string &priv) {
+        return cache.get(UID, pkg, priv);
+    });
+    BOOST_REQUIRE(resolver.calls == PKG_COUNT * PRIVILEGE_COUNT);
+
+    BOOST_TEST_MESSAGE("userInit type lookups for " << PKG_COUNT << " packages x " <<
+                       PRIVILEGE_COUNT << " privileges: uncached " << uncachedMs <<
+                       " ms, cold cache " << firstMs << " ms, warm cache " << secondMs << " ms");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
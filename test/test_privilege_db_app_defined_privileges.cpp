@@ -20,6 +20,9 @@
  * @version    1.0
  */
 
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
 #include <string>
 #include <vector>
 
@@ -37,6 +40,9 @@ struct AppDefinedPrivilegeFixture : public PrivilegeDBFixture {
     void checkClientLicense(const std::string &app, uid_t uid,
                             const std::vector<std::string> &privileges,
                             const std::vector<std::pair<bool, std::string>> &expected);
+    LicenseBundle checkLicenseBundle(uid_t uid, uid_t globalUid, const std::string &privilege,
+                                     const std::string &clientPkg, const std::string &clientApp,
+                                     bool expectedFound);
 };
 
 void AppDefinedPrivilegeFixture::checkAppDefinedPrivileges(const std::string &app, uid_t uid,
@@ -66,6 +72,77 @@ void AppDefinedPrivilegeFixture::checkClientLicense(const std::string &app, uid_
     }
 }
 
+const unsigned int BULK_PRIVILEGES_COUNT = 500;
+
+std::string bulkPrivilege(unsigned int i)
+{
+    char buf[8];
+    snprintf(buf, sizeof(buf), "%04u", i);
+    return std::string("org.tizen.bulk_app.privilege_") + buf;
+}
+
+std::string bulkLicense(unsigned int i)
+{
+    return "/opt/data/bulk_app/res/license_" + std::to_string(i);
+}
+
+/* Lookup done with separate queries, the way license requests were served before */
+bool referenceLicenseBundle(PrivilegeDb *db, uid_t uid, uid_t globalUid,
+                            const std::string &privilege, const std::string &clientPkg,
+                            const std::string &clientApp, LicenseBundle &bundle)
+{
+    bundle = LicenseBundle();
+    if (!db->GetAppPkgLicenseForAppDefinedPrivilege(uid, privilege, bundle.providerAppName,
+                                                    bundle.providerPkgName, bundle.providerLicense)) {
+        if (!db->GetAppPkgLicenseForAppDefinedPrivilege(globalUid, privilege, bundle.providerAppName,
+                                                        bundle.providerPkgName, bundle.providerLicense))
+            return false;
+        if (db->IsUserPkgInstalled(bundle.providerPkgName, uid))
+            return false;
+    }
+
+    bundle.clientHybrid = db->IsPackageHybrid(clientPkg);
+    uid_t requestUid = db->IsUserPkgInstalled(clientPkg, uid) ? uid : globalUid;
+    if (bundle.clientHybrid)
+        bundle.clientLicenseFound = db->GetLicenseForClientPrivilegeAndApp(clientApp, requestUid,
+                                                                           privilege, bundle.clientLicense);
+    else
+        bundle.clientLicenseFound = db->GetLicenseForClientPrivilegeAndPkg(clientPkg, requestUid,
+                                                                           privilege, bundle.clientLicense);
+    return true;
+}
+
+LicenseBundle AppDefinedPrivilegeFixture::checkLicenseBundle(uid_t uid, uid_t globalUid,
+                                                             const std::string &privilege,
+                                                             const std::string &clientPkg,
+                                                             const std::string &clientApp,
+                                                             bool expectedFound)
+{
+    LicenseBundle bundle, reference;
+    BOOST_REQUIRE(expectedFound == testPrivDb->GetLicenseBundle(uid, globalUid, privilege,
+                                                                clientPkg, clientApp, bundle));
+    BOOST_REQUIRE(expectedFound == referenceLicenseBundle(testPrivDb, uid, globalUid, privilege,
+                                                          clientPkg, clientApp, reference));
+    if (expectedFound) {
+        BOOST_REQUIRE(bundle.providerAppName == reference.providerAppName);
+        BOOST_REQUIRE(bundle.providerPkgName == reference.providerPkgName);
+        BOOST_REQUIRE(bundle.providerLicense == reference.providerLicense);
+        BOOST_REQUIRE(bundle.clientHybrid == reference.clientHybrid);
+        BOOST_REQUIRE(bundle.clientLicenseFound == reference.clientLicenseFound);
+        BOOST_REQUIRE(bundle.clientLicense == reference.clientLicense);
+    }
+    return bundle;
+}
+
+template <typename F>
+double measureMs(F &&func)
+{
+    auto start = std::chrono::steady_clock::now();
+    func();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
 } // anonymous namespace
 
 BOOST_FIXTURE_TEST_SUITE(PRIVILEGE_DB_TEST_APP_DEFINED_PRIVILEGES, AppDefinedPrivilegeFixture)
@@ -247,4 +324,195 @@ BOOST_AUTO_TEST_CASE(T1400_client_license)
                        {{false, ""}, {false, ""}});
 }
 
+BOOST_AUTO_TEST_CASE(T1500_app_defined_privileges_bulk)
+{
+    AppDefinedPrivilegesVector privileges;
+    for (unsigned int i = 0; i < BULK_PRIVILEGES_COUNT; ++i)
+        privileges.push_back(std::make_tuple(bulkPrivilege(i),
+                                             i % 2 ? SM_APP_DEFINED_PRIVILEGE_TYPE_LICENSED
+                                                   : SM_APP_DEFINED_PRIVILEGE_TYPE_UNTRUSTED,
+                                             i % 2 ? bulkLicense(i) : ""));
+
+    // add privileges to non-existing application
+    BOOST_REQUIRE_THROW(testPrivDb->AddAppDefinedPrivileges(app(1), uid(1), privileges),
+                        PrivilegeDb::Exception::ConstraintError);
+
+    addAppSuccess(app(1), pkg(1), uid(1), tizenVer(1), author(1), Hybrid);
+    addAppSuccess(app(2), pkg(2), uid(2), tizenVer(1), author(2), Hybrid);
+
+    // empty vector is a no-op
+    BOOST_REQUIRE_NO_THROW(testPrivDb->AddAppDefinedPrivileges(app(1), uid(1), {}));
+    checkAppDefinedPrivileges(app(1), uid(1), {});
+
+    // rows added one by one through the view
+    double singleMs = measureMs([&] {
+        testPrivDb->BeginTransaction();
+        for (const auto &privilege : privileges)
+            testPrivDb->AddAppDefinedPrivilege(app(1), uid(1), privilege);
+        testPrivDb->CommitTransaction();
+    });
+    AppDefinedPrivilegesVector singleResult;
+    testPrivDb->GetAppDefinedPrivileges(app(1), uid(1), singleResult);
+    BOOST_REQUIRE_NO_THROW(testPrivDb->RemoveAppDefinedPrivileges(app(1), uid(1)));
+
+    // same rows added in bulk
+    double bulkMs = measureMs([&] {
+        testPrivDb->BeginTransaction();
+        testPrivDb->AddAppDefinedPrivileges(app(1), uid(1), privileges);
+        testPrivDb->CommitTransaction();
+    });
+    checkAppDefinedPrivileges(app(1), uid(1), singleResult);
+
+    std::sort(singleResult.begin(), singleResult.end());
+    BOOST_REQUIRE(singleResult == privileges);
+
+    BOOST_TEST_MESSAGE("Adding " << BULK_PRIVILEGES_COUNT << " app defined privileges: " <<
+                       singleMs << " ms one by one, " << bulkMs << " ms in bulk");
+
+    // privilege already defined
+    BOOST_REQUIRE_THROW(testPrivDb->AddAppDefinedPrivileges(app(1), uid(1), {privileges[0]}),
+                        PrivilegeDb::Exception::ConstraintError);
+
+    // privileges already defined by first application
+    BOOST_REQUIRE_THROW(testPrivDb->AddAppDefinedPrivileges(app(2), uid(2), {privileges[1]}),
+                        PrivilegeDb::Exception::ConstraintError);
+    checkAppDefinedPrivileges(app(2), uid(2), {});
+
+    removeAppSuccess(app(1), uid(1));
+    removeAppSuccess(app(2), uid(2));
+}
+
+BOOST_AUTO_TEST_CASE(T1600_client_license_bulk)
+{
+    std::vector<std::pair<std::string, std::string>> privileges;
+    std::vector<std::string> names;
+    std::vector<std::pair<bool, std::string>> expected, notFound;
+    for (unsigned int i = 0; i < BULK_PRIVILEGES_COUNT; ++i) {
+        // every third privilege comes without license and should be skipped
+        std::string license = i % 3 ? bulkLicense(i) : "";
+        privileges.push_back(std::make_pair(bulkPrivilege(i), license));
+        names.push_back(bulkPrivilege(i));
+        expected.push_back(std::make_pair(!license.empty(), license));
+        notFound.push_back(std::make_pair(false, ""));
+    }
+
+    // add privileges/licenses to non-existing application
+    BOOST_REQUIRE_THROW(testPrivDb->AddClientPrivileges(app(1), uid(1), privileges),
+                        PrivilegeDb::Exception::ConstraintError);
+
+    addAppSuccess(app(1), pkg(1), uid(1), tizenVer(1), author(1), Hybrid);
+
+    // rows added one by one through the view
+    double singleMs = measureMs([&] {
+        testPrivDb->BeginTransaction();
+        for (const auto &privilege : privileges)
+            if (!privilege.second.empty())
+                testPrivDb->AddClientPrivilege(app(1), uid(1), privilege.first, privilege.second);
+        testPrivDb->CommitTransaction();
+    });
+    checkClientLicense(app(1), uid(1), names, expected);
+    BOOST_REQUIRE_NO_THROW(testPrivDb->RemoveClientPrivileges(app(1), uid(1)));
+    checkClientLicense(app(1), uid(1), names, notFound);
+
+    // same rows added in bulk
+    double bulkMs = measureMs([&] {
+        testPrivDb->BeginTransaction();
+        testPrivDb->AddClientPrivileges(app(1), uid(1), privileges);
+        testPrivDb->CommitTransaction();
+    });
+    checkClientLicense(app(1), uid(1), names, expected);
+
+    BOOST_TEST_MESSAGE("Adding " << BULK_PRIVILEGES_COUNT << " client licenses: " <<
+                       singleMs << " ms one by one, " << bulkMs << " ms in bulk");
+
+    // privilege license already defined
+    BOOST_REQUIRE_THROW(testPrivDb->AddClientPrivileges(app(1), uid(1), {privileges[1]}),
+                        PrivilegeDb::Exception::ConstraintError);
+
+    removeAppSuccess(app(1), uid(1));
+    checkClientLicense(app(1), uid(1), names, notFound);
+}
+
+BOOST_AUTO_TEST_CASE(T1700_license_bundle)
+{
+    const uid_t globalUid = uid(0);
+    const std::string privilege = "org.tizen.provider_app.sso";
+    const std::string providerLicense = "/opt/data/provider_app/res/license";
+    const std::string localProviderLicense = "/opt/data/provider_app/res/local_license";
+    const std::string clientLicense = "/opt/data/client_app/res/license";
+    const AppDefinedPrivilege definition(privilege, SM_APP_DEFINED_PRIVILEGE_TYPE_LICENSED,
+                                         providerLicense);
+    LicenseBundle bundle;
+
+    // no provider
+    checkLicenseBundle(uid(1), globalUid, privilege, pkg(2), "", false);
+
+    // global provider
+    addAppSuccess(app(1), pkg(1), globalUid, tizenVer(1), author(1), NotHybrid);
+    BOOST_REQUIRE_NO_THROW(testPrivDb->AddAppDefinedPrivilege(app(1), globalUid, definition));
+    bundle = checkLicenseBundle(uid(1), globalUid, privilege, pkg(2), "", true);
+    BOOST_REQUIRE(bundle.providerAppName == app(1));
+    BOOST_REQUIRE(bundle.providerPkgName == pkg(1));
+    BOOST_REQUIRE(bundle.providerLicense == providerLicense);
+    BOOST_REQUIRE(!bundle.clientLicenseFound);
+
+    // global non-hybrid client, license found by package
+    addAppSuccess(app(2), pkg(2), globalUid, tizenVer(1), author(2), NotHybrid);
+    BOOST_REQUIRE_NO_THROW(testPrivDb->AddClientPrivilege(app(2), globalUid, privilege, clientLicense));
+    bundle = checkLicenseBundle(uid(1), globalUid, privilege, pkg(2), "", true);
+    BOOST_REQUIRE(!bundle.clientHybrid);
+    BOOST_REQUIRE(bundle.clientLicenseFound);
+    BOOST_REQUIRE(bundle.clientLicense == clientLicense);
+
+    // client package installed for the user hides global one
+    addAppSuccess(app(2), pkg(2), uid(1), tizenVer(1), author(2), NotHybrid);
+    bundle = checkLicenseBundle(uid(1), globalUid, privilege, pkg(2), "", true);
+    BOOST_REQUIRE(!bundle.clientLicenseFound);
+    BOOST_REQUIRE_NO_THROW(testPrivDb->AddClientPrivilege(app(2), uid(1), privilege, clientLicense + "2"));
+    bundle = checkLicenseBundle(uid(1), globalUid, privilege, pkg(2), "", true);
+    BOOST_REQUIRE(bundle.clientLicense == clientLicense + "2");
+
+    // hybrid client, license found by application
+    addAppSuccess(app(3), pkg(3), uid(1), tizenVer(1), author(3), Hybrid);
+    addAppSuccess(app(4), pkg(3), uid(1), tizenVer(1), author(3), Hybrid);
+    BOOST_REQUIRE_NO_THROW(testPrivDb->AddClientPrivilege(app(3), uid(1), privilege, clientLicense + "3"));
+    bundle = checkLicenseBundle(uid(1), globalUid, privilege, pkg(3), app(3), true);
+    BOOST_REQUIRE(bundle.clientHybrid);
+    BOOST_REQUIRE(bundle.clientLicense == clientLicense + "3");
+    bundle = checkLicenseBundle(uid(1), globalUid, privilege, pkg(3), app(4), true);
+    BOOST_REQUIRE(!bundle.clientLicenseFound);
+    bundle = checkLicenseBundle(uid(1), globalUid, privilege, pkg(3), "", true);
+    BOOST_REQUIRE(bundle.clientHybrid && !bundle.clientLicenseFound);
+
+    // provider installed for the user takes precedence
+    addAppSuccess(app(1), pkg(1), uid(1), tizenVer(1), author(1), NotHybrid);
+    checkLicenseBundle(uid(1), globalUid, privilege, pkg(2), "", false);
+    BOOST_REQUIRE_NO_THROW(testPrivDb->AddAppDefinedPrivilege(app(1), uid(1),
+        AppDefinedPrivilege(privilege, SM_APP_DEFINED_PRIVILEGE_TYPE_LICENSED, localProviderLicense)));
+    bundle = checkLicenseBundle(uid(1), globalUid, privilege, pkg(2), "", true);
+    BOOST_REQUIRE(bundle.providerLicense == localProviderLicense);
+
+    // other users still see global provider, unless they install provider package
+    bundle = checkLicenseBundle(uid(2), globalUid, privilege, pkg(2), "", true);
+    BOOST_REQUIRE(bundle.providerLicense == providerLicense);
+    BOOST_REQUIRE(bundle.clientLicense == clientLicense);
+    addAppSuccess(app(1), pkg(1), uid(2), tizenVer(1), author(1), NotHybrid);
+    checkLicenseBundle(uid(2), globalUid, privilege, pkg(2), "", false);
+
+    // latency of one license lookup
+    const int ROUNDS = 2000;
+    bool found = true;
+    double referenceMs = measureMs([&] {
+        for (int i = 0; i < ROUNDS; ++i)
+            found &= referenceLicenseBundle(testPrivDb, uid(1), globalUid, privilege, pkg(3), app(3), bundle);
+    });
+    double bundleMs = measureMs([&] {
+        for (int i = 0; i < ROUNDS; ++i)
+            found &= testPrivDb->GetLicenseBundle(uid(1), globalUid, privilege, pkg(3), app(3), bundle);
+    });
+    BOOST_REQUIRE(found);
+    BOOST_TEST_MESSAGE("License lookup: " << referenceMs * 1000 / ROUNDS << " us with separate queries, " <<
+                       bundleMs * 1000 / ROUNDS << " us with one joined query");
+}
+
 BOOST_AUTO_TEST_SUITE_END()
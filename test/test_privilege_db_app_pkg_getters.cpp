@@ -395,4 +395,20 @@ BOOST_AUTO_TEST_CASE(T380_is_package_Hybrid)
     checkIsPackageHybrid(pkg(3), Hybrid);
 }
 
+BOOST_AUTO_TEST_CASE(T385_get_packages_info)
+{
+    addAppSuccess(app(1), pkg(1), uid(1), tizenVer(1), author(1), NotHybrid);
+    addAppSuccess(app(2), pkg(2), uid(1), tizenVer(1), author(2), Hybrid);
+    addAppSuccess(app(3), pkg(2), uid(2), tizenVer(1), author(2), Hybrid);
+
+    std::vector<PkgInfo> packages = {PkgInfo()};
+    BOOST_REQUIRE_NO_THROW(getPrivDb()->GetPackagesInfo(packages));
+    BOOST_REQUIRE(packages.size() == 2);
+    for (const auto &info : packages) {
+        BOOST_REQUIRE(info.name == pkg(1) || info.name == pkg(2));
+        BOOST_REQUIRE(!info.sharedRO);
+        BOOST_REQUIRE(info.hybrid == (info.name == pkg(2)));
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,209 @@
+/*
+ *  Copyright (c) 2017 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License
+ */
+
+/**
+ * @file       test_request-priority.cpp
+ * @version    1.0
+ * @brief      Priority classes of requests processed by service
+ */
+
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include <fair-queue.h>
+#include <message-buffer.h>
+#include <service-thread.h>
+
+using namespace SecurityManager;
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+enum Class {
+    LAUNCH,
+    NORMAL,
+    BULK,
+    CLASSES
+};
+
+struct CallEvent : public GenericEvent {
+    Class priority;
+    pid_t pid;
+    Clock::time_point posted;
+};
+
+/* Service with calls taking as long as installation and launch path calls do */
+class CallService : public ServiceThread<CallService> {
+public:
+    CallService(bool usePriority)
+      : m_usePriority(usePriority)
+      , m_served(0)
+    {}
+
+    DECLARE_THREAD_EVENT(CallEvent, call)
+
+    void call(const CallEvent &event) {
+        m_queue.Push(m_usePriority ? event.priority : NORMAL, event.pid, 1, event);
+    }
+
+    virtual bool ProcessPending() {
+        CallEvent event;
+        if (!m_queue.Pop(event))
+            return false;
+
+        if (event.priority == BULK) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        } else {
+            auto end = Clock::now() + std::chrono::microseconds(50);
+            while (Clock::now() < end);
+            m_latencies.push_back(std::chrono::duration<double, std::milli>(
+                Clock::now() - event.posted).count());
+        }
+        m_served.fetch_add(1, std::memory_order_release);
+        return true;
+    }
+
+    void waitFor(unsigned count) {
+        while (m_served.load(std::memory_order_acquire) < count)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    bool m_usePriority;
+    PriorityFairQueue<pid_t, CallEvent, CLASSES> m_queue;
+    std::vector<double> m_latencies;
+    std::atomic<unsigned> m_served;
+};
+
+void post(CallService &service, Class priority, pid_t pid)
+{
+    CallEvent event;
+    event.priority = priority;
+    event.pid = pid;
+    event.posted = Clock::now();
+    service.Event(event);
+}
+
+double percentile(std::vector<double> values, double p)
+{
+    std::sort(values.begin(), values.end());
+    return values[static_cast<size_t>(p * (values.size() - 1))];
+}
+
+/* Launch calls made every 5 ms while installer queues bulk calls */
+std::vector<double> launchLatencies(bool usePriority)
+{
+    const int INSTALLS = 10;
+    const int LAUNCHES = 30;
+
+    CallService service(usePriority);
+    service.StartThread();
+    for (int i = 0; i < INSTALLS; ++i)
+        post(service, BULK, 100);
+    for (int i = 0; i < LAUNCHES; ++i) {
+        post(service, LAUNCH, 200 + i);
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    service.waitFor(INSTALLS + LAUNCHES);
+    service.FinishThread();
+    return service.m_latencies;
+}
+
+} // namespace anonymous
+
+BOOST_AUTO_TEST_SUITE(REQUEST_PRIORITY_TEST)
+
+BOOST_AUTO_TEST_CASE(T2100_strict_priority)
+{
+    PriorityFairQueue<int, int, CLASSES> queue;
+    BOOST_REQUIRE(queue.Empty());
+
+    queue.Push(BULK, 1, 1, 10);
+    queue.Push(BULK, 1, 1, 11);
+    queue.Push(NORMAL, 2, 1, 20);
+    queue.Push(LAUNCH, 3, 1, 30);
+    queue.Push(LAUNCH, 4, 1, 40);
+    queue.Push(LAUNCH, 3, 1, 31);
+    BOOST_REQUIRE(queue.Size() == 6);
+    BOOST_REQUIRE(queue.Size(LAUNCH) == 3);
+
+    int item = 0;
+    BOOST_REQUIRE(queue.Pop(item) && item == 30);
+    BOOST_REQUIRE(queue.Pop(item) && item == 40);
+
+    // higher class coming later still goes first
+    queue.Push(LAUNCH, 5, 1, 50);
+    BOOST_REQUIRE(queue.Pop(item) && item == 31);
+    BOOST_REQUIRE(queue.Pop(item) && item == 50);
+    BOOST_REQUIRE(queue.Pop(item) && item == 20);
+    BOOST_REQUIRE(queue.Pop(item) && item == 10);
+    queue.Push(NORMAL, 2, 1, 21);
+    BOOST_REQUIRE(queue.Pop(item) && item == 21);
+    BOOST_REQUIRE(queue.Pop(item) && item == 11);
+    BOOST_REQUIRE(!queue.Pop(item));
+    BOOST_REQUIRE(queue.Empty());
+}
+
+BOOST_AUTO_TEST_CASE(T2110_peek_call_type)
+{
+    MessageBuffer request;
+    Serialization::Serialize(request, 17);
+    Serialization::Serialize(request, 42);
+    RawBuffer data = request.Pop();
+
+    MessageBuffer buffer;
+    int call = 0;
+    auto split = data.begin() + sizeof(size_t) + sizeof(call) - 1;
+    buffer.Push(RawBuffer(data.begin(), split));
+    BOOST_REQUIRE_THROW(buffer.Peek(sizeof(call), &call), MessageBuffer::Exception::OutOfData);
+
+    // call type may be known before the whole request is there
+    buffer.Push(RawBuffer(split, data.end() - 1));
+    BOOST_REQUIRE(!buffer.Ready());
+    buffer.Peek(sizeof(call), &call);
+    BOOST_REQUIRE(call == 17);
+
+    buffer.Push(RawBuffer(data.end() - 1, data.end()));
+    BOOST_REQUIRE(buffer.Ready());
+
+    // peeked data is still there
+    int value;
+    Deserialization::Deserialize(buffer, call);
+    Deserialization::Deserialize(buffer, value);
+    BOOST_REQUIRE(call == 17 && value == 42);
+}
+
+BOOST_AUTO_TEST_CASE(T2120_launch_latency_benchmark)
+{
+    std::vector<double> fifo = launchLatencies(false);
+    std::vector<double> priority = launchLatencies(true);
+
+    BOOST_TEST_MESSAGE("launch call latency while installations run, in ms: single queue p50 " <<
+                       percentile(fifo, 0.5) << " p99 " << percentile(fifo, 0.99) <<
+                       "; launch class first p50 " << percentile(priority, 0.5) <<
+                       " p99 " << percentile(priority, 0.99));
+
+    // launch call waits for at most one installation in progress
+    BOOST_REQUIRE(percentile(priority, 0.99) < 40);
+    BOOST_REQUIRE(percentile(priority, 0.5) < percentile(fifo, 0.5));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,296 @@
+/*
+ *  Copyright (c) 2017 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License
+ */
+
+/**
+ * @file       test_service-thread.cpp
+ * @version    1.0
+ * @brief      Event delivery to service threads
+ */
+
+#include <boost/test/unit_test.hpp>
+
+#include <pthread.h>
+#include <time.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <service-thread.h>
+
+using namespace SecurityManager;
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+std::atomic<int> g_liveEvents(0);
+
+struct TestEvent : public GenericEvent {
+    TestEvent(unsigned p = 0, unsigned s = 0)
+      : producer(p), seq(s), sent(Clock::now())
+    {
+        ++g_liveEvents;
+    }
+    TestEvent(const TestEvent &other)
+      : GenericEvent(), producer(other.producer), seq(other.seq), sent(other.sent)
+    {
+        ++g_liveEvents;
+    }
+    ~TestEvent() {
+        --g_liveEvents;
+    }
+
+    unsigned producer;
+    unsigned seq;
+    Clock::time_point sent;
+};
+
+class TestService : public ServiceThread<TestService> {
+public:
+    TestService(unsigned producers = 1)
+      : m_handled(0)
+      , m_nextSeq(producers, 0)
+      , m_ordered(true)
+      , m_open(true)
+    {}
+
+    DECLARE_THREAD_EVENT(TestEvent, handle)
+
+    void handle(const TestEvent &event) {
+        while (!m_open.load())
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        if (event.seq != m_nextSeq[event.producer]++)
+            m_ordered = false;
+        if (m_latencies.size() < m_latencies.capacity())
+            m_latencies.push_back(std::chrono::duration<double, std::micro>(
+                Clock::now() - event.sent).count());
+        m_handled.fetch_add(1, std::memory_order_release);
+    }
+
+    void waitFor(unsigned count) {
+        while (m_handled.load(std::memory_order_acquire) < count)
+            std::this_thread::yield();
+    }
+
+    std::atomic<unsigned> m_handled;
+    std::vector<unsigned> m_nextSeq;
+    bool m_ordered;
+    std::vector<double> m_latencies;
+    /* Events are handled only when open, as if the service was busy */
+    std::atomic<bool> m_open;
+};
+
+struct BufferEvent : public GenericEvent {
+    std::vector<char> data;
+};
+
+/* Takes data of events posted as rvalues over, copies the rest */
+class BufferService : public ServiceThread<BufferService> {
+public:
+    BufferService() : m_handled(0) {}
+
+    DECLARE_THREAD_EVENT(BufferEvent, take)
+
+    void Event(BufferEvent &&event) {
+        ServiceThread<BufferService>::Event(std::move(event), this, &BufferService::take);
+    }
+
+    void take(const BufferEvent &event) {
+        m_data.push_back(event.data.data());
+        m_handled.fetch_add(1, std::memory_order_release);
+    }
+
+    void take(BufferEvent &event) {
+        std::vector<char> data(std::move(event.data));
+        m_data.push_back(data.data());
+        m_handled.fetch_add(1, std::memory_order_release);
+    }
+
+    void waitFor(unsigned count) {
+        while (m_handled.load(std::memory_order_acquire) < count)
+            std::this_thread::yield();
+    }
+
+    std::atomic<unsigned> m_handled;
+    /* Addresses of the data handled */
+    std::vector<const char *> m_data;
+};
+
+double threadCpuMs(std::thread &thread)
+{
+    clockid_t clock;
+    struct timespec ts;
+    BOOST_REQUIRE(0 == pthread_getcpuclockid(thread.native_handle(), &clock));
+    BOOST_REQUIRE(0 == clock_gettime(clock, &ts));
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+double percentile(std::vector<double> values, double p)
+{
+    std::sort(values.begin(), values.end());
+    return values[static_cast<size_t>(p * (values.size() - 1))];
+}
+
+} // namespace anonymous
+
+BOOST_AUTO_TEST_SUITE(SERVICE_THREAD_TEST)
+
+BOOST_AUTO_TEST_CASE(T1800_events_in_order)
+{
+    const unsigned COUNT = 100000;
+    TestService service;
+    service.StartThread();
+    for (unsigned i = 0; i < COUNT; ++i)
+        service.Event(TestEvent(0, i));
+    service.waitFor(COUNT);
+    service.FinishThread();
+
+    BOOST_REQUIRE(service.m_handled == COUNT);
+    BOOST_REQUIRE(service.m_ordered);
+    BOOST_REQUIRE(g_liveEvents == 0);
+}
+
+BOOST_AUTO_TEST_CASE(T1810_multiple_producers)
+{
+    const unsigned PRODUCERS = 4;
+    const unsigned COUNT = 20000;
+    TestService service(PRODUCERS);
+    service.StartThread();
+
+    std::vector<std::thread> producers;
+    for (unsigned p = 0; p < PRODUCERS; ++p)
+        producers.emplace_back([&service, p] {
+            for (unsigned i = 0; i < COUNT; ++i)
+                service.Event(TestEvent(p, i));
+        });
+    for (auto &producer : producers)
+        producer.join();
+
+    service.waitFor(PRODUCERS * COUNT);
+    service.FinishThread();
+
+    BOOST_REQUIRE(service.m_handled == PRODUCERS * COUNT);
+    BOOST_REQUIRE(service.m_ordered);
+    BOOST_REQUIRE(g_liveEvents == 0);
+}
+
+BOOST_AUTO_TEST_CASE(T1820_finish_with_pending_events)
+{
+    {
+        TestService service;
+        // events queued before the thread runs are released by FinishThread
+        for (unsigned i = 0; i < 10; ++i)
+            service.Event(TestEvent(0, i));
+        service.FinishThread();
+        BOOST_REQUIRE(g_liveEvents == 0);
+
+        service.StartThread();
+        for (unsigned i = 0; i < 1000; ++i)
+            service.Event(TestEvent(0, i));
+        service.FinishThread();
+    }
+    BOOST_REQUIRE(g_liveEvents == 0);
+}
+
+BOOST_AUTO_TEST_CASE(T1825_full_queue)
+{
+    const unsigned COUNT = TestService::QUEUE_SIZE * 2;
+    TestService service;
+    service.m_open = false;
+    service.StartThread();
+
+    // producer fills the queue, then has to wait for the busy service
+    std::thread producer([&service] {
+        for (unsigned i = 0; i < COUNT; ++i)
+            service.Event(TestEvent(0, i));
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    double waitingCpuMs = threadCpuMs(producer);
+
+    service.m_open = true;
+    producer.join();
+    service.waitFor(COUNT);
+    service.FinishThread();
+
+    BOOST_REQUIRE(service.m_handled == COUNT);
+    BOOST_REQUIRE(service.m_ordered);
+    BOOST_REQUIRE(g_liveEvents == 0);
+    BOOST_TEST_MESSAGE("producer of full queue used " << waitingCpuMs << " ms of CPU in 200 ms");
+    BOOST_REQUIRE(waitingCpuMs < 50);
+}
+
+BOOST_AUTO_TEST_CASE(T1827_event_moved)
+{
+    BufferService service;
+    BufferEvent moved, copied;
+    moved.data.resize(4096);
+    copied.data.resize(4096);
+    const char *movedData = moved.data.data();
+    const char *copiedData = copied.data.data();
+
+    service.StartThread();
+    service.Event(std::move(moved));
+    service.Event(copied);
+    service.waitFor(2);
+    service.FinishThread();
+
+    // data of the moved event reaches the handler without a copy
+    BOOST_REQUIRE(service.m_data.size() == 2);
+    BOOST_REQUIRE(service.m_data[0] == movedData);
+    BOOST_REQUIRE(service.m_data[1] != copiedData);
+    BOOST_REQUIRE(copied.data.size() == 4096);
+}
+
+BOOST_AUTO_TEST_CASE(T1830_benchmark)
+{
+    const unsigned COUNT = 200000;
+    const unsigned PINGS = 5000;
+
+    // throughput, events queued back to back
+    TestService service;
+    service.m_latencies.reserve(COUNT);
+    service.StartThread();
+    auto start = Clock::now();
+    for (unsigned i = 0; i < COUNT; ++i)
+        service.Event(TestEvent(0, i));
+    service.waitFor(COUNT);
+    std::chrono::duration<double> elapsed = Clock::now() - start;
+    service.FinishThread();
+    double rate = COUNT / elapsed.count();
+    double burstP99 = percentile(service.m_latencies, 0.99);
+
+    // latency of single event delivered to idle thread
+    TestService idle;
+    idle.m_latencies.reserve(PINGS);
+    idle.StartThread();
+    for (unsigned i = 0; i < PINGS; ++i) {
+        idle.Event(TestEvent(0, i));
+        idle.waitFor(i + 1);
+    }
+    idle.FinishThread();
+
+    BOOST_REQUIRE(service.m_ordered && idle.m_ordered);
+    BOOST_TEST_MESSAGE("service thread: " << rate << " events/s, p99 enqueue to dispatch " <<
+                       burstP99 << " us in burst, idle thread p50 " <<
+                       percentile(idle.m_latencies, 0.5) << " us p99 " <<
+                       percentile(idle.m_latencies, 0.99) << " us");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,228 @@
+/*
+ *  Copyright (c) 2017 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License
+ */
+
+/**
+ * @file       test_socket-manager.cpp
+ * @version    1.0
+ * @brief      Main loop of the daemon serving clients over a real socket
+ */
+
+#include <boost/test/unit_test.hpp>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <message-buffer.h>
+#include <socket-manager.h>
+
+using namespace SecurityManager;
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+/* Connections of system uids are not limited, clients run as this user */
+const uid_t APP_USER = 5001;
+
+/* Sends every request straight back */
+class EchoService : public GenericSocketService {
+public:
+    explicit EchoService(const std::string &path) : m_path(path) {}
+
+    ServiceDescriptionVector GetServiceDescription() {
+        return ServiceDescriptionVector{ServiceDescription(m_path.c_str(), "*")};
+    }
+
+    void Event(const AcceptEvent &) {}
+    void Event(const WriteEvent &) {}
+    void Event(const CloseEvent &) {}
+
+    void Event(const ReadEvent &event) {
+        m_serviceManager->Write(event.connectionID, event.rawBuffer);
+    }
+
+private:
+    std::string m_path;
+};
+
+/* SocketManager running its main loop in a thread of its own */
+class Server {
+public:
+    Server() : m_path("/tmp/sm-socket-manager-test-" + std::to_string(getpid()))
+    {
+        m_manager.RegisterSocketService(new EchoService(m_path));
+        m_thread = std::thread([this] { m_manager.MainLoop(); });
+    }
+
+    ~Server()
+    {
+        m_manager.MainLoopStop();
+        m_thread.join();
+        unlink(m_path.c_str());
+    }
+
+    const std::string &path() const { return m_path; }
+
+private:
+    std::string m_path;
+    SocketManager m_manager;
+    std::thread m_thread;
+};
+
+class Client {
+public:
+    explicit Client(const std::string &path)
+    {
+        m_sock = socket(AF_UNIX, SOCK_STREAM, 0);
+        BOOST_REQUIRE(m_sock >= 0);
+
+        sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+        BOOST_REQUIRE(0 == connect(m_sock, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)));
+    }
+
+    ~Client()
+    {
+        close(m_sock);
+    }
+
+    /* Send a request and wait at most timeoutMs for it to come back */
+    bool call(const RawBuffer &request, int timeoutMs)
+    {
+        if (send(m_sock, request.data(), request.size(), MSG_NOSIGNAL) !=
+            static_cast<ssize_t>(request.size()))
+            return false;
+
+        RawBuffer reply(request.size());
+        size_t received = 0;
+        auto deadline = Clock::now() + std::chrono::milliseconds(timeoutMs);
+        while (received < reply.size()) {
+            auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+                deadline - Clock::now()).count();
+            struct pollfd pfd = {m_sock, POLLIN, 0};
+            if (left <= 0 || poll(&pfd, 1, left) <= 0)
+                return false;
+            ssize_t size = recv(m_sock, &reply[received], reply.size() - received, 0);
+            if (size <= 0)
+                return false;
+            received += size;
+        }
+        return reply == request;
+    }
+
+private:
+    int m_sock;
+};
+
+/* Run the client side as an application user, in a process of its own if
+ * the test runs as root */
+bool asAppUser(const std::function<bool()> &clientSide)
+{
+    if (getuid() != 0)
+        return clientSide();
+
+    pid_t pid = fork();
+    BOOST_REQUIRE(pid >= 0);
+    if (pid == 0) {
+        bool ok = false;
+        try {
+            ok = 0 == setresgid(APP_USER, APP_USER, APP_USER) &&
+                 0 == setresuid(APP_USER, APP_USER, APP_USER) &&
+                 clientSide();
+        } catch (...) {}
+        _exit(ok ? 0 : 1);
+    }
+
+    int status;
+    BOOST_REQUIRE(pid == waitpid(pid, &status, 0));
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+RawBuffer pingRequest()
+{
+    MessageBuffer buffer;
+    Serialization::Serialize(buffer, std::string("ping"));
+    return buffer.Pop();
+}
+
+} // namespace anonymous
+
+BOOST_AUTO_TEST_SUITE(SOCKET_MANAGER_TEST)
+
+BOOST_AUTO_TEST_CASE(T2900_deferred_read_resumed)
+{
+    /* A process gets a burst of 400 reads, then 200 per second. Requests past
+     * the burst have their reads deferred and must still be served once the
+     * peer gets tokens back, without waiting for unrelated traffic */
+    const unsigned REQUESTS = 500;
+
+    Server server;
+    RawBuffer request = pingRequest();
+
+    auto start = Clock::now();
+    BOOST_REQUIRE(asAppUser([&] {
+        Client client(server.path());
+        for (unsigned i = 0; i < REQUESTS; ++i)
+            if (!client.call(request, 2000))
+                return false;
+        return true;
+    }));
+    auto elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+        Clock::now() - start).count();
+
+    BOOST_TEST_MESSAGE(REQUESTS << " requests served in " << elapsedMs << " ms");
+}
+
+BOOST_AUTO_TEST_CASE(T2910_deferred_accept_served)
+{
+    /* A process gets a burst of 200 connections, then 100 per second.
+     * Connections past the burst wait to be accepted by the service and are
+     * served then, instead of being closed */
+    const unsigned CONNECTIONS = 300;
+
+    Server server;
+    RawBuffer request = pingRequest();
+
+    auto start = Clock::now();
+    BOOST_REQUIRE(asAppUser([&] {
+        std::vector<std::unique_ptr<Client>> clients;
+        for (unsigned i = 0; i < CONNECTIONS; ++i)
+            clients.emplace_back(new Client(server.path()));
+        for (auto &client : clients)
+            if (!client->call(request, 3000))
+                return false;
+        return true;
+    }));
+    auto elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+        Clock::now() - start).count();
+
+    BOOST_TEST_MESSAGE(CONNECTIONS << " connections served in " << elapsedMs << " ms");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,168 @@
+/*
+ *  Copyright (c) 2017 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License
+ */
+
+/**
+ * @file       test_thread-sync.cpp
+ * @version    1.0
+ * @brief      Work run on all threads of the process, as done on app launch
+ */
+
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <security-manager-types.h>
+#include <thread-sync.h>
+
+using namespace SecurityManager;
+
+namespace {
+
+/* Keeps a number of threads alive, optionally blocking SIGSETXID in them */
+class Threads {
+public:
+    Threads(unsigned count, bool blockSetxid = false) : m_started(0), m_stop(false)
+    {
+        for (unsigned i = 0; i < count; ++i)
+            m_threads.emplace_back([this, blockSetxid] {
+                if (blockSetxid) {
+                    /* raw syscall, libc refuses to block its internal signals */
+                    unsigned long mask = 1UL << (SIGSETXID - 1);
+                    syscall(SYS_rt_sigprocmask, SIG_BLOCK, &mask, nullptr, sizeof(mask));
+                }
+                std::unique_lock<std::mutex> lock(m_mutex);
+                ++m_started;
+                m_cv.notify_all();
+                m_cv.wait(lock, [this] { return m_stop; });
+            });
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_cv.wait(lock, [this, count] { return m_started == count; });
+    }
+
+    ~Threads()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_cv.notify_all();
+        for (auto &thread : m_threads)
+            thread.join();
+    }
+
+private:
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    unsigned m_started;
+    bool m_stop;
+    std::vector<std::thread> m_threads;
+};
+
+std::atomic<int> g_runs;
+
+bool countRun(int attrFd)
+{
+    ++g_runs;
+    return attrFd == -1;
+}
+
+bool failRun(int)
+{
+    return false;
+}
+
+} // namespace anonymous
+
+BOOST_AUTO_TEST_SUITE(THREAD_SYNC_TEST)
+
+BOOST_AUTO_TEST_CASE(T2700_all_threads_run)
+{
+    for (unsigned count : {0, 1, 16}) {
+        Threads threads(count);
+        g_runs = 0;
+        BOOST_REQUIRE(ThreadSync::runOnOtherThreads(countRun, false, 1000) ==
+                      SECURITY_MANAGER_SUCCESS);
+        BOOST_REQUIRE_MESSAGE(g_runs >= static_cast<int>(count), "Threads: " << count);
+    }
+
+    Threads threads(4);
+    BOOST_REQUIRE(ThreadSync::runOnOtherThreads(failRun, false, 1000) ==
+                  SECURITY_MANAGER_ERROR_UNKNOWN);
+    BOOST_REQUIRE(!ThreadSync::poisoned());
+}
+
+BOOST_AUTO_TEST_CASE(T2710_poisoned_after_timeout)
+{
+    // poisoning is for good, so it is done in a child process
+    pid_t pid = fork();
+    BOOST_REQUIRE(pid >= 0);
+    if (pid == 0) {
+        int status = 0;
+        {
+            Threads threads(1, true);
+            if (ThreadSync::runOnOtherThreads(countRun, false, 50) == SECURITY_MANAGER_SUCCESS)
+                status |= 1;
+            if (!ThreadSync::poisoned())
+                status |= 2;
+        }
+        // nothing left to wait for, still refused
+        if (ThreadSync::runOnOtherThreads(countRun, false, 50) == SECURITY_MANAGER_SUCCESS)
+            status |= 4;
+        _exit(status);
+    }
+
+    int status;
+    BOOST_REQUIRE(waitpid(pid, &status, 0) == pid);
+    BOOST_REQUIRE(WIFEXITED(status));
+    BOOST_REQUIRE_MESSAGE(WEXITSTATUS(status) == 0, "Failed checks: " << WEXITSTATUS(status));
+}
+
+BOOST_AUTO_TEST_CASE(T2720_benchmark)
+{
+    const int ROUNDS = 20;
+
+    for (unsigned count : {1, 16, 128}) {
+        Threads threads(count);
+        std::vector<double> times;
+        for (int i = 0; i < ROUNDS; ++i) {
+            auto start = std::chrono::steady_clock::now();
+            BOOST_REQUIRE(ThreadSync::runOnOtherThreads(countRun, false, 1000) ==
+                          SECURITY_MANAGER_SUCCESS);
+            times.push_back(std::chrono::duration<double, std::micro>(
+                std::chrono::steady_clock::now() - start).count());
+        }
+        std::sort(times.begin(), times.end());
+
+        BOOST_TEST_MESSAGE("sync of " << count << " threads, in us: min " << times.front() <<
+                           ", median " << times[ROUNDS / 2] << ", max " << times.back());
+        // waiting used to be polled every 1 ms
+        if (count == 1)
+            BOOST_REQUIRE(times.front() < 1000);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
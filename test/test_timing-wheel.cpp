@@ -0,0 +1,259 @@
+/*
+ *  Copyright (c) 2017 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License
+ */
+
+/**
+ * @file       test_timing-wheel.cpp
+ * @version    1.0
+ * @brief      Socket timeouts kept in timing wheel
+ */
+
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <queue>
+#include <random>
+#include <vector>
+
+#include <timing-wheel.h>
+
+using namespace SecurityManager;
+
+namespace {
+
+const time_t START = 1500000000;
+const time_t SOCKET_TIMEOUT = 300;
+
+typedef std::map<int, time_t> Deadlines;
+
+time_t earliest(const Deadlines &deadlines)
+{
+    time_t result = TimingWheel::NEVER;
+    for (const auto &d : deadlines)
+        result = std::min(result, d.second);
+    return result;
+}
+
+/* Move to now the way socket manager does, checking what expires against deadlines */
+void expireAndCheck(TimingWheel &wheel, Deadlines &deadlines, time_t now)
+{
+    std::vector<int> expired;
+    wheel.Expire(now, expired);
+    std::sort(expired.begin(), expired.end());
+
+    std::vector<int> due;
+    for (auto it = deadlines.begin(); it != deadlines.end();) {
+        if (it->second <= now) {
+            due.push_back(it->first);
+            it = deadlines.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    BOOST_REQUIRE(expired == due);
+    BOOST_REQUIRE(wheel.Size() == deadlines.size());
+    BOOST_REQUIRE(wheel.NextExpiry() <= earliest(deadlines));
+    BOOST_REQUIRE(wheel.NextExpiry() > now);
+}
+
+} // namespace anonymous
+
+BOOST_AUTO_TEST_SUITE(TIMING_WHEEL_TEST)
+
+BOOST_AUTO_TEST_CASE(T1900_timeouts_fire_on_time)
+{
+    // deadlines around slot and level boundaries, up to beyond the wheel range
+    const time_t delays[] = {0, 1, 2, 63, 64, 65, 127, 128, 300, 4095, 4096, 4097,
+                             262143, 262144, 262145, 16777215, 16777216, 40000000};
+    const int COUNT = sizeof(delays) / sizeof(delays[0]);
+
+    for (time_t offset : {static_cast<time_t>(0), static_cast<time_t>(1), static_cast<time_t>(37)}) {
+        TimingWheel wheel(START + offset);
+        Deadlines deadlines;
+        for (int id = 0; id < COUNT; ++id) {
+            wheel.Set(id, START + offset + delays[id]);
+            deadlines[id] = START + offset + delays[id];
+        }
+        BOOST_REQUIRE(wheel.Size() == COUNT);
+
+        // sleep until next expiry, as select in socket manager does
+        time_t now = START + offset;
+        int wakeups = 0;
+        while (!deadlines.empty()) {
+            expireAndCheck(wheel, deadlines, now);
+            now = std::min(wheel.NextExpiry(), TimingWheel::NEVER - 1);
+            ++wakeups;
+        }
+        BOOST_REQUIRE(wheel.Size() == 0);
+        BOOST_REQUIRE(wheel.NextExpiry() == TimingWheel::NEVER);
+        BOOST_REQUIRE(wakeups < 2 * COUNT + 4 * 64);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(T1910_refresh_and_remove)
+{
+    TimingWheel wheel(START);
+    std::vector<int> expired;
+
+    wheel.Set(5, START + SOCKET_TIMEOUT);
+    wheel.Set(7, START + SOCKET_TIMEOUT);
+    wheel.Set(9, START + SOCKET_TIMEOUT);
+    BOOST_REQUIRE(wheel.IsSet(5) && wheel.IsSet(7) && wheel.IsSet(9));
+    BOOST_REQUIRE(!wheel.IsSet(6) && !wheel.IsSet(1000));
+
+    // activity on socket moves its timeout, closing the socket drops it
+    wheel.Set(7, START + 100 + SOCKET_TIMEOUT);
+    wheel.Remove(9);
+    wheel.Remove(9);
+    wheel.Remove(1000);
+    BOOST_REQUIRE(wheel.Size() == 2);
+
+    wheel.Expire(START + SOCKET_TIMEOUT - 1, expired);
+    BOOST_REQUIRE(expired.empty());
+    wheel.Expire(START + SOCKET_TIMEOUT, expired);
+    BOOST_REQUIRE(expired == std::vector<int>{5});
+    BOOST_REQUIRE(!wheel.IsSet(5));
+
+    expired.clear();
+    wheel.Expire(START + 100 + SOCKET_TIMEOUT - 1, expired);
+    BOOST_REQUIRE(expired.empty());
+    BOOST_REQUIRE(wheel.NextExpiry() <= START + 100 + SOCKET_TIMEOUT);
+
+    // deadline already passed fires right away
+    wheel.Set(3, START);
+    BOOST_REQUIRE(wheel.NextExpiry() == START + 100 + SOCKET_TIMEOUT - 1);
+    wheel.Expire(START + 100 + SOCKET_TIMEOUT, expired);
+    std::sort(expired.begin(), expired.end());
+    BOOST_REQUIRE((expired == std::vector<int>{3, 7}));
+    BOOST_REQUIRE(wheel.Size() == 0);
+}
+
+BOOST_AUTO_TEST_CASE(T1920_random_against_reference)
+{
+    std::mt19937 gen(1920);
+    std::uniform_int_distribution<int> pickId(0, 199);
+    std::uniform_int_distribution<int> pickAction(0, 9);
+    std::uniform_int_distribution<time_t> pickDelay(0, 20000);
+    std::uniform_int_distribution<time_t> pickStep(0, 700);
+
+    TimingWheel wheel(START);
+    Deadlines deadlines;
+    time_t now = START;
+
+    for (int i = 0; i < 200000; ++i) {
+        int id = pickId(gen);
+        switch (pickAction(gen)) {
+        case 0:
+            wheel.Remove(id);
+            deadlines.erase(id);
+            break;
+        case 1:
+            now += pickStep(gen);
+            expireAndCheck(wheel, deadlines, now);
+            break;
+        case 2:
+            now = std::max(now, std::min(wheel.NextExpiry(), now + 1000));
+            expireAndCheck(wheel, deadlines, now);
+            break;
+        default: {
+            // mostly socket timeouts, sometimes spanning coarser levels
+            time_t deadline = now + pickDelay(gen) % (i % 3 ? SOCKET_TIMEOUT + 1 : 20001);
+            wheel.Set(id, deadline);
+            deadlines[id] = deadline;
+            break;
+        }
+        }
+        BOOST_REQUIRE(wheel.Size() == deadlines.size());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(T1930_churn_benchmark)
+{
+    // short connections served side by side, each open, some reads and writes, close
+    const int CONNECTIONS = 10000;
+    const int CONCURRENT = 64;
+    const int ACTIVITIES = 4;
+    const int STEPS = CONNECTIONS * (ACTIVITIES + 1);
+    const int STEPS_PER_SECOND = 250;
+    const int FIRST_SOCK = 10;
+
+    typedef std::chrono::steady_clock Clock;
+    std::vector<int> expired;
+    std::vector<int> activity(FIRST_SOCK + CONCURRENT, 0);
+
+    // timeouts in heap, entry pushed on every activity and stale ones skipped lazily
+    struct Entry {
+        time_t time;
+        int sock;
+        bool operator<(const Entry &second) const { return time > second.time; }
+    };
+    std::priority_queue<Entry> heap;
+    std::vector<time_t> timeout(FIRST_SOCK + CONCURRENT, 0);
+    size_t heapPeak = 0;
+
+    auto start = Clock::now();
+    for (int step = 0; step < STEPS; ++step) {
+        time_t now = START + step / STEPS_PER_SECOND;
+        int sock = FIRST_SOCK + step % CONCURRENT;
+        if (activity[sock]++ < ACTIVITIES) {
+            timeout[sock] = now + SOCKET_TIMEOUT;
+            heap.push(Entry{timeout[sock], sock});
+        } else {
+            timeout[sock] = 0;
+            activity[sock] = 0;
+        }
+        while (!heap.empty() && heap.top().time != timeout[heap.top().sock])
+            heap.pop();
+        heapPeak = std::max(heapPeak, heap.size());
+    }
+    std::chrono::duration<double> heapTime = Clock::now() - start;
+
+    TimingWheel wheel(START);
+    size_t wheelPeak = 0;
+    time_t next = 0;
+    std::fill(activity.begin(), activity.end(), 0);
+
+    start = Clock::now();
+    for (int step = 0; step < STEPS; ++step) {
+        time_t now = START + step / STEPS_PER_SECOND;
+        int sock = FIRST_SOCK + step % CONCURRENT;
+        if (activity[sock]++ < ACTIVITIES) {
+            wheel.Set(sock, now + SOCKET_TIMEOUT);
+        } else {
+            wheel.Remove(sock);
+            activity[sock] = 0;
+        }
+        wheel.Expire(now, expired);
+        next = wheel.NextExpiry();
+        wheelPeak = std::max(wheelPeak, wheel.Size());
+    }
+    std::chrono::duration<double> wheelTime = Clock::now() - start;
+
+    BOOST_REQUIRE(expired.empty());
+    BOOST_REQUIRE(next > START + (STEPS - 1) / STEPS_PER_SECOND);
+    BOOST_REQUIRE(next <= START + (STEPS - 1) / STEPS_PER_SECOND + SOCKET_TIMEOUT);
+    BOOST_REQUIRE(wheelPeak <= static_cast<size_t>(CONCURRENT));
+    BOOST_TEST_MESSAGE("socket timeouts, " << CONNECTIONS << " connections, " <<
+                       CONCURRENT << " at once: heap " <<
+                       heapTime.count() * 1e9 / STEPS << " ns per activity, " <<
+                       heapPeak << " entries at peak; timing wheel " <<
+                       wheelTime.count() * 1e9 / STEPS << " ns per activity, " <<
+                       wheelPeak << " timers at peak");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,195 @@
+/*
+ *  Copyright (c) 2017 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License
+ */
+
+/**
+ * @file       test_user-groups-cache.cpp
+ * @version    1.0
+ */
+
+#include <boost/test/unit_test.hpp>
+
+#include <fcntl.h>
+#include <grp.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <user-groups-cache.h>
+
+using namespace SecurityManager;
+
+namespace {
+
+struct TempDir {
+    TempDir()
+    {
+        char tmpl[] = "/tmp/sm-groups-XXXXXX";
+        BOOST_REQUIRE(mkdtemp(tmpl) != nullptr);
+        path = tmpl;
+    }
+
+    ~TempDir()
+    {
+        UserGroupsCache(path).clear();
+        rmdir(path.c_str());
+    }
+
+    std::string path;
+};
+
+const uid_t UID = 5001;
+
+} // namespace anonymous
+
+BOOST_AUTO_TEST_SUITE(USER_GROUPS_CACHE_TEST)
+
+BOOST_AUTO_TEST_CASE(T1300_store_load)
+{
+    TempDir dir;
+    UserGroupsCache cache(dir.path);
+    const std::vector<gid_t> gids = {100, 200, 5000};
+
+    bool managed = false;
+    std::vector<gid_t> result;
+    BOOST_REQUIRE(!cache.load(UID, managed, result));
+
+    BOOST_REQUIRE(cache.store(UID, true, gids));
+    BOOST_REQUIRE(cache.load(UID, managed, result));
+    BOOST_REQUIRE(managed);
+    BOOST_REQUIRE(result == gids);
+
+    BOOST_REQUIRE(cache.store(UID, false, gids));
+    BOOST_REQUIRE(cache.load(UID, managed, result));
+    BOOST_REQUIRE(!managed);
+    BOOST_REQUIRE(result == gids);
+
+    BOOST_REQUIRE(cache.store(UID, true, {}));
+    BOOST_REQUIRE(cache.load(UID, managed, result));
+    BOOST_REQUIRE(managed);
+    BOOST_REQUIRE(result.empty());
+}
+
+BOOST_AUTO_TEST_CASE(T1310_remove_clear)
+{
+    TempDir dir;
+    UserGroupsCache cache(dir.path);
+    bool managed;
+    std::vector<gid_t> result;
+
+    BOOST_REQUIRE(cache.store(UID, true, {100}));
+    BOOST_REQUIRE(cache.store(UID + 1, true, {200}));
+
+    cache.remove(UID);
+    BOOST_REQUIRE(!cache.load(UID, managed, result));
+    BOOST_REQUIRE(cache.load(UID + 1, managed, result));
+
+    cache.remove(UID);
+    cache.clear();
+    BOOST_REQUIRE(!cache.load(UID + 1, managed, result));
+
+    // directory missing altogether
+    UserGroupsCache(dir.path + "/none").clear();
+    BOOST_REQUIRE(!UserGroupsCache(dir.path + "/none").load(UID, managed, result));
+}
+
+BOOST_AUTO_TEST_CASE(T1320_corrupted_file)
+{
+    TempDir dir;
+    UserGroupsCache cache(dir.path);
+    bool managed;
+    std::vector<gid_t> result;
+
+    BOOST_REQUIRE(cache.store(UID, true, {100, 200}));
+    std::string path = dir.path + "/" + std::to_string(UID);
+
+    // truncated list of groups
+    BOOST_REQUIRE(truncate(path.c_str(), 20) == 0);
+    BOOST_REQUIRE(!cache.load(UID, managed, result));
+
+    // shorter than header
+    BOOST_REQUIRE(truncate(path.c_str(), 4) == 0);
+    BOOST_REQUIRE(!cache.load(UID, managed, result));
+
+    // garbage
+    int fd = open(path.c_str(), O_WRONLY | O_TRUNC);
+    BOOST_REQUIRE(fd >= 0);
+    const char garbage[] = "0123456789abcdef";
+    BOOST_REQUIRE(write(fd, garbage, 16) == 16);
+    close(fd);
+    BOOST_REQUIRE(!cache.load(UID, managed, result));
+}
+
+BOOST_AUTO_TEST_CASE(T1330_login_storm)
+{
+    /* Many sessions starting at once, each calling initgroups(). Previously
+     * every call went to the service and resolved each group name with
+     * getgrnam_r(); name resolution alone is used as a baseline here, as the
+     * service isn't available in this test */
+    const unsigned THREADS = 16;
+    const unsigned LOGINS_PER_THREAD = 500;
+    const unsigned GROUP_COUNT = 8;
+
+    TempDir dir;
+    UserGroupsCache cache(dir.path);
+    for (unsigned i = 0; i < THREADS; ++i)
+        BOOST_REQUIRE(cache.store(UID + i, true, std::vector<gid_t>(GROUP_COUNT, 0)));
+
+    auto storm = [&](const std::function<bool(unsigned)> &login) {
+        std::atomic<unsigned> failures(0);
+        std::vector<std::thread> threads;
+        auto start = std::chrono::steady_clock::now();
+        for (unsigned t = 0; t < THREADS; ++t)
+            threads.emplace_back([&, t]() {
+                for (unsigned i = 0; i < LOGINS_PER_THREAD; ++i)
+                    if (!login(t))
+                        ++failures;
+            });
+        for (auto &thread : threads)
+            thread.join();
+        auto end = std::chrono::steady_clock::now();
+        BOOST_REQUIRE(failures == 0);
+        return std::chrono::duration<double, std::micro>(end - start).count() /
+               (THREADS * LOGINS_PER_THREAD);
+    };
+
+    double resolveUs = storm([&](unsigned) {
+        std::vector<char> buffer(4096);
+        for (unsigned i = 0; i < GROUP_COUNT; ++i) {
+            struct group grpBuff, *grp = nullptr;
+            if (getgrnam_r("root", &grpBuff, buffer.data(), buffer.size(), &grp) != 0 || !grp)
+                return false;
+        }
+        return true;
+    });
+
+    double cachedUs = storm([&](unsigned t) {
+        bool managed;
+        std::vector<gid_t> gids;
+        return cache.load(UID + t, managed, gids) && gids.size() == GROUP_COUNT;
+    });
+
+    BOOST_TEST_MESSAGE("login storm, " << THREADS << " threads, " << GROUP_COUNT <<
+                       " groups: group name resolution " << resolveUs <<
+                       " us/login, cache file " << cachedUs << " us/login");
+}
+
+BOOST_AUTO_TEST_SUITE_END()